@@ -0,0 +1,73 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace mv {
+namespace bench {
+
+// rolling hills with a dirt/grass surface and a few random caves
+inline Chunk makeTerrainChunk(std::uint32_t seed) {
+  Chunk chunk;
+  std::mt19937 rng{seed};
+  float phaseX = static_cast<float>(rng() % 628) / 100.0f;
+  float phaseZ = static_cast<float>(rng() % 628) / 100.0f;
+
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int z = 0; z < Chunk::SIZE; z++) {
+      auto height = static_cast<int>(
+          16.0f + 6.0f * std::sin(x * 0.2f + phaseX) +
+          5.0f * std::cos(z * 0.15f + phaseZ));
+      for (int y = 0; y < height; y++) {
+        chunk.set(x, y, z, y + 3 < height ? block::STONE : block::DIRT);
+      }
+      chunk.set(x, height, z, block::GRASS);
+    }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    int cx = rng() % Chunk::SIZE, cy = rng() % 12, cz = rng() % Chunk::SIZE;
+    for (int x = cx - 3; x <= cx + 3; x++) {
+      for (int y = cy - 2; y <= cy + 2; y++) {
+        for (int z = cz - 3; z <= cz + 3; z++) {
+          if (x >= 0 && x < Chunk::SIZE && y >= 0 && z >= 0 &&
+              z < Chunk::SIZE) {
+            chunk.set(x, y, z, block::AIR);
+          }
+        }
+      }
+    }
+  }
+  return chunk;
+}
+
+// worst case for meshers: every other block set, nothing can merge
+inline Chunk makeCheckerChunk() {
+  Chunk chunk;
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int y = 0; y < Chunk::SIZE; y++) {
+      for (int z = 0; z < Chunk::SIZE; z++) {
+        if ((x + y + z) % 2 == 0) {
+          chunk.set(x, y, z, block::STONE);
+        }
+      }
+    }
+  }
+  return chunk;
+}
+
+inline std::vector<Chunk> makeTerrainCorpus(std::uint32_t count) {
+  std::vector<Chunk> chunks;
+  chunks.reserve(count);
+  for (std::uint32_t i = 0; i < count; i++) {
+    chunks.push_back(makeTerrainChunk(i + 1));
+  }
+  return chunks;
+}
+
+} // namespace bench
+} // namespace mv
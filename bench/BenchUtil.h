@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Log.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace mv {
+namespace bench {
+
+// results are folded into this so the optimizer cannot drop benchmarked work
+inline volatile std::uint64_t sink = {0};
+
+template <typename Fn> double measureMs(Fn &&fn, int iterations = 1) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         iterations;
+}
+
+} // namespace bench
+} // namespace mv
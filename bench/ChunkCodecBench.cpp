@@ -0,0 +1,186 @@
+#include "BenchChunks.h"
+#include "BenchUtil.h"
+#include "world/ChunkCodec.h"
+#include "world/WorldGenerator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr std::int32_t SEED = 1337;
+// generated corpus: every section of these columns
+constexpr std::int32_t AREA_RADIUS = 6;
+constexpr int ITERATIONS = 5;
+constexpr double RAW_SECTION_BYTES =
+    static_cast<double>(Chunk::VOLUME) * sizeof(BlockId);
+
+bool sameBlocks(const Chunk &a, const Chunk &b) {
+  for (std::uint32_t i = 0; i < Chunk::VOLUME; i++) {
+    if (a.get(i) != b.get(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct Corpus {
+  std::string name;
+  std::vector<const Chunk *> chunks;
+};
+
+// ratio against 16 bit blocks and against the in-memory palette storage,
+// throughput in raw megabytes per second
+bool measure(const Corpus &corpus) {
+  if (corpus.chunks.empty()) {
+    return true;
+  }
+  std::vector<std::vector<std::uint8_t>> encoded(corpus.chunks.size());
+  auto encodeMs = bench::measureMs(
+      [&] {
+        for (std::size_t i = 0; i < corpus.chunks.size(); i++) {
+          encoded[i].clear();
+          chunk_codec::encode(*corpus.chunks[i], encoded[i]);
+        }
+      },
+      ITERATIONS);
+
+  bool ok = true;
+  std::vector<Chunk> decoded(corpus.chunks.size());
+  auto decodeMs = bench::measureMs(
+      [&] {
+        for (std::size_t i = 0; i < corpus.chunks.size(); i++) {
+          ok &= chunk_codec::decode(encoded[i].data(), encoded[i].size(),
+                                    decoded[i]);
+        }
+      },
+      ITERATIONS);
+
+  double encodedBytes = 0.0;
+  double memoryBytes = 0.0;
+  for (std::size_t i = 0; i < corpus.chunks.size(); i++) {
+    ok &= sameBlocks(*corpus.chunks[i], decoded[i]);
+    encodedBytes += static_cast<double>(encoded[i].size());
+    memoryBytes += static_cast<double>(corpus.chunks[i]->memoryUsage());
+  }
+  auto rawBytes = RAW_SECTION_BYTES * static_cast<double>(corpus.chunks.size());
+  auto rawMb = rawBytes / (1024.0 * 1024.0);
+  LOG("{:>9}: {:4} sections, {:7.0f} bytes each, x{:6.1f} smaller than "
+      "16 bit blocks, x{:6.1f} than in memory; encode {:5.0f} MB/s, decode "
+      "{:5.0f} MB/s",
+      corpus.name, corpus.chunks.size(),
+      encodedBytes / static_cast<double>(corpus.chunks.size()),
+      rawBytes / encodedBytes, memoryBytes / encodedBytes,
+      rawMb / (encodeMs / 1000.0), rawMb / (decodeMs / 1000.0));
+  if (!ok) {
+    ELOG("{}: decoded sections differ from the originals", corpus.name);
+  }
+  return ok;
+}
+
+// the byte coder on inputs that stress literal and match lengths and
+// overlapping matches
+bool roundTripBytes() {
+  std::mt19937 rng{5};
+  bool ok = true;
+  std::vector<std::uint8_t> input;
+  std::vector<std::uint8_t> packed;
+  std::vector<std::uint8_t> output;
+  for (int i = 0; i < 400; i++) {
+    input.resize(i < 8 ? i : rng() % 70000);
+    auto alphabet = 1 + rng() % (i % 3 == 0 ? 256 : 4);
+    auto runs = rng() % 3;
+    for (std::size_t j = 0; j < input.size(); j++) {
+      input[j] = runs != 0 && j > 0 && rng() % 16 != 0
+                     ? input[j - 1]
+                     : static_cast<std::uint8_t>(rng() % alphabet);
+    }
+    packed.clear();
+    chunk_codec::compress(input.data(), input.size(), packed);
+    output.assign(input.size(), 0);
+    ok &= chunk_codec::decompress(packed.data(), packed.size(), output.data(),
+                                  output.size()) &&
+          output == input;
+  }
+  return ok;
+}
+
+// truncated and bit flipped encodings must be refused or decode to some
+// chunk, never read or write out of bounds
+void damage(const std::vector<const Chunk *> &chunks) {
+  std::mt19937 rng{17};
+  std::vector<std::uint8_t> encoded;
+  Chunk chunk;
+  std::uint32_t accepted = 0;
+  std::uint32_t attempts = 0;
+  for (std::size_t i = 0; i < chunks.size(); i += 16) {
+    encoded.clear();
+    chunk_codec::encode(*chunks[i], encoded);
+    for (std::size_t size = 0; size < encoded.size(); size++) {
+      accepted += chunk_codec::decode(encoded.data(), size, chunk);
+      attempts++;
+    }
+    for (int flip = 0; flip < 200; flip++) {
+      auto damaged = encoded;
+      damaged[rng() % damaged.size()] ^=
+          static_cast<std::uint8_t>(1 + rng() % 255);
+      accepted += chunk_codec::decode(damaged.data(), damaged.size(), chunk);
+      attempts++;
+    }
+  }
+  LOG("Damaged encodings: {} of {} still decoded to a chunk", accepted,
+      attempts);
+}
+} // namespace
+
+int main() {
+  JobSystem jobs;
+  WorldGenerator world{jobs, SEED};
+  for (std::int32_t x = -AREA_RADIUS; x < AREA_RADIUS; x++) {
+    for (std::int32_t z = -AREA_RADIUS; z < AREA_RADIUS; z++) {
+      world.request(x, z);
+    }
+  }
+  world.finish();
+  std::vector<const ChunkColumn *> columns;
+  world.takeCompleted(columns);
+  // completion order depends on scheduling
+  std::sort(columns.begin(), columns.end(), [](const auto *a, const auto *b) {
+    return a->x != b->x ? a->x < b->x : a->z < b->z;
+  });
+
+  Corpus uniform{"uniform", {}};
+  Corpus terrain{"terrain", {}};
+  Corpus generated{"generated", {}};
+  for (const auto *column : columns) {
+    for (const auto &section : column->sections) {
+      (section.isUniform() ? uniform : terrain).chunks.push_back(&section);
+      generated.chunks.push_back(&section);
+    }
+  }
+  std::vector<Chunk> synthetic;
+  for (std::uint32_t seed = 0; seed < 64; seed++) {
+    synthetic.push_back(bench::makeTerrainChunk(seed));
+  }
+  synthetic.push_back(bench::makeCheckerChunk());
+  Corpus hills{"hills", {}};
+  for (std::size_t i = 0; i + 1 < synthetic.size(); i++) {
+    hills.chunks.push_back(&synthetic[i]);
+  }
+  Corpus checker{"checker", {&synthetic.back()}};
+
+  bool ok = roundTripBytes();
+  if (!ok) {
+    ELOG("Byte coder round trip failed");
+  }
+  for (const auto *corpus :
+       {&generated, &terrain, &uniform, &hills, &checker}) {
+    ok &= measure(*corpus);
+  }
+  damage(generated.chunks);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+#include "BenchUtil.h"
+#include "world/Chunk.h"
+#include "world/ChunkMap.h"
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr int RADIUS = 32;
+constexpr int HEIGHT = 16;
+constexpr int LOOKUPS = 4'000'000;
+
+std::vector<ChunkCoord> makeCoords() {
+  std::vector<ChunkCoord> coords;
+  for (int x = -RADIUS; x < RADIUS; x++) {
+    for (int y = 0; y < HEIGHT; y++) {
+      for (int z = -RADIUS; z < RADIUS; z++) {
+        coords.push_back({x, y, z});
+      }
+    }
+  }
+  return coords;
+}
+
+// lookups follow a mesher walking one chunk and now and then reading one of
+// its 26 neighbours
+std::vector<std::uint64_t> makeNeighbourPattern(
+    const std::vector<ChunkCoord> &coords) {
+  std::vector<std::uint64_t> keys;
+  keys.reserve(LOOKUPS);
+  std::mt19937 rng{7};
+  while (keys.size() < LOOKUPS) {
+    auto center = coords[rng() % coords.size()];
+    for (int i = 0; i < 64; i++) {
+      ChunkCoord coord = {center.x + static_cast<int>(rng() % 3) - 1,
+                          center.y + static_cast<int>(rng() % 3) - 1,
+                          center.z + static_cast<int>(rng() % 3) - 1};
+      // most voxel reads stay inside the current chunk
+      keys.push_back(packChunkCoord(i % 8 == 0 ? coord : center));
+    }
+  }
+  return keys;
+}
+
+void logChunkMemory() {
+  Chunk uniform{block::STONE};
+
+  Chunk terrain;
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int z = 0; z < Chunk::SIZE; z++) {
+      int height = 12 + (x * 7 + z * 3) % 9;
+      for (int y = 0; y < height; y++) {
+        terrain.set(x, y, z, y + 4 < height ? block::STONE : block::DIRT);
+      }
+      terrain.set(x, height, z, block::GRASS);
+    }
+  }
+
+  Chunk noisy;
+  std::mt19937 rng{3};
+  for (std::uint32_t i = 0; i < Chunk::VOLUME; i++) {
+    noisy.set(i, static_cast<BlockId>(rng() % 200));
+  }
+
+  auto report = [](const char *name, const Chunk &chunk) {
+    auto stats = chunk.stats();
+    LOG("{:<8} bits {:>2} palette {:>3} memory {:>6} B (dense u16 {} B)", name,
+        stats.bitsPerBlock, stats.paletteSize, stats.memoryUsage,
+        Chunk::VOLUME * sizeof(BlockId));
+  };
+  report("uniform", uniform);
+  report("terrain", terrain);
+  report("noisy", noisy);
+}
+} // namespace
+
+int main() {
+  logChunkMemory();
+
+  auto coords = makeCoords();
+  auto pattern = makeNeighbourPattern(coords);
+
+  std::vector<std::uint64_t> randomKeys;
+  std::mt19937 rng{11};
+  for (int i = 0; i < LOOKUPS; i++) {
+    randomKeys.push_back(packChunkCoord(coords[rng() % coords.size()]));
+  }
+  std::vector<std::uint64_t> missKeys;
+  for (int i = 0; i < LOOKUPS; i++) {
+    auto coord = coords[rng() % coords.size()];
+    coord.y += HEIGHT;
+    missKeys.push_back(packChunkCoord(coord));
+  }
+
+  LOG("{} chunks, {} lookups per run", coords.size(), LOOKUPS);
+
+  ChunkMap<std::uint64_t> chunkMap;
+  std::unordered_map<std::uint64_t, std::uint64_t> stdMap;
+
+  auto insertFlat = bench::measureMs([&] {
+    chunkMap.clear();
+    for (const auto &coord : coords) {
+      chunkMap.emplace(coord, packChunkCoord(coord));
+    }
+  });
+  auto insertStd = bench::measureMs([&] {
+    stdMap.clear();
+    for (const auto &coord : coords) {
+      stdMap.emplace(packChunkCoord(coord), packChunkCoord(coord));
+    }
+  });
+
+  auto lookupFlat = [&](const std::vector<std::uint64_t> &keys) {
+    return bench::measureMs([&] {
+      std::uint64_t sum = 0;
+      for (auto key : keys) {
+        if (auto *value = chunkMap.find(key)) {
+          sum += *value;
+        }
+      }
+      bench::sink = bench::sink + sum;
+    });
+  };
+  auto lookupStd = [&](const std::vector<std::uint64_t> &keys) {
+    return bench::measureMs([&] {
+      std::uint64_t sum = 0;
+      for (auto key : keys) {
+        if (auto it = stdMap.find(key); it != stdMap.end()) {
+          sum += it->second;
+        }
+      }
+      bench::sink = bench::sink + sum;
+    });
+  };
+
+  auto report = [](const char *name, double flatMs, double stdMs) {
+    LOG("{:<10} ChunkMap {:>8.3f} ms  unordered_map {:>8.3f} ms  x{:.2f}", name,
+        flatMs, stdMs, stdMs / flatMs);
+  };
+  report("insert", insertFlat, insertStd);
+  report("random", lookupFlat(randomKeys), lookupStd(randomKeys));
+  report("miss", lookupFlat(missKeys), lookupStd(missKeys));
+  report("neighbour", lookupFlat(pattern), lookupStd(pattern));
+  LOG("ChunkMap memory {} KiB", chunkMap.memoryUsage() / 1024);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include "BenchChunks.h"
+#include "BenchUtil.h"
+#include "world/ChunkMesher.h"
+
+using namespace mv;
+
+namespace {
+ChunkMeshStats meshCorpus(ChunkMesher &mesher, const std::vector<Chunk> &corpus) {
+  ChunkMesh mesh;
+  ChunkNeighbours neighbours = {};
+
+  ChunkMeshStats total = {};
+  for (const auto &chunk : corpus) {
+    mesher.mesh(chunk, neighbours, mesh);
+    total.quads += mesh.stats.quads;
+    total.naiveQuads += mesh.stats.naiveQuads;
+    total.triangles += mesh.stats.triangles;
+    total.meshTimeMs += mesh.stats.meshTimeMs;
+  }
+  return total;
+}
+} // namespace
+
+int main() {
+  auto corpus = bench::makeTerrainCorpus(64);
+  auto checker = std::vector<Chunk>{};
+  checker.push_back(bench::makeCheckerChunk());
+
+  ChunkMesher greedy{MesherBackend::Greedy};
+  ChunkMesher binary{MesherBackend::BinaryGreedy};
+
+  ChunkMesh mesh;
+  LOG("terrain chunk:");
+  greedy.mesh(corpus.front(), {}, mesh);
+  ChunkMesher::logStats(mesh.stats);
+  binary.mesh(corpus.front(), {}, mesh);
+  ChunkMesher::logStats(mesh.stats);
+
+  auto packedBytes = mesh.stats.vertexBytes;
+  ChunkMesher unpacked{MesherBackend::BinaryGreedy, ChunkVertexFormat::Vertex};
+  unpacked.mesh(corpus.front(), {}, mesh);
+  LOG("vertex data: {} B as Vertex, {} B as VoxelVertex (x{:.1f})",
+      mesh.stats.vertexBytes, packedBytes,
+      static_cast<double>(mesh.stats.vertexBytes) / packedBytes);
+
+  // warm up scratch buffers before timing
+  meshCorpus(greedy, corpus);
+  meshCorpus(binary, corpus);
+
+  auto report = [](const char *name, const std::vector<Chunk> &chunks,
+                   const ChunkMeshStats &scalar, const ChunkMeshStats &bits) {
+    LOG("{:<8} {} chunks: {} triangles ({} naive), greedy {:.3f} ms/chunk, "
+        "binary {:.3f} ms/chunk, x{:.1f}",
+        name, chunks.size(), bits.triangles, bits.naiveQuads * 2,
+        scalar.meshTimeMs / chunks.size(), bits.meshTimeMs / chunks.size(),
+        scalar.meshTimeMs / bits.meshTimeMs);
+    if (scalar.quads != bits.quads) {
+      ELOG("backends disagree: {} vs {} quads", scalar.quads, bits.quads);
+    }
+  };
+  report("terrain", corpus, meshCorpus(greedy, corpus),
+         meshCorpus(binary, corpus));
+  report("checker", checker, meshCorpus(greedy, checker),
+         meshCorpus(binary, checker));
+  return 0;
+}
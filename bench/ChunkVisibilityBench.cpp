@@ -0,0 +1,179 @@
+#include "BenchChunks.h"
+#include "BenchUtil.h"
+#include "Camera.h"
+#include "world/ChunkVisibilityGraph.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <queue>
+
+using namespace mv;
+
+namespace {
+constexpr int RADIUS = 16;
+constexpr int SECTIONS = 8;
+constexpr int SURFACE = 5;
+constexpr int ITERATIONS = 100;
+
+// one block at a time flood fill as the reference for ChunkVisibilityBuilder
+ChunkVisibility referenceVisibility(const Chunk &chunk) {
+  constexpr int S = Chunk::SIZE;
+  std::vector<bool> visited(Chunk::VOLUME, false);
+  ChunkVisibility visibility;
+  for (int x = 0; x < S; x++) {
+    for (int y = 0; y < S; y++) {
+      for (int z = 0; z < S; z++) {
+        auto idx = Chunk::index(x, y, z);
+        if (visited[idx] || block::isOpaque(chunk.get(idx))) {
+          continue;
+        }
+        std::uint32_t faces = 0;
+        std::queue<std::array<int, 3>> open;
+        open.push({x, y, z});
+        visited[idx] = true;
+        while (!open.empty()) {
+          auto [bx, by, bz] = open.front();
+          open.pop();
+          const int pos[3] = {bx, by, bz};
+          for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+            int next[3] = {pos[0], pos[1], pos[2]};
+            next[face / 2] += (face & 1) ? 1 : -1;
+            if (next[face / 2] < 0 || next[face / 2] >= S) {
+              faces |= 1u << face;
+              continue;
+            }
+            auto n = Chunk::index(next[0], next[1], next[2]);
+            if (!visited[n] && !block::isOpaque(chunk.get(n))) {
+              visited[n] = true;
+              open.push({next[0], next[1], next[2]});
+            }
+          }
+        }
+        visibility.connectAll(faces);
+      }
+    }
+  }
+  return visibility;
+}
+
+// solid rock with a tunnel along X at the given height
+Chunk makeTunnelChunk(int height) {
+  Chunk chunk{block::STONE};
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int y = height; y < height + 3; y++) {
+      for (int z = 14; z < 18; z++) {
+        chunk.set(x, y, z, block::AIR);
+      }
+    }
+  }
+  return chunk;
+}
+
+// hollow room with no way out, connects nothing
+Chunk makeSealedChunk() {
+  Chunk chunk{block::STONE};
+  for (int x = 8; x < 24; x++) {
+    for (int y = 8; y < 24; y++) {
+      for (int z = 8; z < 24; z++) {
+        chunk.set(x, y, z, block::AIR);
+      }
+    }
+  }
+  return chunk;
+}
+} // namespace
+
+int main() {
+  auto corpus = bench::makeTerrainCorpus(64);
+  corpus.push_back(bench::makeCheckerChunk());
+  corpus.push_back(makeTunnelChunk(4));
+  corpus.push_back(makeSealedChunk());
+  corpus.emplace_back(block::STONE);
+  corpus.emplace_back(block::AIR);
+
+  bool ok = true;
+  ChunkVisibilityBuilder builder;
+  for (std::size_t i = 0; i < corpus.size(); i++) {
+    auto expected = referenceVisibility(corpus[i]);
+    auto actual = builder.compute(corpus[i]);
+    if (!(actual == expected)) {
+      ELOG("chunk {}: visibility {:#x}, reference {:#x}", i, actual.bits(),
+           expected.bits());
+      ok = false;
+    }
+  }
+
+  auto fillMs = bench::measureMs(
+      [&] {
+        for (const auto &chunk : corpus) {
+          bench::sink = bench::sink + builder.compute(chunk).bits();
+        }
+      },
+      ITERATIONS);
+  LOG("flood fill: {:.4f} ms/chunk", fillMs / corpus.size());
+
+  // rock below the surface with tunnels every few sections, terrain on top
+  // and air above
+  auto tunnel = builder.compute(makeTunnelChunk(4));
+  auto rock = ChunkVisibility::none();
+  auto surface = builder.compute(corpus.front());
+  ChunkVisibilityGraph graph;
+  std::uint32_t drawIndex = 0;
+  AabbList bounds;
+  const glm::vec3 origin = glm::vec3(0.0f);
+  for (int x = -RADIUS; x <= RADIUS; x++) {
+    for (int z = -RADIUS; z <= RADIUS; z++) {
+      for (int y = 0; y < SECTIONS; y++) {
+        ChunkCoord coord = {x, y, z};
+        if (y > SURFACE) {
+          graph.set(coord, ChunkVisibility::all());
+          continue;
+        }
+        auto visibility = y == SURFACE ? surface
+                          : z % 4 == 0 ? tunnel
+                                       : rock;
+        graph.set(coord, visibility, drawIndex++);
+        auto min = glm::vec3(x, y, z) * static_cast<float>(Chunk::SIZE);
+        bounds.push(min, min + glm::vec3(static_cast<float>(Chunk::SIZE)));
+      }
+    }
+  }
+
+  Camera camera;
+  camera.setPerspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f,
+                        RADIUS * Chunk::SIZE * 1.5f);
+  std::vector<std::uint32_t> visible;
+  std::vector<std::uint32_t> inFrustum;
+  for (auto height : {2, SURFACE + 1}) {
+    glm::vec3 eye = glm::vec3(5.0f, height * Chunk::SIZE + 5.5f, 16.0f);
+    camera.lookAt(eye, eye + glm::vec3(1.0f, -0.1f, 0.05f),
+                  glm::vec3(0.0f, 1.0f, 0.0f));
+
+    auto section = ChunkVisibilityGraph::sectionAt(eye, origin);
+    auto ms = bench::measureMs(
+        [&] {
+          bench::sink = bench::sink + graph.collectVisible(
+                                          section, camera.getFrustum(),
+                                          origin, visible);
+        },
+        ITERATIONS);
+    camera.cull(bounds, inFrustum);
+
+    // cave culling may only remove sections the frustum would draw
+    std::sort(visible.begin(), visible.end());
+    bool subset = std::includes(inFrustum.begin(), inFrustum.end(),
+                                visible.begin(), visible.end());
+    ok &= subset;
+    LOG("camera at section y {}: {} of {} frustum sections visible, {} "
+        "visited, {:.4f} ms{}",
+        section.y, visible.size(), inFrustum.size(), graph.lastVisitedCount(),
+        ms, subset ? "" : "  NOT A SUBSET");
+  }
+
+  if (!ok) {
+    ELOG("Visibility does not match the reference");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
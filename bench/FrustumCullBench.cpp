@@ -0,0 +1,96 @@
+#include "BenchUtil.h"
+#include "Camera.h"
+#include "CpuFeatures.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+// render distance 32 around the player with 16 sections per column
+constexpr int RADIUS = 32;
+constexpr int SECTIONS = 16;
+constexpr float SECTION_SIZE = 32.0f;
+constexpr int ITERATIONS = 200;
+
+AabbList makeSections() {
+  AabbList boxes;
+  boxes.reserve((2 * RADIUS + 1) * (2 * RADIUS + 1) * SECTIONS);
+  for (int x = -RADIUS; x <= RADIUS; x++) {
+    for (int z = -RADIUS; z <= RADIUS; z++) {
+      for (int y = 0; y < SECTIONS; y++) {
+        glm::vec3 min = glm::vec3(static_cast<float>(x), static_cast<float>(y),
+                                  static_cast<float>(z)) *
+                        SECTION_SIZE;
+        boxes.push(min, min + glm::vec3(SECTION_SIZE));
+      }
+    }
+  }
+  return boxes;
+}
+
+const char *backendName(CullBackend backend) {
+  switch (backend) {
+  case CullBackend::Scalar:
+    return "scalar";
+  case CullBackend::Sse:
+    return "sse";
+  case CullBackend::Avx2:
+    return "avx2";
+  default:
+    return "auto";
+  }
+}
+} // namespace
+
+int main() {
+  auto boxes = makeSections();
+  LOG("{} section AABBs, avx2 {}", boxes.size(), cpu::hasAvx2());
+
+  Camera camera;
+  camera.setPerspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f,
+                        RADIUS * SECTION_SIZE * 1.5f);
+
+  bool ok = true;
+  std::vector<std::uint32_t> reference;
+  std::vector<std::uint32_t> visible;
+  for (int view = 0; view < 4; view++) {
+    float yaw = static_cast<float>(view) * 1.3f;
+    glm::vec3 eye = glm::vec3(5.0f, SECTIONS * SECTION_SIZE * 0.5f, -7.0f);
+    glm::vec3 dir = glm::vec3(std::cos(yaw), -0.2f, std::sin(yaw));
+    camera.lookAt(eye, eye + dir, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // plain per box test as the reference for every backend
+    reference.clear();
+    const auto &frustum = camera.getFrustum();
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+      glm::vec3 min = {boxes.minX[i], boxes.minY[i], boxes.minZ[i]};
+      glm::vec3 max = {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]};
+      if (frustum.intersects(min, max)) {
+        reference.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+
+    for (auto backend : {CullBackend::Scalar, CullBackend::Sse,
+                         CullBackend::Avx2, CullBackend::Auto}) {
+      auto ms = bench::measureMs(
+          [&] {
+            bench::sink = bench::sink + camera.cull(boxes, visible, backend);
+          },
+          ITERATIONS);
+      bool match = visible == reference;
+      ok &= match;
+      LOG("view {} {:<6} {:>6} visible {:>8.4f} ms{}", view,
+          backendName(backend), visible.size(), ms,
+          match ? "" : "  MISMATCH");
+    }
+  }
+
+  if (!ok) {
+    ELOG("Culling backends disagree with the reference test");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
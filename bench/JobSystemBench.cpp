@@ -0,0 +1,177 @@
+#include "BenchUtil.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr std::uint32_t TINY_JOBS = 1u << 20;
+constexpr std::uint32_t TREE_DEPTH = 18;
+constexpr int ITERATIONS = 5;
+constexpr std::uint32_t CHAINS = 2000;
+// enough that one worker can take a job's dependency while another one
+// waits for it, whatever the core count
+constexpr std::uint32_t CHAIN_WORKERS = 3;
+
+std::uint32_t hash(std::uint32_t value) noexcept {
+  value ^= value >> 16;
+  value *= 0x7feb352du;
+  value ^= value >> 15;
+  value *= 0x846ca68bu;
+  value ^= value >> 16;
+  return value;
+}
+
+// binary fork/join tree, every node waits for its two children and each leaf
+// bumps leaves
+void forkJoin(JobSystem &jobs, std::uint32_t depth,
+              std::atomic<std::uint32_t> &leaves) {
+  if (depth == 0) {
+    leaves.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  JobCounter children;
+  jobs.run([&jobs, depth, &leaves] { forkJoin(jobs, depth - 1, leaves); },
+           &children);
+  jobs.run([&jobs, depth, &leaves] { forkJoin(jobs, depth - 1, leaves); },
+           &children);
+  jobs.wait(children);
+}
+
+// chains of three jobs, each started with runAfter on the one before. A job
+// whose dependency is still running must not get parked under a job that
+// needs it: a worker waiting on the first job could steal the last one and
+// never get back to the second.
+bool dependencyChains() {
+  JobSystem jobs{CHAIN_WORKERS};
+  std::uint32_t chained = 0;
+  for (std::uint32_t i = 0; i < CHAINS; i++) {
+    std::atomic<std::uint32_t> step = {0};
+    JobCounter first;
+    JobCounter second;
+    JobCounter third;
+    jobs.run(
+        [&step] {
+          // long enough for the other workers to take the rest of the chain
+          std::this_thread::sleep_for(std::chrono::microseconds{20});
+          step.fetch_add(1, std::memory_order_relaxed);
+        },
+        &first);
+    jobs.runAfter(
+        first,
+        [&step] {
+          std::uint32_t expected = 1;
+          step.compare_exchange_strong(expected, 2, std::memory_order_relaxed);
+        },
+        &second);
+    jobs.runAfter(
+        second,
+        [&step] {
+          std::uint32_t expected = 2;
+          step.compare_exchange_strong(expected, 3, std::memory_order_relaxed);
+        },
+        &third);
+    // leaves the chain to the workers, wait() would pop it from the bottom
+    while (!third.done()) {
+      std::this_thread::yield();
+    }
+    chained += step.load(std::memory_order_relaxed) == 3;
+  }
+  LOG("{} of {} dependency chains ran in order", chained, CHAINS);
+  return chained == CHAINS;
+}
+} // namespace
+
+int main() {
+  // before the main system, a thread drives one system at a time
+  bool ok = dependencyChains();
+  JobSystem jobs;
+
+  std::vector<std::uint32_t> expected(TINY_JOBS);
+  auto serialMs = bench::measureMs(
+      [&] {
+        for (std::uint32_t i = 0; i < TINY_JOBS; i++) {
+          expected[i] = hash(i);
+        }
+      },
+      ITERATIONS);
+
+  // one job per element, all submitted from the main thread
+  std::vector<std::uint32_t> results(TINY_JOBS);
+  auto tinyMs = bench::measureMs(
+      [&] {
+        JobCounter counter;
+        auto *out = results.data();
+        for (std::uint32_t i = 0; i < TINY_JOBS; i++) {
+          jobs.run([out, i] { out[i] = hash(i); }, &counter);
+        }
+        jobs.wait(counter);
+      },
+      ITERATIONS);
+  ok &= results == expected;
+  LOG("{} tiny jobs on {} threads: {:.2f} ms, {:.1f} M jobs/s (serial loop "
+      "{:.2f} ms)",
+      TINY_JOBS, jobs.threadCount(), tinyMs, TINY_JOBS / tinyMs / 1000.0,
+      serialMs);
+
+  std::fill(results.begin(), results.end(), 0);
+  auto forMs = bench::measureMs(
+      [&] {
+        jobs.parallelFor(0, TINY_JOBS, [&](std::uint32_t first,
+                                           std::uint32_t last) {
+          for (auto i = first; i < last; i++) {
+            results[i] = hash(i);
+          }
+        });
+      },
+      ITERATIONS);
+  ok &= results == expected;
+  LOG("parallelFor over {} elements: {:.2f} ms, x{:.1f} over serial",
+      TINY_JOBS, forMs, serialMs / forMs);
+
+  std::atomic<std::uint32_t> leaves = {0};
+  auto treeMs = bench::measureMs(
+      [&] {
+        leaves = 0;
+        forkJoin(jobs, TREE_DEPTH, leaves);
+      },
+      ITERATIONS);
+  ok &= leaves == (1u << TREE_DEPTH);
+  LOG("fork/join tree of depth {}: {} leaves, {:.2f} ms, {:.1f} M nodes/s",
+      TREE_DEPTH, leaves.load(), treeMs,
+      ((2u << TREE_DEPTH) - 1) / treeMs / 1000.0);
+
+  // a job started with runAfter must see everything its dependency did
+  std::atomic<std::uint32_t> stage = {0};
+  std::atomic<bool> ordered = {true};
+  JobCounter first;
+  JobCounter second;
+  for (int i = 0; i < 64; i++) {
+    jobs.run([&stage] { stage.fetch_add(1, std::memory_order_relaxed); },
+             &first);
+  }
+  for (int i = 0; i < 64; i++) {
+    jobs.runAfter(
+        first,
+        [&stage, &ordered] {
+          if (stage.load(std::memory_order_relaxed) != 64) {
+            ordered = false;
+          }
+        },
+        &second);
+  }
+  jobs.wait(second);
+  ok &= ordered.load();
+
+  if (!ok) {
+    ELOG("Job system produced wrong results");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
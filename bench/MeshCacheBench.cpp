@@ -0,0 +1,163 @@
+#include "BenchUtil.h"
+#include "Hash.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr int ITERATIONS = 10;
+
+// what Model does with the data: one copy into upload memory
+std::vector<char> gStaging;
+
+void copyToStaging(const void *vertices, std::size_t vertexBytes,
+                   const void *indices, std::size_t indexBytes) {
+  gStaging.resize(vertexBytes + indexBytes);
+  std::memcpy(gStaging.data(), vertices, vertexBytes);
+  std::memcpy(gStaging.data() + vertexBytes, indices, indexBytes);
+  bench::sink = bench::sink + static_cast<unsigned char>(gStaging.back());
+}
+
+bool sameMesh(const ModelLoader &loader, const MeshFile &mesh) {
+  return loader.vertices.size() == mesh.vertexCount() &&
+         loader.indices.size() == mesh.indexCount() &&
+         std::memcmp(loader.vertices.data(), mesh.vertices(),
+                     loader.vertices.size() * sizeof(Vertex)) == 0 &&
+         std::memcmp(loader.indices.data(), mesh.indices(),
+                     loader.indices.size() * sizeof(std::uint32_t)) == 0;
+}
+} // namespace
+
+int main() {
+  namespace fs = std::filesystem;
+  // work on a copy so the benchmark controls when the cache is cold
+  auto dir = fs::temp_directory_path() / "minevoxel_mesh_cache_bench";
+  fs::create_directories(dir);
+  auto objPath = (dir / "room.obj").string();
+  fs::copy_file(RESOURCES_PATH + std::string("/room.obj"), objPath,
+                fs::copy_options::overwrite_existing);
+  auto cachePath = MeshFile::cachePath(objPath);
+  fs::remove(cachePath);
+  bool ok = true;
+
+  ModelLoader reference;
+  auto objMs = bench::measureMs(
+      [&] {
+        reference.load(objPath);
+        copyToStaging(reference.vertices.data(),
+                      reference.vertices.size() * sizeof(Vertex),
+                      reference.indices.data(),
+                      reference.indices.size() * sizeof(std::uint32_t));
+      },
+      ITERATIONS);
+  ok &= !reference.vertices.empty();
+  // the cache stores the optimized order
+  auto expected = reference;
+  mesh_optimizer::optimize(expected);
+
+  auto coldMs = bench::measureMs([&] {
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && mesh.isMapped() && sameMesh(expected, mesh);
+  });
+
+  auto warmMs = bench::measureMs(
+      [&] {
+        MeshFile mesh;
+        ok &= mesh.load(objPath) && mesh.isMapped();
+        copyToStaging(mesh.vertices(), mesh.vertexCount() * sizeof(Vertex),
+                      mesh.indices(),
+                      mesh.indexCount() * sizeof(std::uint32_t));
+      },
+      ITERATIONS);
+  {
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh);
+  }
+  LOG("{}: {} vertices, {} indices, {} KiB cache",
+      RESOURCES_PATH + std::string("/room.obj"), reference.vertices.size(),
+      reference.indices.size(), fs::file_size(cachePath) / 1024);
+  LOG("OBJ parse + copy {:.2f} ms, first run conversion {:.2f} ms, cached "
+      "map + copy {:.2f} ms, x{:.1f}",
+      objMs, coldMs, warmMs, objMs / warmMs);
+
+  // a new mtime alone costs a hash of the OBJ but keeps the cache, and goes
+  // into its header so the next load trusts it again
+  auto touchedTime = fs::last_write_time(objPath) + std::chrono::seconds{10};
+  fs::last_write_time(objPath, touchedTime);
+  auto touchedMtime =
+      static_cast<std::int64_t>(touchedTime.time_since_epoch().count());
+  auto touchedMs = bench::measureMs([&] {
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh) &&
+          mesh.source().mtime == touchedMtime;
+  });
+  std::uint64_t touchedHash = 0;
+  {
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh) &&
+          mesh.source().mtime == touchedMtime;
+    touchedHash = mesh.source().hash;
+  }
+
+  // changed content converts again
+  {
+    std::ofstream obj{objPath, std::ios_base::app};
+    obj << "# edited\n";
+  }
+  {
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh) &&
+          mesh.source().hash != touchedHash;
+  }
+  LOG("touched OBJ {:.2f} ms", touchedMs);
+
+  // a cache that is current but indexes past its vertices is converted again
+  {
+    MeshFile::Source source = {};
+    source.size = fs::file_size(objPath);
+    source.mtime = static_cast<std::int64_t>(
+        fs::last_write_time(objPath).time_since_epoch().count());
+    std::ifstream obj{objPath, std::ios_base::binary};
+    std::vector<char> bytes(source.size);
+    obj.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    source.hash = hashBytes(bytes.data(), bytes.size());
+    auto damaged = expected;
+    damaged.indices[damaged.indices.size() / 2] =
+        static_cast<std::uint32_t>(damaged.vertices.size());
+    ok &= MeshFile::write(cachePath, damaged, source);
+
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh);
+  }
+
+  // so is one whose vertex offset wraps the bounds checks around to a small
+  // end; the offset sits after magic, four counts and the 24 byte Source
+  {
+    constexpr std::streamoff VERTEX_OFFSET_FIELD = 48;
+    const std::uint64_t wrapping = ~std::uint64_t{15};
+    {
+      std::fstream cache{cachePath, std::ios_base::binary |
+                                        std::ios_base::in | std::ios_base::out};
+      cache.seekp(VERTEX_OFFSET_FIELD);
+      cache.write(reinterpret_cast<const char *>(&wrapping), sizeof(wrapping));
+      ok &= cache.good();
+    }
+    MeshFile mesh;
+    ok &= mesh.load(objPath) && sameMesh(expected, mesh);
+  }
+
+  fs::remove_all(dir);
+  if (!ok) {
+    ELOG("Mesh cache returned different data or missed an invalidation");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+#include "BenchUtil.h"
+#include "CpuFeatures.h"
+#include "Noise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace mv;
+using namespace mv::noise;
+
+namespace {
+// one chunk of density samples, and an odd grid for the partial vectors
+constexpr std::uint32_t CHUNK = 32;
+constexpr std::uint32_t ODD = 37;
+constexpr int ITERATIONS = 20;
+// float rounding differs between backends only where the compiler reorders
+constexpr float TOLERANCE = 1e-4f;
+
+const char *typeName(NoiseType type) {
+  switch (type) {
+  case NoiseType::Perlin:
+    return "perlin";
+  case NoiseType::Simplex:
+    return "simplex";
+  case NoiseType::OpenSimplex2:
+    return "opensimplex2";
+  default:
+    return "cellular";
+  }
+}
+
+const char *fractalName(FractalType fractal) {
+  switch (fractal) {
+  case FractalType::Fbm:
+    return "fbm";
+  case FractalType::Ridged:
+    return "ridged";
+  default:
+    return "single";
+  }
+}
+
+const char *backendName(NoiseBackend backend) {
+  switch (backend) {
+  case NoiseBackend::Scalar:
+    return "scalar";
+  case NoiseBackend::Sse41:
+    return "sse4.1";
+  case NoiseBackend::Avx2:
+    return "avx2";
+  default:
+    return "auto";
+  }
+}
+
+float maxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+  if (a.size() != b.size()) {
+    return INFINITY;
+  }
+  float difference = 0.0f;
+  for (std::size_t i = 0; i < a.size(); i++) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+// every backend against sample() at every point of the grid
+bool matchesReference(const NoiseSettings &settings, const Grid2 &grid) {
+  std::vector<float> expected;
+  expected.reserve(grid.size());
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    for (std::uint32_t y = 0; y < grid.sizeY; y++) {
+      expected.push_back(sample(
+          settings, grid.origin + glm::vec2(static_cast<float>(x),
+                                            static_cast<float>(y)) *
+                                      grid.step));
+    }
+  }
+  bool ok = true;
+  std::vector<float> out;
+  for (auto backend : {NoiseBackend::Scalar, NoiseBackend::Sse41,
+                       NoiseBackend::Avx2}) {
+    generate(settings, grid, out, backend);
+    float difference = maxDifference(expected, out);
+    if (!(difference <= TOLERANCE)) {
+      ELOG("{} {} 2D: {} differs from the reference by {}",
+           typeName(settings.type), fractalName(settings.fractal),
+           backendName(resolve(backend)), difference);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool matchesReference(const NoiseSettings &settings, const Grid3 &grid) {
+  std::vector<float> expected;
+  expected.reserve(grid.size());
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    for (std::uint32_t z = 0; z < grid.sizeZ; z++) {
+      for (std::uint32_t y = 0; y < grid.sizeY; y++) {
+        expected.push_back(sample(
+            settings, grid.origin + glm::vec3(static_cast<float>(x),
+                                              static_cast<float>(y),
+                                              static_cast<float>(z)) *
+                                        grid.step));
+      }
+    }
+  }
+  bool ok = true;
+  std::vector<float> out;
+  for (auto backend : {NoiseBackend::Scalar, NoiseBackend::Sse41,
+                       NoiseBackend::Avx2}) {
+    generate(settings, grid, out, backend);
+    float difference = maxDifference(expected, out);
+    if (!(difference <= TOLERANCE)) {
+      ELOG("{} {} 3D: {} differs from the reference by {}",
+           typeName(settings.type), fractalName(settings.fractal),
+           backendName(resolve(backend)), difference);
+      ok = false;
+    }
+  }
+  return ok;
+}
+} // namespace
+
+int main() {
+  LOG("sse4.1 {}, avx2 {}", cpu::hasSse41(), cpu::hasAvx2());
+  bool ok = true;
+
+  const NoiseType types[] = {NoiseType::Perlin, NoiseType::Simplex,
+                             NoiseType::OpenSimplex2, NoiseType::Cellular};
+  const FractalType fractals[] = {FractalType::None, FractalType::Fbm,
+                                  FractalType::Ridged};
+  // negative origins cover floor() and the lattice hash below zero
+  Grid2 odd2 = {{-301.7f, 55.25f}, {0.75f, 1.25f}, ODD, ODD};
+  Grid3 odd3 = {{-41.5f, -13.3f, 77.1f}, {0.75f, 1.25f, 0.5f}, ODD, ODD, 11};
+  for (auto type : types) {
+    for (auto fractal : fractals) {
+      NoiseSettings settings;
+      settings.type = type;
+      settings.fractal = fractal;
+      settings.frequency = 0.05f;
+      ok &= matchesReference(settings, odd2);
+      ok &= matchesReference(settings, odd3);
+    }
+  }
+
+  // single octave values stay in [-1, 1]
+  std::vector<float> out;
+  for (auto type : types) {
+    NoiseSettings settings;
+    settings.type = type;
+    settings.frequency = 0.37f;
+    generate(settings, Grid2{{0.13f, 0.71f}, {0.25f, 0.25f}, 512, 512}, out);
+    auto [low2, high2] = std::minmax_element(out.begin(), out.end());
+    float min2 = *low2;
+    float max2 = *high2;
+    generate(settings, Grid3{{0.13f, 0.71f, 0.29f}, {0.25f, 0.25f, 0.25f}, 64, 64, 64}, out);
+    auto [low3, high3] = std::minmax_element(out.begin(), out.end());
+    LOG("{}: 2D [{:.3f}, {:.3f}], 3D [{:.3f}, {:.3f}]", typeName(type), min2,
+        max2, *low3, *high3);
+    ok &= min2 >= -1.0f && max2 <= 1.0f && *low3 >= -1.0f && *high3 <= 1.0f;
+  }
+
+  // a chunk's worth of 3D density per call, as the generator samples it
+  for (auto type : types) {
+    NoiseSettings settings;
+    settings.type = type;
+    settings.fractal = FractalType::Fbm;
+    Grid3 chunk = {{96.0f, 0.0f, -64.0f}, {1.0f, 1.0f, 1.0f}, CHUNK, CHUNK, CHUNK};
+    auto pointMs = bench::measureMs(
+        [&] {
+          float sum = 0.0f;
+          for (std::uint32_t x = 0; x < CHUNK; x++) {
+            for (std::uint32_t z = 0; z < CHUNK; z++) {
+              for (std::uint32_t y = 0; y < CHUNK; y++) {
+                sum += sample(settings,
+                              chunk.origin + glm::vec3(static_cast<float>(x),
+                                                       static_cast<float>(y),
+                                                       static_cast<float>(z)));
+              }
+            }
+          }
+          bench::sink = bench::sink + static_cast<std::uint64_t>(sum != 0.0f);
+        },
+        ITERATIONS);
+    for (auto backend : {NoiseBackend::Scalar, NoiseBackend::Sse41,
+                         NoiseBackend::Avx2}) {
+      if (resolve(backend) != backend) {
+        continue;
+      }
+      auto ms = bench::measureMs(
+          [&] {
+            generate(settings, chunk, out, backend);
+            bench::sink = bench::sink + static_cast<std::uint64_t>(out[7] != 0.0f);
+          },
+          ITERATIONS);
+      LOG("{} fbm 32^3: per point sample() {:.3f} ms, {} grid {:.3f} ms, "
+          "x{:.1f}",
+          typeName(type), pointMs, backendName(backend), ms, pointMs / ms);
+    }
+  }
+
+  if (!ok) {
+    ELOG("Noise backends disagree with the reference or leave [-1, 1]");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
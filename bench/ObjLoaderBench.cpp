@@ -0,0 +1,98 @@
+#include "BenchUtil.h"
+#include "JobSystem.h"
+#include "Model.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+// GRID x GRID quads, a bit under a million triangles
+constexpr std::uint32_t GRID = 700;
+constexpr int ITERATIONS = 3;
+
+void writeGrid(const std::string &path) {
+  std::ofstream obj{path};
+  obj << "# generated by obj_loader_bench\no grid\n";
+  for (std::uint32_t z = 0; z <= GRID; z++) {
+    for (std::uint32_t x = 0; x <= GRID; x++) {
+      obj << "v " << x * 0.25f << " " << ((x * 7 + z * 13) % 17) * 0.01f
+          << " " << z * 0.25f << "\n";
+      obj << "vt " << static_cast<float>(x) / GRID << " "
+          << static_cast<float>(z) / GRID << "\n";
+    }
+  }
+  obj << "vn 0 1 0\ns off\n";
+  for (std::uint32_t z = 0; z < GRID; z++) {
+    for (std::uint32_t x = 0; x < GRID; x++) {
+      auto corner = [](std::uint32_t cx, std::uint32_t cz) {
+        return std::to_string(cz * (GRID + 1) + cx + 1);
+      };
+      auto a = corner(x, z), b = corner(x + 1, z), c = corner(x + 1, z + 1),
+           d = corner(x, z + 1);
+      obj << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << c
+          << "/" << c << "/1 " << d << "/" << d << "/1\n";
+    }
+  }
+}
+
+bool sameMesh(const ModelLoader &a, const ModelLoader &b) {
+  return a.vertices.size() == b.vertices.size() && a.indices == b.indices &&
+         std::memcmp(a.vertices.data(), b.vertices.data(),
+                     a.vertices.size() * sizeof(Vertex)) == 0;
+}
+} // namespace
+
+int main() {
+  namespace fs = std::filesystem;
+  auto dir = fs::temp_directory_path() / "minevoxel_obj_loader_bench";
+  fs::create_directories(dir);
+  bool ok = true;
+
+  // negative indices, quads and statements the loader skips
+  auto smallPath = (dir / "quad.obj").string();
+  {
+    std::ofstream obj{smallPath};
+    obj << "mtllib none.mtl\nv 0 0 0\nv 1 0 0\r\nv 1 1 0 0.5 0.5 0.5\n"
+           "v 0 1 0\nvt 0 0\nvn 0 0 1\n# comment\ng quad\nusemtl none\n"
+           "f -4/1/1 -3/1/1 -2/1/1 -1/1/1\n";
+  }
+  ModelLoader quad;
+  quad.load(smallPath);
+  ok &= quad.vertices.size() == 4 &&
+        quad.indices == std::vector<uint32_t>{0, 1, 2, 0, 2, 3} &&
+        quad.vertices[2].color == glm::vec3{0.5f, 0.5f, 0.5f} &&
+        quad.vertices[0].color == glm::vec3{1.0f, 1.0f, 1.0f} &&
+        quad.vertices[3].normal == glm::vec3{0.0f, 0.0f, 1.0f};
+
+  auto gridPath = (dir / "grid.obj").string();
+  writeGrid(gridPath);
+
+  ModelLoader serial;
+  auto serialMs = bench::measureMs([&] { serial.load(gridPath); }, ITERATIONS);
+  JobSystem jobs;
+  ModelLoader parallel;
+  auto parallelMs =
+      bench::measureMs([&] { parallel.load(gridPath, &jobs); }, ITERATIONS);
+
+  ok &= serial.vertices.size() == (GRID + 1) * (GRID + 1) &&
+        serial.indices.size() == GRID * GRID * 6;
+  ok &= sameMesh(serial, parallel);
+  LOG("{}: {} MiB, {} triangles, {} vertices", gridPath,
+      fs::file_size(gridPath) >> 20, serial.indices.size() / 3,
+      serial.vertices.size());
+  LOG("serial {:.1f} ms, {} threads {:.1f} ms, {:.0f} MiB/s", serialMs,
+      jobs.threadCount(), parallelMs,
+      (fs::file_size(gridPath) >> 20) / (parallelMs / 1000.0));
+
+  fs::remove_all(dir);
+  if (!ok) {
+    ELOG("OBJ loader produced wrong results");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
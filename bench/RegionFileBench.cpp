@@ -0,0 +1,250 @@
+#include "BenchChunks.h"
+#include "BenchUtil.h"
+#include "Hash.h"
+#include "world/RegionFile.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr int COLUMNS = RegionFile::COLUMNS;
+constexpr int FUZZ_ROUNDS = 24;
+constexpr int FUZZ_OPERATIONS = 400;
+
+struct Saved {
+  std::vector<char> bytes;
+  std::int64_t timestamp = {0};
+  bool stored = {false};
+};
+using Model = std::array<Saved, COLUMNS * COLUMNS>;
+
+// sizes around sector boundaries, small columns and the odd large one
+std::size_t fuzzSize(std::mt19937 &rng) {
+  switch (rng() % 4) {
+  case 0:
+    return 1 + rng() % 64;
+  case 1:
+    return (1 + rng() % 8) * RegionFile::SECTOR_SIZE - 1 + rng() % 3;
+  case 2:
+    return 1 + rng() % (24 * RegionFile::SECTOR_SIZE);
+  default:
+    return 1 + rng() % 4000;
+  }
+}
+
+bool matches(RegionFile &region, const Model &model, int x, int z) {
+  const auto &saved = model[x * COLUMNS + z];
+  auto payload = region.read(x, z);
+  if (!saved.stored) {
+    return !region.contains(x, z) && payload.size == 0;
+  }
+  return region.contains(x, z) && payload.size == saved.bytes.size() &&
+         payload.timestamp == saved.timestamp &&
+         std::memcmp(payload.data, saved.bytes.data(), payload.size) == 0;
+}
+
+bool matchesAll(RegionFile &region, const Model &model,
+                std::uint32_t headerSectors) {
+  bool ok = true;
+  std::size_t sectors = 0;
+  for (int x = 0; x < COLUMNS; x++) {
+    for (int z = 0; z < COLUMNS; z++) {
+      ok &= matches(region, model, x, z);
+      const auto &saved = model[x * COLUMNS + z];
+      sectors += (saved.bytes.size() + RegionFile::SECTOR_SIZE - 1) /
+                 RegionFile::SECTOR_SIZE * saved.stored;
+    }
+  }
+  // no sector leaked or is held twice
+  return ok && region.sectorCount() - region.freeSectorCount() ==
+                   sectors + headerSectors;
+}
+
+// random writes, rewrites and erases checked against an in-memory model,
+// reopening the file between rounds
+bool fuzz(const std::string &path) {
+  std::filesystem::remove(path);
+  std::mt19937 rng{29};
+  Model model;
+  RegionFile region;
+  bool ok = region.open(path);
+  std::uint32_t headerSectors = region.sectorCount();
+  std::size_t writes = 0;
+  std::size_t bytes = 0;
+  for (int round = 0; round < FUZZ_ROUNDS && ok; round++) {
+    for (int i = 0; i < FUZZ_OPERATIONS; i++) {
+      // a few hot columns get rewritten over and over
+      int x = static_cast<int>(rng() % (rng() % 2 ? 4 : COLUMNS));
+      int z = static_cast<int>(rng() % COLUMNS);
+      auto &saved = model[x * COLUMNS + z];
+      auto op = rng() % 10;
+      if (op < 6) {
+        saved.bytes.resize(fuzzSize(rng));
+        for (auto &b : saved.bytes) {
+          b = static_cast<char>(rng());
+        }
+        saved.timestamp = static_cast<std::int64_t>(rng()) << 16;
+        saved.stored = true;
+        ok &= region.write(x, z, saved.bytes.data(), saved.bytes.size(),
+                           saved.timestamp);
+        writes++;
+        bytes += saved.bytes.size();
+      } else if (op < 7) {
+        saved = {};
+        ok &= region.erase(x, z);
+      } else {
+        ok &= matches(region, model, x, z);
+      }
+    }
+    ok &= matchesAll(region, model, headerSectors);
+    region.close();
+    ok &= region.open(path) && matchesAll(region, model, headerSectors);
+  }
+
+  // freed sectors are reused: the file holds little more than the live data
+  std::size_t live = 0;
+  for (const auto &saved : model) {
+    live += saved.stored ? (saved.bytes.size() + RegionFile::SECTOR_SIZE - 1) /
+                               RegionFile::SECTOR_SIZE
+                         : 0;
+  }
+  LOG("Fuzz: {} writes of {:.1f} MB, {} live sectors, {} in the file ({} of "
+      "them free)",
+      writes, static_cast<double>(bytes) / (1024.0 * 1024.0), live,
+      region.sectorCount() - headerSectors, region.freeSectorCount());
+  ok &= region.sectorCount() - headerSectors <= live * 2;
+  region.close();
+  return ok;
+}
+
+// damaged files: a torn append drops the columns it held for good, anything
+// that is not a region file is refused and left alone
+bool damaged(const std::string &path) {
+  std::filesystem::remove(path);
+  std::vector<char> payload(3 * RegionFile::SECTOR_SIZE, 'a');
+  std::vector<char> other(3 * RegionFile::SECTOR_SIZE, 'b');
+  bool ok = true;
+  {
+    RegionFile region;
+    ok &= region.open(path) &&
+          region.write(0, 0, payload.data(), payload.size(), 1) &&
+          region.write(0, 1, payload.data(), payload.size(), 2);
+  }
+  auto size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size - RegionFile::SECTOR_SIZE - 100);
+  {
+    RegionFile region;
+    ok &= region.open(path) && region.contains(0, 0) && !region.contains(0, 1);
+    auto first = region.read(0, 0);
+    ok &= first.size == payload.size() &&
+          std::memcmp(first.data, payload.data(), payload.size()) == 0;
+    // another column reuses the torn sectors
+    ok &= region.write(0, 2, other.data(), other.size(), 3);
+    ok &= region.freeSectorCount() == 0;
+  }
+  {
+    // the dropped entry must not claim those sectors back
+    RegionFile region;
+    ok &= region.open(path) && region.contains(0, 0) &&
+          !region.contains(0, 1) && region.contains(0, 2);
+    auto second = region.read(0, 2);
+    ok &= second.size == other.size() && second.timestamp == 3 &&
+          std::memcmp(second.data, other.data(), other.size()) == 0;
+  }
+
+  {
+    std::ofstream file{path, std::ios_base::binary | std::ios_base::trunc};
+    file << "not a region";
+  }
+  RegionFile region;
+  ok &= !region.open(path) &&
+        std::filesystem::file_size(path) == std::strlen("not a region");
+  return ok;
+}
+} // namespace
+
+int main() {
+  namespace fs = std::filesystem;
+  auto dir = fs::temp_directory_path() / "minevoxel_region_bench";
+  fs::create_directories(dir);
+  auto path = (dir / RegionFile::fileName(0, 0)).string();
+  bool ok = true;
+
+  ok &= RegionFile::region(-1) == -1 && RegionFile::local(-1) == COLUMNS - 1 &&
+        RegionFile::region(COLUMNS) == 1 && RegionFile::local(COLUMNS) == 0;
+  ok &= fuzz(path);
+  ok &= damaged(path);
+
+  // a full region of uncompressed terrain sections
+  std::vector<std::vector<BlockId>> columns;
+  for (std::uint32_t i = 0; i < COLUMNS * COLUMNS; i++) {
+    auto chunk = bench::makeTerrainChunk(i % 64);
+    std::vector<BlockId> blocks(Chunk::VOLUME);
+    for (int x = 0; x < Chunk::SIZE; x++) {
+      for (int z = 0; z < Chunk::SIZE; z++) {
+        chunk.getColumn(x, z, blocks.data() + Chunk::index(x, 0, z));
+      }
+    }
+    blocks[i % Chunk::VOLUME] ^= static_cast<BlockId>(i);
+    columns.push_back(std::move(blocks));
+  }
+  auto megabytes = static_cast<double>(columns.size() * Chunk::VOLUME *
+                                       sizeof(BlockId)) /
+                   (1024.0 * 1024.0);
+  auto writeAll = [&](RegionFile &region, std::int64_t timestamp) {
+    for (int x = 0; x < COLUMNS; x++) {
+      for (int z = 0; z < COLUMNS; z++) {
+        const auto &blocks = columns[x * COLUMNS + z];
+        ok &= region.write(x, z, blocks.data(),
+                           blocks.size() * sizeof(BlockId), timestamp);
+      }
+    }
+  };
+
+  fs::remove(path);
+  RegionFile region;
+  ok &= region.open(path);
+  auto writeMs = bench::measureMs([&] { writeAll(region, 1); });
+  auto sectors = region.sectorCount();
+  // each column takes the sectors the one before it just freed
+  auto rewriteMs = bench::measureMs([&] { writeAll(region, 2); });
+  ok &= region.sectorCount() <= sectors + Chunk::VOLUME * sizeof(BlockId) /
+                                             RegionFile::SECTOR_SIZE;
+  region.close();
+
+  std::uint64_t expected = 0;
+  for (const auto &blocks : columns) {
+    expected += hashBytes(blocks.data(), blocks.size() * sizeof(BlockId));
+  }
+  std::uint64_t hash = 0;
+  auto readMs = bench::measureMs([&] {
+    ok &= region.open(path);
+    for (int x = 0; x < COLUMNS; x++) {
+      for (int z = 0; z < COLUMNS; z++) {
+        auto payload = region.read(x, z);
+        hash += hashBytes(payload.data, payload.size);
+      }
+    }
+  });
+  ok &= hash == expected;
+  bench::sink = bench::sink + hash;
+  LOG("{:.0f} MB region, page cache warm: write {:.0f} MB/s, rewrite {:.0f} "
+      "MB/s, open and read {:.0f} MB/s",
+      megabytes, megabytes / (writeMs / 1000.0),
+      megabytes / (rewriteMs / 1000.0), megabytes / (readMs / 1000.0));
+  region.close();
+  fs::remove_all(dir);
+
+  if (!ok) {
+    ELOG("Region file round trip failed");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
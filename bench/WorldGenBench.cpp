@@ -0,0 +1,247 @@
+#include "BenchUtil.h"
+#include "Hash.h"
+#include "world/WorldGenerator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace mv;
+
+namespace {
+constexpr std::int32_t SEED = 1337;
+// a teleport into unexplored terrain: every column within RADIUS at once
+constexpr std::int32_t RADIUS = 5;
+// the reference generates the requested area plus the two rings of
+// neighbours the stages reading neighbours pull in
+constexpr std::int32_t BORDER = 2;
+
+// interpolated density against the golden output sampled at every block:
+// the ground is sampled exactly, only the walls of deep caves move by a block
+// or two; a surface only moves where such a cave shaft opens into it
+constexpr double MIN_SAMPLE_RATIO = 4.0;
+constexpr double MAX_BLOCK_DIFFERENCE = 0.005;
+constexpr double MAX_SURFACE_DIFFERENCE = 0.0001;
+
+struct Coord {
+  std::int32_t x = {0};
+  std::int32_t z = {0};
+};
+
+// nearest first, the order a game requests them in
+std::vector<Coord> teleportArea() {
+  std::vector<Coord> coords;
+  for (std::int32_t x = -RADIUS; x <= RADIUS; x++) {
+    for (std::int32_t z = -RADIUS; z <= RADIUS; z++) {
+      coords.push_back({x, z});
+    }
+  }
+  std::stable_sort(coords.begin(), coords.end(), [](Coord a, Coord b) {
+    return a.x * a.x + a.z * a.z < b.x * b.x + b.z * b.z;
+  });
+  return coords;
+}
+
+std::uint64_t hashColumn(const ChunkColumn &column) {
+  std::uint64_t hash = hashBytes(column.surface.data(),
+                                 column.surface.size() * sizeof(std::int16_t));
+  BlockId blocks[Chunk::SIZE];
+  for (const auto &section : column.sections) {
+    for (int x = 0; x < Chunk::SIZE; x++) {
+      for (int z = 0; z < Chunk::SIZE; z++) {
+        section.getColumn(x, z, blocks);
+        hash = hashBytes(blocks, sizeof(blocks), hash);
+      }
+    }
+  }
+  return hash;
+}
+
+// one stage at a time over the whole area on the calling thread, what a
+// one-shot generator in the game loop would do
+struct SerialWorld {
+  static constexpr std::int32_t SIDE = 2 * (RADIUS + BORDER) + 1;
+
+  explicit SerialWorld(DensitySampling sampling) : terrain{SEED, sampling} {}
+
+  TerrainGenerator terrain;
+  std::vector<std::unique_ptr<ChunkColumn>> columns;
+  std::uint64_t noiseSamples = {0};
+
+  ChunkColumn &at(std::int32_t x, std::int32_t z) {
+    return *columns[(x + RADIUS + BORDER) * SIDE + z + RADIUS + BORDER];
+  }
+
+  void generate() {
+    columns.clear();
+    for (std::int32_t x = -RADIUS - BORDER; x <= RADIUS + BORDER; x++) {
+      for (std::int32_t z = -RADIUS - BORDER; z <= RADIUS + BORDER; z++) {
+        auto column = std::make_unique<ChunkColumn>();
+        column->x = x;
+        column->z = z;
+        columns.push_back(std::move(column));
+      }
+    }
+    TerrainScratch scratch;
+    ColumnNeighbourhood none = {};
+    for (auto stage : {GenStage::Biome, GenStage::Terrain, GenStage::Caves,
+                       GenStage::Surface}) {
+      for (auto &column : columns) {
+        terrain.run(stage, *column, none, scratch);
+      }
+    }
+    // decoration for the requested area and one ring, then structures
+    for (auto [stage, reach] :
+         {std::pair{GenStage::Decoration, RADIUS + 1},
+          std::pair{GenStage::Structures, RADIUS}}) {
+      for (std::int32_t x = -reach; x <= reach; x++) {
+        for (std::int32_t z = -reach; z <= reach; z++) {
+          ColumnNeighbourhood neighbourhood;
+          for (std::int32_t dx = -1; dx <= 1; dx++) {
+            for (std::int32_t dz = -1; dz <= 1; dz++) {
+              neighbourhood[(dx + 1) * 3 + dz + 1] = &at(x + dx, z + dz);
+            }
+          }
+          terrain.run(stage, at(x, z), neighbourhood, scratch);
+        }
+      }
+    }
+    noiseSamples = scratch.noiseSamples;
+  }
+};
+
+struct WorldStats {
+  std::uint32_t logs = {0};
+  std::uint32_t stone = {0};
+  std::uint32_t air = {0};
+};
+
+struct Difference {
+  std::uint64_t blocks = {0};
+  // block columns whose surface moved by more than one block
+  std::uint32_t surfaces = {0};
+};
+
+Difference compare(const ChunkColumn &a, const ChunkColumn &b) {
+  Difference difference;
+  for (int s = 0; s < ChunkColumn::SECTIONS; s++) {
+    for (std::uint32_t i = 0; i < Chunk::VOLUME; i++) {
+      difference.blocks += a.sections[s].get(i) != b.sections[s].get(i);
+    }
+  }
+  for (std::uint32_t i = 0; i < Chunk::AREA; i++) {
+    difference.surfaces += std::abs(a.surface[i] - b.surface[i]) > 1;
+  }
+  return difference;
+}
+
+WorldStats countBlocks(const ChunkColumn &column) {
+  WorldStats stats;
+  for (const auto &section : column.sections) {
+    for (std::uint32_t i = 0; i < Chunk::VOLUME; i++) {
+      auto id = section.get(i);
+      stats.logs += id == block::LOG;
+      stats.stone += id == block::STONE;
+      stats.air += id == block::AIR;
+    }
+  }
+  return stats;
+}
+} // namespace
+
+int main() {
+  auto area = teleportArea();
+  bool ok = true;
+
+  SerialWorld serial{DensitySampling::Interpolated};
+  auto serialMs = bench::measureMs([&] { serial.generate(); });
+
+  // golden output: every block sampled
+  SerialWorld full{DensitySampling::Full};
+  auto fullMs = bench::measureMs([&] { full.generate(); });
+  Difference difference;
+  for (auto coord : area) {
+    auto d = compare(serial.at(coord.x, coord.z), full.at(coord.x, coord.z));
+    difference.blocks += d.blocks;
+    difference.surfaces += d.surfaces;
+  }
+  auto blocks = static_cast<double>(area.size()) * ChunkColumn::SECTIONS *
+                Chunk::VOLUME;
+  auto surfaces = static_cast<double>(area.size()) * Chunk::AREA;
+  auto sampleRatio = static_cast<double>(full.noiseSamples) /
+                     static_cast<double>(serial.noiseSamples);
+  LOG("Interpolated density: {:.0f} noise samples per column instead of "
+      "{:.0f} (x{:.1f} fewer), {:.1f} ms instead of {:.1f} ms",
+      static_cast<double>(serial.noiseSamples) / serial.columns.size(),
+      static_cast<double>(full.noiseSamples) / full.columns.size(),
+      sampleRatio, serialMs, fullMs);
+  LOG("Interpolated density: {:.3f}% of blocks and {:.3f}% of surfaces "
+      "differ from full sampling",
+      100.0 * static_cast<double>(difference.blocks) / blocks,
+      100.0 * difference.surfaces / surfaces);
+  auto &heightmaps = serial.terrain.heightmaps();
+  LOG("Heightmap cache: {} hits, {} misses", heightmaps.hits(),
+      heightmaps.misses());
+  bool golden = sampleRatio >= MIN_SAMPLE_RATIO &&
+                static_cast<double>(difference.blocks) <=
+                    MAX_BLOCK_DIFFERENCE * blocks &&
+                difference.surfaces <= MAX_SURFACE_DIFFERENCE * surfaces;
+
+  JobSystem jobs;
+  std::vector<std::uint64_t> expected;
+  WorldStats total;
+  for (auto coord : area) {
+    const auto &column = serial.at(coord.x, coord.z);
+    expected.push_back(hashColumn(column));
+    auto stats = countBlocks(column);
+    total.logs += stats.logs;
+    total.stone += stats.stone;
+    total.air += stats.air;
+  }
+  // trees, caves and terrain all made it in
+  ok &= total.logs > 0 && total.stone > 0 && total.air > 0;
+
+  // requested nearest first, then the reverse; the result must not depend on
+  // the order columns finish in
+  for (bool reverse : {false, true}) {
+    auto order = area;
+    if (reverse) {
+      std::reverse(order.begin(), order.end());
+    }
+    std::unique_ptr<WorldGenerator> generator;
+    auto ms = bench::measureMs([&] {
+      generator = std::make_unique<WorldGenerator>(jobs, SEED);
+      for (auto coord : order) {
+        generator->request(coord.x, coord.z);
+      }
+      generator->finish();
+    });
+    std::vector<const ChunkColumn *> completed;
+    generator->takeCompleted(completed);
+    for (std::size_t i = 0; i < area.size(); i++) {
+      const auto *column = generator->find(area[i].x, area[i].z);
+      ok &= column != nullptr && hashColumn(*column) == expected[i];
+    }
+    ok &= completed.size() == area.size();
+    LOG("{} columns ({} generated in part) on {} threads, {}: pipeline "
+        "{:.1f} ms, one stage at a time on one thread {:.1f} ms, x{:.2f}",
+        area.size(), generator->columnCount() - area.size(),
+        jobs.threadCount(),
+        reverse ? "farthest first" : "nearest first", ms, serialMs,
+        serialMs / ms);
+  }
+  LOG("{} log, {} stone and {} air blocks", total.logs, total.stone,
+      total.air);
+
+  if (!golden) {
+    ELOG("Interpolated density strays from the full resolution output");
+  }
+  if (!ok) {
+    ELOG("Pipeline output differs from the serial generator");
+  }
+  if (!golden || !ok) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -31,7 +31,8 @@ public:
 
   void *getMappedMemory() const { return mMapped; }
   VkBuffer getBuffer() const { return mBuffer; }
-  VkDeviceMemory getMemory() const { return mMemory; }
+  VkDeviceMemory getMemory() const { return mMemory.memory; }
+  VkDeviceSize getMemoryOffset() const { return mMemory.offset; }
 
   VkDeviceSize getBufferSize() const { return mBufferSize; }
   uint32_t getInstanceCount() const { return mInstanceCount; }
@@ -51,7 +52,7 @@ private:
 
   void *mMapped = nullptr;
   VkBuffer mBuffer;
-  VkDeviceMemory mMemory;
+  MemoryAllocation mMemory;
 
   VkDeviceSize mBufferSize;
   uint32_t mInstanceCount;
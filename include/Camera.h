@@ -1,20 +1,44 @@
 #pragma once
 
+#include "Frustum.h"
+
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <vector>
+
 namespace mv {
+// Owns the view and projection of the player and the frustum derived from
+// them. The frustum is rebuilt whenever either matrix changes.
 class Camera {
 public:
-  Camera() {
-    projectionMatrix = glm::mat4(1.0f);
-    viewMatrix = glm::mat4(1.0f);
+  Camera() = default;
+
+  void setPerspective(float fovy, float aspect, float near, float far);
+  void lookAt(const glm::vec3 &position, const glm::vec3 &target,
+              const glm::vec3 &up);
+
+  const glm::mat4 &getProjectionMatrix() const { return projectionMatrix; }
+  const glm::mat4 &getViewMatrix() const { return viewMatrix; }
+  const glm::mat4 &getViewProjectionMatrix() const {
+    return viewProjectionMatrix;
   }
+  const Frustum &getFrustum() const { return frustum; }
 
-  glm::mat4 getViewMatrix() const { return viewMatrix; }
+  // indices of the boxes inside the view frustum, see Frustum::cull
+  std::size_t cull(const AabbList &boxes, std::vector<std::uint32_t> &visible,
+                   CullBackend backend = CullBackend::Auto) const {
+    return frustum.cull(boxes, visible, backend);
+  }
+
+private:
+  void update();
 
 private:
-  glm::mat4 projectionMatrix;
-  glm::mat4 viewMatrix;
+  glm::mat4 projectionMatrix = glm::mat4(1.0f);
+  glm::mat4 viewMatrix = glm::mat4(1.0f);
+  glm::mat4 viewProjectionMatrix = glm::mat4(1.0f);
+  Frustum frustum = {};
 };
 } // namespace mv
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Device.h"
+#include "Model.h"
+#include "TlsfAllocator.h"
+#include "UploadQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mv {
+
+// location of one chunk mesh inside the shared buffers of a ChunkMeshPool
+struct ChunkMeshRange {
+  std::uint32_t vertexBlock = {TlsfAllocator::INVALID_BLOCK};
+  std::uint32_t indexBlock = {TlsfAllocator::INVALID_BLOCK};
+  // in elements, ready to go into VkDrawIndexedIndirectCommand
+  std::int32_t vertexOffset = {0};
+  std::uint32_t firstIndex = {0};
+  std::uint32_t indexCount = {0};
+  UploadTicket vertexTicket = {0};
+  UploadTicket indexTicket = {0};
+
+  bool valid() const noexcept {
+    return vertexBlock != TlsfAllocator::INVALID_BLOCK;
+  }
+};
+
+// Shared device local vertex and index buffers holding every chunk mesh, so
+// all chunks draw from one binding with a single indirect call. Ranges are
+// sub-allocated with TLSF and filled through the UploadQueue; freed ranges
+// are kept until the frames that may still read them have finished.
+// Not thread safe; used from the render thread.
+class ChunkMeshPool {
+public:
+  static constexpr VkDeviceSize DEFAULT_VERTEX_CAPACITY = 64ull * 1024 * 1024;
+  static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 48ull * 1024 * 1024;
+
+  explicit ChunkMeshPool(Device &device,
+                         VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+                         VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+  ~ChunkMeshPool();
+
+  ChunkMeshPool(const ChunkMeshPool &) = delete;
+  ChunkMeshPool &operator=(const ChunkMeshPool &) = delete;
+
+  // returns an invalid mesh when the pool has no room left
+  ChunkMeshRange add(const std::vector<VoxelVertex> &vertices,
+                const std::vector<std::uint32_t> &indices);
+  void remove(ChunkMeshRange &mesh);
+
+  bool isReady(const ChunkMeshRange &mesh) const;
+
+  // releases ranges removed more than MAX_FRAME_IN_FLIGHT frames ago; called
+  // once per frame
+  void nextFrame();
+
+  VkBuffer vertexBuffer() const { return mVertexBuffer->getBuffer(); }
+  VkBuffer indexBuffer() const { return mIndexBuffer->getBuffer(); }
+
+  VkDeviceSize vertexBytesUsed() const noexcept { return mVertexRanges.used(); }
+  VkDeviceSize indexBytesUsed() const noexcept { return mIndexRanges.used(); }
+
+private:
+  struct RetiredMesh {
+    std::uint64_t frame = {0};
+    std::uint32_t vertexBlock = {TlsfAllocator::INVALID_BLOCK};
+    std::uint32_t indexBlock = {TlsfAllocator::INVALID_BLOCK};
+  };
+
+private:
+  Device &mDevice;
+
+  std::unique_ptr<Buffer> mVertexBuffer;
+  std::unique_ptr<Buffer> mIndexBuffer;
+  // byte ranges of the two buffers
+  TlsfAllocator mVertexRanges;
+  TlsfAllocator mIndexRanges;
+
+  std::uint64_t mFrame = {0};
+  std::vector<RetiredMesh> mRetired;
+  // uploads into the shared buffers that were not ready last frame
+  std::vector<UploadTicket> mPendingTickets;
+};
+
+} // namespace mv
@@ -0,0 +1,26 @@
+#pragma once
+
+// compiles a single function for AVX2 or SSE4.1 without raising the baseline
+// of the whole build; callers must check cpu::hasAvx2() or cpu::hasSse41()
+// first
+#if defined(__GNUC__) || defined(__clang__)
+#define MV_TARGET_AVX2 __attribute__((target("avx2")))
+#define MV_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define MV_TARGET_AVX2
+#define MV_TARGET_SSE41
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MV_X86_64 1
+#endif
+
+namespace mv {
+namespace cpu {
+// SSE2 is part of x86-64 and always available there
+bool hasSse2() noexcept;
+bool hasSse41() noexcept;
+// also checks that the OS saves the YMM registers
+bool hasAvx2() noexcept;
+} // namespace cpu
+} // namespace mv
@@ -1,11 +1,17 @@
 #pragma once
 
+#include "DeviceAllocator.h"
 #include "DeviceHelper.h"
 #include "Window.h"
+#include <memory>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 namespace mv {
+class PipelineCache;
+class StagingRing;
+class UploadQueue;
+
 class Device {
 public:
   explicit Device(Window &window);
@@ -26,6 +32,20 @@ public:
 
   VkQueue getPresentQueue() const { return presentQueue; }
 
+  // true when the device exposes a transfer-only queue family
+  bool hasTransferQueue() const { return transferQueue != VK_NULL_HANDLE; }
+  VkQueue getTransferQueue() const { return transferQueue; }
+
+  DeviceAllocator &getAllocator() { return *mAllocator; }
+
+  // shared by every Pipeline, saved to disk when the device goes away
+  PipelineCache &getPipelineCache() { return *mPipelineCache; }
+
+  // source of all buffer/image uploads, flushed once per frame by Renderer
+  StagingRing &getStagingRing() { return *mStagingRing; }
+  // background uploads, acquired by Renderer once per frame
+  UploadQueue &getUploadQueue() { return *mUploadQueue; }
+
   SwapChainSupportDetails getSwapChainSupport() {
     return device_helper::querySwapChainSupport(physicalDevice, &surface);
   }
@@ -40,21 +60,25 @@ public:
   VkFormat findSupportedFormat(const std::vector<VkFormat> &formats,
                                VkImageTiling tiling,
                                VkFormatFeatureFlags features);
+  bool supportsFormatFeatures(VkFormat format, VkImageTiling tiling,
+                              VkFormatFeatureFlags features);
 
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                    VkDeviceMemory &bufferMemory);
+                    MemoryAllocation &bufferMemory);
   void copyBuffer(VkBuffer scrBuffer, VkBuffer dstBuffer, VkDeviceSize size);
   void copyBufferToImage(VkBuffer buffer, VkImage image, std::uint32_t width,
                          std::uint32_t height, std::uint32_t layerCount);
   void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                            VkMemoryPropertyFlags properties, VkImage &image,
-                           VkDeviceMemory &imageMemory);
+                           MemoryAllocation &imageMemory);
 
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
   VkPhysicalDeviceProperties properties;
+  // optional features are only enabled when the device supports them
+  VkPhysicalDeviceFeatures enabledFeatures = {};
 
 private:
   void createInstance();
@@ -82,6 +106,12 @@ private:
   VkCommandPool commandPool;
   VkQueue graphicsQueue;
   VkQueue presentQueue;
+  VkQueue transferQueue = {VK_NULL_HANDLE};
+
+  std::unique_ptr<DeviceAllocator> mAllocator;
+  std::unique_ptr<PipelineCache> mPipelineCache;
+  std::unique_ptr<StagingRing> mStagingRing;
+  std::unique_ptr<UploadQueue> mUploadQueue;
 
   bool enableValidationLayers = {true};
 
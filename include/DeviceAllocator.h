@@ -0,0 +1,114 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mv {
+
+// buffers and linear images vs optimal tiling images; the two are kept in
+// separate pages when bufferImageGranularity could make them alias
+enum class AllocationKind : std::uint32_t { Linear = 0, Optimal = 1 };
+
+struct MemoryPage;
+
+struct MemoryAllocation {
+  VkDeviceMemory memory = {VK_NULL_HANDLE};
+  VkDeviceSize offset = {0};
+  VkDeviceSize size = {0};
+  // persistent mapping of offset for host visible memory, otherwise nullptr
+  void *mapped = {nullptr};
+  std::uint32_t memoryType = {0};
+
+  // owning page and TLSF block; nullptr page means a dedicated allocation
+  MemoryPage *page = {nullptr};
+  std::uint32_t block = {TlsfAllocator::INVALID_BLOCK};
+};
+
+struct DeviceAllocatorStats {
+  // vkAllocateMemory objects alive: pages plus dedicated allocations
+  std::uint32_t deviceMemoryCount = {0};
+  std::uint32_t pageCount = {0};
+  std::uint32_t dedicatedCount = {0};
+  std::uint32_t liveAllocations = {0};
+  VkDeviceSize reservedBytes = {0};
+  VkDeviceSize usedBytes = {0};
+  VkDeviceSize freeBytes = {0};
+  VkDeviceSize largestFreeBlock = {0};
+  std::uint32_t freeBlocks = {0};
+  // 1 - largest free block / free bytes of the most fragmented page; 0 means
+  // every page keeps its free space in one piece
+  float fragmentation = {0.0f};
+};
+
+// Sub-allocates buffers and images from large per memory type pages instead
+// of calling vkAllocateMemory for each resource, which is slow and limited to
+// maxMemoryAllocationCount objects. Each page is a TLSF range; requests larger
+// than half a page get their own dedicated VkDeviceMemory. Host visible pages
+// are mapped once for their whole lifetime. Thread safe.
+class DeviceAllocator {
+public:
+  static constexpr VkDeviceSize DEFAULT_PAGE_SIZE = 64ull * 1024 * 1024;
+
+  DeviceAllocator(VkPhysicalDevice physicalDevice, VkDevice device,
+                  VkDeviceSize pageSize = DEFAULT_PAGE_SIZE);
+  ~DeviceAllocator();
+
+  DeviceAllocator(const DeviceAllocator &) = delete;
+  DeviceAllocator &operator=(const DeviceAllocator &) = delete;
+
+  MemoryAllocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties,
+                            AllocationKind kind);
+  void free(MemoryAllocation &allocation);
+
+  // no-ops on host coherent memory; ranges are widened to nonCoherentAtomSize
+  VkResult flush(const MemoryAllocation &allocation, VkDeviceSize size,
+                 VkDeviceSize offset = 0);
+  VkResult invalidate(const MemoryAllocation &allocation, VkDeviceSize size,
+                      VkDeviceSize offset = 0);
+
+  std::uint32_t findMemoryType(std::uint32_t typeFilter,
+                               VkMemoryPropertyFlags properties) const;
+
+  DeviceAllocatorStats stats() const;
+  void logStats() const;
+
+private:
+  std::uint32_t poolIndex(std::uint32_t memoryType,
+                          AllocationKind kind) const noexcept;
+  VkDeviceSize pageSize(std::uint32_t memoryType) const noexcept;
+  bool isNonCoherent(std::uint32_t memoryType) const noexcept;
+
+  VkDeviceMemory allocateMemory(VkDeviceSize size, std::uint32_t memoryType,
+                                void **mapped);
+  MemoryAllocation allocateDedicated(VkDeviceSize size,
+                                     std::uint32_t memoryType);
+  MemoryPage *createPage(std::uint32_t pool, std::uint32_t memoryType);
+  void destroyPage(MemoryPage *page);
+  std::uint32_t emptyPageCount(std::uint32_t pool) const;
+
+  VkMappedMemoryRange mappedRange(const MemoryAllocation &allocation,
+                                  VkDeviceSize size,
+                                  VkDeviceSize offset) const noexcept;
+
+private:
+  VkDevice mDevice;
+  VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+  VkDeviceSize mPageSize;
+  VkDeviceSize mBufferImageGranularity = {1};
+  VkDeviceSize mNonCoherentAtomSize = {1};
+
+  mutable std::mutex mMutex;
+  // indexed by poolIndex(); each pool only holds pages of one memory type
+  std::vector<std::vector<std::unique_ptr<MemoryPage>>> mPools;
+  std::uint32_t mDedicatedCount = {0};
+  VkDeviceSize mDedicatedBytes = {0};
+};
+
+} // namespace mv
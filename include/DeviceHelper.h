@@ -25,6 +25,9 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   std::optional<std::uint32_t> graphicsFamily;
   std::optional<std::uint32_t> presentFamily;
+  // family with transfer but neither graphics nor compute support, typically
+  // backed by a dedicated DMA engine; absent on e.g. lavapipe
+  std::optional<std::uint32_t> transferFamily;
 
   bool isComplete() const noexcept {
     return graphicsFamily.has_value() && presentFamily.has_value();
@@ -35,6 +38,8 @@ struct FrameInfo {
   VkCommandBuffer commandBuffer;
   VkDescriptorSet frameDescriptorSet;
   std::vector<std::unique_ptr<Model>> &models;
+  // index of the frame in flight, selects per frame buffers
+  int frameIndex = {0};
 };
 
 namespace device_helper {
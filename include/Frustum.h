@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Axis aligned boxes stored as one array per component so the culling loop
+// can load several boxes into one SIMD register.
+struct AabbList {
+  std::vector<float> minX = {};
+  std::vector<float> minY = {};
+  std::vector<float> minZ = {};
+  std::vector<float> maxX = {};
+  std::vector<float> maxY = {};
+  std::vector<float> maxZ = {};
+
+  void push(const glm::vec3 &min, const glm::vec3 &max);
+  void reserve(std::size_t count);
+  void clear();
+  std::size_t size() const noexcept { return minX.size(); }
+};
+
+enum class CullBackend {
+  // best backend the CPU supports
+  Auto,
+  Scalar,
+  Sse,
+  Avx2,
+};
+
+// Six planes (left, right, bottom, top, near, far) with normalized xyz
+// normals pointing inside; a point p is inside a plane when
+// dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+  std::array<glm::vec4, 6> planes = {};
+
+  // Gribb/Hartmann extraction from a Vulkan (depth 0..1) view projection
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+  bool intersects(const glm::vec3 &min, const glm::vec3 &max) const noexcept;
+
+  // writes the indices of the boxes touching the frustum into visible in
+  // ascending order and returns their count; a box is only rejected when it
+  // lies completely outside one plane, so a few boxes near the corners pass
+  std::size_t cull(const AabbList &boxes, std::vector<std::uint32_t> &visible,
+                   CullBackend backend = CullBackend::Auto) const;
+};
+
+} // namespace mv
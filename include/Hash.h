@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mv {
+
+// 64-bit FNV-1a. Used to notice changed or damaged files, not as a hash table
+// function; pass the previous result as seed to hash data in pieces.
+inline std::uint64_t hashBytes(const void *data, std::size_t size,
+                               std::uint64_t seed = 0xcbf29ce484222325ull) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  auto hash = seed;
+  for (std::size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+} // namespace mv
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mv {
+
+// Number of unfinished jobs started with it. Jobs may be added while it is
+// non-zero; it must outlive every job it counts and every job started with
+// runAfter on it.
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  bool done() const noexcept {
+    return mValue.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  friend class JobSystem;
+
+  static constexpr std::uint32_t COUNT_MASK = (1u << 30) - 1;
+  // mContinuations is not empty
+  static constexpr std::uint32_t WAITING = 1u << 30;
+  // a thread is changing mContinuations; keeps done() false while the last
+  // job hands them out, so the counter may go away right after
+  static constexpr std::uint32_t LOCKED = 1u << 31;
+
+  // the job count and the two flags; runAfter parks jobs on const counters
+  mutable std::atomic<std::uint32_t> mValue = {0};
+  // jobs started with runAfter on this counter, queued when it is done
+  mutable void *mContinuations = {nullptr};
+};
+
+// Work stealing scheduler for CPU work of the whole engine. Every worker
+// thread, plus the thread that created the system, owns a Chase-Lev deque:
+// it pushes and pops jobs at the bottom without locks while idle threads
+// steal the oldest job from the top of a random victim. Jobs live in a fixed
+// ring per thread; when that ring is full the job runs inline, which keeps
+// producers from running ahead of the workers.
+//
+// Waiting never blocks a thread that owns a deque: wait() runs other jobs
+// until the counter drops to zero, so jobs can wait for jobs they started
+// (fork/join). runAfter() does not wait: the job stays on the counter and is
+// queued by whichever thread finishes the counter's last job, so it never
+// runs on top of a job its dependency needs. Threads the system does not
+// know run their jobs inline. Jobs must not throw, and captures must fit
+// Job::STORAGE_SIZE; capture by reference.
+class JobSystem {
+public:
+  // 0 uses one worker per hardware thread besides the creating thread
+  explicit JobSystem(std::uint32_t workerCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  template <typename Fn> void run(Fn &&fn, JobCounter *counter = nullptr) {
+    schedule(std::forward<Fn>(fn), counter, nullptr);
+  }
+
+  // fn runs once dependency is done
+  template <typename Fn>
+  void runAfter(const JobCounter &dependency, Fn &&fn,
+                JobCounter *counter = nullptr) {
+    schedule(std::forward<Fn>(fn), counter, &dependency);
+  }
+
+  void wait(const JobCounter &counter);
+
+  // calls fn(first, last) on disjoint ranges covering [begin, end) and
+  // returns when all of them finished. Ranges are halved down to grain so
+  // thieves take the biggest remaining halves first.
+  template <typename Fn>
+  void parallelFor(std::uint32_t begin, std::uint32_t end, std::uint32_t grain,
+                   Fn &&fn) {
+    if (begin >= end) {
+      return;
+    }
+    JobCounter counter;
+    const ForRange<std::remove_reference_t<Fn>> range = {
+        this, &fn, std::max(grain, 1u), &counter};
+    range.split(begin, end);
+    wait(counter);
+  }
+
+  // grain chosen for about eight ranges per thread
+  template <typename Fn>
+  void parallelFor(std::uint32_t begin, std::uint32_t end, Fn &&fn) {
+    auto grain = (end > begin ? end - begin : 0) / (threadCount() * 8);
+    parallelFor(begin, end, grain, std::forward<Fn>(fn));
+  }
+
+  // workers plus the creating thread
+  std::uint32_t threadCount() const noexcept {
+    return static_cast<std::uint32_t>(mWorkers.size());
+  }
+  // 0 on the creating thread, 1..threadCount()-1 on workers; meant for
+  // indexing per thread scratch data. Only valid on threads of this system.
+  std::uint32_t threadIndex() const noexcept;
+
+private:
+  struct alignas(64) Job {
+    static constexpr std::size_t STORAGE_SIZE = 32;
+
+    // calls and destroys the callable in storage
+    void (*invoke)(void *storage) = {nullptr};
+    JobCounter *counter = {nullptr};
+    // next job waiting on the same counter
+    Job *next = {nullptr};
+    // set while the job is waiting, queued or running, the slot is free
+    // otherwise
+    std::atomic<bool> busy = {false};
+    // allocated on the heap because the ring was full, deleted once run
+    bool overflow = {false};
+    alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+  };
+
+  template <typename Fn> struct ForRange {
+    JobSystem *system;
+    Fn *fn;
+    std::uint32_t grain;
+    JobCounter *counter;
+
+    void split(std::uint32_t begin, std::uint32_t end) const {
+      while (end - begin > grain) {
+        auto mid = begin + (end - begin) / 2;
+        system->run([this, mid, end] { split(mid, end); }, counter);
+        end = mid;
+      }
+      (*fn)(begin, end);
+    }
+  };
+
+  struct Worker;
+
+  template <typename Fn>
+  void schedule(Fn &&fn, JobCounter *counter, const JobCounter *dependency) {
+    using Callable = std::decay_t<Fn>;
+    static_assert(sizeof(Callable) <= Job::STORAGE_SIZE,
+                  "job captures too much, capture by reference instead");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t));
+
+    Job *job = allocate();
+    if (job == nullptr) {
+      if (dependency == nullptr || dependency->done()) {
+        fn();
+        return;
+      }
+      // waiting for the dependency here could stack this thread on top of
+      // a job the dependency needs, so the job waits on it instead
+      job = new Job;
+      job->overflow = true;
+    }
+    ::new (static_cast<void *>(job->storage)) Callable(std::forward<Fn>(fn));
+    job->invoke = [](void *storage) {
+      auto *callable = std::launder(static_cast<Callable *>(storage));
+      (*callable)();
+      callable->~Callable();
+    };
+    job->counter = counter;
+    if (counter != nullptr) {
+      counter->mValue.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (dependency == nullptr || !park(job, *dependency)) {
+      push(job);
+    }
+  }
+
+  // nullptr when the calling thread has no free job slot or is not ours
+  Job *allocate();
+  // queues job, or runs it when the calling thread cannot
+  void push(Job *job);
+  // false when dependency is already done and job can be pushed right away
+  bool park(Job *job, const JobCounter &dependency);
+  // counts one job of counter as done and queues the jobs waiting on it
+  void finish(JobCounter &counter);
+  void execute(Job *job);
+  bool runOne(Worker &worker);
+  bool hasWork() const;
+  void workerLoop(Worker &worker);
+  Worker *currentWorker() const noexcept;
+
+private:
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::atomic<bool> mStop = {false};
+  // idle workers sleep on mWake; pushers only bump it while one is asleep
+  std::atomic<std::uint32_t> mWake = {0};
+  std::atomic<std::uint32_t> mSleeping = {0};
+};
+
+} // namespace mv
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace mv {
+
+// Read only memory mapping of a whole file. The pages are only read in by the
+// first access, so a file can be copied to the GPU without an intermediate
+// buffer on the heap.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  // false when the file is missing, empty or cannot be mapped
+  bool open(const std::string &path);
+  void close() noexcept;
+
+  bool isOpen() const noexcept { return mData != nullptr; }
+  const char *data() const noexcept { return mData; }
+  std::size_t size() const noexcept { return mSize; }
+
+private:
+  const char *mData = {nullptr};
+  std::size_t mSize = {0};
+#if defined(_WIN32)
+  void *mFile = {nullptr};
+  void *mMapping = {nullptr};
+#endif
+};
+
+} // namespace mv
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Model.h"
+
+#include <cstdint>
+#include <string>
+
+namespace mv {
+
+// Model geometry in the binary .mvmesh format, which is written the first
+// time an OBJ is loaded and sits next to it:
+//
+//   Header (64 bytes) | vertices | indices
+//
+// Both blobs start at multiples of BLOB_ALIGNMENT and hold Vertex and
+// uint32_t exactly as Model uploads them, already reordered by
+// mesh_optimizer::optimize, so later runs map the file and copy
+// straight into the staging buffer without parsing. The header records the
+// size, mtime and content hash of the OBJ it came from: matching size and
+// mtime is trusted, otherwise the OBJ is hashed and only converted again
+// when its content really changed. A new mtime on the same content is
+// written back into the header, so the hash is paid once.
+class MeshFile {
+public:
+  static constexpr const char *EXTENSION = ".mvmesh";
+  // 2: triangles and vertices are stored in mesh_optimizer order
+  static constexpr std::uint32_t VERSION = 2;
+  static constexpr std::uint64_t BLOB_ALIGNMENT = 16;
+
+  struct Source {
+    std::int64_t mtime = {0};
+    std::uint64_t size = {0};
+    std::uint64_t hash = {0};
+  };
+
+  MeshFile() = default;
+  MeshFile(const MeshFile &) = delete;
+  MeshFile &operator=(const MeshFile &) = delete;
+
+  // loads the mesh of objPath through its .mvmesh, converting the OBJ first
+  // when the cache is missing or stale; false when neither can be read.
+  // jobs, when given, parses the OBJ in parallel.
+  bool load(const std::string &objPath, JobSystem *jobs = nullptr);
+
+  // writes mesh as a .mvmesh for source; atomic like PipelineCache::save
+  static bool write(const std::string &path, const ModelLoader &mesh,
+                    const Source &source);
+  static std::string cachePath(const std::string &objPath);
+
+  const Vertex *vertices() const noexcept { return mVertices; }
+  std::uint32_t vertexCount() const noexcept { return mVertexCount; }
+  const std::uint32_t *indices() const noexcept { return mIndices; }
+  std::uint32_t indexCount() const noexcept { return mIndexCount; }
+
+  // false when the cache could not be written and the parsed OBJ is used
+  bool isMapped() const noexcept { return mFile.isOpen(); }
+  // the OBJ the mapped cache was made from
+  const Source &source() const noexcept { return mSource; }
+
+private:
+  struct Header {
+    char magic[4] = {'M', 'V', 'M', 'S'};
+    std::uint32_t version = {VERSION};
+    std::uint32_t vertexSize = {sizeof(Vertex)};
+    std::uint32_t vertexCount = {0};
+    std::uint32_t indexCount = {0};
+    std::uint32_t reserved = {0};
+    Source source = {};
+    std::uint64_t vertexOffset = {0};
+    std::uint64_t indexOffset = {0};
+  };
+  static_assert(sizeof(Header) == 64);
+
+  // maps path if it holds a well formed .mvmesh, header is its copy
+  bool map(const std::string &path, Header &header);
+  void unmap() noexcept;
+  // stores mtime in the header of the cache at path
+  static bool writeMtime(const std::string &path, std::int64_t mtime);
+
+private:
+  MappedFile mFile;
+  Source mSource = {};
+  // only filled when the OBJ was parsed but could not be cached
+  ModelLoader mParsed;
+
+  const Vertex *mVertices = {nullptr};
+  std::uint32_t mVertexCount = {0};
+  const std::uint32_t *mIndices = {nullptr};
+  std::uint32_t mIndexCount = {0};
+};
+
+} // namespace mv
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Model.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Post processing for imported triangle lists, run once before the data is
+// cached or uploaded. None of it changes what is drawn, only the order.
+namespace mesh_optimizer {
+
+// post transform cache the statistics and the cache pass assume; 16 entries
+// is on the safe side of what current GPUs keep per batch
+constexpr std::uint32_t CACHE_SIZE = 16;
+
+struct CacheStats {
+  // vertex shader runs per triangle: 3 without any reuse, 0.5 at best
+  float acmr = {0.0f};
+  // vertex shader runs per referenced vertex, 1 is ideal
+  float atvr = {0.0f};
+};
+
+struct Settings {
+  bool vertexCache = {true};
+  // needs vertexCache, it sorts the clusters that pass leaves behind
+  bool overdraw = {true};
+  bool vertexFetch = {true};
+  // how much worse than the cache pass the ACMR of a cluster may get when
+  // clusters are split further for the overdraw sort
+  float overdrawThreshold = {1.05f};
+};
+
+// replays indices through a FIFO cache of cacheSize entries
+CacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices,
+                              std::uint32_t vertexCount,
+                              std::uint32_t cacheSize = CACHE_SIZE);
+
+// Tipsify (Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw", 2007). Returns the first triangle of each
+// cluster, a cluster starting wherever the walk had to jump.
+std::vector<std::uint32_t>
+optimizeVertexCache(std::vector<std::uint32_t> &indices,
+                    std::uint32_t vertexCount,
+                    std::uint32_t cacheSize = CACHE_SIZE);
+
+// Splits the clusters of optimizeVertexCache where that costs little cache
+// efficiency and orders them so the ones facing away from the mesh centre
+// come first, which occludes more of the rest from most view directions.
+void optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                      const std::vector<Vertex> &vertices,
+                      const std::vector<std::uint32_t> &clusters,
+                      float threshold, std::uint32_t cacheSize = CACHE_SIZE);
+
+// renumbers vertices in the order the indices first use them, so vertex
+// fetches walk memory forward; unused vertices are dropped
+void optimizeVertexFetch(std::vector<Vertex> &vertices,
+                         std::vector<std::uint32_t> &indices);
+
+// runs the passes enabled in settings and logs ACMR and ATVR before and after
+void optimize(ModelLoader &mesh, const Settings &settings = {});
+
+} // namespace mesh_optimizer
+} // namespace mv
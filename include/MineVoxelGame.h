@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Device.h"
+#include "JobSystem.h"
 #include "Renderer.h"
 #include "Window.h"
 
+#include <chrono>
+
 namespace mv {
 class MineVoxelGame {
   static constexpr auto WIDTH = 1280;
@@ -16,8 +19,12 @@ public:
   void run();
 
 private:
+  // first member, so startup timing includes the device and swap chain
+  std::chrono::high_resolution_clock::time_point startTime =
+      std::chrono::high_resolution_clock::now();
+  JobSystem jobSystem;
   Window window{"minevoxel", WIDTH, HEIGHT};
   Device device{window};
-  Renderer renderer{window, device};
+  Renderer renderer{window, device, jobSystem};
 };
 } // namespace mv
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Buffer.h"
 #include "Device.h"
+#include "UploadQueue.h"
 
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
@@ -11,6 +12,9 @@
 
 namespace mv {
 
+class JobSystem;
+class MeshFile;
+
 struct Vertex {
   glm::vec3 position = {};
   glm::vec3 color = {};
@@ -27,29 +31,83 @@ struct Vertex {
   }
 };
 
+// Block mesh vertex packed into two 32-bit words:
+//   data0: x:6 | y:6 | z:6 | face:3 | ao:2 | unused:9
+//   data1: texture layer:16 | sky light:4 | block light:4 | unused:8
+// Positions are chunk local (0..32). Normals come from the face index and
+// texture coordinates are derived from the position in shaders/voxel.vert.
+struct VoxelVertex {
+  uint32_t data0 = {0};
+  uint32_t data1 = {0};
+
+  static constexpr VoxelVertex pack(uint32_t x, uint32_t y, uint32_t z,
+                                    uint32_t face, uint32_t ao, uint32_t layer,
+                                    uint32_t skyLight, uint32_t blockLight) {
+    VoxelVertex vertex = {};
+    vertex.data0 = (x & 63u) | ((y & 63u) << 6) | ((z & 63u) << 12) |
+                   ((face & 7u) << 18) | ((ao & 3u) << 21);
+    vertex.data1 = (layer & 0xffffu) | ((skyLight & 15u) << 16) |
+                   ((blockLight & 15u) << 20);
+    return vertex;
+  }
+
+  static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+  static std::vector<VkVertexInputAttributeDescription>
+  getAttributeDescriptions();
+};
+static_assert(sizeof(VoxelVertex) == 8, "VoxelVertex must stay 8 bytes");
+
+// Wavefront OBJ reader: positions with optional vertex colors, texture
+// coordinates, normals and polygon faces, which are fan triangulated; other
+// statements are ignored. The file is mapped and split into line aligned
+// chunks that are parsed in parallel when a job system is given. Vertices
+// with identical bits are welded in file order.
 struct ModelLoader {
   std::vector<Vertex> vertices = {};
   std::vector<uint32_t> indices = {};
 
-  void load(const std::string &filePath);
+  // leaves both vectors empty and logs the line when the file is malformed
+  void load(const std::string &filePath, JobSystem *jobs = nullptr);
 };
 
+// Immediate records the copies into this frame's StagingRing; Async hands
+// them to the UploadQueue and the model must not be drawn before isReady()
+enum class UploadMode { Immediate, Async };
+
 class Model {
 public:
   Model(Device &device, const ModelLoader &loader);
+  // copies straight from the mapped file
+  Model(Device &device, const MeshFile &mesh);
+  Model(Device &device, const std::vector<Vertex> &vertices,
+        const std::vector<uint32_t> &indices,
+        UploadMode uploadMode = UploadMode::Immediate);
+  Model(Device &device, const std::vector<VoxelVertex> &vertices,
+        const std::vector<uint32_t> &indices,
+        UploadMode uploadMode = UploadMode::Immediate);
+  ~Model();
 
   Model(const Model &) = delete;
   Model &operator=(const Model &) = delete;
 
+  bool isReady() const;
+
   void bind(VkCommandBuffer commandBuffer);
   void draw(VkCommandBuffer commandBuffer);
 
 private:
-  void createVertexBuffer(const std::vector<Vertex> &vertices);
-  void createIndexBuffer(const std::vector<uint32_t> &indices);
+  void createVertexBuffer(const void *vertices, VkDeviceSize vertexSize,
+                          uint32_t vertexCount);
+  void createIndexBuffer(const uint32_t *indices, uint32_t indexCount);
+  UploadTicket upload(VkBuffer buffer, const void *data, VkDeviceSize size,
+                      VkAccessFlags dstAccess);
 
 private:
   Device &mDevice;
+  UploadMode mUploadMode = {UploadMode::Immediate};
+  // 0 for immediate uploads
+  UploadTicket mVertexTicket = {0};
+  UploadTicket mIndexTicket = {0};
 
   std::unique_ptr<Buffer> mVertexBuffer;
   uint32_t mVertexCount = {0};
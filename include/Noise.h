@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Coherent noise for world generation. sample() is the scalar reference and
+// evaluates one point; generate() fills a whole grid per call with SSE4.1 or
+// AVX2 kernels picked at runtime, which is where generation spends its time.
+// Both agree to float rounding for every type and fractal. Values lie in
+// about [-1, 1].
+namespace noise {
+
+enum class NoiseType {
+  // Perlin's gradient noise on the square/cube lattice
+  Perlin,
+  // Gustavson's simplex noise
+  Simplex,
+  // OpenSimplex2: rotated gradients in 2D, two offset BCC lattices in 3D;
+  // fewer axis aligned artifacts than Simplex
+  OpenSimplex2,
+  // distance to the nearest jittered feature point, one per lattice cell
+  Cellular,
+};
+
+enum class FractalType {
+  None,
+  // octaves summed with falling amplitude
+  Fbm,
+  // octaves of 1 - 2|n|, sharp crests where the noise crosses zero
+  Ridged,
+};
+
+enum class NoiseBackend {
+  // best backend the CPU supports
+  Auto,
+  Scalar,
+  Sse41,
+  Avx2,
+};
+
+struct NoiseSettings {
+  NoiseType type = {NoiseType::OpenSimplex2};
+  FractalType fractal = {FractalType::None};
+  std::int32_t seed = {1337};
+  float frequency = {0.01f};
+  // fractal only: layer count, and the frequency and amplitude factors from
+  // one layer to the next; every layer uses the next seed
+  std::uint32_t octaves = {4};
+  float lacunarity = {2.0f};
+  float gain = {0.5f};
+};
+
+// sizeX * sizeY samples starting at origin, step apart along each axis
+struct Grid2 {
+  glm::vec2 origin = {0.0f, 0.0f};
+  glm::vec2 step = {1.0f, 1.0f};
+  std::uint32_t sizeX = {0};
+  std::uint32_t sizeY = {0};
+
+  std::size_t size() const noexcept {
+    return static_cast<std::size_t>(sizeX) * sizeY;
+  }
+};
+
+// sizeX * sizeY * sizeZ samples starting at origin, step apart along each
+// axis
+struct Grid3 {
+  glm::vec3 origin = {0.0f, 0.0f, 0.0f};
+  glm::vec3 step = {1.0f, 1.0f, 1.0f};
+  std::uint32_t sizeX = {0};
+  std::uint32_t sizeY = {0};
+  std::uint32_t sizeZ = {0};
+
+  std::size_t size() const noexcept {
+    return static_cast<std::size_t>(sizeX) * sizeY * sizeZ;
+  }
+};
+
+float sample(const NoiseSettings &settings, const glm::vec2 &position);
+float sample(const NoiseSettings &settings, const glm::vec3 &position);
+
+// out[x * sizeY + y]; a 2D grid over world x and z is a chunk's columns
+void generate(const NoiseSettings &settings, const Grid2 &grid,
+              std::vector<float> &out,
+              NoiseBackend backend = NoiseBackend::Auto);
+// out[(x * sizeZ + z) * sizeY + y], Y fastest like Chunk::index
+void generate(const NoiseSettings &settings, const Grid3 &grid,
+              std::vector<float> &out,
+              NoiseBackend backend = NoiseBackend::Auto);
+
+// the backend generate() runs for backend on this CPU
+NoiseBackend resolve(NoiseBackend backend);
+
+} // namespace noise
+} // namespace mv
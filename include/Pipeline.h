@@ -12,6 +12,8 @@ struct PipelineConfig {
   PipelineConfig(const PipelineConfig &) = delete;
   PipelineConfig &operator=(const PipelineConfig &) = delete;
 
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
   VkPipelineViewportStateCreateInfo viewportInfo = {};
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
   VkPipelineRasterizationStateCreateInfo rasterizationInfo = {};
@@ -28,13 +30,34 @@ struct PipelineConfig {
 
 class Pipeline {
 public:
+  // vkCreateGraphicsPipelines input for one pipeline; points into itself and
+  // into the config, so it stays where it was filled
+  struct CreateInfo {
+    CreateInfo() = default;
+    CreateInfo(const CreateInfo &) = delete;
+    CreateInfo &operator=(const CreateInfo &) = delete;
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  };
+
   Pipeline(Device &device, const std::string &vertexFilepath,
            const std::string &fragmentFilepath, const PipelineConfig &config);
+  // takes ownership of a pipeline created elsewhere, see PipelineLibrary
+  Pipeline(Device &device, VkPipeline pipeline);
   ~Pipeline();
 
+  Pipeline(const Pipeline &) = delete;
+  Pipeline &operator=(const Pipeline &) = delete;
+
   void bind(VkCommandBuffer commandBuffer);
 
   static void defaultPipelineConfig(PipelineConfig &config) noexcept;
+  static void fillCreateInfo(const PipelineConfig &config,
+                             VkShaderModule vertexModule,
+                             VkShaderModule fragmentModule,
+                             CreateInfo &createInfo) noexcept;
 
 private:
   void createGraphicsPipeline(const std::string &vertexFilepath,
@@ -46,8 +69,9 @@ private:
 private:
   Device &mDevice;
 
-  VkPipeline graphicsPipeline;
-  VkShaderModule vertexShaderModule;
-  VkShaderModule fragmentShaderModule;
+  VkPipeline graphicsPipeline = {VK_NULL_HANDLE};
+  // only set when the pipeline created its own modules
+  VkShaderModule vertexShaderModule = {VK_NULL_HANDLE};
+  VkShaderModule fragmentShaderModule = {VK_NULL_HANDLE};
 };
 } // namespace mv
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mv {
+
+// VkPipelineCache persisted between runs. The blob is loaded at startup and
+// only used when the Vulkan header matches this device's vendor, device and
+// pipeline cache UUID; our own file header adds a size and a hash so a
+// truncated or corrupt file is dropped before the driver sees it. save()
+// writes a temporary file and renames it over the old one, so a crash while
+// saving never leaves a half written cache behind.
+class PipelineCache {
+public:
+  static constexpr const char *DEFAULT_PATH = "pipeline_cache.bin";
+
+  PipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties,
+                std::string path = DEFAULT_PATH);
+  // saves the cache
+  ~PipelineCache();
+
+  PipelineCache(const PipelineCache &) = delete;
+  PipelineCache &operator=(const PipelineCache &) = delete;
+
+  VkPipelineCache get() const noexcept { return mCache; }
+
+  // true when a valid blob from an earlier run was loaded
+  bool isWarm() const noexcept { return mWarm; }
+
+  bool save();
+
+  // time spent creating count pipelines, reported by Pipeline and
+  // PipelineLibrary; thread safe
+  void addCompileTime(double ms, std::uint32_t count = 1) noexcept;
+  double compileTimeMs() const noexcept;
+  std::uint32_t pipelineCount() const noexcept {
+    return mPipelineCount.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct FileHeader {
+    char magic[4] = {'M', 'V', 'P', 'C'};
+    std::uint32_t version = {1};
+    std::uint64_t dataSize = {0};
+    std::uint64_t dataHash = {0};
+  };
+
+  // empty when there is no usable cache file
+  std::vector<char> loadBlob();
+  bool matchesDevice(const std::vector<char> &blob) const;
+
+private:
+  VkDevice mDevice;
+  VkPhysicalDeviceProperties mProperties;
+  std::string mPath;
+  VkPipelineCache mCache = {VK_NULL_HANDLE};
+  bool mWarm = {false};
+  // hash of the blob on disk, unchanged caches are not written again
+  std::uint64_t mSavedHash = {0};
+
+  std::atomic<std::uint64_t> mCompileNs = {0};
+  std::atomic<std::uint32_t> mPipelineCount = {0};
+};
+
+} // namespace mv
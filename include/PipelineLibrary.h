@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Device.h"
+#include "Pipeline.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mv {
+
+class JobSystem;
+
+// Owns the graphics pipelines of the render systems. add() registers a
+// variant and returns its handle right away; compile() creates everything
+// pending at once, one batched vkCreateGraphicsPipelines call per job system
+// thread, so startup pays for the slowest batch instead of the sum of all
+// pipelines. Each SPIR-V file is read once and shader modules are shared
+// between pipelines whose code hashes and compares equal.
+class PipelineLibrary {
+public:
+  using Handle = std::uint32_t;
+
+  PipelineLibrary(Device &device, JobSystem &jobs);
+  ~PipelineLibrary();
+
+  PipelineLibrary(const PipelineLibrary &) = delete;
+  PipelineLibrary &operator=(const PipelineLibrary &) = delete;
+
+  // the config needs its render pass and layout, it is kept until compiled
+  Handle add(const std::string &vertexFilepath,
+             const std::string &fragmentFilepath,
+             std::unique_ptr<PipelineConfig> config);
+
+  // creates every pipeline added since the last call
+  void compile();
+
+  // compiles pending pipelines first, which is only allowed on the thread
+  // that owns the library; once compiled any thread may call it
+  Pipeline &get(Handle handle);
+
+  std::uint32_t shaderModuleCount() const noexcept {
+    return static_cast<std::uint32_t>(mModules.size());
+  }
+
+private:
+  struct ShaderModule {
+    std::uint64_t hash = {0};
+    std::vector<char> code;
+    VkShaderModule module = {VK_NULL_HANDLE};
+  };
+
+  struct Entry {
+    VkShaderModule vertexModule = {VK_NULL_HANDLE};
+    VkShaderModule fragmentModule = {VK_NULL_HANDLE};
+    std::unique_ptr<PipelineConfig> config;
+    std::unique_ptr<Pipeline> pipeline;
+  };
+
+  VkShaderModule loadShaderModule(const std::string &filepath);
+
+private:
+  Device &mDevice;
+  JobSystem &mJobs;
+
+  std::vector<Entry> mEntries;
+  std::vector<Handle> mPending;
+
+  std::vector<ShaderModule> mModules;
+  std::unordered_map<std::string, VkShaderModule> mModulesByPath;
+  // content hash to index into mModules
+  std::unordered_multimap<std::uint64_t, std::size_t> mModulesByHash;
+};
+
+} // namespace mv
@@ -1,19 +1,25 @@
 #pragma once
 
 #include "Device.h"
+#include "JobSystem.h"
 #include "SwapChain.h"
 #include "Window.h"
 
 #include <vulkan/vulkan.h>
 
 #include <cassert>
+#include <functional>
 #include <memory>
 #include <vector>
 
 namespace mv {
+// records draws into a secondary command buffer that continues the swap chain
+// render pass; runs on a job system thread
+using SecondaryRecorder = std::function<void(VkCommandBuffer)>;
+
 class Renderer {
 public:
-  Renderer(Window &window, Device &device);
+  Renderer(Window &window, Device &device, JobSystem &jobs);
   ~Renderer();
 
   Renderer(const Renderer &) = delete;
@@ -40,20 +46,47 @@ public:
 
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // pass VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to draw through
+  // recordSecondaries(); viewport and scissor are then set per secondary
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+  // Records each recorder into its own secondary command buffer, in parallel
+  // on the job system, then executes them in order on commandBuffer. Every
+  // thread allocates from its own command pool of the current frame, so the
+  // recorders never share a pool.
+  void recordSecondaries(VkCommandBuffer commandBuffer,
+                         const std::vector<SecondaryRecorder> &recorders);
+
 private:
+  // command pool of one thread for one frame in flight; reset as a whole
+  // when the frame starts again
+  struct ThreadCommands {
+    VkCommandPool pool = {VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> secondaries = {};
+    std::uint32_t used = {0};
+  };
+
   void createCommandBuffers();
   void freeCommandBuffers();
+  void createThreadCommandPools();
+  void destroyThreadCommandPools();
+  VkResult beginSecondary(ThreadCommands &commands, VkCommandBuffer &out);
   void recreateSwapChain();
 
 private:
   Window &mWindow;
   Device &mDevice;
+  JobSystem &mJobs;
 
   std::unique_ptr<SwapChain> swapChain;
   std::vector<VkCommandBuffer> commandBuffers;
+  // [frame in flight][job system thread]
+  std::vector<std::vector<ThreadCommands>> mThreadCommands;
+  std::vector<VkCommandBuffer> mSecondaries;
+  std::vector<VkResult> mSecondaryResults;
 
   std::uint32_t currentImageIdx;
   int currentFrameIdx = {0};
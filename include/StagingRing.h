@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mv {
+
+struct StagingAllocation {
+  void *mapped = {nullptr};
+  VkBuffer buffer = {VK_NULL_HANDLE};
+  VkDeviceSize offset = {0};
+};
+
+struct StagingStats {
+  VkDeviceSize bytesStaged = {0};
+  std::uint32_t uploads = {0};
+  std::uint32_t submits = {0};
+  // times allocate() had to block on a fence for ring space
+  std::uint32_t stalls = {0};
+  // uploads too large for the ring that got a dedicated staging buffer
+  std::uint32_t dedicatedUploads = {0};
+};
+
+// Persistently mapped host visible ring used as the source of every
+// buffer/image upload. Copies are recorded into one upload command buffer per
+// frame; submit() hands that buffer to the ring's queue with the frame's
+// fence and the ring space it used is reclaimed once the fence signals, so
+// nothing on the upload path waits for the queue to go idle.
+// Not thread safe; a ring is used by the thread owning its queue (the render
+// thread for Device's ring, the UploadQueue worker for the transfer ring).
+class StagingRing {
+public:
+  static constexpr std::uint32_t FRAME_COUNT = 3;
+  static constexpr VkDeviceSize DEFAULT_CAPACITY = 32ull * 1024 * 1024;
+
+  StagingRing(Device &device, VkQueue queue, std::uint32_t queueFamily,
+              VkDeviceSize capacity = DEFAULT_CAPACITY);
+  ~StagingRing();
+
+  StagingRing(const StagingRing &) = delete;
+  StagingRing &operator=(const StagingRing &) = delete;
+
+  // reserves size bytes of mapped staging memory for the current frame; the
+  // memory stays valid until the frame's upload commands complete
+  StagingAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+  // upload command buffer of the current frame, begun on first use
+  VkCommandBuffer commandBuffer();
+
+  void uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size,
+                    VkDeviceSize dstOffset = 0);
+  // image must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL when the copy runs;
+  // width and height are those of mipLevel
+  void uploadImage(VkImage image, const void *data, VkDeviceSize size,
+                   std::uint32_t width, std::uint32_t height,
+                   std::uint32_t layerCount = 1, std::uint32_t mipLevel = 0);
+
+  // submits the recorded uploads ahead of the frame's draw commands and
+  // returns the submission serial; does nothing when the frame recorded no
+  // uploads and returns the last serial instead
+  std::uint64_t submit();
+
+  // serial of the newest submission known to have finished on the GPU;
+  // reclaims the ring space of every finished frame without blocking
+  std::uint64_t completedSerial();
+  // returns false when the submission did not finish within timeout
+  bool waitForSerial(std::uint64_t serial, std::uint64_t timeout = UINT64_MAX);
+
+  // destroys buffer once the current frame's submission finished, which
+  // covers everything recorded into the ring so far and every earlier
+  // submission to its queue; for resources that uploads may still target
+  void release(std::unique_ptr<Buffer> buffer);
+
+  std::uint32_t queueFamily() const noexcept { return mQueueFamily; }
+  VkDeviceSize capacity() const noexcept { return mCapacity; }
+  VkDeviceSize used() const noexcept { return mHead - mTail; }
+  const StagingStats &stats() const noexcept { return mStats; }
+  void resetStats() noexcept { mStats = {}; }
+
+private:
+  struct UploadFrame {
+    VkCommandBuffer commandBuffer = {VK_NULL_HANDLE};
+    VkFence fence = {VK_NULL_HANDLE};
+    // ring head when the frame was submitted; everything before it is free
+    // once the fence signals
+    VkDeviceSize end = {0};
+    std::uint64_t serial = {0};
+    bool recording = {false};
+    bool inFlight = {false};
+    // dedicated staging buffers and released resources, freed once the
+    // fence signals
+    std::vector<std::unique_ptr<Buffer>> retained = {};
+  };
+
+  void createCommandPool();
+  void createFrames();
+  void beginFrame(UploadFrame &frame);
+  void retire(UploadFrame &frame);
+  bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment,
+                   VkDeviceSize &offset);
+  StagingAllocation allocateDedicated(VkDeviceSize size);
+
+private:
+  Device &mDevice;
+  VkQueue mQueue;
+  std::uint32_t mQueueFamily;
+  // transfer-only queues cannot use the graphics stage barrier after copies
+  bool mGraphicsQueue = {false};
+
+  VkCommandPool mCommandPool = {VK_NULL_HANDLE};
+  std::unique_ptr<Buffer> mBuffer;
+  char *mMapped = {nullptr};
+
+  // monotonic byte offsets, the physical offset is offset % mCapacity
+  VkDeviceSize mCapacity;
+  VkDeviceSize mHead = {0};
+  VkDeviceSize mTail = {0};
+
+  std::array<UploadFrame, FRAME_COUNT> mFrames = {};
+  std::uint32_t mFrameIdx = {0};
+  std::uint64_t mSubmitSerial = {0};
+  std::uint64_t mCompletedSerial = {0};
+
+  StagingStats mStats = {};
+};
+} // namespace mv
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Device.h"
+#include "StagingRing.h"
 
 #include <vulkan/vulkan.h>
 
@@ -9,6 +10,37 @@
 #include <string>
 
 namespace mv {
+  // Mip chain helpers shared by every sampled image. Images are expected to
+  // live on the graphics queue's staging ring, blits are not available on
+  // transfer-only queues.
+  namespace texture_helper {
+    // full chain down to 1x1
+    std::uint32_t mipLevelCount(std::uint32_t width, std::uint32_t height);
+
+    // the GPU path needs linear filtered blits from and to format
+    bool canBlitMipmaps(Device& device, VkFormat format);
+
+    // Every range the transfer and sampling code moves images through:
+    // UNDEFINED -> TRANSFER_DST -> (TRANSFER_SRC ->) SHADER_READ_ONLY.
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image,
+      const VkImageSubresourceRange& range,
+      VkImageLayout oldLayout, VkImageLayout newLayout);
+
+    // Blits level 0 down the chain. Every level must be in TRANSFER_DST and
+    // level 0 filled; all of them end up in SHADER_READ_ONLY.
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image,
+      std::uint32_t width, std::uint32_t height,
+      std::uint32_t mipLevels, std::uint32_t layerCount = 1);
+
+    // Fallback for formats without linear blits: box filters RGBA8 pixels
+    // (layerCount tightly packed layers) on the CPU and uploads every level.
+    // sRGB data is averaged in linear space like a blit would. Levels stay in
+    // TRANSFER_DST.
+    void uploadMipChain(StagingRing& staging, VkImage image, VkFormat format,
+      const std::uint8_t* pixels, std::uint32_t width, std::uint32_t height,
+      std::uint32_t mipLevels, std::uint32_t layerCount = 1);
+  } // namespace texture_helper
+
   class Texture {
   public:
     Texture(Device& device, const std::string& textureFilePath, VkFormat format);
@@ -23,20 +55,22 @@ namespace mv {
       return mImageSampler;
     }
 
+    std::uint32_t mipLevels() const {
+      return mMipLevels;
+    }
+
   private:
     void loadTextureFromFile(const std::string& filePath);
     void createTexture();
     void createImageView();
     void createTextureSampler();
     void createImageBuffer();
-    void transitionImageLayout(VkImage image, VkFormat format,
-      VkImageLayout oldLayout, VkImageLayout newLayout);
 
   private:
     Device& mDevice;
 
     VkImage mImage;
-    VkDeviceMemory mImageMemory;
+    MemoryAllocation mImageMemory;
     VkImageView mImageView;
     VkSampler mImageSampler;
     VkFormat mFormat;
@@ -44,7 +78,8 @@ namespace mv {
     std::int32_t mWidth;
     std::int32_t mHeight;
     std::int32_t mChannels;
+    std::uint32_t mMipLevels = { 1 };
     stbi_uc* mImageRawData;
   };
 
-} // namespace mv
\ No newline at end of file
+} // namespace mv
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Device.h"
+#include "JobSystem.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace mv {
+  // Every *.png of a directory as one layer of a single 2D array image with
+  // a full mip chain, so all block faces share one descriptor and tiles
+  // cannot bleed into each other the way atlas cells do. Layers are named
+  // after the file stem and ordered by name after layer 0, a generated
+  // checkerboard that stands in for unknown names and for files that fail to
+  // decode or differ in size from the first tile. Files are decoded in
+  // parallel on the job system.
+  class TextureArray {
+  public:
+    static constexpr std::uint32_t MISSING_LAYER = 0;
+    // tile size when the directory holds no usable image
+    static constexpr std::uint32_t DEFAULT_TILE_SIZE = 16;
+
+    TextureArray(Device& device, JobSystem& jobs, const std::string& directory,
+      VkFormat format);
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // MISSING_LAYER for names without a file
+    std::uint32_t layer(const std::string& name) const;
+    std::uint32_t layerCount() const { return mLayerCount; }
+    std::uint32_t tileSize() const { return mTileSize; }
+    std::uint32_t mipLevels() const { return mMipLevels; }
+
+    VkImageView getImageView() const { return mImageView; }
+    VkSampler getSampler() const { return mImageSampler; }
+    VkDescriptorImageInfo descriptorInfo() const;
+
+  private:
+    void createImage(const std::uint8_t* pixels);
+    void createImageView();
+    void createTextureSampler();
+
+  private:
+    Device& mDevice;
+
+    VkImage mImage = { VK_NULL_HANDLE };
+    MemoryAllocation mImageMemory;
+    VkImageView mImageView = { VK_NULL_HANDLE };
+    VkSampler mImageSampler = { VK_NULL_HANDLE };
+    VkFormat mFormat;
+
+    std::uint32_t mTileSize = { DEFAULT_TILE_SIZE };
+    std::uint32_t mLayerCount = { 1 };
+    std::uint32_t mMipLevels = { 1 };
+    std::unordered_map<std::string, std::uint32_t> mLayers;
+  };
+
+} // namespace mv
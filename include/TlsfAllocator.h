@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Two-level segregated fit allocator over an abstract [0, size) range. It only
+// hands out offsets; DeviceAllocator maps them onto VkDeviceMemory pages.
+// Allocation and free are O(1): the first level splits sizes by power of two,
+// the second level into SL_COUNT linear steps, and bitmaps find the first
+// non-empty free list that is guaranteed to fit.
+class TlsfAllocator {
+public:
+  static constexpr std::uint32_t INVALID_BLOCK = UINT32_MAX;
+  static constexpr std::uint32_t SL_BITS = 4;
+  static constexpr std::uint32_t SL_COUNT = 1u << SL_BITS;
+  static constexpr std::uint32_t FL_COUNT = 64;
+  // smallest block and the granularity of every size and offset
+  static constexpr std::uint64_t MIN_BLOCK_SIZE = SL_COUNT;
+
+  explicit TlsfAllocator(std::uint64_t size);
+
+  // returns a block handle for free(), or INVALID_BLOCK when no free block
+  // can hold size bytes at the given power of two alignment
+  std::uint32_t allocate(std::uint64_t size, std::uint64_t alignment,
+                         std::uint64_t &offset);
+  void free(std::uint32_t block);
+
+  std::uint64_t size() const noexcept { return mSize; }
+  std::uint64_t used() const noexcept { return mUsed; }
+  std::uint32_t allocationCount() const noexcept { return mAllocationCount; }
+  bool empty() const noexcept { return mAllocationCount == 0; }
+
+  std::uint32_t freeBlockCount() const noexcept;
+  std::uint64_t largestFreeBlock() const noexcept;
+
+private:
+  struct Block {
+    std::uint64_t offset = {0};
+    std::uint64_t size = {0};
+    std::uint32_t prevPhysical = {INVALID_BLOCK};
+    std::uint32_t nextPhysical = {INVALID_BLOCK};
+    std::uint32_t prevFree = {INVALID_BLOCK};
+    std::uint32_t nextFree = {INVALID_BLOCK};
+    bool free = {false};
+  };
+
+  static void mapping(std::uint64_t size, std::uint32_t &fl,
+                      std::uint32_t &sl) noexcept;
+
+  std::uint32_t findFree(std::uint64_t size) const noexcept;
+  void insertFree(std::uint32_t block) noexcept;
+  void removeFree(std::uint32_t block) noexcept;
+  // splits the first size bytes off block; returns the block holding the rest
+  std::uint32_t split(std::uint32_t block, std::uint64_t size);
+  void mergeWithNext(std::uint32_t block);
+
+  std::uint32_t newBlock();
+  void releaseBlock(std::uint32_t block);
+
+private:
+  std::uint64_t mSize;
+  std::uint64_t mUsed = {0};
+  std::uint32_t mAllocationCount = {0};
+
+  std::vector<Block> mBlocks;
+  std::vector<std::uint32_t> mUnusedBlocks;
+
+  std::uint64_t mFlBitmap = {0};
+  std::array<std::uint32_t, FL_COUNT> mSlBitmaps = {};
+  std::array<std::array<std::uint32_t, SL_COUNT>, FL_COUNT> mFreeLists;
+};
+
+} // namespace mv
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mv {
+class Device;
+class StagingRing;
+
+// increases with every request; tickets become ready in issue order
+using UploadTicket = std::uint64_t;
+
+// Uploads resources off the render thread. When the device has a transfer-only
+// queue family a worker thread records the copies on that queue and releases
+// the resources to the graphics family; acquire() records the matching
+// acquire barriers on the render thread once the transfer batch finished.
+// Without such a family (e.g. lavapipe) the requests are recorded into the
+// graphics StagingRing by acquire() instead. Either way a ticket is ready once
+// the draws recorded after it can safely use the resource, which may be
+// before the GPU ran the graphics ring's part of the upload.
+// Request functions are thread safe; acquire() and cancel() belong to the
+// render thread.
+class UploadQueue {
+public:
+  explicit UploadQueue(Device &device);
+  ~UploadQueue();
+
+  UploadQueue(const UploadQueue &) = delete;
+  UploadQueue &operator=(const UploadQueue &) = delete;
+
+  // data is copied, the caller may free it right away; dstStage/dstAccess
+  // describe how the graphics queue reads the buffer afterwards
+  UploadTicket uploadBuffer(VkBuffer dstBuffer, const void *data,
+                            VkDeviceSize size, VkDeviceSize dstOffset,
+                            VkPipelineStageFlags dstStage,
+                            VkAccessFlags dstAccess);
+  // image starts in VK_IMAGE_LAYOUT_UNDEFINED and ends up in
+  // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+  UploadTicket uploadImage(VkImage image, const void *data, VkDeviceSize size,
+                           std::uint32_t width, std::uint32_t height,
+                           std::uint32_t layerCount = 1);
+
+  bool isReady(UploadTicket ticket) const noexcept {
+    return ticket <= mReadyTicket.load(std::memory_order_acquire);
+  }
+
+  // drops a request whose destination is about to be destroyed; blocks while
+  // the transfer queue still writes to it. Copies and acquire barriers that
+  // are already in the graphics ring are not waited for, the destination has
+  // to go through StagingRing::release() instead of being destroyed.
+  void cancel(UploadTicket ticket);
+
+  // records the graphics side of finished uploads into graphicsRing; called
+  // once per frame before the ring is submitted
+  void acquire(StagingRing &graphicsRing);
+
+  bool isAsync() const noexcept { return mRing != nullptr; }
+
+private:
+  struct Request {
+    UploadTicket ticket = {0};
+    VkBuffer buffer = {VK_NULL_HANDLE};
+    VkImage image = {VK_NULL_HANDLE};
+    VkDeviceSize dstOffset = {0};
+    std::uint32_t width = {0};
+    std::uint32_t height = {0};
+    std::uint32_t layerCount = {0};
+    VkPipelineStageFlags dstStage = {0};
+    VkAccessFlags dstAccess = {0};
+    std::vector<char> data = {};
+  };
+
+  // queue family ownership acquire recorded on the graphics queue
+  struct Acquire {
+    UploadTicket ticket = {0};
+    VkBuffer buffer = {VK_NULL_HANDLE};
+    // only the written range changes owner, the rest of a shared buffer may
+    // be in use by the graphics queue meanwhile
+    VkDeviceSize offset = {0};
+    VkDeviceSize size = {0};
+    VkImage image = {VK_NULL_HANDLE};
+    std::uint32_t layerCount = {0};
+    VkPipelineStageFlags dstStage = {0};
+    VkAccessFlags dstAccess = {0};
+  };
+
+  struct InFlightBatch {
+    std::uint64_t serial = {0};
+    UploadTicket firstTicket = {0};
+    UploadTicket lastTicket = {0};
+    std::vector<Acquire> acquires = {};
+  };
+
+  UploadTicket push(Request request);
+  void workerLoop();
+  // records a batch on the transfer queue ring and collects the acquire side
+  void recordTransfer(const std::vector<Request> &batch,
+                      std::vector<Acquire> &acquires);
+  // single queue mode: records a batch straight into the graphics ring
+  void recordDirect(StagingRing &ring, const std::vector<Request> &batch);
+  // moves finished transfer batches to mCompleted, needs mMutex held
+  void retireBatches(std::uint64_t completedSerial);
+  bool isTransferring(UploadTicket ticket) const noexcept;
+
+private:
+  Device &mDevice;
+  std::uint32_t mGraphicsFamily = {0};
+  std::uint32_t mTransferFamily = {0};
+  // transfer queue ring used by the worker; nullptr in single queue mode
+  std::unique_ptr<StagingRing> mRing;
+
+  std::mutex mMutex;
+  // wakes the worker on new requests and on shutdown
+  std::condition_variable mWake;
+  // signalled whenever a transfer batch finished on the GPU
+  std::condition_variable mBatchDone;
+  std::deque<Request> mPending;
+  // tickets the worker is recording right now, not yet in mInFlight
+  UploadTicket mRecordingFirst = {0};
+  UploadTicket mRecordingLast = {0};
+  std::deque<InFlightBatch> mInFlight;
+  std::vector<Acquire> mCompleted;
+  UploadTicket mNextTicket = {1};
+  // every ticket up to this one has left the transfer queue
+  UploadTicket mTransferredTicket = {0};
+  bool mStop = {false};
+
+  std::atomic<UploadTicket> mReadyTicket = {0};
+  std::thread mWorker;
+};
+
+} // namespace mv
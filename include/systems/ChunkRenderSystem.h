@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Buffer.h"
+#include "ChunkMeshPool.h"
+#include "Descriptors.h"
+#include "Device.h"
+#include "PipelineLibrary.h"
+#include "TextureArray.h"
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+namespace mv {
+struct ChunkRenderObject {
+  glm::vec3 origin = {};
+  ChunkMeshRange mesh = {};
+};
+
+// Draws every chunk mesh of a ChunkMeshPool with one vkCmdDrawIndexedIndirect.
+// Each frame in flight owns a host visible buffer of draw commands and an SSBO
+// of chunk origins; draw i passes firstInstance = i so voxel.vert finds its
+// origin through gl_InstanceIndex. Every chunk samples the same block
+// TextureArray through one descriptor set bound as set 2.
+class ChunkRenderSystem {
+public:
+  // upper bound of chunk sections drawn in one frame
+  static constexpr std::uint32_t MAX_DRAWS = 32768;
+  // smallest share of per draw fallback calls worth its own secondary
+  static constexpr std::uint32_t MIN_BUCKET_DRAWS = 512;
+
+  ChunkRenderSystem(Device &device, PipelineLibrary &pipelines,
+                    VkRenderPass renderPass,
+                    VkDescriptorSetLayout globalSetLayout,
+                    const TextureArray &blockTextures);
+  ~ChunkRenderSystem();
+
+  // draws the chunks whose indices are listed in visible
+  void render(FrameInfo &frameInfo, ChunkMeshPool &meshPool,
+              const std::vector<ChunkRenderObject> &chunks,
+              const std::vector<std::uint32_t> &visible);
+
+  // render() in two steps, so the draws can be recorded on other threads.
+  // prepare() writes this frame's draw commands and returns their count; it
+  // belongs to the render thread.
+  std::uint32_t prepare(FrameInfo &frameInfo, ChunkMeshPool &meshPool,
+                        const std::vector<ChunkRenderObject> &chunks,
+                        const std::vector<std::uint32_t> &visible);
+  // records the prepared draws [firstDraw, firstDraw + drawCount) into
+  // frameInfo.commandBuffer; calls on different command buffers may run
+  // concurrently
+  void record(FrameInfo &frameInfo, const ChunkMeshPool &meshPool,
+              std::uint32_t firstDraw, std::uint32_t drawCount);
+  // how many record() calls drawCount draws are worth splitting into; one
+  // when a single indirect call draws them all
+  std::uint32_t bucketCount(std::uint32_t drawCount,
+                            std::uint32_t maxBuckets) const;
+
+private:
+  void createDrawBuffers();
+  void createTextureSet(const TextureArray &blockTextures);
+  void createPipelineLayout(VkDescriptorSetLayout descriptorSetLayout);
+  void createPipeline(VkRenderPass renderPass);
+
+private:
+  Device &mDevice;
+  PipelineLibrary &mPipelines;
+  PipelineLibrary::Handle mPipeline;
+  VkPipelineLayout mPipelineLayout;
+
+  std::unique_ptr<DescriptorSetLayout> mChunkSetLayout;
+  std::unique_ptr<DescriptorPool> mChunkPool;
+  std::vector<VkDescriptorSet> mChunkSets;
+  std::vector<std::unique_ptr<Buffer>> mDrawBuffers;
+  std::vector<std::unique_ptr<Buffer>> mOriginBuffers;
+
+  std::unique_ptr<DescriptorSetLayout> mTextureSetLayout;
+  std::unique_ptr<DescriptorPool> mTexturePool;
+  VkDescriptorSet mTextureSet = {VK_NULL_HANDLE};
+};
+} // namespace mv
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Device.h"
-#include "Pipeline.h"
+#include "PipelineLibrary.h"
 
 #include <vulkan/vulkan.h>
 
@@ -10,7 +10,8 @@
 namespace mv {
 class ModelTestRenderSystem {
 public:
-  ModelTestRenderSystem(Device &device, VkRenderPass renderPass,
+  ModelTestRenderSystem(Device &device, PipelineLibrary &pipelines,
+                        VkRenderPass renderPass,
                         VkDescriptorSetLayout globalSetLayout);
   ~ModelTestRenderSystem();
 
@@ -22,7 +23,8 @@ private:
 
 private:
   Device &mDevice;
-  std::unique_ptr<Pipeline> mPipeline;
+  PipelineLibrary &mPipelines;
+  PipelineLibrary::Handle mPipeline;
   VkPipelineLayout mPipelineLayout;
 };
 } // namespace mv
\ No newline at end of file
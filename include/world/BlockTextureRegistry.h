@@ -0,0 +1,40 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Texture array layer of every face of every block type. ChunkMesher writes
+// the layers into packed vertices; faceLayers() is the same table flattened
+// for shaders that would rather look them up per block from an SSBO.
+class BlockTextureRegistry {
+public:
+  // unassigned faces use layer 0, TextureArray's missing texture
+  static constexpr std::uint32_t DEFAULT_LAYER = 0;
+
+  void assign(BlockId id, std::uint32_t face, std::uint32_t layer);
+  void assign(BlockId id, std::uint32_t layer);
+  void assign(BlockId id, std::uint32_t top, std::uint32_t bottom,
+              std::uint32_t sides);
+
+  std::uint32_t layer(BlockId id, std::uint32_t face) const noexcept {
+    auto idx = static_cast<std::size_t>(id) * FACE_COUNT + face;
+    return idx < mLayers.size() ? mLayers[idx] : DEFAULT_LAYER;
+  }
+
+  // layer of face of block id at id * FACE_COUNT + face
+  const std::vector<std::uint32_t> &faceLayers() const noexcept {
+    return mLayers;
+  }
+  std::uint32_t blockCount() const noexcept {
+    return static_cast<std::uint32_t>(mLayers.size() / FACE_COUNT);
+  }
+
+private:
+  std::vector<std::uint32_t> mLayers;
+};
+
+} // namespace mv
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+using BlockId = std::uint16_t;
+
+namespace block {
+constexpr BlockId AIR = 0;
+constexpr BlockId STONE = 1;
+constexpr BlockId DIRT = 2;
+constexpr BlockId GRASS = 3;
+constexpr BlockId LOG = 4;
+constexpr BlockId LEAVES = 5;
+
+constexpr bool isOpaque(BlockId id) noexcept { return id != AIR; }
+} // namespace block
+
+// faces of a block or a chunk, ordered -X, +X, -Y, +Y, -Z, +Z
+enum ChunkFace : std::uint32_t {
+  FACE_NEG_X = 0,
+  FACE_POS_X,
+  FACE_NEG_Y,
+  FACE_POS_Y,
+  FACE_NEG_Z,
+  FACE_POS_Z,
+  FACE_COUNT
+};
+
+struct ChunkStats {
+  std::uint32_t bitsPerBlock = {0};
+  std::uint32_t paletteSize = {0};
+  std::uint32_t liveEntries = {0};
+  std::size_t memoryUsage = {0};
+};
+
+// 32^3 voxel section stored as a palette plus bit-packed palette indices.
+// A section holding a single block type keeps no index data at all (0 bits),
+// otherwise the index width is one of 1, 2, 4, 8 or 16 bits so entries never
+// straddle a 64-bit word.
+class Chunk {
+public:
+  static constexpr int SIZE = 32;
+  static constexpr int AREA = SIZE * SIZE;
+  static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+  explicit Chunk(BlockId fill = block::AIR);
+
+  // Y is the fastest varying axis so a column of blocks is contiguous
+  static constexpr std::uint32_t index(int x, int y, int z) noexcept {
+    return static_cast<std::uint32_t>((x * SIZE + z) * SIZE + y);
+  }
+
+  BlockId get(int x, int y, int z) const noexcept {
+    assert(x >= 0 && x < SIZE && y >= 0 && y < SIZE && z >= 0 && z < SIZE);
+    return get(index(x, y, z));
+  }
+
+  BlockId get(std::uint32_t idx) const noexcept {
+    if (mBits == 0) {
+      return mPalette[0];
+    }
+    return mPalette[readIndex(idx)];
+  }
+
+  void set(int x, int y, int z, BlockId id) {
+    assert(x >= 0 && x < SIZE && y >= 0 && y < SIZE && z >= 0 && z < SIZE);
+    set(index(x, y, z), id);
+  }
+
+  void set(std::uint32_t idx, BlockId id);
+  void fill(BlockId id);
+  // replaces every block at once: block idx becomes palette[indices[idx]].
+  // palette must not repeat an id and every index must be in range.
+  void assign(std::vector<BlockId> palette, const std::uint16_t *indices);
+
+  // decodes the SIZE blocks of column (x, z) bottom to top into out
+  void getColumn(int x, int z, BlockId *out) const noexcept;
+
+  // drops unused palette entries and repacks with the smallest bit width
+  void compact();
+
+  bool isUniform() const noexcept { return mBits == 0; }
+  bool isEmpty() const noexcept {
+    return mBits == 0 && mPalette[0] == block::AIR;
+  }
+
+  std::uint32_t bitsPerBlock() const noexcept { return mBits; }
+  std::uint32_t paletteSize() const noexcept {
+    return static_cast<std::uint32_t>(mPalette.size());
+  }
+  const std::vector<BlockId> &palette() const noexcept { return mPalette; }
+
+  std::size_t memoryUsage() const noexcept;
+  ChunkStats stats() const noexcept;
+
+private:
+  std::uint32_t readIndex(std::uint32_t idx) const noexcept {
+    auto word = idx >> mValuesPerWordShift;
+    auto shift = (idx & mValuesPerWordMask) * mBits;
+    return static_cast<std::uint32_t>((mData[word] >> shift) & mIndexMask);
+  }
+
+  void writeIndex(std::uint32_t idx, std::uint32_t value) noexcept {
+    auto word = idx >> mValuesPerWordShift;
+    auto shift = (idx & mValuesPerWordMask) * mBits;
+    mData[word] = (mData[word] & ~(mIndexMask << shift)) |
+                  (static_cast<std::uint64_t>(value) << shift);
+  }
+
+  std::uint32_t findOrAddEntry(BlockId id);
+  void resize(std::uint32_t bits);
+  void repack(std::uint32_t bits, const std::vector<std::uint32_t> &remap);
+  void setBits(std::uint32_t bits) noexcept;
+  void maybeShrink();
+
+  static std::uint32_t requiredBits(std::uint32_t entries) noexcept;
+
+private:
+  std::vector<BlockId> mPalette;
+  std::vector<std::uint16_t> mRefCounts;
+  std::vector<std::uint64_t> mData;
+
+  std::uint32_t mLiveEntries = {1};
+  std::uint32_t mBits = {0};
+  std::uint32_t mValuesPerWordShift = {0};
+  std::uint32_t mValuesPerWordMask = {0};
+  std::uint64_t mIndexMask = {0};
+};
+
+} // namespace mv
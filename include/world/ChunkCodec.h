@@ -0,0 +1,40 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// Compact encoding of a Chunk for region files and cold storage:
+//
+//   FORMAT | varint transformed size | LZ sequences of the transformed bytes
+//
+// The transform writes the blocks as runs of palette indices along Y in
+// Chunk::index order, a run continuing into the next column when that
+// starts with the same block, followed by the palette as zigzag deltas
+// between consecutive ids. All numbers are LEB128 varints. Terrain columns
+// turn into a handful of runs, and neighbouring columns of the same height
+// repeat each other's runs byte for byte, which the LZ stage folds into
+// matches.
+namespace chunk_codec {
+
+constexpr std::uint8_t FORMAT = 1;
+
+// appends the encoding of chunk to out
+void encode(const Chunk &chunk, std::vector<std::uint8_t> &out);
+// false when data is not exactly one well formed encoding; chunk is
+// unspecified then
+bool decode(const std::uint8_t *data, std::size_t size, Chunk &chunk);
+
+// The byte coder on its own: LZ77 with 4 byte matches found through a hash
+// table, up to 64 KiB back, in sequences laid out like LZ4's. Appends to out.
+void compress(const std::uint8_t *data, std::size_t size,
+              std::vector<std::uint8_t> &out);
+// false unless data decompresses to exactly outSize bytes
+bool decompress(const std::uint8_t *data, std::size_t size,
+                std::uint8_t *out, std::size_t outSize);
+
+} // namespace chunk_codec
+} // namespace mv
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MV_CHUNK_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mv {
+
+struct ChunkCoord {
+  std::int32_t x = {0};
+  std::int32_t y = {0};
+  std::int32_t z = {0};
+
+  bool operator==(const ChunkCoord &other) const noexcept {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+constexpr ChunkCoord neighbourCoord(const ChunkCoord &coord,
+                                    std::uint32_t face) noexcept {
+  constexpr std::int32_t offsets[FACE_COUNT][3] = {
+      {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+  return {coord.x + offsets[face][0], coord.y + offsets[face][1],
+          coord.z + offsets[face][2]};
+}
+
+// 21 bits per axis, enough for +-1M chunks in every direction
+constexpr std::uint64_t packChunkCoord(const ChunkCoord &coord) noexcept {
+  constexpr std::uint64_t mask = (std::uint64_t{1} << 21) - 1;
+  return ((static_cast<std::uint64_t>(coord.x) & mask) << 42) |
+         ((static_cast<std::uint64_t>(coord.y) & mask) << 21) |
+         (static_cast<std::uint64_t>(coord.z) & mask);
+}
+
+constexpr ChunkCoord unpackChunkKey(std::uint64_t key) noexcept {
+  // shift the 21 bit field to the top and arithmetic shift back to sign extend
+  auto field = [](std::uint64_t value) {
+    return static_cast<std::int32_t>(static_cast<std::int64_t>(value << 43) >>
+                                     43);
+  };
+  return {field(key >> 42), field(key >> 21), field(key)};
+}
+
+// Flat open addressing hash map from packed chunk coordinates to T.
+// Slots are grouped by 16; every slot has a control byte holding either
+// EMPTY, DELETED or 7 bits of the hash, so a probe compares a whole group
+// with one SSE2 compare and only touches keys whose hash bits match.
+// The last successful lookup is cached, neighbouring lookups on the same
+// chunk skip hashing entirely. The cache makes const lookups non thread-safe.
+template <typename T> class ChunkMap {
+  static constexpr std::size_t GROUP_SIZE = 16;
+  static constexpr std::int8_t CTRL_EMPTY = -128;  // 0b10000000
+  static constexpr std::int8_t CTRL_DELETED = -2;  // 0b11111110
+  static constexpr std::size_t NO_SLOT = ~std::size_t{0};
+
+  struct Slot {
+    std::uint64_t key = {0};
+    T value = {};
+  };
+
+public:
+  ChunkMap() = default;
+  ~ChunkMap() = default;
+
+  ChunkMap(const ChunkMap &) = delete;
+  ChunkMap &operator=(const ChunkMap &) = delete;
+  ChunkMap(ChunkMap &&other) noexcept { *this = std::move(other); }
+  ChunkMap &operator=(ChunkMap &&other) noexcept {
+    mCtrl = std::move(other.mCtrl);
+    mSlots = std::move(other.mSlots);
+    mCapacity = std::exchange(other.mCapacity, 0);
+    mSize = std::exchange(other.mSize, 0);
+    mDeleted = std::exchange(other.mDeleted, 0);
+    mCachedSlot = NO_SLOT;
+    other.mCachedSlot = NO_SLOT;
+    return *this;
+  }
+
+  T *find(const ChunkCoord &coord) { return find(packChunkCoord(coord)); }
+  const T *find(const ChunkCoord &coord) const {
+    return find(packChunkCoord(coord));
+  }
+
+  T *find(std::uint64_t key) {
+    auto slot = findSlot(key);
+    return slot == NO_SLOT ? nullptr : &mSlots[slot].value;
+  }
+
+  const T *find(std::uint64_t key) const {
+    auto slot = findSlot(key);
+    return slot == NO_SLOT ? nullptr : &mSlots[slot].value;
+  }
+
+  bool contains(const ChunkCoord &coord) const {
+    return findSlot(packChunkCoord(coord)) != NO_SLOT;
+  }
+
+  // returns the stored value and true when it was newly inserted
+  std::pair<T *, bool> emplace(const ChunkCoord &coord, T value) {
+    return emplace(packChunkCoord(coord), std::move(value));
+  }
+
+  std::pair<T *, bool> emplace(std::uint64_t key, T value) {
+    if (auto slot = findSlot(key); slot != NO_SLOT) {
+      return {&mSlots[slot].value, false};
+    }
+
+    if (mSize + mDeleted + 1 > maxLoad()) {
+      rehash(mSize + 1 > maxLoad() ? mCapacity * 2 : mCapacity);
+    }
+
+    auto slot = findInsertSlot(hash(key));
+    if (mCtrl[slot] == CTRL_DELETED) {
+      mDeleted--;
+    }
+    mCtrl[slot] = h2(hash(key));
+    mSlots[slot].key = key;
+    mSlots[slot].value = std::move(value);
+    mSize++;
+
+    mCachedKey = key;
+    mCachedSlot = slot;
+    return {&mSlots[slot].value, true};
+  }
+
+  T &operator[](const ChunkCoord &coord) { return *emplace(coord, T{}).first; }
+
+  bool erase(const ChunkCoord &coord) { return erase(packChunkCoord(coord)); }
+
+  bool erase(std::uint64_t key) {
+    auto slot = findSlot(key);
+    if (slot == NO_SLOT) {
+      return false;
+    }
+
+    // a group that still has an EMPTY slot never overflowed, so no probe
+    // sequence continues past it and the slot can become EMPTY again
+    auto group = slot & ~(GROUP_SIZE - 1);
+    bool groupHasEmpty = matchEmpty(&mCtrl[group]) != 0;
+    mCtrl[slot] = groupHasEmpty ? CTRL_EMPTY : CTRL_DELETED;
+    if (!groupHasEmpty) {
+      mDeleted++;
+    }
+    mSlots[slot].value = T{};
+    mSize--;
+    mCachedSlot = NO_SLOT;
+    return true;
+  }
+
+  void clear() {
+    if (mCapacity == 0) {
+      return;
+    }
+    std::memset(mCtrl.get(), static_cast<std::uint8_t>(CTRL_EMPTY), mCapacity);
+    for (std::size_t i = 0; i < mCapacity; i++) {
+      mSlots[i].value = T{};
+    }
+    mSize = 0;
+    mDeleted = 0;
+    mCachedSlot = NO_SLOT;
+  }
+
+  void reserve(std::size_t count) {
+    if (count > maxLoad()) {
+      rehash(count * 8 / 7 + 1);
+    }
+  }
+
+  template <typename Fn> void forEach(Fn &&fn) {
+    for (std::size_t i = 0; i < mCapacity; i++) {
+      if (mCtrl[i] >= 0) {
+        fn(unpackChunkKey(mSlots[i].key), mSlots[i].value);
+      }
+    }
+  }
+
+  template <typename Fn> void forEach(Fn &&fn) const {
+    for (std::size_t i = 0; i < mCapacity; i++) {
+      if (mCtrl[i] >= 0) {
+        fn(unpackChunkKey(mSlots[i].key), mSlots[i].value);
+      }
+    }
+  }
+
+  std::size_t size() const noexcept { return mSize; }
+  bool empty() const noexcept { return mSize == 0; }
+  std::size_t capacity() const noexcept { return mCapacity; }
+
+  std::size_t memoryUsage() const noexcept {
+    return sizeof(*this) + mCapacity * (sizeof(std::int8_t) + sizeof(Slot));
+  }
+
+private:
+  static std::uint64_t hash(std::uint64_t key) noexcept {
+    // murmur3 finalizer, every key bit affects both h1 and h2
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+  }
+
+  static std::int8_t h2(std::uint64_t hash) noexcept {
+    return static_cast<std::int8_t>(hash & 0x7f);
+  }
+
+  std::size_t maxLoad() const noexcept { return mCapacity - mCapacity / 8; }
+
+#ifdef MV_CHUNK_MAP_SSE2
+  static std::uint32_t match(const std::int8_t *group, std::int8_t value) {
+    auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+  }
+
+  static std::uint32_t matchEmptyOrDeleted(const std::int8_t *group) {
+    // EMPTY and DELETED are the only control bytes with the sign bit set
+    auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl));
+  }
+#else
+  static std::uint32_t match(const std::int8_t *group, std::int8_t value) {
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+      mask |= static_cast<std::uint32_t>(group[i] == value) << i;
+    }
+    return mask;
+  }
+
+  static std::uint32_t matchEmptyOrDeleted(const std::int8_t *group) {
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+      mask |= static_cast<std::uint32_t>(group[i] < 0) << i;
+    }
+    return mask;
+  }
+#endif
+
+  static std::uint32_t matchEmpty(const std::int8_t *group) {
+    return match(group, CTRL_EMPTY);
+  }
+
+  std::size_t findSlot(std::uint64_t key) const {
+    if (mCachedSlot != NO_SLOT && mCachedKey == key) {
+      return mCachedSlot;
+    }
+    if (mSize == 0) {
+      return NO_SLOT;
+    }
+
+    auto h = hash(key);
+    auto tag = h2(h);
+    auto groupMask = mCapacity / GROUP_SIZE - 1;
+    auto group = (h >> 7) & groupMask;
+
+    // triangular probing visits every group once for power of two counts
+    for (std::size_t step = 1;; step++) {
+      const auto *ctrl = &mCtrl[group * GROUP_SIZE];
+      for (auto bits = match(ctrl, tag); bits != 0; bits &= bits - 1) {
+        auto slot = group * GROUP_SIZE + std::countr_zero(bits);
+        if (mSlots[slot].key == key) {
+          mCachedKey = key;
+          mCachedSlot = slot;
+          return slot;
+        }
+      }
+      if (matchEmpty(ctrl) != 0 || step > groupMask) {
+        return NO_SLOT;
+      }
+      group = (group + step) & groupMask;
+    }
+  }
+
+  std::size_t findInsertSlot(std::uint64_t h) const {
+    auto groupMask = mCapacity / GROUP_SIZE - 1;
+    auto group = (h >> 7) & groupMask;
+    for (std::size_t step = 1;; step++) {
+      auto bits = matchEmptyOrDeleted(&mCtrl[group * GROUP_SIZE]);
+      if (bits != 0) {
+        return group * GROUP_SIZE + std::countr_zero(bits);
+      }
+      group = (group + step) & groupMask;
+    }
+  }
+
+  void rehash(std::size_t minCapacity) {
+    auto capacity = std::max<std::size_t>(
+        GROUP_SIZE, std::bit_ceil(std::max<std::size_t>(minCapacity, 1)));
+
+    auto oldCtrl = std::move(mCtrl);
+    auto oldSlots = std::move(mSlots);
+    auto oldCapacity = mCapacity;
+
+    mCtrl = std::make_unique<std::int8_t[]>(capacity);
+    mSlots = std::make_unique<Slot[]>(capacity);
+    mCapacity = capacity;
+    std::memset(mCtrl.get(), static_cast<std::uint8_t>(CTRL_EMPTY), capacity);
+
+    for (std::size_t i = 0; i < oldCapacity; i++) {
+      if (oldCtrl[i] >= 0) {
+        auto h = hash(oldSlots[i].key);
+        auto slot = findInsertSlot(h);
+        mCtrl[slot] = h2(h);
+        mSlots[slot] = std::move(oldSlots[i]);
+      }
+    }
+    mDeleted = 0;
+    mCachedSlot = NO_SLOT;
+  }
+
+private:
+  std::unique_ptr<std::int8_t[]> mCtrl;
+  std::unique_ptr<Slot[]> mSlots;
+  std::size_t mCapacity = {0};
+  std::size_t mSize = {0};
+  std::size_t mDeleted = {0};
+
+  mutable std::uint64_t mCachedKey = {0};
+  mutable std::size_t mCachedSlot = {NO_SLOT};
+};
+
+} // namespace mv
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Model.h"
+#include "world/BlockTextureRegistry.h"
+#include "world/Chunk.h"
+#include "world/ChunkVisibility.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+// neighbouring sections indexed by ChunkFace; nullptr is treated as air
+using ChunkNeighbours = std::array<const Chunk *, FACE_COUNT>;
+
+struct ChunkMeshStats {
+  std::uint32_t quads = {0};
+  std::uint32_t triangles = {0};
+  // faces a naive one-quad-per-face mesher would have emitted
+  std::uint32_t naiveQuads = {0};
+  std::size_t vertexBytes = {0};
+  double meshTimeMs = {0.0};
+};
+
+enum class ChunkVertexFormat {
+  // 44 byte mv::Vertex, drawn with the model pipeline
+  Vertex,
+  // 8 byte mv::VoxelVertex, drawn with the voxel pipeline
+  Packed
+};
+
+// only the vertex array matching the mesher's ChunkVertexFormat is filled
+struct ChunkMesh {
+  std::vector<Vertex> vertices = {};
+  std::vector<VoxelVertex> packedVertices = {};
+  std::vector<uint32_t> indices = {};
+  // face connectivity of the section for ChunkVisibilityGraph
+  ChunkVisibility visibility = {};
+  ChunkMeshStats stats = {};
+
+  void clear() {
+    vertices.clear();
+    packedVertices.clear();
+    indices.clear();
+    visibility = {};
+    stats = {};
+  }
+};
+
+enum class MesherBackend {
+  // per-voxel face mask and rectangle growth
+  Greedy,
+  // 64-bit occupancy columns; faces and merges found with shifts and bit
+  // scans. Produces the same quads as Greedy.
+  BinaryGreedy
+};
+
+// Builds chunk meshes by merging coplanar faces of the same block type into
+// maximal rectangles (greedy meshing). Positions are chunk local, in blocks.
+// The mesher keeps scratch buffers between calls; use one per thread.
+class ChunkMesher {
+public:
+  static constexpr int PADDED_SIZE = Chunk::SIZE + 2;
+  static_assert(PADDED_SIZE <= 64, "padded column must fit in 64 bits");
+
+  explicit ChunkMesher(MesherBackend backend = MesherBackend::BinaryGreedy,
+                       ChunkVertexFormat format = ChunkVertexFormat::Packed);
+
+  void setBackend(MesherBackend backend) noexcept { mBackend = backend; }
+  MesherBackend getBackend() const noexcept { return mBackend; }
+
+  void setVertexFormat(ChunkVertexFormat format) noexcept { mFormat = format; }
+  ChunkVertexFormat getVertexFormat() const noexcept { return mFormat; }
+
+  // layers written into packed vertices; without a registry the block id
+  // doubles as layer. The registry is shared and must outlive the mesher.
+  void setTextureLayers(const BlockTextureRegistry *registry) noexcept {
+    mTextureLayers = registry;
+  }
+
+  void mesh(const Chunk &chunk, const ChunkNeighbours &neighbours,
+            ChunkMesh &out);
+
+  static void logStats(const ChunkMeshStats &stats);
+
+private:
+  static constexpr std::uint32_t paddedIndex(int x, int y, int z) noexcept {
+    return static_cast<std::uint32_t>(((x + 1) * PADDED_SIZE + (z + 1)) *
+                                          PADDED_SIZE +
+                                      (y + 1));
+  }
+
+  void gatherBlocks(const Chunk &chunk, const ChunkNeighbours &neighbours);
+  void meshGreedy(ChunkMesh &out);
+  void meshBinary(ChunkMesh &out);
+  std::uint32_t blockSlot(BlockId id);
+
+  std::uint32_t textureLayer(BlockId id, std::uint32_t face) const noexcept {
+    return mTextureLayers ? mTextureLayers->layer(id, face) : id;
+  }
+
+private:
+  MesherBackend mBackend;
+  ChunkVertexFormat mFormat;
+  const BlockTextureRegistry *mTextureLayers = {nullptr};
+
+  // chunk blocks plus a one block border copied from the neighbours
+  std::vector<BlockId> mBlocks;
+  std::vector<BlockId> mMask;
+
+  // binary backend: occupancy columns along each axis, [axis][v][u] over the
+  // padded volume, and per block type face planes [slot][face][slice][v]
+  // holding one bit per u
+  std::vector<std::uint64_t> mColumns;
+  std::vector<std::uint32_t> mPlanes;
+  std::vector<std::uint32_t> mUsedSlices;
+  std::vector<BlockId> mSlotBlocks;
+  std::vector<std::uint16_t> mBlockSlots;
+
+  ChunkVisibilityBuilder mVisibility;
+};
+
+namespace mesher_helper {
+glm::vec3 blockColor(BlockId id) noexcept;
+void emitQuad(ChunkMesh &mesh, std::uint32_t face, int slice, int u, int v,
+              int width, int height, BlockId id);
+void emitPackedQuad(ChunkMesh &mesh, std::uint32_t face, int slice, int u,
+                    int v, int width, int height, std::uint32_t layer);
+} // namespace mesher_helper
+
+} // namespace mv
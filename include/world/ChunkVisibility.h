@@ -0,0 +1,89 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mv {
+
+constexpr std::uint32_t oppositeFace(std::uint32_t face) noexcept {
+  return face ^ 1u;
+}
+
+// Which pairs of section faces are connected through non-opaque blocks, as a
+// symmetric 6x6 bit matrix. Two faces are connected when one flood fill
+// region of air touches both of them.
+class ChunkVisibility {
+public:
+  static constexpr ChunkVisibility none() noexcept { return {}; }
+  static constexpr ChunkVisibility all() noexcept {
+    ChunkVisibility visibility;
+    visibility.mBits = (std::uint64_t{1} << (FACE_COUNT * FACE_COUNT)) - 1;
+    return visibility;
+  }
+
+  constexpr bool connected(std::uint32_t a, std::uint32_t b) const noexcept {
+    return (mBits >> (a * FACE_COUNT + b)) & 1u;
+  }
+
+  constexpr void connect(std::uint32_t a, std::uint32_t b) noexcept {
+    mBits |= std::uint64_t{1} << (a * FACE_COUNT + b);
+    mBits |= std::uint64_t{1} << (b * FACE_COUNT + a);
+  }
+
+  // connects every pair of faces set in faceMask, bit i is ChunkFace i
+  constexpr void connectAll(std::uint32_t faceMask) noexcept {
+    for (std::uint32_t a = 0; a < FACE_COUNT; a++) {
+      if (faceMask & (1u << a)) {
+        mBits |= static_cast<std::uint64_t>(faceMask & 0x3fu)
+                 << (a * FACE_COUNT);
+      }
+    }
+  }
+
+  // faces connected to face, as a mask
+  constexpr std::uint32_t connections(std::uint32_t face) const noexcept {
+    return static_cast<std::uint32_t>(mBits >> (face * FACE_COUNT)) & 0x3fu;
+  }
+
+  constexpr std::uint64_t bits() const noexcept { return mBits; }
+
+  constexpr bool operator==(const ChunkVisibility &other) const noexcept {
+    return mBits == other.mBits;
+  }
+
+private:
+  std::uint64_t mBits = {0};
+};
+
+// Flood fills the non-opaque blocks of a section to find its face
+// connectivity. Blocks are handled a column span at a time: a popped seed
+// grows to the whole run of air along Y with two bit scans, and the four
+// neighbouring columns get one seed per new run touching it. Only regions
+// reachable from the section border matter, so seeds start there.
+// Keeps scratch buffers between calls; use one per thread.
+class ChunkVisibilityBuilder {
+public:
+  ChunkVisibilityBuilder();
+
+  ChunkVisibility compute(const Chunk &chunk);
+
+private:
+  static constexpr std::uint32_t column(int x, int z) noexcept {
+    return static_cast<std::uint32_t>(x * Chunk::SIZE + z);
+  }
+
+  // fills the region containing the seed, returns the faces it touches
+  std::uint32_t fill(std::uint32_t seedColumn, int seedY);
+
+private:
+  // bit y of column (x, z) is set for non-opaque blocks and visited blocks
+  std::vector<std::uint32_t> mOpen;
+  std::vector<std::uint32_t> mVisited;
+  // packed Chunk::index of pending seeds
+  std::vector<std::uint16_t> mStack;
+};
+
+} // namespace mv
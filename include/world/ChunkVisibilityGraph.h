@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Frustum.h"
+#include "world/ChunkMap.h"
+#include "world/ChunkVisibility.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace mv {
+
+// Potentially visible set of chunk sections through cave culling. Every
+// section keeps its ChunkVisibility; a breadth first search from the camera
+// section only leaves a section through faces connected to the face it was
+// entered by, never turns back against a direction it already moved in and
+// skips sections outside the frustum. Sections are updated one at a time, so
+// a block edit only replaces the connectivity of the edited section.
+// Unknown sections inside the bounds of the known ones count as air.
+class ChunkVisibilityGraph {
+public:
+  // section without anything to draw, it still passes visibility on
+  static constexpr std::uint32_t NO_DRAW =
+      std::numeric_limits<std::uint32_t>::max();
+
+  void set(const ChunkCoord &coord, ChunkVisibility visibility,
+           std::uint32_t drawIndex = NO_DRAW);
+  void remove(const ChunkCoord &coord);
+  void clear();
+
+  // writes the draw indices of the sections the search reaches into visible
+  // and returns their count. origin is the world position of section 0, 0, 0;
+  // a camera outside the known sections starts from the nearest border.
+  std::size_t collectVisible(const ChunkCoord &camera, const Frustum &frustum,
+                             const glm::vec3 &origin,
+                             std::vector<std::uint32_t> &visible);
+
+  // section containing a world position
+  static ChunkCoord sectionAt(const glm::vec3 &position,
+                              const glm::vec3 &origin);
+
+  std::size_t size() const noexcept { return mSections.size(); }
+  // sections reached by the last collectVisible, drawn or not
+  std::size_t lastVisitedCount() const noexcept { return mLastVisited; }
+
+private:
+  struct Section {
+    ChunkVisibility visibility = {};
+    std::uint32_t drawIndex = {NO_DRAW};
+  };
+
+  struct Node {
+    ChunkCoord coord = {};
+    // face of this section the search came through, FACE_COUNT at the start
+    std::uint32_t entryFace = {FACE_COUNT};
+    // faces the search moved through on the way here
+    std::uint32_t directions = {0};
+  };
+
+  // the searched region is the bounds of the known sections plus a layer of
+  // air around them, so the search can go around the outside
+  bool inRegion(const ChunkCoord &coord) const noexcept;
+  std::size_t regionIndex(const ChunkCoord &coord) const noexcept;
+  void prepareVisited();
+
+private:
+  ChunkMap<Section> mSections;
+  // bounds only grow until clear(); removed sections leave air behind
+  ChunkCoord mMin = {};
+  ChunkCoord mMax = {};
+
+  ChunkCoord mRegionMin = {};
+  ChunkCoord mRegionSize = {};
+  // a section was visited by this search when its stamp matches mStamp
+  std::vector<std::uint32_t> mVisited;
+  std::uint32_t mStamp = {0};
+  std::vector<Node> mQueue;
+  std::size_t mLastVisited = {0};
+};
+
+} // namespace mv
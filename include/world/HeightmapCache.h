@@ -0,0 +1,66 @@
+#pragma once
+
+#include "world/Chunk.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mv {
+
+enum class Biome : std::uint8_t {
+  Plains,
+  Forest,
+  Hills,
+};
+
+// Biome and terrain height of COLUMNS^2 chunk columns, x and z in
+// regions. Per block column data is indexed by index(x, z), x and z in blocks
+// from the region's corner.
+struct HeightRegion {
+  static constexpr int COLUMNS = 4;
+  static constexpr int SIZE = COLUMNS * Chunk::SIZE;
+  static constexpr std::uint32_t AREA = SIZE * SIZE;
+
+  std::int32_t x = {0};
+  std::int32_t z = {0};
+  std::vector<std::int16_t> heights = std::vector<std::int16_t>(AREA);
+  std::vector<Biome> biomes = std::vector<Biome>(AREA);
+
+  static constexpr std::uint32_t index(int x, int z) noexcept {
+    return static_cast<std::uint32_t>(x * SIZE + z);
+  }
+};
+
+// Least recently used HeightRegions, shared by the generator threads so a
+// region's 2D noise is evaluated once for all the columns and sections in it.
+// Regions are immutable once inserted and handed out by shared_ptr, eviction
+// never invalidates one in use. Thread safe.
+class HeightmapCache {
+public:
+  explicit HeightmapCache(std::size_t capacity);
+
+  HeightmapCache(const HeightmapCache &) = delete;
+  HeightmapCache &operator=(const HeightmapCache &) = delete;
+
+  // nullptr on a miss; compute the region outside the cache and insert() it
+  std::shared_ptr<const HeightRegion> find(std::int32_t x, std::int32_t z);
+  // returns the cached region instead if another thread inserted the same
+  // one meanwhile
+  std::shared_ptr<const HeightRegion>
+  insert(std::shared_ptr<const HeightRegion> region);
+
+  std::uint64_t hits() const;
+  std::uint64_t misses() const;
+
+private:
+  mutable std::mutex mMutex;
+  std::size_t mCapacity = {0};
+  // most recently used first
+  std::vector<std::shared_ptr<const HeightRegion>> mRegions;
+  std::uint64_t mHits = {0};
+  std::uint64_t mMisses = {0};
+};
+
+} // namespace mv
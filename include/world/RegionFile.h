@@ -0,0 +1,125 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mv {
+
+// Saved chunk columns, COLUMNS^2 of them per file in the .mvregion format:
+//
+//   Header (64 bytes) | Entry table | payload sectors
+//
+// Payloads are opaque bytes starting at SECTOR_SIZE aligned offsets. The
+// entry table holds each column's first sector, length and timestamp;
+// header and table fill the first HEADER_SECTORS sectors. Free sectors are
+// tracked by a bitmap rebuilt from the table on open.
+//
+// A write goes to newly allocated sectors and only then repoints the entry,
+// so a process crash in the middle leaves the old payload readable. Both are
+// only flushed to the OS, not synced: after a power loss the entry may have
+// reached the disk without its payload, and the column reads back whatever
+// the sectors held. The sectors a write replaces become free for later
+// writes, which keeps the file from growing as columns get saved again.
+//
+// Reads come straight from a mapping of the file, loading a column costs no
+// syscalls beyond page faults. Writes go through a stream; the mapping is
+// refreshed on the first read after a write. Not thread safe.
+class RegionFile {
+public:
+  static constexpr const char *EXTENSION = ".mvregion";
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr int COLUMNS = 32;
+  static constexpr std::uint32_t ENTRY_COUNT = COLUMNS * COLUMNS;
+  static constexpr std::uint32_t SECTOR_SIZE = 4096;
+
+  // a column's bytes inside the mapping, valid until the next write or close
+  struct Payload {
+    const char *data = {nullptr};
+    std::size_t size = {0};
+    std::int64_t timestamp = {0};
+  };
+
+  RegionFile() = default;
+  RegionFile(const RegionFile &) = delete;
+  RegionFile &operator=(const RegionFile &) = delete;
+
+  // opens path or creates an empty region there; false when it cannot be
+  // created or is not a region file of this version, which is left untouched
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const noexcept { return mStream.is_open(); }
+
+  // x and z are the column inside the region, see local()
+  bool contains(int x, int z) const noexcept;
+  // size 0 when the column was never saved
+  Payload read(int x, int z);
+  // replaces the column's payload, false on an I/O error
+  bool write(int x, int z, const void *data, std::size_t size,
+             std::int64_t timestamp);
+  // false on an I/O error
+  bool erase(int x, int z);
+
+  // sectors in the file and how many of them hold nothing
+  std::uint32_t sectorCount() const noexcept { return mSectorCount; }
+  std::uint32_t freeSectorCount() const noexcept;
+
+  // the region holding column x (or z) in chunks, and its place in there
+  static std::int32_t region(std::int32_t column) noexcept;
+  static int local(std::int32_t column) noexcept;
+  static std::string fileName(std::int32_t regionX, std::int32_t regionZ);
+
+private:
+  struct Header {
+    char magic[4] = {'M', 'V', 'R', 'G'};
+    std::uint32_t version = {VERSION};
+    std::uint32_t columns = {COLUMNS};
+    std::uint32_t sectorSize = {SECTOR_SIZE};
+    std::uint8_t reserved[48] = {};
+  };
+  static_assert(sizeof(Header) == 64);
+
+  struct Entry {
+    // 0 when the column is not stored
+    std::uint32_t sector = {0};
+    std::uint32_t length = {0};
+    std::int64_t timestamp = {0};
+  };
+  static_assert(sizeof(Entry) == 16);
+
+  static constexpr std::uint32_t HEADER_SECTORS =
+      (sizeof(Header) + ENTRY_COUNT * sizeof(Entry) + SECTOR_SIZE - 1) /
+      SECTOR_SIZE;
+
+  static constexpr std::uint32_t sectorsFor(std::size_t size) noexcept {
+    return static_cast<std::uint32_t>((size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+  }
+  static std::uint32_t entryIndex(int x, int z) noexcept;
+
+  bool create();
+  // dropped gets the indices of entries that were invalid or overlapped an
+  // earlier one; they are cleared in memory only
+  bool load(std::vector<std::uint32_t> &dropped);
+  // first run of count free sectors, appended at the end if there is none
+  std::uint32_t allocate(std::uint32_t count);
+  void markSectors(std::uint32_t first, std::uint32_t count, bool used);
+  bool isUsed(std::uint32_t sector) const noexcept;
+  bool writeEntry(std::uint32_t index, const Entry &entry);
+
+private:
+  std::string mPath;
+  std::fstream mStream;
+  MappedFile mMapping;
+  // the mapping misses writes made after it was opened
+  bool mMappingStale = {true};
+  std::array<Entry, ENTRY_COUNT> mEntries = {};
+  // one bit per sector, set while it holds the header or a payload
+  std::vector<std::uint64_t> mUsed;
+  std::uint32_t mSectorCount = {0};
+};
+
+} // namespace mv
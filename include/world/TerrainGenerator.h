@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Noise.h"
+#include "world/Chunk.h"
+#include "world/HeightmapCache.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mv {
+
+// world generation steps in the order every column goes through them; a
+// column's stage is the last one it completed
+enum class GenStage : std::uint8_t {
+  None,
+  // biome and terrain height per block column
+  Biome,
+  // solid stone wherever the density field is positive
+  Terrain,
+  Caves,
+  // grass and dirt on the topmost solid blocks
+  Surface,
+  // trees, which spill into neighbouring columns
+  Decoration,
+  // ruins spanning column borders
+  Structures,
+};
+
+constexpr GenStage nextStage(GenStage stage) noexcept {
+  return static_cast<GenStage>(static_cast<std::uint8_t>(stage) + 1);
+}
+
+// how Terrain and Caves evaluate their 3D noise
+enum class DensitySampling : std::uint8_t {
+  // at every block; the reference
+  Full,
+  // at the corners of 4x8x4 block cells, trilinearly interpolated inside;
+  // cells holding the ground's edge or caves near it are sampled per block
+  Interpolated,
+};
+
+// All sections of one chunk column, x and z in chunks. Per block column data
+// is indexed by columnIndex(x, z) like the rows of Chunk::index.
+struct ChunkColumn {
+  static constexpr int SECTIONS = 4;
+  static constexpr int HEIGHT = SECTIONS * Chunk::SIZE;
+  static constexpr std::int16_t NO_SURFACE = -1;
+
+  std::int32_t x = {0};
+  std::int32_t z = {0};
+  std::array<Chunk, SECTIONS> sections;
+  // written by Biome: the height the density field is centred on
+  std::array<std::int16_t, Chunk::AREA> heights = {};
+  std::array<Biome, Chunk::AREA> biomes = {};
+  // written by Surface: y of the topmost solid block, NO_SURFACE if none
+  std::array<std::int16_t, Chunk::AREA> surface = {};
+
+  static constexpr std::uint32_t columnIndex(int x, int z) noexcept {
+    return static_cast<std::uint32_t>(x * Chunk::SIZE + z);
+  }
+
+  BlockId get(int x, int y, int z) const noexcept {
+    return sections[y / Chunk::SIZE].get(x, y % Chunk::SIZE, z);
+  }
+
+  void set(int x, int y, int z, BlockId id) {
+    sections[y / Chunk::SIZE].set(x, y % Chunk::SIZE, z, id);
+  }
+};
+
+// the column and its 8 neighbours at (dx + 1) * 3 + dz + 1
+using ColumnNeighbourhood = std::array<const ChunkColumn *, 9>;
+constexpr std::uint32_t NEIGHBOURHOOD_CENTRE = 4;
+
+// noise buffers reused between columns, one per thread
+struct TerrainScratch {
+  std::vector<float> a;
+  std::vector<float> b;
+  std::vector<float> c;
+  // noise samples evaluated on this thread, for profiling
+  std::uint64_t noiseSamples = {0};
+};
+
+// The stages themselves; WorldGenerator decides when each one runs. Stages
+// write only their own column. Decoration and Structures also read biomes and
+// surface of the neighbourhood, which no stage changes after Surface, and
+// evaluate every tree or ruin that reaches into the column again, so the
+// result does not depend on the order neighbours are generated in.
+// All methods are const and can run on any thread.
+class TerrainGenerator {
+public:
+  // regions of 2D maps kept around, enough for a 32x32 column area
+  static constexpr std::size_t HEIGHTMAP_CACHE_SIZE = 64;
+
+  explicit TerrainGenerator(
+      std::int32_t seed,
+      DensitySampling sampling = DensitySampling::Interpolated);
+
+  // whether stage reads the neighbourhood, which must have completed the
+  // stage before it
+  static constexpr bool needsNeighbours(GenStage stage) noexcept {
+    return stage == GenStage::Decoration || stage == GenStage::Structures;
+  }
+
+  // neighbourhood only has to be filled for stages that need neighbours
+  void run(GenStage stage, ChunkColumn &column,
+           const ColumnNeighbourhood &neighbourhood,
+           TerrainScratch &scratch) const;
+
+  std::int32_t seed() const noexcept { return mSeed; }
+  DensitySampling sampling() const noexcept { return mSampling; }
+  const HeightmapCache &heightmaps() const noexcept { return mHeightmaps; }
+
+private:
+  std::shared_ptr<const HeightRegion> region(std::int32_t x, std::int32_t z,
+                                             TerrainScratch &scratch) const;
+  void biomes(ChunkColumn &column, TerrainScratch &scratch) const;
+  void terrain(ChunkColumn &column, TerrainScratch &scratch) const;
+  void caves(ChunkColumn &column, TerrainScratch &scratch) const;
+  void surface(ChunkColumn &column) const;
+  void decorate(ChunkColumn &column,
+                const ColumnNeighbourhood &neighbourhood) const;
+  void structures(ChunkColumn &column,
+                  const ColumnNeighbourhood &neighbourhood) const;
+
+private:
+  std::int32_t mSeed = {0};
+  DensitySampling mSampling = {DensitySampling::Interpolated};
+  mutable HeightmapCache mHeightmaps{HEIGHTMAP_CACHE_SIZE};
+  noise::NoiseSettings mContinents;
+  noise::NoiseSettings mHills;
+  noise::NoiseSettings mHillBiome;
+  noise::NoiseSettings mForestBiome;
+  noise::NoiseSettings mDensity;
+  noise::NoiseSettings mCaveA;
+  noise::NoiseSettings mCaveB;
+};
+
+} // namespace mv
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "world/ChunkMap.h"
+#include "world/TerrainGenerator.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mv {
+
+// Drives chunk columns through the GenStage pipeline on the job system.
+// Stages that only touch their column run back to back in one job; a stage
+// that needs neighbours waits until all 8 neighbours completed the stage
+// before it, and requesting a column pulls its neighbours as far along as
+// that takes. Columns that are not waiting on each other generate in
+// parallel, so a burst of requests fills every thread.
+//
+// The scheduler state lives on the thread that owns the generator:
+// request(), update() and the lookups are not thread safe, only the stages
+// run on workers.
+class WorldGenerator {
+public:
+  WorldGenerator(JobSystem &jobs, std::int32_t seed);
+  // waits for running stages
+  ~WorldGenerator();
+
+  WorldGenerator(const WorldGenerator &) = delete;
+  WorldGenerator &operator=(const WorldGenerator &) = delete;
+
+  // queues column (x, z) for every stage; requests are served first come
+  // first served, so request the columns nearest the player first
+  void request(std::int32_t x, std::int32_t z);
+
+  // collects finished jobs and starts every stage whose neighbours are
+  // ready; never blocks, call it once per frame
+  void update();
+  // update() until every requested column is complete, helping with the
+  // jobs meanwhile
+  void finish();
+
+  // requested columns completed since the last call, in completion order
+  void takeCompleted(std::vector<const ChunkColumn *> &out);
+
+  // nullptr unless the column is complete
+  const ChunkColumn *find(std::int32_t x, std::int32_t z) const;
+
+  // columns in memory, including partially generated neighbours
+  std::size_t columnCount() const noexcept { return mColumns.size(); }
+  std::size_t runningCount() const noexcept { return mRunning.size(); }
+  std::size_t pendingCount() const noexcept { return mPending.size(); }
+
+  const TerrainGenerator &terrain() const noexcept { return mTerrain; }
+
+private:
+  struct Entry {
+    ChunkColumn column;
+    // completed stage, only updated by the owning thread once a job is done
+    GenStage stage = {GenStage::None};
+    GenStage target = {GenStage::None};
+    // last stage of the running job
+    GenStage runningTo = {GenStage::None};
+    bool running = {false};
+    bool queued = {false};
+    bool requested = {false};
+    ColumnNeighbourhood neighbourhood = {};
+    JobCounter job;
+  };
+
+  Entry &entry(std::int32_t x, std::int32_t z);
+  // raises the target of e to stage and its neighbours' to what that needs
+  void want(Entry &e, GenStage stage);
+  bool canStart(Entry &e);
+  void start(Entry &e);
+  void runStages(Entry &e);
+
+private:
+  JobSystem &mJobs;
+  TerrainGenerator mTerrain;
+  ChunkMap<std::unique_ptr<Entry>> mColumns;
+  // columns below their target that are not running, oldest first
+  std::vector<Entry *> mPending;
+  std::vector<Entry *> mRunning;
+  std::vector<const ChunkColumn *> mCompleted;
+  std::vector<TerrainScratch> mScratch;
+};
+
+} // namespace mv
@@ -0,0 +1,13 @@
+#version 450
+layout (location = 0) in vec4 color;
+layout (location = 1) in vec2 uv;
+layout (location = 2) flat in uint layer;
+
+layout (location = 0) out vec4 FragColor;
+
+// every block tile, layers from BlockTextureRegistry via the packed vertex
+layout (set = 2, binding = 0) uniform sampler2DArray blockTextures;
+
+void main() {
+    FragColor = color * texture(blockTextures, vec3(uv, float(layer)));
+}
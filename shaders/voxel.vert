@@ -0,0 +1,46 @@
+#version 450
+
+// mv::VoxelVertex, see include/Model.h for the bit layout
+layout(location = 0) in uint data0;
+layout(location = 1) in uint data1;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) flat out uint outLayer;
+
+layout(binding = 0) uniform UniformBufferObj {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// one entry per draw, the indirect commands pass the draw index as
+// firstInstance
+layout(set = 1, binding = 0) readonly buffer ChunkOrigins {
+    vec4 origins[];
+} chunks;
+
+// -X, +X, -Y, +Y, -Z, +Z
+const float FACE_SHADE[6] = float[](0.8f, 0.8f, 0.5f, 1.0f, 0.65f, 0.65f);
+
+void main() {
+    vec3 position = vec3(data0 & 63u, (data0 >> 6) & 63u, (data0 >> 12) & 63u);
+    uint face = (data0 >> 18) & 7u;
+    uint ao = (data0 >> 21) & 3u;
+    uint layer = data1 & 0xffffu;
+    uint skyLight = (data1 >> 16) & 15u;
+    uint blockLight = (data1 >> 20) & 15u;
+
+    // the texture repeats once per block over the two axes spanning the face,
+    // v follows y on the side faces so tiles stand upright
+    uint axis = face / 2u;
+    vec2 uv = axis == 0u ? position.zy : (axis == 1u ? position.xz : position.xy);
+
+    float light = float(max(skyLight, blockLight)) / 15.0f;
+    float occlusion = mix(0.4f, 1.0f, float(ao) / 3.0f);
+
+    gl_Position = ubo.proj * ubo.view * vec4(position + chunks.origins[gl_InstanceIndex].xyz, 1.0f);
+    outColor = vec4(vec3(FACE_SHADE[face] * occlusion * light), 1.0f);
+    outTexCoord = uv;
+    outLayer = layer;
+}
@@ -21,19 +21,22 @@ Buffer::Buffer(Device &device, VkDeviceSize instanceSize,
 Buffer::~Buffer() {
   unMap();
   vkDestroyBuffer(mDevice.device(), mBuffer, CUSTOM_ALLOCATOR);
-  vkFreeMemory(mDevice.device(), mMemory, CUSTOM_ALLOCATOR);
+  mDevice.getAllocator().free(mMemory);
 }
 
 VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
-  assert(mBuffer && mMemory && "Called map on buffer before create");
-  return vkMapMemory(mDevice.device(), mMemory, offset, size, 0, &mMapped);
+  assert(mBuffer && mMemory.memory && "Called map on buffer before create");
+  UNUSE(size);
+  // host visible pages stay mapped for their whole lifetime
+  if (!mMemory.mapped) {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  mMapped = static_cast<char *>(mMemory.mapped) + offset;
+  return VK_SUCCESS;
 }
 
 void Buffer::unMap() {
-  if (mMapped) {
-    vkUnmapMemory(mDevice.device(), mMemory);
-    mMapped = nullptr;
-  }
+  mMapped = nullptr;
 }
 
 void Buffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset) {
@@ -45,12 +48,7 @@ void Buffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset) {
 }
 
 VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = mMemory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkFlushMappedMemoryRanges(mDevice.device(), 1, &mappedRange);
+  return mDevice.getAllocator().flush(mMemory, size, offset);
 }
 
 VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size,
@@ -63,12 +61,7 @@ VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size,
 }
 
 VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = mMemory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkInvalidateMappedMemoryRanges(mDevice.device(), 1, &mappedRange);
+  return mDevice.getAllocator().invalidate(mMemory, size, offset);
 }
 
 void Buffer::writeToIndex(void *data, int32_t idx) {
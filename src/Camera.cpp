@@ -1,3 +1,23 @@
 #include "Camera.h"
 
-namespace mv {}
\ No newline at end of file
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace mv {
+
+void Camera::setPerspective(float fovy, float aspect, float near, float far) {
+  projectionMatrix = glm::perspective(fovy, aspect, near, far);
+  update();
+}
+
+void Camera::lookAt(const glm::vec3 &position, const glm::vec3 &target,
+                    const glm::vec3 &up) {
+  viewMatrix = glm::lookAt(position, target, up);
+  update();
+}
+
+void Camera::update() {
+  viewProjectionMatrix = projectionMatrix * viewMatrix;
+  frustum = Frustum::fromMatrix(viewProjectionMatrix);
+}
+
+} // namespace mv
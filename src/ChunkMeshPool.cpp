@@ -0,0 +1,124 @@
+#include "ChunkMeshPool.h"
+#include "Log.h"
+#include "StagingRing.h"
+#include "SwapChain.h"
+
+#include <algorithm>
+
+namespace mv {
+
+ChunkMeshPool::ChunkMeshPool(Device &device, VkDeviceSize vertexCapacity,
+                             VkDeviceSize indexCapacity)
+    : mDevice{device}, mVertexRanges{vertexCapacity},
+      mIndexRanges{indexCapacity} {
+  mVertexBuffer = std::make_unique<Buffer>(
+      mDevice, sizeof(VoxelVertex),
+      static_cast<std::uint32_t>(vertexCapacity / sizeof(VoxelVertex)),
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  mIndexBuffer = std::make_unique<Buffer>(
+      mDevice, sizeof(std::uint32_t),
+      static_cast<std::uint32_t>(indexCapacity / sizeof(std::uint32_t)),
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+ChunkMeshPool::~ChunkMeshPool() {
+  // the buffers go away with the pool, pending copies into them must not run
+  auto &uploadQueue = mDevice.getUploadQueue();
+  for (auto ticket : mPendingTickets) {
+    if (!uploadQueue.isReady(ticket)) {
+      uploadQueue.cancel(ticket);
+    }
+  }
+  // and the ones already in the graphics ring have to finish first
+  auto &ring = mDevice.getStagingRing();
+  ring.release(std::move(mVertexBuffer));
+  ring.release(std::move(mIndexBuffer));
+}
+
+ChunkMeshRange ChunkMeshPool::add(const std::vector<VoxelVertex> &vertices,
+                             const std::vector<std::uint32_t> &indices) {
+  ChunkMeshRange mesh = {};
+  if (vertices.empty() || indices.empty()) {
+    return mesh;
+  }
+
+  auto vertexBytes = vertices.size() * sizeof(VoxelVertex);
+  auto indexBytes = indices.size() * sizeof(std::uint32_t);
+
+  std::uint64_t vertexOffset = 0;
+  std::uint64_t indexOffset = 0;
+  auto vertexBlock =
+      mVertexRanges.allocate(vertexBytes, sizeof(VoxelVertex), vertexOffset);
+  auto indexBlock = vertexBlock == TlsfAllocator::INVALID_BLOCK
+                        ? TlsfAllocator::INVALID_BLOCK
+                        : mIndexRanges.allocate(indexBytes,
+                                                sizeof(std::uint32_t),
+                                                indexOffset);
+  if (indexBlock == TlsfAllocator::INVALID_BLOCK) {
+    if (vertexBlock != TlsfAllocator::INVALID_BLOCK) {
+      mVertexRanges.free(vertexBlock);
+    }
+    WLOG("Chunk mesh pool is full, dropping mesh with {} vertices",
+         vertices.size());
+    return mesh;
+  }
+
+  auto &uploadQueue = mDevice.getUploadQueue();
+  mesh.vertexTicket = uploadQueue.uploadBuffer(
+      mVertexBuffer->getBuffer(), vertices.data(), vertexBytes, vertexOffset,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  mesh.indexTicket = uploadQueue.uploadBuffer(
+      mIndexBuffer->getBuffer(), indices.data(), indexBytes, indexOffset,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+  mPendingTickets.push_back(mesh.vertexTicket);
+  mPendingTickets.push_back(mesh.indexTicket);
+
+  mesh.vertexBlock = vertexBlock;
+  mesh.indexBlock = indexBlock;
+  mesh.vertexOffset =
+      static_cast<std::int32_t>(vertexOffset / sizeof(VoxelVertex));
+  mesh.firstIndex =
+      static_cast<std::uint32_t>(indexOffset / sizeof(std::uint32_t));
+  mesh.indexCount = static_cast<std::uint32_t>(indices.size());
+  return mesh;
+}
+
+void ChunkMeshPool::remove(ChunkMeshRange &mesh) {
+  if (!mesh.valid()) {
+    return;
+  }
+  if (!isReady(mesh)) {
+    auto &uploadQueue = mDevice.getUploadQueue();
+    uploadQueue.cancel(mesh.vertexTicket);
+    uploadQueue.cancel(mesh.indexTicket);
+  }
+  mRetired.push_back({mFrame, mesh.vertexBlock, mesh.indexBlock});
+  mesh = {};
+}
+
+bool ChunkMeshPool::isReady(const ChunkMeshRange &mesh) const {
+  // tickets are ready in order, the index ticket covers both copies
+  return mesh.valid() && mDevice.getUploadQueue().isReady(mesh.indexTicket);
+}
+
+void ChunkMeshPool::nextFrame() {
+  mFrame++;
+
+  auto &uploadQueue = mDevice.getUploadQueue();
+  std::erase_if(mPendingTickets, [&uploadQueue](UploadTicket ticket) {
+    return uploadQueue.isReady(ticket);
+  });
+
+  std::erase_if(mRetired, [this](const RetiredMesh &retired) {
+    if (mFrame - retired.frame <= SwapChain::MAX_FRAME_IN_FLIGHT) {
+      return false;
+    }
+    mVertexRanges.free(retired.vertexBlock);
+    mIndexRanges.free(retired.indexBlock);
+    return true;
+  });
+}
+
+} // namespace mv
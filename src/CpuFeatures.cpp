@@ -0,0 +1,104 @@
+#include "CpuFeatures.h"
+
+#if defined(MV_X86_64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <cstdint>
+
+namespace mv {
+namespace cpu {
+
+namespace {
+#if defined(MV_X86_64)
+void cpuid(std::uint32_t leaf, std::uint32_t subLeaf, std::uint32_t regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subLeaf));
+  for (int i = 0; i < 4; i++) {
+    regs[i] = static_cast<std::uint32_t>(info[i]);
+  }
+#else
+  __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+std::uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  std::uint32_t eax = 0;
+  std::uint32_t edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+bool detectSse41() {
+  std::uint32_t regs[4] = {};
+  cpuid(0, 0, regs);
+  if (regs[0] < 1) {
+    return false;
+  }
+  cpuid(1, 0, regs);
+  constexpr std::uint32_t SSE41 = 1u << 19;
+  return (regs[2] & SSE41) != 0;
+}
+
+bool detectAvx2() {
+  std::uint32_t regs[4] = {};
+  cpuid(0, 0, regs);
+  if (regs[0] < 7) {
+    return false;
+  }
+
+  cpuid(1, 0, regs);
+  constexpr std::uint32_t OSXSAVE = 1u << 27;
+  constexpr std::uint32_t AVX = 1u << 28;
+  if ((regs[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX)) {
+    return false;
+  }
+  // XMM and YMM state enabled by the OS
+  if ((xgetbv0() & 0x6) != 0x6) {
+    return false;
+  }
+
+  cpuid(7, 0, regs);
+  constexpr std::uint32_t AVX2 = 1u << 5;
+  return (regs[1] & AVX2) != 0;
+}
+#endif
+} // namespace
+
+bool hasSse2() noexcept {
+#if defined(MV_X86_64)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool hasSse41() noexcept {
+#if defined(MV_X86_64)
+  static const bool sse41 = detectSse41();
+  return sse41;
+#else
+  return false;
+#endif
+}
+
+bool hasAvx2() noexcept {
+#if defined(MV_X86_64)
+  static const bool avx2 = detectAvx2();
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+} // namespace cpu
+} // namespace mv
@@ -1,5 +1,8 @@
 #include "Device.h"
 #include "Log.h"
+#include "PipelineCache.h"
+#include "StagingRing.h"
+#include "UploadQueue.h"
 
 #include <set>
 #include <unordered_set>
@@ -49,9 +52,18 @@ Device::Device(Window &window) : mWindow{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  mAllocator = std::make_unique<DeviceAllocator>(physicalDevice, mDevice);
+  mPipelineCache = std::make_unique<PipelineCache>(mDevice, properties);
+  mStagingRing = std::make_unique<StagingRing>(
+      *this, graphicsQueue, findPhysicalQueueFamily().graphicsFamily.value());
+  mUploadQueue = std::make_unique<UploadQueue>(*this);
 }
 
 Device::~Device() {
+  mUploadQueue.reset();
+  mStagingRing.reset();
+  mAllocator.reset();
+  mPipelineCache.reset();
   vkDestroyCommandPool(mDevice, commandPool, CUSTOM_ALLOCATOR);
   vkDestroyDevice(mDevice, CUSTOM_ALLOCATOR);
 
@@ -166,6 +178,9 @@ void Device::createLogicalDevice() {
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<std::uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
                                                  indices.presentFamily.value()};
+  if (indices.transferFamily.has_value()) {
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
+  }
 
   float queuePrio = 1.0f;
 
@@ -178,8 +193,16 @@ void Device::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures = {};
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // chunk rendering issues all draws from one indirect buffer
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance =
+      supportedFeatures.drawIndirectFirstInstance;
+  enabledFeatures = deviceFeatures;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -208,6 +231,10 @@ void Device::createLogicalDevice() {
 
   vkGetDeviceQueue(mDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
   vkGetDeviceQueue(mDevice, indices.presentFamily.value(), 0, &presentQueue);
+  if (indices.transferFamily.has_value()) {
+    vkGetDeviceQueue(mDevice, indices.transferFamily.value(), 0,
+                     &transferQueue);
+  }
 }
 
 void Device::createCommandPool() {
@@ -319,23 +346,26 @@ VkFormat Device::findSupportedFormat(const std::vector<VkFormat> &formats,
                                      VkImageTiling tiling,
                                      VkFormatFeatureFlags features) {
   for (VkFormat format : formats) {
-    VkFormatProperties prop;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &prop);
-
-    if (tiling == VK_IMAGE_TILING_LINEAR &&
-        (prop.linearTilingFeatures & features) == features) {
-      return format;
-    } else if (tiling == VK_IMAGE_TILING_OPTIMAL &&
-               (prop.optimalTilingFeatures & features) == features) {
+    if (supportsFormatFeatures(format, tiling, features)) {
       return format;
     }
   }
   RT_THROW("Failed to find supported format");
 }
 
+bool Device::supportsFormatFeatures(VkFormat format, VkImageTiling tiling,
+                                    VkFormatFeatureFlags features) {
+  VkFormatProperties prop;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &prop);
+  if (tiling == VK_IMAGE_TILING_LINEAR) {
+    return (prop.linearTilingFeatures & features) == features;
+  }
+  return (prop.optimalTilingFeatures & features) == features;
+}
+
 void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                           VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                          VkDeviceMemory &bufferMemory) {
+                          MemoryAllocation &bufferMemory) {
   VkBufferCreateInfo bufferInfo = {};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -348,18 +378,11 @@ void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   VkMemoryRequirements memReq;
   vkGetBufferMemoryRequirements(mDevice, buffer, &memReq);
 
-  VkMemoryAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memReq.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
+  bufferMemory =
+      mAllocator->allocate(memReq, properties, AllocationKind::Linear);
 
-  VK_TEST(
-      vkAllocateMemory(mDevice, &allocInfo, CUSTOM_ALLOCATOR, &bufferMemory),
-      "Failed to allocate buffer memory")
-
-  // worst case scenario; each buffer (index, vertex, uniform) needs separeate
-  // memoryBuffer and buffer
-  VK_TEST(vkBindBufferMemory(mDevice, buffer, bufferMemory, 0),
+  VK_TEST(vkBindBufferMemory(mDevice, buffer, bufferMemory.memory,
+                             bufferMemory.offset),
           "Failed to bind buffer memory")
 }
 
@@ -400,7 +423,8 @@ void Device::copyBufferToImage(VkBuffer buffer, VkImage image,
 
 void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                  VkMemoryPropertyFlags properties,
-                                 VkImage &image, VkDeviceMemory &imageMemory) {
+                                 VkImage &image,
+                                 MemoryAllocation &imageMemory) {
 
   VK_TEST(vkCreateImage(mDevice, &imageInfo, CUSTOM_ALLOCATOR, &image),
           "Failed to create image")
@@ -408,15 +432,13 @@ void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo,
   VkMemoryRequirements memReq;
   vkGetImageMemoryRequirements(mDevice, image, &memReq);
 
-  VkMemoryAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memReq.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
-
-  VK_TEST(vkAllocateMemory(mDevice, &allocInfo, CUSTOM_ALLOCATOR, &imageMemory),
-          "Failed to allocate image memory")
+  auto kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR
+                  ? AllocationKind::Linear
+                  : AllocationKind::Optimal;
+  imageMemory = mAllocator->allocate(memReq, properties, kind);
 
-  VK_TEST(vkBindImageMemory(mDevice, image, imageMemory, 0),
+  VK_TEST(vkBindImageMemory(mDevice, image, imageMemory.memory,
+                            imageMemory.offset),
           "Failed to bind image memory")
 }
 
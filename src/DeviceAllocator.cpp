@@ -0,0 +1,320 @@
+#include "DeviceAllocator.h"
+#include "DeviceHelper.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace mv {
+
+struct MemoryPage {
+  MemoryPage(VkDeviceMemory memory, void *mapped, VkDeviceSize size,
+             std::uint32_t pool)
+      : memory{memory}, mapped{mapped}, pool{pool}, tlsf{size} {}
+
+  VkDeviceMemory memory;
+  void *mapped;
+  std::uint32_t pool;
+  TlsfAllocator tlsf;
+};
+
+namespace {
+constexpr VkDeviceSize alignUp(VkDeviceSize value,
+                               VkDeviceSize alignment) noexcept {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr VkDeviceSize alignDown(VkDeviceSize value,
+                                 VkDeviceSize alignment) noexcept {
+  return value / alignment * alignment;
+}
+} // namespace
+
+DeviceAllocator::DeviceAllocator(VkPhysicalDevice physicalDevice,
+                                 VkDevice device, VkDeviceSize pageSize)
+    : mDevice{device}, mPageSize{pageSize} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemoryProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  mBufferImageGranularity =
+      std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+  mNonCoherentAtomSize =
+      std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+  mPools.resize(mMemoryProperties.memoryTypeCount * 2);
+}
+
+DeviceAllocator::~DeviceAllocator() {
+  auto leftover = stats();
+  if (leftover.liveAllocations > 0 || mDedicatedCount > 0) {
+    WLOG("DeviceAllocator destroyed with {} live allocations",
+         leftover.liveAllocations);
+  }
+
+  for (auto &pool : mPools) {
+    for (auto &page : pool) {
+      vkFreeMemory(mDevice, page->memory, CUSTOM_ALLOCATOR);
+    }
+  }
+}
+
+MemoryAllocation
+DeviceAllocator::allocate(const VkMemoryRequirements &requirements,
+                          VkMemoryPropertyFlags properties,
+                          AllocationKind kind) {
+  std::lock_guard lock{mMutex};
+
+  auto memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+  auto size = requirements.size;
+  auto alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+  if (isNonCoherent(memoryType)) {
+    // flushes are widened to whole atoms, keep them inside the allocation
+    size = alignUp(size, mNonCoherentAtomSize);
+    alignment = std::max(alignment, mNonCoherentAtomSize);
+  }
+
+  if (size > pageSize(memoryType) / 2) {
+    return allocateDedicated(size, memoryType);
+  }
+
+  auto pool = poolIndex(memoryType, kind);
+  MemoryPage *page = nullptr;
+  std::uint64_t offset = 0;
+  std::uint32_t block = TlsfAllocator::INVALID_BLOCK;
+  for (auto &candidate : mPools[pool]) {
+    block = candidate->tlsf.allocate(size, alignment, offset);
+    if (block != TlsfAllocator::INVALID_BLOCK) {
+      page = candidate.get();
+      break;
+    }
+  }
+
+  if (page == nullptr) {
+    // an empty page takes any pooled request, free() keeps at most one
+    assert(emptyPageCount(pool) == 0);
+    page = createPage(pool, memoryType);
+    block = page->tlsf.allocate(size, alignment, offset);
+    if (block == TlsfAllocator::INVALID_BLOCK) {
+      RT_THROW("Failed to sub-allocate device memory");
+    }
+  }
+
+  MemoryAllocation allocation = {};
+  allocation.memory = page->memory;
+  allocation.offset = offset;
+  allocation.size = size;
+  allocation.mapped =
+      page->mapped ? static_cast<char *>(page->mapped) + offset : nullptr;
+  allocation.memoryType = memoryType;
+  allocation.page = page;
+  allocation.block = block;
+  return allocation;
+}
+
+void DeviceAllocator::free(MemoryAllocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  std::lock_guard lock{mMutex};
+  if (allocation.page == nullptr) {
+    vkFreeMemory(mDevice, allocation.memory, CUSTOM_ALLOCATOR);
+    mDedicatedCount--;
+    mDedicatedBytes -= allocation.size;
+  } else {
+    auto *page = allocation.page;
+    auto pool = page->pool;
+    page->tlsf.free(allocation.block);
+    // keep one empty page per pool around so a free/alloc pattern at a page
+    // boundary does not hit vkAllocateMemory every time; full pages next to
+    // it do not count as spares
+    if (page->tlsf.empty() && emptyPageCount(pool) > 1) {
+      destroyPage(page);
+    }
+    assert(emptyPageCount(pool) <= 1);
+  }
+  allocation = {};
+}
+
+VkResult DeviceAllocator::flush(const MemoryAllocation &allocation,
+                                VkDeviceSize size, VkDeviceSize offset) {
+  if (!isNonCoherent(allocation.memoryType)) {
+    return VK_SUCCESS;
+  }
+  auto range = mappedRange(allocation, size, offset);
+  return vkFlushMappedMemoryRanges(mDevice, 1, &range);
+}
+
+VkResult DeviceAllocator::invalidate(const MemoryAllocation &allocation,
+                                     VkDeviceSize size, VkDeviceSize offset) {
+  if (!isNonCoherent(allocation.memoryType)) {
+    return VK_SUCCESS;
+  }
+  auto range = mappedRange(allocation, size, offset);
+  return vkInvalidateMappedMemoryRanges(mDevice, 1, &range);
+}
+
+std::uint32_t
+DeviceAllocator::findMemoryType(std::uint32_t typeFilter,
+                                VkMemoryPropertyFlags properties) const {
+  for (std::uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (mMemoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+  RT_THROW("Failed to find suitable memory type");
+}
+
+DeviceAllocatorStats DeviceAllocator::stats() const {
+  std::lock_guard lock{mMutex};
+
+  DeviceAllocatorStats stats = {};
+  for (const auto &pool : mPools) {
+    for (const auto &page : pool) {
+      const auto &tlsf = page->tlsf;
+      stats.pageCount++;
+      stats.liveAllocations += tlsf.allocationCount();
+      stats.reservedBytes += tlsf.size();
+      stats.usedBytes += tlsf.used();
+      auto pageFree = tlsf.size() - tlsf.used();
+      stats.freeBytes += pageFree;
+      stats.freeBlocks += tlsf.freeBlockCount();
+      auto largest = tlsf.largestFreeBlock();
+      stats.largestFreeBlock = std::max(stats.largestFreeBlock, largest);
+      if (pageFree > 0) {
+        stats.fragmentation =
+            std::max(stats.fragmentation,
+                     1.0f - static_cast<float>(largest) /
+                                static_cast<float>(pageFree));
+      }
+    }
+  }
+  stats.dedicatedCount = mDedicatedCount;
+  stats.deviceMemoryCount = stats.pageCount + mDedicatedCount;
+  stats.liveAllocations += mDedicatedCount;
+  stats.reservedBytes += mDedicatedBytes;
+  stats.usedBytes += mDedicatedBytes;
+  return stats;
+}
+
+void DeviceAllocator::logStats() const {
+  auto current = stats();
+  LOG("Device memory: {} allocations in {} vkDeviceMemory ({} pages, {} "
+      "dedicated)",
+      current.liveAllocations, current.deviceMemoryCount, current.pageCount,
+      current.dedicatedCount);
+  LOG("Device memory: {} / {} KiB used, {} free blocks, largest {} KiB, "
+      "fragmentation {:.2f}",
+      current.usedBytes / 1024, current.reservedBytes / 1024,
+      current.freeBlocks, current.largestFreeBlock / 1024,
+      current.fragmentation);
+}
+
+std::uint32_t DeviceAllocator::poolIndex(std::uint32_t memoryType,
+                                         AllocationKind kind) const noexcept {
+  // with a granularity of 1 linear and optimal resources may share pages
+  auto kindIdx =
+      mBufferImageGranularity > 1 ? static_cast<std::uint32_t>(kind) : 0u;
+  return memoryType * 2 + kindIdx;
+}
+
+VkDeviceSize DeviceAllocator::pageSize(std::uint32_t memoryType) const noexcept {
+  auto heapIndex = mMemoryProperties.memoryTypes[memoryType].heapIndex;
+  auto heapSize = mMemoryProperties.memoryHeaps[heapIndex].size;
+  // small heaps (e.g. 256 MiB host visible VRAM) get proportionally smaller
+  // pages so one page cannot take most of the heap
+  auto size = std::min(mPageSize, heapSize / 8);
+  return std::max(alignDown(size, mNonCoherentAtomSize),
+                  TlsfAllocator::MIN_BLOCK_SIZE);
+}
+
+bool DeviceAllocator::isNonCoherent(std::uint32_t memoryType) const noexcept {
+  auto flags = mMemoryProperties.memoryTypes[memoryType].propertyFlags;
+  return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+         !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+VkDeviceMemory DeviceAllocator::allocateMemory(VkDeviceSize size,
+                                               std::uint32_t memoryType,
+                                               void **mapped) {
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  VkDeviceMemory memory;
+  VK_TEST(vkAllocateMemory(mDevice, &allocInfo, CUSTOM_ALLOCATOR, &memory),
+          "Failed to allocate device memory")
+
+  *mapped = nullptr;
+  if (mMemoryProperties.memoryTypes[memoryType].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    VK_TEST(vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, mapped),
+            "Failed to map device memory")
+  }
+  return memory;
+}
+
+MemoryAllocation DeviceAllocator::allocateDedicated(VkDeviceSize size,
+                                                    std::uint32_t memoryType) {
+  MemoryAllocation allocation = {};
+  allocation.memory = allocateMemory(size, memoryType, &allocation.mapped);
+  allocation.size = size;
+  allocation.memoryType = memoryType;
+
+  mDedicatedCount++;
+  mDedicatedBytes += size;
+  return allocation;
+}
+
+MemoryPage *DeviceAllocator::createPage(std::uint32_t pool,
+                                        std::uint32_t memoryType) {
+  auto size = pageSize(memoryType);
+  void *mapped = nullptr;
+  auto memory = allocateMemory(size, memoryType, &mapped);
+
+  mPools[pool].push_back(
+      std::make_unique<MemoryPage>(memory, mapped, size, pool));
+  return mPools[pool].back().get();
+}
+
+std::uint32_t DeviceAllocator::emptyPageCount(std::uint32_t pool) const {
+  return static_cast<std::uint32_t>(
+      std::count_if(mPools[pool].begin(), mPools[pool].end(),
+                    [](const auto &page) { return page->tlsf.empty(); }));
+}
+
+void DeviceAllocator::destroyPage(MemoryPage *page) {
+  auto &pool = mPools[page->pool];
+  auto it = std::find_if(pool.begin(), pool.end(),
+                         [page](const auto &entry) { return entry.get() == page; });
+  assert(it != pool.end());
+
+  // freeing mapped memory implicitly unmaps it
+  vkFreeMemory(mDevice, page->memory, CUSTOM_ALLOCATOR);
+  pool.erase(it);
+}
+
+VkMappedMemoryRange
+DeviceAllocator::mappedRange(const MemoryAllocation &allocation,
+                             VkDeviceSize size,
+                             VkDeviceSize offset) const noexcept {
+  auto memorySize =
+      allocation.page ? allocation.page->tlsf.size() : allocation.size;
+  auto begin = allocation.offset + offset;
+  auto end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size
+                                   : begin + size;
+
+  VkMappedMemoryRange range = {};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = allocation.memory;
+  range.offset = alignDown(begin, mNonCoherentAtomSize);
+  range.size =
+      std::min(alignUp(end, mNonCoherentAtomSize), memorySize) - range.offset;
+  return range;
+}
+
+} // namespace mv
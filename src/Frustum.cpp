@@ -0,0 +1,267 @@
+#include "Frustum.h"
+#include "CpuFeatures.h"
+
+#include <bit>
+#include <cmath>
+
+#if defined(MV_X86_64)
+#include <immintrin.h>
+#endif
+
+namespace mv {
+
+namespace {
+// per plane pointers to the box corner furthest along the plane normal; the
+// box is outside when even that corner is behind the plane
+struct PlaneInput {
+  float nx, ny, nz, w;
+  const float *px;
+  const float *py;
+  const float *pz;
+};
+
+using PlaneInputs = std::array<PlaneInput, 6>;
+
+PlaneInputs makePlaneInputs(const Frustum &frustum, const AabbList &boxes) {
+  PlaneInputs inputs = {};
+  for (std::size_t p = 0; p < inputs.size(); p++) {
+    const auto &plane = frustum.planes[p];
+    inputs[p] = {plane.x,
+                 plane.y,
+                 plane.z,
+                 plane.w,
+                 plane.x >= 0.0f ? boxes.maxX.data() : boxes.minX.data(),
+                 plane.y >= 0.0f ? boxes.maxY.data() : boxes.minY.data(),
+                 plane.z >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data()};
+  }
+  return inputs;
+}
+
+std::size_t cullScalar(const PlaneInputs &planes, std::size_t begin,
+                       std::size_t end, std::uint32_t *out) {
+  std::size_t count = 0;
+  for (auto i = begin; i < end; i++) {
+    bool outside = false;
+    for (const auto &plane : planes) {
+      float distance =
+          plane.nx * plane.px[i] + plane.ny * plane.py[i] +
+          plane.nz * plane.pz[i] + plane.w;
+      outside |= distance < 0.0f;
+    }
+    out[count] = static_cast<std::uint32_t>(i);
+    count += outside ? 0 : 1;
+  }
+  return count;
+}
+
+#if defined(MV_X86_64)
+// for every 8 bit visibility mask the lanes to gather, visible ones first
+struct CompactTable {
+  std::uint32_t lanes[256][8];
+};
+
+constexpr CompactTable makeCompactTable() {
+  CompactTable table = {};
+  for (std::uint32_t mask = 0; mask < 256; mask++) {
+    std::uint32_t count = 0;
+    for (std::uint32_t lane = 0; lane < 8; lane++) {
+      if (mask & (1u << lane)) {
+        table.lanes[mask][count++] = lane;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr CompactTable COMPACT_LUT = makeCompactTable();
+
+std::size_t cullSse(const PlaneInputs &planes, std::size_t size,
+                    std::uint32_t *out, std::size_t &done) {
+  std::size_t count = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128 outside = _mm_setzero_ps();
+    for (const auto &plane : planes) {
+      // same operation order as cullScalar so all backends agree exactly
+      __m128 distance =
+          _mm_mul_ps(_mm_set1_ps(plane.nx), _mm_loadu_ps(plane.px + i));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ny),
+                                                 _mm_loadu_ps(plane.py + i)));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz),
+                                                 _mm_loadu_ps(plane.pz + i)));
+      distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+      if (_mm_movemask_ps(outside) == 0xf) {
+        break;
+      }
+    }
+    // branchless compaction, a rejected box gets overwritten by the next one
+    auto visible = static_cast<unsigned>(~_mm_movemask_ps(outside));
+    for (std::uint32_t lane = 0; lane < 4; lane++) {
+      out[count] = static_cast<std::uint32_t>(i + lane);
+      count += (visible >> lane) & 1u;
+    }
+  }
+  done = i;
+  return count;
+}
+
+MV_TARGET_AVX2 std::size_t cullAvx2(const PlaneInputs &planes,
+                                    std::size_t size, std::uint32_t *out,
+                                    std::size_t &done) {
+  // local copies: the index stores below may alias anything, which would
+  // force the plane data to be reloaded every iteration
+  __m256 nx[6], ny[6], nz[6], w[6];
+  const float *px[6], *py[6], *pz[6];
+  for (std::size_t p = 0; p < 6; p++) {
+    nx[p] = _mm256_set1_ps(planes[p].nx);
+    ny[p] = _mm256_set1_ps(planes[p].ny);
+    nz[p] = _mm256_set1_ps(planes[p].nz);
+    w[p] = _mm256_set1_ps(planes[p].w);
+    px[p] = planes[p].px;
+    py[p] = planes[p].py;
+    pz[p] = planes[p].pz;
+  }
+
+  const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i base = _mm256_setzero_si256();
+  std::size_t count = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256 outside = _mm256_setzero_ps();
+    for (std::size_t p = 0; p < 6; p++) {
+      __m256 distance = _mm256_mul_ps(nx[p], _mm256_loadu_ps(px[p] + i));
+      distance = _mm256_add_ps(distance,
+                               _mm256_mul_ps(ny[p], _mm256_loadu_ps(py[p] + i)));
+      distance = _mm256_add_ps(distance,
+                               _mm256_mul_ps(nz[p], _mm256_loadu_ps(pz[p] + i)));
+      distance = _mm256_add_ps(distance, w[p]);
+      outside = _mm256_or_ps(
+          outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+      // neighbouring boxes are usually rejected by the same plane
+      if (_mm256_movemask_ps(outside) == 0xff) {
+        break;
+      }
+    }
+    // move the visible lanes to the front and store all eight; the slots
+    // past count are overwritten by the next group
+    auto visible = static_cast<unsigned>(~_mm256_movemask_ps(outside)) & 0xffu;
+    __m256i lanes = _mm256_permutevar8x32_epi32(
+        _mm256_add_epi32(base, laneOffsets),
+        _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(COMPACT_LUT.lanes[visible])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + count), lanes);
+    count += static_cast<std::size_t>(std::popcount(visible));
+    base = _mm256_add_epi32(base, _mm256_set1_epi32(8));
+  }
+  done = i;
+  return count;
+}
+#endif
+
+CullBackend resolve(CullBackend backend) {
+  if (backend == CullBackend::Auto) {
+    if (cpu::hasAvx2()) {
+      return CullBackend::Avx2;
+    }
+    return cpu::hasSse2() ? CullBackend::Sse : CullBackend::Scalar;
+  }
+  // explicit requests the CPU cannot run fall back to the next best one
+  if (backend == CullBackend::Avx2 && !cpu::hasAvx2()) {
+    backend = CullBackend::Sse;
+  }
+  if (backend == CullBackend::Sse && !cpu::hasSse2()) {
+    backend = CullBackend::Scalar;
+  }
+  return backend;
+}
+} // namespace
+
+void AabbList::push(const glm::vec3 &min, const glm::vec3 &max) {
+  minX.push_back(min.x);
+  minY.push_back(min.y);
+  minZ.push_back(min.z);
+  maxX.push_back(max.x);
+  maxY.push_back(max.y);
+  maxZ.push_back(max.z);
+}
+
+void AabbList::reserve(std::size_t count) {
+  for (auto *component : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+    component->reserve(count);
+  }
+}
+
+void AabbList::clear() {
+  for (auto *component : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+    component->clear();
+  }
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m) {
+  // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+  auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+  auto r0 = row(0);
+  auto r1 = row(1);
+  auto r2 = row(2);
+  auto r3 = row(3);
+
+  Frustum frustum = {};
+  frustum.planes[0] = r3 + r0; // left
+  frustum.planes[1] = r3 - r0; // right
+  frustum.planes[2] = r3 + r1; // bottom
+  frustum.planes[3] = r3 - r1; // top
+  frustum.planes[4] = r2;      // near, clip z starts at 0 in Vulkan
+  frustum.planes[5] = r3 - r2; // far
+
+  for (auto &plane : frustum.planes) {
+    float length =
+        std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    plane = plane / length;
+  }
+  return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3 &min,
+                         const glm::vec3 &max) const noexcept {
+  for (const auto &plane : planes) {
+    float px = plane.x >= 0.0f ? max.x : min.x;
+    float py = plane.y >= 0.0f ? max.y : min.y;
+    float pz = plane.z >= 0.0f ? max.z : min.z;
+    if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t Frustum::cull(const AabbList &boxes,
+                          std::vector<std::uint32_t> &visible,
+                          CullBackend backend) const {
+  auto size = boxes.size();
+  // the AVX2 path stores whole groups of 8 indices past the last visible one
+  visible.resize(size + 8);
+
+  auto inputs = makePlaneInputs(*this, boxes);
+  auto *out = visible.data();
+  std::size_t count = 0;
+  std::size_t done = 0;
+  switch (resolve(backend)) {
+#if defined(MV_X86_64)
+  case CullBackend::Avx2:
+    count = cullAvx2(inputs, size, out, done);
+    break;
+  case CullBackend::Sse:
+    count = cullSse(inputs, size, out, done);
+    break;
+#endif
+  default:
+    break;
+  }
+  count += cullScalar(inputs, done, size, out + count);
+
+  visible.resize(count);
+  return count;
+}
+
+} // namespace mv
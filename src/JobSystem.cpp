@@ -0,0 +1,342 @@
+#include "JobSystem.h"
+#include "CpuFeatures.h"
+#include "Log.h"
+
+#include <cassert>
+#include <thread>
+
+#if defined(MV_X86_64)
+#include <immintrin.h>
+#endif
+
+namespace mv {
+
+namespace {
+// jobs one thread can have queued or running; also the deque capacity, so a
+// push never finds the deque full
+constexpr std::uint32_t JOB_CAPACITY = 4096;
+static_assert((JOB_CAPACITY & (JOB_CAPACITY - 1)) == 0);
+
+// failed steal rounds before an idle worker goes to sleep
+constexpr std::uint32_t IDLE_SPINS = 64;
+
+void cpuRelax() {
+#if defined(MV_X86_64)
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+std::uint32_t nextRandom(std::uint32_t &state) noexcept {
+  // xorshift32, only used to pick steal victims
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+} // namespace
+
+// Fixed size Chase-Lev deque of job pointers (Le, Pop, Cohen, Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models"). push and pop
+// belong to the owning thread, steal may be called from any thread.
+class JobDeque {
+public:
+  JobDeque() : mBuffer{std::make_unique<std::atomic<void *>[]>(JOB_CAPACITY)} {}
+
+  bool push(void *job) {
+    auto bottom = mBottom.load(std::memory_order_relaxed);
+    auto top = mTop.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<std::int64_t>(JOB_CAPACITY)) {
+      return false;
+    }
+    mBuffer[bottom & (JOB_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    // publishes the job contents to thieves reading bottom
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  void *pop() {
+    auto bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = mTop.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      mBottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    void *job =
+        mBuffer[bottom & (JOB_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // last job, race the thieves for it
+      if (!mTop.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  void *steal() {
+    auto top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = mBottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    void *job =
+        mBuffer[top & (JOB_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return job;
+  }
+
+  bool empty() const noexcept {
+    return mTop.load(std::memory_order_relaxed) >=
+           mBottom.load(std::memory_order_relaxed);
+  }
+
+private:
+  // owner and thieves touch different ends, keep them on separate lines
+  alignas(64) std::atomic<std::int64_t> mTop = {0};
+  alignas(64) std::atomic<std::int64_t> mBottom = {0};
+  std::unique_ptr<std::atomic<void *>[]> mBuffer;
+};
+
+struct JobSystem::Worker {
+  JobSystem *system = {nullptr};
+  std::uint32_t index = {0};
+  std::uint32_t random = {0};
+  JobDeque deque;
+  std::unique_ptr<Job[]> jobs;
+  std::uint32_t nextJob = {0};
+  std::thread thread;
+};
+
+namespace {
+// the worker the current thread runs for; the creating thread of a system
+// counts as its worker 0
+thread_local void *tWorker = nullptr;
+} // namespace
+
+JobSystem::JobSystem(std::uint32_t workerCount) {
+  if (workerCount == 0) {
+    auto hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware - 1 : 1;
+  }
+
+  mWorkers.resize(workerCount + 1);
+  for (std::uint32_t i = 0; i < mWorkers.size(); i++) {
+    auto worker = std::make_unique<Worker>();
+    worker->system = this;
+    worker->index = i;
+    worker->random = 0x9e3779b9u * (i + 1);
+    worker->jobs = std::make_unique<Job[]>(JOB_CAPACITY);
+    mWorkers[i] = std::move(worker);
+  }
+
+  assert(tWorker == nullptr && "one JobSystem per thread");
+  tWorker = mWorkers[0].get();
+  for (std::uint32_t i = 1; i < mWorkers.size(); i++) {
+    auto &worker = *mWorkers[i];
+    worker.thread = std::thread{[this, &worker] {
+      tWorker = &worker;
+      workerLoop(worker);
+    }};
+  }
+  LOG("Job system: {} worker threads", workerCount);
+}
+
+JobSystem::~JobSystem() {
+  mStop.store(true, std::memory_order_seq_cst);
+  mWake.fetch_add(1, std::memory_order_seq_cst);
+  mWake.notify_all();
+  for (std::uint32_t i = 1; i < mWorkers.size(); i++) {
+    mWorkers[i]->thread.join();
+  }
+  tWorker = nullptr;
+}
+
+std::uint32_t JobSystem::threadIndex() const noexcept {
+  auto *worker = currentWorker();
+  assert(worker != nullptr && "not a thread of this job system");
+  return worker != nullptr ? worker->index : 0;
+}
+
+JobSystem::Worker *JobSystem::currentWorker() const noexcept {
+  auto *worker = static_cast<Worker *>(tWorker);
+  return worker != nullptr && worker->system == this ? worker : nullptr;
+}
+
+JobSystem::Job *JobSystem::allocate() {
+  auto *worker = currentWorker();
+  if (worker == nullptr) {
+    return nullptr;
+  }
+  // slots are handed out round robin; one still queued or running means
+  // this thread is far ahead of the others
+  auto &job = worker->jobs[worker->nextJob & (JOB_CAPACITY - 1)];
+  if (job.busy.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  worker->nextJob++;
+  job.busy.store(true, std::memory_order_relaxed);
+  return &job;
+}
+
+void JobSystem::push(Job *job) {
+  auto *worker = currentWorker();
+  if (worker == nullptr || !worker->deque.push(job)) {
+    execute(job);
+    return;
+  }
+  // pairs with the fence in workerLoop: either the sleeper sees the job or
+  // we see the sleeper
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mSleeping.load(std::memory_order_relaxed) > 0) {
+    mWake.fetch_add(1, std::memory_order_relaxed);
+    mWake.notify_one();
+  }
+}
+
+bool JobSystem::park(Job *job, const JobCounter &dependency) {
+  auto value = dependency.mValue.load(std::memory_order_acquire);
+  while (true) {
+    if ((value & JobCounter::COUNT_MASK) == 0) {
+      return false;
+    }
+    if ((value & JobCounter::LOCKED) != 0) {
+      cpuRelax();
+      value = dependency.mValue.load(std::memory_order_acquire);
+      continue;
+    }
+    if (dependency.mValue.compare_exchange_weak(value,
+                                                value | JobCounter::LOCKED,
+                                                std::memory_order_acquire)) {
+      break;
+    }
+  }
+  // the count cannot reach zero while locked, finish() waits for the lock
+  job->next = static_cast<Job *>(dependency.mContinuations);
+  dependency.mContinuations = job;
+  value |= JobCounter::LOCKED;
+  while (!dependency.mValue.compare_exchange_weak(
+      value, (value & ~JobCounter::LOCKED) | JobCounter::WAITING,
+      std::memory_order_release)) {
+  }
+  return true;
+}
+
+void JobSystem::finish(JobCounter &counter) {
+  auto value = counter.mValue.load(std::memory_order_relaxed);
+  while (true) {
+    auto count = value & JobCounter::COUNT_MASK;
+    if (count > 1 || (value & (JobCounter::LOCKED | JobCounter::WAITING)) ==
+                         0) {
+      // release publishes the job's writes to wait() and to the thread
+      // that finishes the counter's last job
+      if (counter.mValue.compare_exchange_weak(value, value - 1,
+                                               std::memory_order_acq_rel)) {
+        return;
+      }
+    } else if ((value & JobCounter::LOCKED) != 0) {
+      // a job is being parked, it has to land before the count hits zero
+      cpuRelax();
+      value = counter.mValue.load(std::memory_order_relaxed);
+    } else if (counter.mValue.compare_exchange_weak(
+                   value, JobCounter::LOCKED, std::memory_order_acq_rel)) {
+      break;
+    }
+  }
+
+  auto *waiting = static_cast<Job *>(counter.mContinuations);
+  counter.mContinuations = nullptr;
+  // last access, the counter may be gone once done() sees zero
+  counter.mValue.fetch_and(~JobCounter::LOCKED, std::memory_order_release);
+  while (waiting != nullptr) {
+    auto *next = waiting->next;
+    push(waiting);
+    waiting = next;
+  }
+}
+
+void JobSystem::execute(Job *job) {
+  job->invoke(job->storage);
+
+  auto *counter = job->counter;
+  if (job->overflow) {
+    delete job;
+  } else {
+    job->busy.store(false, std::memory_order_release);
+  }
+  if (counter != nullptr) {
+    finish(*counter);
+  }
+}
+
+bool JobSystem::runOne(Worker &worker) {
+  auto *job = static_cast<Job *>(worker.deque.pop());
+  if (job == nullptr) {
+    auto count = static_cast<std::uint32_t>(mWorkers.size());
+    auto first = nextRandom(worker.random) % count;
+    for (std::uint32_t i = 0; i < count && job == nullptr; i++) {
+      auto victim = (first + i) % count;
+      if (victim != worker.index) {
+        job = static_cast<Job *>(mWorkers[victim]->deque.steal());
+      }
+    }
+  }
+  if (job == nullptr) {
+    return false;
+  }
+  execute(job);
+  return true;
+}
+
+bool JobSystem::hasWork() const {
+  for (const auto &worker : mWorkers) {
+    if (!worker->deque.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::wait(const JobCounter &counter) {
+  auto *worker = currentWorker();
+  while (!counter.done()) {
+    if (worker == nullptr || !runOne(*worker)) {
+      cpuRelax();
+    }
+  }
+}
+
+void JobSystem::workerLoop(Worker &worker) {
+  std::uint32_t idle = 0;
+  while (!mStop.load(std::memory_order_relaxed)) {
+    if (runOne(worker)) {
+      idle = 0;
+      continue;
+    }
+    if (++idle < IDLE_SPINS) {
+      cpuRelax();
+      continue;
+    }
+
+    mSleeping.fetch_add(1, std::memory_order_seq_cst);
+    auto wake = mWake.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!hasWork() && !mStop.load(std::memory_order_relaxed)) {
+      mWake.wait(wake, std::memory_order_relaxed);
+    }
+    mSleeping.fetch_sub(1, std::memory_order_relaxed);
+    idle = 0;
+  }
+}
+
+} // namespace mv
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mv {
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    mData = std::exchange(other.mData, nullptr);
+    mSize = std::exchange(other.mSize, 0);
+#if defined(_WIN32)
+    mFile = std::exchange(other.mFile, nullptr);
+    mMapping = std::exchange(other.mMapping, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  // writers may keep the file open, e.g. RegionFile's stream
+  auto file = CreateFileA(path.c_str(), GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+  auto *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  mFile = file;
+  mMapping = mapping;
+  mData = static_cast<const char *>(data);
+  mSize = static_cast<std::size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::close() noexcept {
+  if (mData != nullptr) {
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+  }
+  mData = nullptr;
+  mSize = 0;
+  mFile = nullptr;
+  mMapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info = {};
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  auto size = static_cast<std::size_t>(info.st_size);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  mData = static_cast<const char *>(data);
+  mSize = size;
+  return true;
+}
+
+void MappedFile::close() noexcept {
+  if (mData != nullptr) {
+    munmap(const_cast<char *>(mData), mSize);
+  }
+  mData = nullptr;
+  mSize = 0;
+}
+
+#endif
+
+} // namespace mv
@@ -0,0 +1,230 @@
+#include "MeshFile.h"
+#include "Hash.h"
+#include "Log.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace mv {
+
+namespace {
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment) noexcept {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// size and mtime of path, false when it does not exist
+bool statSource(const std::string &path, MeshFile::Source &source) {
+  std::error_code error;
+  auto size = std::filesystem::file_size(path, error);
+  if (error) {
+    return false;
+  }
+  auto mtime = std::filesystem::last_write_time(path, error);
+  if (error) {
+    return false;
+  }
+  source.size = size;
+  source.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+  return true;
+}
+
+bool hashSource(const std::string &path, MeshFile::Source &source) {
+  MappedFile file;
+  if (!file.open(path)) {
+    return false;
+  }
+  source.hash = hashBytes(file.data(), file.size());
+  return true;
+}
+} // namespace
+
+std::string MeshFile::cachePath(const std::string &objPath) {
+  return std::filesystem::path{objPath}.replace_extension(EXTENSION).string();
+}
+
+bool MeshFile::load(const std::string &objPath, JobSystem *jobs) {
+  auto path = cachePath(objPath);
+  Source source = {};
+  bool hasSource = statSource(objPath, source);
+
+  Header header = {};
+  if (map(path, header)) {
+    if (!hasSource) {
+      // shipped without the OBJ, nothing to compare against
+      return true;
+    }
+    const auto &cached = header.source;
+    if (cached.size == source.size && cached.mtime == source.mtime) {
+      return true;
+    }
+    // touched but maybe not changed, e.g. by a checkout
+    if (cached.size == source.size && hashSource(objPath, source) &&
+        cached.hash == source.hash) {
+      LOG("{} has a new mtime but the same content, keeping {}", objPath,
+          path);
+      // otherwise every later load hashes the OBJ again
+      if (writeMtime(path, source.mtime)) {
+        mSource.mtime = source.mtime;
+      }
+      return true;
+    }
+    LOG("{} changed, converting it again", objPath);
+    unmap();
+  }
+  if (!hasSource) {
+    ELOG("Failed to load {}: neither it nor {} can be read", objPath, path);
+    return false;
+  }
+
+  ModelLoader loader;
+  loader.load(objPath, jobs);
+  if (loader.vertices.empty() || !hashSource(objPath, source)) {
+    return false;
+  }
+  // paid once per conversion, every later load gets the optimized order
+  mesh_optimizer::optimize(loader);
+  if (write(path, loader, source) && map(path, header)) {
+    return true;
+  }
+
+  WLOG("Failed to cache {}, using the parsed OBJ", objPath);
+  mParsed = std::move(loader);
+  mVertices = mParsed.vertices.data();
+  mVertexCount = static_cast<std::uint32_t>(mParsed.vertices.size());
+  mIndices = mParsed.indices.data();
+  mIndexCount = static_cast<std::uint32_t>(mParsed.indices.size());
+  return true;
+}
+
+bool MeshFile::write(const std::string &path, const ModelLoader &mesh,
+                     const Source &source) {
+  Header header = {};
+  header.vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+  header.indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+  header.source = source;
+  header.vertexOffset = alignUp(sizeof(Header), BLOB_ALIGNMENT);
+  auto vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+  header.indexOffset =
+      alignUp(header.vertexOffset + vertexBytes, BLOB_ALIGNMENT);
+  auto indexBytes = mesh.indices.size() * sizeof(std::uint32_t);
+
+  const char padding[BLOB_ALIGNMENT] = {};
+  auto tempPath = path + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios_base::binary | std::ios_base::trunc};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, static_cast<std::streamsize>(header.vertexOffset -
+                                                     sizeof(header)));
+    file.write(reinterpret_cast<const char *>(mesh.vertices.data()),
+               static_cast<std::streamsize>(vertexBytes));
+    file.write(padding,
+               static_cast<std::streamsize>(header.indexOffset -
+                                            header.vertexOffset - vertexBytes));
+    file.write(reinterpret_cast<const char *>(mesh.indices.data()),
+               static_cast<std::streamsize>(indexBytes));
+    file.flush();
+    if (!file.good()) {
+      WLOG("Failed to write mesh cache {}", tempPath);
+      file.close();
+      std::error_code error;
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    WLOG("Failed to replace mesh cache {}: {}", path, error.message());
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  LOG("Wrote mesh cache {}: {} vertices, {} indices", path,
+      header.vertexCount, header.indexCount);
+  return true;
+}
+
+bool MeshFile::map(const std::string &path, Header &header) {
+  if (!mFile.open(path)) {
+    return false;
+  }
+  auto size = static_cast<std::uint64_t>(mFile.size());
+  if (size < sizeof(Header)) {
+    WLOG("Mesh cache {} is truncated, ignoring it", path);
+    unmap();
+    return false;
+  }
+  std::memcpy(&header, mFile.data(), sizeof(Header));
+
+  const Header expected = {};
+  auto vertexBytes = std::uint64_t{header.vertexCount} * sizeof(Vertex);
+  auto indexBytes = std::uint64_t{header.indexCount} * sizeof(std::uint32_t);
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.version != expected.version ||
+      header.vertexSize != expected.vertexSize ||
+      header.vertexOffset % BLOB_ALIGNMENT != 0 ||
+      header.indexOffset % BLOB_ALIGNMENT != 0 ||
+      header.vertexOffset < sizeof(Header) ||
+      // each blob inside the file, without sums a huge offset could wrap
+      header.vertexOffset > size || vertexBytes > size - header.vertexOffset ||
+      header.indexOffset > size || indexBytes > size - header.indexOffset ||
+      header.indexOffset < header.vertexOffset + vertexBytes) {
+    WLOG("Mesh cache {} has a bad header or an old version, ignoring it", path);
+    unmap();
+    return false;
+  }
+
+  // the mapping is page aligned, the blob offsets keep that alignment
+  const auto *indices = reinterpret_cast<const std::uint32_t *>(
+      mFile.data() + header.indexOffset);
+  // a damaged index would have the GPU read past the vertex buffer
+  if (std::any_of(indices, indices + header.indexCount,
+                  [&header](std::uint32_t index) {
+                    return index >= header.vertexCount;
+                  })) {
+    WLOG("Mesh cache {} has indices past its {} vertices, ignoring it", path,
+         header.vertexCount);
+    unmap();
+    return false;
+  }
+  mVertices =
+      reinterpret_cast<const Vertex *>(mFile.data() + header.vertexOffset);
+  mVertexCount = header.vertexCount;
+  mIndices = indices;
+  mIndexCount = header.indexCount;
+  mSource = header.source;
+  return true;
+}
+
+void MeshFile::unmap() noexcept {
+  mFile.close();
+  mSource = {};
+  mVertices = nullptr;
+  mVertexCount = 0;
+  mIndices = nullptr;
+  mIndexCount = 0;
+}
+
+bool MeshFile::writeMtime(const std::string &path, std::int64_t mtime) {
+  // eight bytes in place: the rest of the header and the blobs stay valid
+  // whether or not the write lands
+  std::fstream file{path,
+                    std::ios_base::binary | std::ios_base::in |
+                        std::ios_base::out};
+  file.seekp(static_cast<std::streamoff>(offsetof(Header, source) +
+                                         offsetof(Source, mtime)));
+  file.write(reinterpret_cast<const char *>(&mtime), sizeof(mtime));
+  file.flush();
+  if (!file.good()) {
+    WLOG("Failed to update the source mtime in {}", path);
+    return false;
+  }
+  return true;
+}
+
+} // namespace mv
@@ -0,0 +1,319 @@
+#include "MeshOptimizer.h"
+#include "Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+
+namespace mv {
+namespace mesh_optimizer {
+
+namespace {
+constexpr std::uint32_t NO_VERTEX = std::numeric_limits<std::uint32_t>::max();
+
+// FIFO post transform cache. A vertex is cached while fewer than cacheSize
+// others were inserted after it; hits do not refresh it.
+class CacheSimulator {
+public:
+  CacheSimulator(std::uint32_t vertexCount, std::uint32_t cacheSize)
+      : mStamps(vertexCount, 0), mCacheSize{cacheSize},
+        mTime{cacheSize + 1} {}
+
+  // true when v had to be transformed
+  bool access(std::uint32_t v) {
+    if (mTime - mStamps[v] > mCacheSize) {
+      mStamps[v] = mTime++;
+      return true;
+    }
+    return false;
+  }
+
+  std::uint32_t accessTriangle(const std::uint32_t *triangle) {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+
+  void flush() { mTime += mCacheSize + 1; }
+
+private:
+  std::vector<std::uint32_t> mStamps;
+  std::uint32_t mCacheSize;
+  std::uint32_t mTime;
+};
+} // namespace
+
+CacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices,
+                              std::uint32_t vertexCount,
+                              std::uint32_t cacheSize) {
+  CacheStats stats = {};
+  if (indices.size() < 3) {
+    return stats;
+  }
+  CacheSimulator cache{vertexCount, cacheSize};
+  std::vector<bool> used(vertexCount, false);
+  std::uint32_t transforms = 0;
+  std::uint32_t unique = 0;
+  for (auto v : indices) {
+    transforms += cache.access(v);
+    if (!used[v]) {
+      used[v] = true;
+      unique++;
+    }
+  }
+  stats.acmr = static_cast<float>(transforms) /
+               static_cast<float>(indices.size() / 3);
+  stats.atvr = static_cast<float>(transforms) / static_cast<float>(unique);
+  return stats;
+}
+
+std::vector<std::uint32_t>
+optimizeVertexCache(std::vector<std::uint32_t> &indices,
+                    std::uint32_t vertexCount, std::uint32_t cacheSize) {
+  assert(indices.size() % 3 == 0 && "indices must form triangles");
+  auto triangleCount = static_cast<std::uint32_t>(indices.size() / 3);
+  std::vector<std::uint32_t> clusters;
+  if (triangleCount == 0) {
+    return clusters;
+  }
+
+  // triangles of every vertex, CSR style
+  std::vector<std::uint32_t> live(vertexCount, 0);
+  for (auto v : indices) {
+    live[v]++;
+  }
+  std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+  std::inclusive_scan(live.begin(), live.end(), offsets.begin() + 1);
+  std::vector<std::uint32_t> adjacency(indices.size());
+  {
+    auto fill = offsets;
+    for (std::uint32_t t = 0; t < triangleCount; t++) {
+      for (std::uint32_t c = 0; c < 3; c++) {
+        adjacency[fill[indices[t * 3 + c]]++] = t;
+      }
+    }
+  }
+
+  std::vector<std::uint32_t> cacheTime(vertexCount, 0);
+  std::uint32_t time = cacheSize + 1;
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<std::uint32_t> deadEnds;
+  std::vector<std::uint32_t> candidates;
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  std::uint32_t cursor = 0;
+
+  // most recently touched vertex with triangles left, then the first one in
+  // input order
+  auto skipDeadEnd = [&]() {
+    while (!deadEnds.empty()) {
+      auto v = deadEnds.back();
+      deadEnds.pop_back();
+      if (live[v] > 0) {
+        return v;
+      }
+    }
+    for (; cursor < vertexCount; cursor++) {
+      if (live[cursor] > 0) {
+        return cursor;
+      }
+    }
+    return NO_VERTEX;
+  };
+
+  auto fanning = skipDeadEnd();
+  bool jumped = true;
+  while (fanning != NO_VERTEX) {
+    candidates.clear();
+    for (auto i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+      auto t = adjacency[i];
+      if (emitted[t]) {
+        continue;
+      }
+      if (jumped) {
+        clusters.push_back(static_cast<std::uint32_t>(output.size() / 3));
+        jumped = false;
+      }
+      for (std::uint32_t c = 0; c < 3; c++) {
+        auto v = indices[t * 3 + c];
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cacheTime[v] > cacheSize) {
+          cacheTime[v] = time++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // the candidate that stays cached longest while its fan is emitted; ones
+    // that would fall out of the cache midway rank last
+    auto next = NO_VERTEX;
+    std::int64_t bestPriority = -1;
+    for (auto v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      std::int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+        priority = time - cacheTime[v];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+    if (next == NO_VERTEX) {
+      next = skipDeadEnd();
+      jumped = true;
+    }
+    fanning = next;
+  }
+
+  assert(output.size() == indices.size());
+  indices = std::move(output);
+  return clusters;
+}
+
+void optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                      const std::vector<Vertex> &vertices,
+                      const std::vector<std::uint32_t> &clusters,
+                      float threshold, std::uint32_t cacheSize) {
+  auto triangleCount = static_cast<std::uint32_t>(indices.size() / 3);
+  if (clusters.empty() || triangleCount == 0) {
+    return;
+  }
+
+  // split the clusters wherever the ACMR since the last split came within
+  // threshold of the ACMR of the whole cluster; each split flushes the cache
+  // since the next cluster may be drawn anywhere
+  std::vector<std::uint32_t> splits;
+  CacheSimulator cache{static_cast<std::uint32_t>(vertices.size()), cacheSize};
+  for (std::size_t i = 0; i < clusters.size(); i++) {
+    auto begin = clusters[i];
+    auto end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+    cache.flush();
+    std::uint32_t misses = 0;
+    for (auto t = begin; t < end; t++) {
+      misses += cache.accessTriangle(&indices[t * 3]);
+    }
+    auto clusterAcmr = static_cast<float>(misses) / (end - begin);
+
+    cache.flush();
+    splits.push_back(begin);
+    misses = 0;
+    auto start = begin;
+    for (auto t = begin; t < end; t++) {
+      misses += cache.accessTriangle(&indices[t * 3]);
+      if (t + 1 < end && static_cast<float>(misses) <=
+                             threshold * clusterAcmr * (t + 1 - start)) {
+        splits.push_back(t + 1);
+        cache.flush();
+        misses = 0;
+        start = t + 1;
+      }
+    }
+  }
+
+  // area weighted centroid and normal of every cluster and of the mesh
+  struct ClusterInfo {
+    std::uint32_t begin = {0};
+    std::uint32_t end = {0};
+    float sortKey = {0.0f};
+  };
+  std::vector<ClusterInfo> infos(splits.size());
+  std::vector<glm::vec3> centroids(splits.size());
+  std::vector<glm::vec3> normals(splits.size());
+  glm::vec3 meshCentroid = {0.0f, 0.0f, 0.0f};
+  float meshArea = 0.0f;
+  for (std::size_t i = 0; i < splits.size(); i++) {
+    auto &info = infos[i];
+    info.begin = splits[i];
+    info.end = i + 1 < splits.size() ? splits[i + 1] : triangleCount;
+
+    glm::vec3 centroid = {0.0f, 0.0f, 0.0f};
+    glm::vec3 normal = {0.0f, 0.0f, 0.0f};
+    float area = 0.0f;
+    for (auto t = info.begin; t < info.end; t++) {
+      const auto &a = vertices[indices[t * 3 + 0]].position;
+      const auto &b = vertices[indices[t * 3 + 1]].position;
+      const auto &c = vertices[indices[t * 3 + 2]].position;
+      auto cross = glm::cross(b - a, c - a);
+      auto triangleArea = glm::length(cross) * 0.5f;
+      centroid += (a + b + c) * (triangleArea / 3.0f);
+      normal += cross;
+      area += triangleArea;
+    }
+    meshCentroid += centroid;
+    meshArea += area;
+    centroids[i] = area > 0.0f ? centroid * (1.0f / area) : centroid;
+    normals[i] = normal;
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid = meshCentroid * (1.0f / meshArea);
+  }
+  for (std::size_t i = 0; i < infos.size(); i++) {
+    auto length = glm::length(normals[i]);
+    infos[i].sortKey =
+        length > 0.0f
+            ? glm::dot(centroids[i] - meshCentroid, normals[i] * (1.0f / length))
+            : 0.0f;
+  }
+
+  // outward facing clusters first
+  std::stable_sort(infos.begin(), infos.end(),
+                   [](const ClusterInfo &a, const ClusterInfo &b) {
+                     return a.sortKey > b.sortKey;
+                   });
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  for (const auto &info : infos) {
+    output.insert(output.end(), indices.begin() + info.begin * 3,
+                  indices.begin() + info.end * 3);
+  }
+  indices = std::move(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices,
+                         std::vector<std::uint32_t> &indices) {
+  std::vector<std::uint32_t> remap(vertices.size(), NO_VERTEX);
+  std::vector<Vertex> output;
+  output.reserve(vertices.size());
+  for (auto &index : indices) {
+    if (remap[index] == NO_VERTEX) {
+      remap[index] = static_cast<std::uint32_t>(output.size());
+      output.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(output);
+}
+
+void optimize(ModelLoader &mesh, const Settings &settings) {
+  auto vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+  auto before = analyzeVertexCache(mesh.indices, vertexCount);
+
+  if (settings.vertexCache) {
+    auto clusters = optimizeVertexCache(mesh.indices, vertexCount);
+    if (settings.overdraw) {
+      optimizeOverdraw(mesh.indices, mesh.vertices, clusters,
+                       settings.overdrawThreshold);
+    }
+  }
+  if (settings.vertexFetch) {
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+  }
+
+  auto after = analyzeVertexCache(
+      mesh.indices, static_cast<std::uint32_t>(mesh.vertices.size()));
+  LOG("Mesh optimized: {} triangles, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> "
+      "{:.3f}",
+      mesh.indices.size() / 3, before.acmr, after.acmr, before.atvr,
+      after.atvr);
+}
+
+} // namespace mesh_optimizer
+} // namespace mv
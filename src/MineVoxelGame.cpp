@@ -2,12 +2,24 @@
 #include "Log.h"
 #include <chrono>
 
+#include "Camera.h"
+#include "ChunkMeshPool.h"
 #include "Descriptors.h"
 
+#include "MeshFile.h"
 #include "Model.h"
+#include "PipelineCache.h"
+#include "PipelineLibrary.h"
 #include "Texture.h"
+#include "TextureArray.h"
+#include "systems/ChunkRenderSystem.h"
 #include "systems/ModelTestRenderSystem.h"
 #include "systems/TestRenderSystem.h"
+#include "world/BlockTextureRegistry.h"
+#include "world/ChunkMap.h"
+#include "world/ChunkMesher.h"
+#include "world/ChunkVisibilityGraph.h"
+#include "world/WorldGenerator.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -23,13 +35,129 @@ namespace mv {
     glm::mat4 projection;
   };
 
+  namespace {
+    constexpr int DEMO_CHUNKS = 4;
+    constexpr std::int32_t WORLD_SEED = 1337;
+    const glm::vec3 DEMO_OFFSET = { -64.0f, -72.0f, -128.0f };
+
+    // block faces by tile name, resolved against the array's layers
+    BlockTextureRegistry makeBlockTextures(const TextureArray& textures) {
+      BlockTextureRegistry registry;
+      registry.assign(block::STONE, textures.layer("stone"));
+      registry.assign(block::DIRT, textures.layer("dirt"));
+      registry.assign(block::GRASS, textures.layer("grass_top"),
+        textures.layer("dirt"), textures.layer("grass_side"));
+      registry.assign(block::LOG, textures.layer("log_top"),
+        textures.layer("log_top"), textures.layer("log_side"));
+      registry.assign(block::LEAVES, textures.layer("leaves"));
+      return registry;
+    }
+
+    struct DemoSection {
+      ChunkCoord coord = {};
+      const Chunk* chunk = {nullptr};
+      ChunkNeighbours neighbours = {};
+      ChunkMesh mesh = {};
+    };
+
+    // meshes the sections of the generated columns on the job system, one
+    // mesher per thread; the pool and the graph are filled on the calling
+    // thread
+    std::vector<ChunkRenderObject> buildDemoChunks(JobSystem& jobs,
+      WorldGenerator& world, const BlockTextureRegistry& textureLayers,
+      ChunkMeshPool& meshPool, ChunkVisibilityGraph& visibilityGraph) {
+      auto start = std::chrono::high_resolution_clock::now();
+      world.finish();
+      std::vector<const ChunkColumn*> columns;
+      world.takeCompleted(columns);
+      LOG("Generated {} chunk columns, waited {:.1f} ms for the last ones",
+        columns.size(), std::chrono::duration<double, std::milli>(
+          std::chrono::high_resolution_clock::now() - start).count());
+
+      std::vector<DemoSection> sections;
+      for (const auto* column : columns) {
+        for (int y = 0; y < ChunkColumn::SECTIONS; y++) {
+          DemoSection section;
+          section.coord = { column->x, y, column->z };
+          section.chunk = &column->sections[y];
+          sections.push_back(std::move(section));
+        }
+      }
+      auto count = static_cast<std::uint32_t>(sections.size());
+
+      // ChunkMap lookups are not thread safe, resolve neighbours up front
+      ChunkMap<const Chunk*> chunks;
+      for (auto& section : sections) {
+        chunks.emplace(section.coord, section.chunk);
+      }
+      for (auto& section : sections) {
+        for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+          if (auto* neighbour = chunks.find(neighbourCoord(section.coord, face))) {
+            section.neighbours[face] = *neighbour;
+          }
+        }
+      }
+
+      std::vector<ChunkMesher> meshers(jobs.threadCount());
+      for (auto& mesher : meshers) {
+        mesher.setTextureLayers(&textureLayers);
+      }
+      jobs.parallelFor(0, count, 1, [&](std::uint32_t first, std::uint32_t last) {
+        auto& mesher = meshers[jobs.threadIndex()];
+        for (auto i = first; i < last; i++) {
+          mesher.mesh(*sections[i].chunk, sections[i].neighbours,
+            sections[i].mesh);
+        }
+        });
+
+      std::vector<ChunkRenderObject> objects;
+      std::uint32_t triangles = 0;
+      for (const auto& section : sections) {
+        const auto& coord = section.coord;
+        const auto& mesh = section.mesh;
+        if (mesh.indices.empty()) {
+          visibilityGraph.set(coord, mesh.visibility);
+          continue;
+        }
+        visibilityGraph.set(coord, mesh.visibility,
+          static_cast<std::uint32_t>(objects.size()));
+        triangles += mesh.stats.triangles;
+
+        ChunkRenderObject object = {};
+        object.origin = glm::vec3(coord.x, coord.y, coord.z) *
+          static_cast<float>(Chunk::SIZE) + DEMO_OFFSET;
+        object.mesh = meshPool.add(mesh.packedVertices, mesh.indices);
+        objects.push_back(std::move(object));
+      }
+
+      LOG("Demo chunks: {} meshes, {} triangles", objects.size(), triangles);
+      return objects;
+    }
+  } // namespace
+
   void MineVoxelGame::run() {
 
     std::string cubeModelPath = RESOURCES_PATH + std::string("/room.obj");
     std::string modelTexture = RESOURCES_PATH + std::string("/viking_room.png");
 
-    ModelLoader loader;
-    loader.load(cubeModelPath);
+    // the mesh is mapped, or converted on the first run, on a worker while
+    // the texture and the demo chunks are prepared
+    MeshFile modelMesh;
+    JobCounter modelLoaded;
+    jobSystem.run([this, &modelMesh, &cubeModelPath] {
+        if (!modelMesh.load(cubeModelPath, &jobSystem)) {
+          ELOG("Failed to load model {}", cubeModelPath);
+        }
+      }, &modelLoaded);
+
+    // the world generates on the workers while the rest starts up
+    WorldGenerator world{ jobSystem, WORLD_SEED };
+    for (int x = 0; x < DEMO_CHUNKS; x++) {
+      for (int z = 0; z < DEMO_CHUNKS; z++) {
+        world.request(x, z);
+      }
+    }
+    world.update();
 
     Texture texture = {
       device,
@@ -37,6 +165,14 @@ namespace mv {
       VK_FORMAT_R8G8B8A8_SRGB
     };
 
+    TextureArray blockTextures = {
+      device,
+      jobSystem,
+      RESOURCES_PATH + std::string("/blocks"),
+      VK_FORMAT_R8G8B8A8_SRGB
+    };
+    auto blockTextureLayers = makeBlockTextures(blockTextures);
+
 
     std::vector<std::unique_ptr<Buffer>> uboBuffers(
       SwapChain::MAX_FRAME_IN_FLIGHT);
@@ -78,12 +214,42 @@ namespace mv {
       writer.build(globalDescriptorSets[i]);
     }
 
+    // outlives the render systems, they only keep handles into it
+    PipelineLibrary pipelineLibrary{ device, jobSystem };
+
     ModelTestRenderSystem renderSystem = {
-        device, renderer.getSwapChainRenderPass(),
+        device, pipelineLibrary, renderer.getSwapChainRenderPass(),
         globalDescriptorSetLayout->getDescriptorSetLayout() };
 
+    ChunkRenderSystem chunkRenderSystem = {
+        device, pipelineLibrary, renderer.getSwapChainRenderPass(),
+        globalDescriptorSetLayout->getDescriptorSetLayout(), blockTextures };
+
+    // every variant at once; the secondaries recorded on workers only look
+    // pipelines up
+    pipelineLibrary.compile();
+
+    ChunkMeshPool chunkMeshPool{ device };
+    ChunkVisibilityGraph visibilityGraph;
+    auto demoChunks =
+      buildDemoChunks(jobSystem, world, blockTextureLayers, chunkMeshPool,
+        visibilityGraph);
+
+    jobSystem.wait(modelLoaded);
     std::vector<std::unique_ptr<Model>> models;
-    models.push_back(std::make_unique<Model>(device, loader));
+    models.push_back(std::make_unique<Model>(device, modelMesh));
+    std::vector<std::uint32_t> visibleChunks;
+    std::vector<SecondaryRecorder> recorders;
+    device.getAllocator().logStats();
+
+    auto& pipelineCache = device.getPipelineCache();
+    LOG("Startup took {:.1f} ms, {} pipelines created in {:.1f} ms with a {} "
+      "pipeline cache", std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count(),
+      pipelineCache.pipelineCount(), pipelineCache.compileTimeMs(),
+      pipelineCache.isWarm() ? "warm" : "cold");
+    // saved again at shutdown, this one survives a crash
+    pipelineCache.save();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
     auto input = window.getInput();
@@ -91,6 +257,7 @@ namespace mv {
     glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
     glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
     glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    Camera camera;
     UniformBufferObj ubo = {};
     ubo.model = glm::mat4(1.0f);
     while (!window.shouldClose()) {
@@ -127,9 +294,13 @@ namespace mv {
       auto aspect = renderer.getAspectRatio();
       auto frameIdx = renderer.getFrameIndex();
 
-      ubo.projection =
-        glm::perspective(glm::radians(90.0f), (float)aspect, 0.1f, 100.0f);
-      ubo.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+      camera.setPerspective(glm::radians(90.0f), (float)aspect, 0.1f, 100.0f);
+      camera.lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+      ubo.projection = camera.getProjectionMatrix();
+      ubo.view = camera.getViewMatrix();
+      visibilityGraph.collectVisible(
+        ChunkVisibilityGraph::sectionAt(cameraPos, DEMO_OFFSET),
+        camera.getFrustum(), DEMO_OFFSET, visibleChunks);
       ubo.model = glm::rotate(ubo.model, glm::radians(frameTime * -45.0f),
         glm::vec3(0.0f, 1.0f, 0.0f));
 
@@ -139,16 +310,38 @@ namespace mv {
         int frameIdx = renderer.getFrameIndex();
 
         FrameInfo frameInfo = { commandBuffer, globalDescriptorSets[frameIdx],
-                               models };
+                               models, frameIdx };
 
         // update UBO; MVP matrix
 
         uboBuffers[frameIdx]->writeToBuffer(&ubo, sizeof(ubo));
         uboBuffers[frameIdx]->flush(sizeof(ubo));
 
-        renderer.beginSwapChainRenderPass(frameInfo.commandBuffer);
-        // render system; call to all objects to draw via vkCmdDraw()
-        renderSystem.render(frameInfo);
+        renderer.beginSwapChainRenderPass(frameInfo.commandBuffer,
+          VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // draws are recorded on the job system, one secondary command buffer
+        // for the models and one per bucket of chunk draws
+        auto chunkDraws = chunkRenderSystem.prepare(frameInfo, chunkMeshPool,
+          demoChunks, visibleChunks);
+        auto buckets =
+          chunkRenderSystem.bucketCount(chunkDraws, jobSystem.threadCount());
+        recorders.clear();
+        recorders.push_back([&](VkCommandBuffer secondary) {
+          FrameInfo info = frameInfo;
+          info.commandBuffer = secondary;
+          renderSystem.render(info);
+          });
+        for (std::uint32_t bucket = 0; bucket < buckets; bucket++) {
+          auto first = chunkDraws * bucket / buckets;
+          auto last = chunkDraws * (bucket + 1) / buckets;
+          recorders.push_back([&, first, last](VkCommandBuffer secondary) {
+            FrameInfo info = frameInfo;
+            info.commandBuffer = secondary;
+            chunkRenderSystem.record(info, chunkMeshPool, first, last - first);
+            });
+        }
+        renderer.recordSecondaries(frameInfo.commandBuffer, recorders);
         renderer.endSwapChainRenderPass(frameInfo.commandBuffer);
         renderer.endFrame();
       }
@@ -2,30 +2,13 @@
 
 #include "DeviceHelper.h"
 #include "Log.h"
+#include "MeshFile.h"
+#include "StagingRing.h"
+#include "UploadQueue.h"
 
-#include <glm/gtx/hash.hpp>
-#include <tiny_obj_loader.h>
-
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <functional>
-
-// from: https://stackoverflow.com/a/57595105
-template <typename T, typename... Rest>
-void hashCombine(std::size_t &seed, const T &v, const Rest &...rest) {
-  seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-  (hashCombine(seed, rest), ...);
-};
-
-namespace std {
-template <> struct hash<mv::Vertex> {
-  size_t operator()(mv::Vertex const &vertex) const {
-    size_t seed = 0;
-    hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-    return seed;
-  }
-};
-} // namespace std
 
 namespace mv {
 
@@ -50,9 +33,71 @@ Vertex::getAttributeDescriptions() {
   return attribDesc;
 }
 
-Model::Model(Device &device, const ModelLoader &loader) : mDevice{device} {
-  createVertexBuffer(loader.vertices);
-  createIndexBuffer(loader.indices);
+std::vector<VkVertexInputBindingDescription>
+VoxelVertex::getBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDesc(1);
+  bindingDesc[0].binding = 0;
+  bindingDesc[0].stride = sizeof(VoxelVertex);
+  bindingDesc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDesc;
+}
+
+std::vector<VkVertexInputAttributeDescription>
+VoxelVertex::getAttributeDescriptions() {
+  std::vector<VkVertexInputAttributeDescription> attribDesc{};
+  attribDesc.push_back(
+      {0, 0, VK_FORMAT_R32_UINT, offsetof(VoxelVertex, data0)});
+  attribDesc.push_back(
+      {1, 0, VK_FORMAT_R32_UINT, offsetof(VoxelVertex, data1)});
+  return attribDesc;
+}
+
+Model::Model(Device &device, const ModelLoader &loader)
+    : Model{device, loader.vertices, loader.indices} {}
+
+Model::Model(Device &device, const MeshFile &mesh) : mDevice{device} {
+  createVertexBuffer(mesh.vertices(), sizeof(Vertex), mesh.vertexCount());
+  createIndexBuffer(mesh.indices(), mesh.indexCount());
+}
+
+Model::Model(Device &device, const std::vector<Vertex> &vertices,
+             const std::vector<uint32_t> &indices, UploadMode uploadMode)
+    : mDevice{device}, mUploadMode{uploadMode} {
+  createVertexBuffer(vertices.data(), sizeof(Vertex),
+                     static_cast<uint32_t>(vertices.size()));
+  createIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+Model::Model(Device &device, const std::vector<VoxelVertex> &vertices,
+             const std::vector<uint32_t> &indices, UploadMode uploadMode)
+    : mDevice{device}, mUploadMode{uploadMode} {
+  createVertexBuffer(vertices.data(), sizeof(VoxelVertex),
+                     static_cast<uint32_t>(vertices.size()));
+  createIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+Model::~Model() {
+  // the buffers are about to go away: queued copies are dropped, ones on the
+  // transfer queue waited for
+  if (!isReady()) {
+    auto &uploadQueue = mDevice.getUploadQueue();
+    for (auto ticket : {mVertexTicket, mIndexTicket}) {
+      if (ticket != 0) {
+        uploadQueue.cancel(ticket);
+      }
+    }
+  }
+  // copies and barriers in the graphics ring, immediate uploads included,
+  // may still be running; the ring frees the buffers after them
+  auto &ring = mDevice.getStagingRing();
+  ring.release(std::move(mVertexBuffer));
+  ring.release(std::move(mIndexBuffer));
+}
+
+bool Model::isReady() const {
+  // tickets become ready in order, the larger one covers both buffers
+  auto ticket = std::max(mVertexTicket, mIndexTicket);
+  return ticket == 0 || mDevice.getUploadQueue().isReady(ticket);
 }
 
 void Model::bind(VkCommandBuffer commandBuffer) {
@@ -74,103 +119,48 @@ void Model::draw(VkCommandBuffer commandBuffer) {
   }
 }
 
-void Model::createVertexBuffer(const std::vector<Vertex> &vertices) {
-  mVertexCount = static_cast<uint32_t>(vertices.size());
+void Model::createVertexBuffer(const void *vertices, VkDeviceSize vertexSize,
+                               uint32_t vertexCount) {
+  mVertexCount = vertexCount;
   assert(mVertexCount >= 3 && "Vertex count must be at least 3");
 
-  auto vertexSize = sizeof(vertices[0]);
   VkDeviceSize bufferSize = vertexSize * mVertexCount;
 
-  Buffer staginBuffer = {mDevice, vertexSize, mVertexCount,
-                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-
-  staginBuffer.map(bufferSize);
-  staginBuffer.writeToBuffer((void *)vertices.data(), bufferSize);
-
   mVertexBuffer = std::make_unique<Buffer>(mDevice, vertexSize, mVertexCount,
                                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
                                                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-  mDevice.copyBuffer(staginBuffer.getBuffer(), mVertexBuffer->getBuffer(),
-                     bufferSize);
+  mVertexTicket = upload(mVertexBuffer->getBuffer(), vertices, bufferSize,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 }
 
-void Model::createIndexBuffer(const std::vector<uint32_t> &indices) {
-  mIndexCount = static_cast<uint32_t>(indices.size());
+void Model::createIndexBuffer(const uint32_t *indices, uint32_t indexCount) {
+  mIndexCount = indexCount;
   mHasIndices = mIndexCount > 0;
 
   if (!mHasIndices) {
     return;
   }
 
-  auto indexSize = sizeof(indices[0]);
+  auto indexSize = sizeof(uint32_t);
   VkDeviceSize bufferSize = indexSize * mIndexCount;
 
-  Buffer staginBuffer = {mDevice, indexSize, mIndexCount,
-                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-
-  staginBuffer.map(bufferSize);
-  staginBuffer.writeToBuffer((void *)indices.data(), bufferSize);
-
   mIndexBuffer = std::make_unique<Buffer>(mDevice, indexSize, mIndexCount,
                                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
                                               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-  mDevice.copyBuffer(staginBuffer.getBuffer(), mIndexBuffer->getBuffer(),
-                     bufferSize);
+  mIndexTicket = upload(mIndexBuffer->getBuffer(), indices, bufferSize,
+                        VK_ACCESS_INDEX_READ_BIT);
 }
 
-void ModelLoader::load(const std::string &filePath) {
-  tinyobj::attrib_t attrib;
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-  std::string warn, err;
-
-  if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
-                        filePath.c_str())) {
-    ELOG("Failed to load file {}: {}{}", filePath, warn, err);
-    return;
+UploadTicket Model::upload(VkBuffer buffer, const void *data,
+                           VkDeviceSize size, VkAccessFlags dstAccess) {
+  if (mUploadMode == UploadMode::Immediate) {
+    mDevice.getStagingRing().uploadBuffer(buffer, data, size);
+    return 0;
   }
-
-  vertices.clear();
-  indices.clear();
-
-  std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
-
-  for (const auto &shape : shapes) {
-    for (const auto index : shape.mesh.indices) {
-      Vertex vertex = {};
-
-      if (index.vertex_index >= 0) {
-        vertex.position = {attrib.vertices[3 * index.vertex_index + 0],
-                           attrib.vertices[3 * index.vertex_index + 1],
-                           attrib.vertices[3 * index.vertex_index + 2]};
-        vertex.color = {attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2]};
-      } // vertex_index
-
-      if (index.normal_index >= 0) {
-        vertex.normal = {attrib.normals[3 * index.normal_index + 0],
-                         attrib.normals[3 * index.normal_index + 1],
-                         attrib.normals[3 * index.normal_index + 2]};
-      } // normal_index
-
-      if (index.texcoord_index >= 0) {
-        vertex.uv = {attrib.texcoords[2 * index.texcoord_index + 0],
-                     attrib.texcoords[2 * index.texcoord_index + 1]};
-      } // texcoord_index
-
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
-      indices.push_back(uniqueVertices[vertex]);
-    } // index
-  }   // shape
+  return mDevice.getUploadQueue().uploadBuffer(
+      buffer, data, size, 0, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, dstAccess);
 }
+
 } // namespace mv
\ No newline at end of file
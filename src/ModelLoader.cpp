@@ -0,0 +1,497 @@
+#include "Model.h"
+
+#include "JobSystem.h"
+#include "Log.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace mv {
+
+namespace {
+// smallest piece of a file worth its own job
+constexpr std::size_t MIN_CHUNK_BYTES = 64 * 1024;
+// chunks per thread, so a chunk full of faces does not hold up the rest
+constexpr std::uint32_t CHUNKS_PER_THREAD = 4;
+
+constexpr std::int32_t NO_INDEX = INT32_MIN;
+
+// welding compares the raw bytes, a padded Vertex would compare garbage
+static_assert(sizeof(Vertex) == 11 * sizeof(float));
+static_assert(std::is_trivially_copyable_v<Vertex>);
+
+// One face corner, zero based. Indices with their RELATIVE_* bit set were
+// negative in the file and are still relative to the chunk's first element
+// of that kind; they become absolute once all chunks are counted.
+struct ObjCorner {
+  static constexpr std::uint8_t RELATIVE_POSITION = 1;
+  static constexpr std::uint8_t RELATIVE_TEXCOORD = 2;
+  static constexpr std::uint8_t RELATIVE_NORMAL = 4;
+
+  std::int32_t position = {NO_INDEX};
+  std::int32_t texcoord = {NO_INDEX};
+  std::int32_t normal = {NO_INDEX};
+  std::uint8_t relative = {0};
+};
+
+// what one line aligned piece of the file declares
+struct ObjChunk {
+  const char *begin = {nullptr};
+  const char *end = {nullptr};
+
+  std::vector<float> positions; // x y z r g b
+  std::vector<float> texcoords; // u v
+  std::vector<float> normals;   // x y z
+  // three per triangle, polygons are fan triangulated
+  std::vector<ObjCorner> corners;
+
+  // counts of the chunks before this one
+  std::uint32_t positionBase = {0};
+  std::uint32_t texcoordBase = {0};
+  std::uint32_t normalBase = {0};
+  std::uint32_t cornerBase = {0};
+
+  // first line that failed to parse
+  const char *error = {nullptr};
+};
+
+bool isSpace(char c) noexcept { return c == ' ' || c == '\t'; }
+
+const char *skipSpaces(const char *p, const char *end) noexcept {
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+// reads up to count floats and returns how many there were
+int parseFloats(const char *&p, const char *end, float *out, int count) {
+  int read = 0;
+  while (read < count) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') {
+      p++;
+    }
+    auto [next, error] = std::from_chars(p, end, out[read]);
+    if (error != std::errc{}) {
+      break;
+    }
+    p = next;
+    read++;
+  }
+  return read;
+}
+
+// one index of a corner; count is the number of elements declared so far in
+// this chunk, which negative indices count back from
+bool parseIndex(const char *&p, const char *end, std::size_t count,
+                std::int32_t &index, bool &relative) {
+  std::int32_t value = 0;
+  auto [next, error] = std::from_chars(p, end, value);
+  if (error != std::errc{} || value == 0) {
+    return false;
+  }
+  p = next;
+  relative = value < 0;
+  index = relative ? static_cast<std::int32_t>(count) + value : value - 1;
+  return true;
+}
+
+// v, v/vt, v//vn or v/vt/vn
+bool parseCorner(const char *&p, const char *end, const ObjChunk &chunk,
+                 ObjCorner &corner) {
+  bool relative = false;
+  if (!parseIndex(p, end, chunk.positions.size() / 6, corner.position,
+                  relative)) {
+    return false;
+  }
+  corner.relative |= relative ? ObjCorner::RELATIVE_POSITION : 0;
+  if (p == end || *p != '/') {
+    return true;
+  }
+  p++;
+  if (p < end && *p != '/') {
+    if (!parseIndex(p, end, chunk.texcoords.size() / 2, corner.texcoord,
+                    relative)) {
+      return false;
+    }
+    corner.relative |= relative ? ObjCorner::RELATIVE_TEXCOORD : 0;
+  }
+  if (p == end || *p != '/') {
+    return true;
+  }
+  p++;
+  if (!parseIndex(p, end, chunk.normals.size() / 3, corner.normal,
+                  relative)) {
+    return false;
+  }
+  corner.relative |= relative ? ObjCorner::RELATIVE_NORMAL : 0;
+  return true;
+}
+
+bool parseLine(const char *p, const char *end, ObjChunk &chunk) {
+  p = skipSpaces(p, end);
+  auto *keywordEnd = p;
+  while (keywordEnd < end && !isSpace(*keywordEnd)) {
+    keywordEnd++;
+  }
+  std::string_view keyword{p, static_cast<std::size_t>(keywordEnd - p)};
+  p = keywordEnd;
+
+  if (keyword == "v") {
+    float values[6] = {};
+    auto count = parseFloats(p, end, values, 6);
+    if (count < 3) {
+      return false;
+    }
+    if (count < 6) {
+      // no vertex colors, or an unused w
+      values[3] = values[4] = values[5] = 1.0f;
+    }
+    chunk.positions.insert(chunk.positions.end(), values, values + 6);
+  } else if (keyword == "vt") {
+    float values[2] = {};
+    if (parseFloats(p, end, values, 2) < 1) {
+      return false;
+    }
+    chunk.texcoords.insert(chunk.texcoords.end(), values, values + 2);
+  } else if (keyword == "vn") {
+    float values[3] = {};
+    if (parseFloats(p, end, values, 3) < 3) {
+      return false;
+    }
+    chunk.normals.insert(chunk.normals.end(), values, values + 3);
+  } else if (keyword == "f") {
+    ObjCorner first = {};
+    ObjCorner previous = {};
+    std::uint32_t count = 0;
+    for (p = skipSpaces(p, end); p < end; p = skipSpaces(p, end)) {
+      ObjCorner corner = {};
+      if (!parseCorner(p, end, chunk, corner) || (p < end && !isSpace(*p))) {
+        return false;
+      }
+      if (count == 0) {
+        first = corner;
+      } else if (count >= 2) {
+        chunk.corners.push_back(first);
+        chunk.corners.push_back(previous);
+        chunk.corners.push_back(corner);
+      }
+      previous = corner;
+      count++;
+    }
+  }
+  // comments, o, g, s, usemtl, mtllib, l and p do not affect the mesh
+  return true;
+}
+
+void parseChunk(ObjChunk &chunk) {
+  const char *p = chunk.begin;
+  while (p < chunk.end) {
+    auto *lineEnd =
+        static_cast<const char *>(std::memchr(p, '\n', chunk.end - p));
+    auto *next = lineEnd != nullptr ? lineEnd + 1 : chunk.end;
+    if (lineEnd == nullptr) {
+      lineEnd = chunk.end;
+    }
+    if (lineEnd > p && lineEnd[-1] == '\r') {
+      lineEnd--;
+    }
+    if (!parseLine(p, lineEnd, chunk)) {
+      chunk.error = p;
+      return;
+    }
+    p = next;
+  }
+}
+
+// makes the corner's indices absolute, false when one is out of range
+bool resolveCorner(ObjCorner &corner, const ObjChunk &chunk,
+                   std::uint32_t positionCount, std::uint32_t texcoordCount,
+                   std::uint32_t normalCount) {
+  auto resolve = [&corner](std::int32_t &index, std::uint8_t relativeBit,
+                           std::uint32_t base, std::uint32_t count,
+                           bool optional) {
+    if (index == NO_INDEX) {
+      return optional;
+    }
+    std::int64_t value = index;
+    if ((corner.relative & relativeBit) != 0) {
+      value += base;
+    }
+    if (value < 0 || value >= count) {
+      return false;
+    }
+    index = static_cast<std::int32_t>(value);
+    return true;
+  };
+  bool valid =
+      resolve(corner.position, ObjCorner::RELATIVE_POSITION,
+              chunk.positionBase, positionCount, false) &&
+      resolve(corner.texcoord, ObjCorner::RELATIVE_TEXCOORD,
+              chunk.texcoordBase, texcoordCount, true) &&
+      resolve(corner.normal, ObjCorner::RELATIVE_NORMAL, chunk.normalBase,
+              normalCount, true);
+  corner.relative = 0;
+  return valid;
+}
+
+Vertex makeVertex(const ObjCorner &corner, const std::vector<float> &positions,
+                  const std::vector<float> &texcoords,
+                  const std::vector<float> &normals) {
+  Vertex vertex = {};
+  const auto *position = &positions[6 * corner.position];
+  vertex.position = {position[0], position[1], position[2]};
+  vertex.color = {position[3], position[4], position[5]};
+  if (corner.normal != NO_INDEX) {
+    const auto *normal = &normals[3 * corner.normal];
+    vertex.normal = {normal[0], normal[1], normal[2]};
+  }
+  if (corner.texcoord != NO_INDEX) {
+    const auto *texcoord = &texcoords[2 * corner.texcoord];
+    vertex.uv = {texcoord[0], texcoord[1]};
+  }
+  return vertex;
+}
+
+std::uint32_t mixHash(std::uint64_t hash) noexcept {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return static_cast<std::uint32_t>(hash);
+}
+
+std::uint32_t hashCorner(const ObjCorner &corner) noexcept {
+  auto hash = static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                  corner.position)) *
+              0x9e3779b97f4a7c15ull;
+  hash ^= static_cast<std::uint32_t>(corner.texcoord) + (hash << 6);
+  hash ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+              corner.normal))
+          << 32;
+  return mixHash(hash);
+}
+
+bool sameCorner(const ObjCorner &a, const ObjCorner &b) noexcept {
+  return a.position == b.position && a.texcoord == b.texcoord &&
+         a.normal == b.normal;
+}
+
+std::uint32_t hashVertex(const Vertex &vertex) noexcept {
+  std::uint32_t words[sizeof(Vertex) / sizeof(std::uint32_t)];
+  std::memcpy(words, &vertex, sizeof(Vertex));
+  std::uint64_t hash = 0x9e3779b97f4a7c15ull;
+  for (auto word : words) {
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  return mixHash(hash);
+}
+
+// Open addressing hash table of indices into an array the caller owns; it
+// stores 32 bits of the hash next to each index and doubles at half load.
+class WeldTable {
+public:
+  WeldTable() : mSlots(1024) {}
+
+  // the index equal() accepts among those inserted with this hash; inserts
+  // and returns next when there is none
+  template <typename Equal>
+  std::uint32_t findOrInsert(std::uint32_t hash, std::uint32_t next,
+                             Equal &&equal) {
+    auto mask = mSlots.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+      auto &entry = mSlots[slot];
+      if (entry.index == 0) {
+        entry = {hash, next + 1};
+        if (++mCount * 2 > mSlots.size()) {
+          grow();
+        }
+        return next;
+      }
+      if (entry.hash == hash && equal(entry.index - 1)) {
+        return entry.index - 1;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::uint32_t hash = {0};
+    // index plus one, 0 marks an empty slot
+    std::uint32_t index = {0};
+  };
+
+  void grow() {
+    std::vector<Slot> slots(mSlots.size() * 2);
+    auto mask = slots.size() - 1;
+    for (const auto &entry : mSlots) {
+      if (entry.index == 0) {
+        continue;
+      }
+      auto slot = entry.hash & mask;
+      while (slots[slot].index != 0) {
+        slot = (slot + 1) & mask;
+      }
+      slots[slot] = entry;
+    }
+    mSlots = std::move(slots);
+  }
+
+private:
+  std::vector<Slot> mSlots;
+  std::size_t mCount = {0};
+};
+
+// runs fn(i) for every chunk, in parallel when there is a job system
+template <typename Fn>
+void forEachChunk(JobSystem *jobs, std::uint32_t count, Fn &&fn) {
+  if (jobs == nullptr) {
+    for (std::uint32_t i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+  jobs->parallelFor(0, count, 1, [&fn](std::uint32_t first,
+                                       std::uint32_t last) {
+    for (auto i = first; i < last; i++) {
+      fn(i);
+    }
+  });
+}
+} // namespace
+
+void ModelLoader::load(const std::string &filePath, JobSystem *jobs) {
+  vertices.clear();
+  indices.clear();
+
+  MappedFile file;
+  if (!file.open(filePath)) {
+    ELOG("Failed to load file {}: cannot open it", filePath);
+    return;
+  }
+
+  // line aligned chunks, parsed independently
+  std::size_t chunkCount = 1;
+  if (jobs != nullptr) {
+    chunkCount = std::min<std::size_t>(jobs->threadCount() * CHUNKS_PER_THREAD,
+                                       file.size() / MIN_CHUNK_BYTES + 1);
+  }
+  std::vector<ObjChunk> chunks(chunkCount);
+  const char *fileEnd = file.data() + file.size();
+  const char *begin = file.data();
+  for (std::size_t i = 0; i < chunkCount; i++) {
+    const char *end = file.data() + file.size() * (i + 1) / chunkCount;
+    if (end < begin) {
+      end = begin;
+    }
+    auto *newline = static_cast<const char *>(
+        std::memchr(end, '\n', static_cast<std::size_t>(fileEnd - end)));
+    end = newline != nullptr && i + 1 < chunkCount ? newline + 1 : fileEnd;
+    chunks[i].begin = begin;
+    chunks[i].end = end;
+    begin = end;
+  }
+
+  auto count = static_cast<std::uint32_t>(chunkCount);
+  forEachChunk(jobs, count, [&chunks](std::uint32_t i) {
+    parseChunk(chunks[i]);
+  });
+
+  std::uint32_t positionCount = 0;
+  std::uint32_t texcoordCount = 0;
+  std::uint32_t normalCount = 0;
+  std::uint32_t cornerCount = 0;
+  for (auto &chunk : chunks) {
+    if (chunk.error != nullptr) {
+      auto *lineEnd = std::find(chunk.error, fileEnd, '\n');
+      auto line = 1 + std::count(file.data(), chunk.error, '\n');
+      ELOG("Failed to load file {}: cannot parse line {}: {}", filePath, line,
+           std::string_view(chunk.error, lineEnd - chunk.error));
+      return;
+    }
+    chunk.positionBase = positionCount;
+    chunk.texcoordBase = texcoordCount;
+    chunk.normalBase = normalCount;
+    chunk.cornerBase = cornerCount;
+    positionCount += static_cast<std::uint32_t>(chunk.positions.size() / 6);
+    texcoordCount += static_cast<std::uint32_t>(chunk.texcoords.size() / 2);
+    normalCount += static_cast<std::uint32_t>(chunk.normals.size() / 3);
+    cornerCount += static_cast<std::uint32_t>(chunk.corners.size());
+  }
+
+  // merge the attributes, then resolve and hash every corner
+  std::vector<float> positions(positionCount * 6);
+  std::vector<float> texcoords(texcoordCount * 2);
+  std::vector<float> normals(normalCount * 3);
+  forEachChunk(jobs, count, [&](std::uint32_t i) {
+    const auto &chunk = chunks[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(),
+              positions.begin() + chunk.positionBase * 6);
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+              texcoords.begin() + chunk.texcoordBase * 2);
+    std::copy(chunk.normals.begin(), chunk.normals.end(),
+              normals.begin() + chunk.normalBase * 3);
+  });
+
+  std::vector<std::uint32_t> hashes(cornerCount);
+  std::vector<std::uint8_t> invalid(chunkCount, 0);
+  forEachChunk(jobs, count, [&](std::uint32_t i) {
+    auto &chunk = chunks[i];
+    for (std::size_t c = 0; c < chunk.corners.size(); c++) {
+      auto &corner = chunk.corners[c];
+      if (!resolveCorner(corner, chunk, positionCount, texcoordCount,
+                         normalCount)) {
+        invalid[i] = 1;
+        return;
+      }
+      hashes[chunk.cornerBase + c] = hashCorner(corner);
+    }
+  });
+  if (std::find(invalid.begin(), invalid.end(), 1) != invalid.end()) {
+    ELOG("Failed to load file {}: a face references a missing vertex",
+         filePath);
+    return;
+  }
+
+  // Weld in file order. Most corners repeat an index triple seen before and
+  // only need the cheap triple lookup; each new triple builds its vertex and
+  // is welded on the exact bits of it.
+  WeldTable cornerTable;
+  WeldTable vertexTable;
+  std::vector<ObjCorner> uniqueCorners;
+  std::vector<std::uint32_t> cornerVertices;
+  indices.resize(cornerCount);
+  for (const auto &chunk : chunks) {
+    for (std::size_t c = 0; c < chunk.corners.size(); c++) {
+      const auto &corner = chunk.corners[c];
+      auto next = static_cast<std::uint32_t>(uniqueCorners.size());
+      auto unique = cornerTable.findOrInsert(
+          hashes[chunk.cornerBase + c], next, [&](std::uint32_t index) {
+            return sameCorner(uniqueCorners[index], corner);
+          });
+      if (unique == next) {
+        auto vertex = makeVertex(corner, positions, texcoords, normals);
+        auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+        auto index = vertexTable.findOrInsert(
+            hashVertex(vertex), vertexCount, [&](std::uint32_t other) {
+              return std::memcmp(&vertices[other], &vertex, sizeof(Vertex)) ==
+                     0;
+            });
+        if (index == vertexCount) {
+          vertices.push_back(vertex);
+        }
+        uniqueCorners.push_back(corner);
+        cornerVertices.push_back(index);
+      }
+      indices[chunk.cornerBase + c] = cornerVertices[unique];
+    }
+  }
+}
+
+} // namespace mv
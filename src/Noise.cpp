@@ -0,0 +1,660 @@
+#include "Noise.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(MV_X86_64)
+#include <immintrin.h>
+#endif
+
+namespace mv {
+namespace noise {
+
+namespace {
+// lattice coordinates are multiplied by these (wrapping) before hashing
+constexpr std::uint32_t PRIME_X = 501125321u;
+constexpr std::uint32_t PRIME_Y = 1136930381u;
+constexpr std::uint32_t PRIME_Z = 1720413743u;
+constexpr std::uint32_t HASH_MULTIPLIER = 0x27d4eb2du;
+
+// simplex skew factors, (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6 in 2D
+constexpr float F2 = 0.36602540378f;
+constexpr float G2 = 0.21132486540f;
+constexpr float F3 = 1.0f / 3.0f;
+constexpr float G3 = 1.0f / 6.0f;
+
+// falloff of the far OpenSimplex2 2D corner as t * A + (B + a)
+constexpr float FAR_CORNER_A = 2.0f * (1.0f - 2.0f * G2) * (1.0f / G2 - 2.0f);
+constexpr float FAR_CORNER_B = -2.0f * (1.0f - 2.0f * G2) * (1.0f - 2.0f * G2);
+
+// OpenSimplex2 2D gradients point 22.5 degrees off the axes
+constexpr float ROTATED_MAJOR = 0.92387953f;
+constexpr float ROTATED_MINOR = 0.38268343f;
+
+// a cell's feature point lies in [CELL_OFFSET, CELL_OFFSET + CELL_JITTER)
+// along every axis, jittered by 10 hash bits per axis
+constexpr float CELL_OFFSET = 0.1f;
+constexpr float CELL_JITTER = 0.8f;
+constexpr float JITTER_UNIT = 1.0f / 1023.0f;
+constexpr float CELL_FAR = 1e10f;
+
+// bring each type to about [-1, 1]; measured maxima over dense grids and
+// several seeds were 1.511, 0.9995, 0.02211, 0.03058, 0.009996 and 0.03059
+constexpr float PERLIN2_SCALE = 0.66f;
+constexpr float PERLIN3_SCALE = 1.0f;
+constexpr float SIMPLEX2_SCALE = 45.0f;
+constexpr float SIMPLEX3_SCALE = 32.6f;
+constexpr float OPEN_SIMPLEX2_2_SCALE = 99.0f;
+constexpr float OPEN_SIMPLEX2_3_SCALE = 32.6f;
+
+// 1 / sum of the octave amplitudes, so fractals stay in the range of one
+// octave
+float fractalBounding(const NoiseSettings &settings) {
+  if (settings.fractal == FractalType::None) {
+    return 1.0f;
+  }
+  float amplitude = 1.0f;
+  float sum = 0.0f;
+  for (std::uint32_t octave = 0; octave < settings.octaves; octave++) {
+    sum += amplitude;
+    amplitude *= settings.gain;
+  }
+  return sum > 0.0f ? 1.0f / sum : 1.0f;
+}
+
+// The scalar reference. The SIMD kernels in NoiseKernels.inl repeat every
+// operation in the same order, change both together.
+namespace reference {
+std::uint32_t hash(std::uint32_t seed, std::uint32_t xp, std::uint32_t yp) {
+  auto h = (seed ^ xp ^ yp) * HASH_MULTIPLIER;
+  return h ^ (h >> 15);
+}
+
+std::uint32_t hash(std::uint32_t seed, std::uint32_t xp, std::uint32_t yp,
+                   std::uint32_t zp) {
+  auto h = (seed ^ xp ^ yp ^ zp) * HASH_MULTIPLIER;
+  return h ^ (h >> 15);
+}
+
+std::uint32_t lattice(float coordinate, std::uint32_t prime) {
+  return static_cast<std::uint32_t>(static_cast<std::int32_t>(coordinate)) *
+         prime;
+}
+
+// (+-1, +-2) and (+-2, +-1)
+float grad(std::uint32_t h, float x, float y) {
+  bool swap = (h & 4) != 0;
+  float u = swap ? y : x;
+  float v = swap ? x : y;
+  u = (h & 1) ? -u : u;
+  v = v * 2.0f;
+  v = (h & 2) ? -v : v;
+  return u + v;
+}
+
+float gradRotated(std::uint32_t h, float x, float y) {
+  bool swap = (h & 4) != 0;
+  float u = swap ? y : x;
+  float v = swap ? x : y;
+  u = (h & 1) ? -u : u;
+  v = (h & 2) ? -v : v;
+  return u * ROTATED_MAJOR + v * ROTATED_MINOR;
+}
+
+// Perlin's 12 cube edge directions, 4 of them twice
+float grad(std::uint32_t h, float x, float y, float z) {
+  float u = (h & 8) == 0 ? x : y;
+  float v = (h & 12) == 0 ? y : ((h & 13) == 12 ? x : z);
+  u = (h & 1) ? -u : u;
+  v = (h & 2) ? -v : v;
+  return u + v;
+}
+
+float fade(float t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+float lerp(float a, float b, float t) { return a + t * (b - a); }
+
+// t^4 inside the kernel radius, 0 outside
+float falloff(float t) {
+  t = std::max(t, 0.0f);
+  t = t * t;
+  return t * t;
+}
+
+float perlin(std::uint32_t seed, glm::vec2 p) {
+  float fx = std::floor(p.x);
+  float fy = std::floor(p.y);
+  auto xp0 = lattice(fx, PRIME_X);
+  auto yp0 = lattice(fy, PRIME_Y);
+  auto xp1 = xp0 + PRIME_X;
+  auto yp1 = yp0 + PRIME_Y;
+  float x0 = p.x - fx;
+  float y0 = p.y - fy;
+  float x1 = x0 - 1.0f;
+  float y1 = y0 - 1.0f;
+  float u = fade(x0);
+  float v = fade(y0);
+
+  float n00 = grad(hash(seed, xp0, yp0), x0, y0);
+  float n10 = grad(hash(seed, xp1, yp0), x1, y0);
+  float n01 = grad(hash(seed, xp0, yp1), x0, y1);
+  float n11 = grad(hash(seed, xp1, yp1), x1, y1);
+  return lerp(lerp(n00, n10, u), lerp(n01, n11, u), v) * PERLIN2_SCALE;
+}
+
+float perlin(std::uint32_t seed, glm::vec3 p) {
+  float fx = std::floor(p.x);
+  float fy = std::floor(p.y);
+  float fz = std::floor(p.z);
+  auto xp0 = lattice(fx, PRIME_X);
+  auto yp0 = lattice(fy, PRIME_Y);
+  auto zp0 = lattice(fz, PRIME_Z);
+  auto xp1 = xp0 + PRIME_X;
+  auto yp1 = yp0 + PRIME_Y;
+  auto zp1 = zp0 + PRIME_Z;
+  float x0 = p.x - fx;
+  float y0 = p.y - fy;
+  float z0 = p.z - fz;
+  float x1 = x0 - 1.0f;
+  float y1 = y0 - 1.0f;
+  float z1 = z0 - 1.0f;
+  float u = fade(x0);
+  float v = fade(y0);
+  float w = fade(z0);
+
+  float n000 = grad(hash(seed, xp0, yp0, zp0), x0, y0, z0);
+  float n100 = grad(hash(seed, xp1, yp0, zp0), x1, y0, z0);
+  float n010 = grad(hash(seed, xp0, yp1, zp0), x0, y1, z0);
+  float n110 = grad(hash(seed, xp1, yp1, zp0), x1, y1, z0);
+  float n001 = grad(hash(seed, xp0, yp0, zp1), x0, y0, z1);
+  float n101 = grad(hash(seed, xp1, yp0, zp1), x1, y0, z1);
+  float n011 = grad(hash(seed, xp0, yp1, zp1), x0, y1, z1);
+  float n111 = grad(hash(seed, xp1, yp1, zp1), x1, y1, z1);
+  float lowerZ = lerp(lerp(n000, n100, u), lerp(n010, n110, u), v);
+  float upperZ = lerp(lerp(n001, n101, u), lerp(n011, n111, u), v);
+  return lerp(lowerZ, upperZ, w) * PERLIN3_SCALE;
+}
+
+float simplex(std::uint32_t seed, glm::vec2 p) {
+  float s = (p.x + p.y) * F2;
+  float fi = std::floor(p.x + s);
+  float fj = std::floor(p.y + s);
+  float t = (fi + fj) * G2;
+  float x0 = p.x - (fi - t);
+  float y0 = p.y - (fj - t);
+
+  // lower or upper triangle of the skewed square
+  bool lower = x0 > y0;
+  float i1 = lower ? 1.0f : 0.0f;
+  float j1 = lower ? 0.0f : 1.0f;
+  float x1 = (x0 - i1) + G2;
+  float y1 = (y0 - j1) + G2;
+  float x2 = x0 + (2.0f * G2 - 1.0f);
+  float y2 = y0 + (2.0f * G2 - 1.0f);
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  float n0 = falloff(0.5f - x0 * x0 - y0 * y0) * grad(hash(seed, ip, jp), x0, y0);
+  float n1 = falloff(0.5f - x1 * x1 - y1 * y1) *
+             grad(hash(seed, lower ? ip + PRIME_X : ip,
+                       lower ? jp : jp + PRIME_Y),
+                  x1, y1);
+  float n2 = falloff(0.5f - x2 * x2 - y2 * y2) *
+             grad(hash(seed, ip + PRIME_X, jp + PRIME_Y), x2, y2);
+  return (n0 + n1 + n2) * SIMPLEX2_SCALE;
+}
+
+float simplex(std::uint32_t seed, glm::vec3 p) {
+  float s = (p.x + p.y + p.z) * F3;
+  float fi = std::floor(p.x + s);
+  float fj = std::floor(p.y + s);
+  float fk = std::floor(p.z + s);
+  float t = (fi + fj + fk) * G3;
+  float x0 = p.x - (fi - t);
+  float y0 = p.y - (fj - t);
+  float z0 = p.z - (fk - t);
+
+  // the tetrahedron containing the point, from the order of x0, y0, z0
+  bool a = x0 >= y0;
+  bool b = y0 >= z0;
+  bool c = x0 >= z0;
+  bool i1 = a && (b || c);
+  bool j1 = !a && b;
+  bool k1 = !b && !c;
+  bool i2 = a || (b && c);
+  bool j2 = !a || b;
+  bool k2 = !b || (!a && !c);
+
+  float x1 = (x0 - (i1 ? 1.0f : 0.0f)) + G3;
+  float y1 = (y0 - (j1 ? 1.0f : 0.0f)) + G3;
+  float z1 = (z0 - (k1 ? 1.0f : 0.0f)) + G3;
+  float x2 = (x0 - (i2 ? 1.0f : 0.0f)) + 2.0f * G3;
+  float y2 = (y0 - (j2 ? 1.0f : 0.0f)) + 2.0f * G3;
+  float z2 = (z0 - (k2 ? 1.0f : 0.0f)) + 2.0f * G3;
+  float x3 = x0 + (3.0f * G3 - 1.0f);
+  float y3 = y0 + (3.0f * G3 - 1.0f);
+  float z3 = z0 + (3.0f * G3 - 1.0f);
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto kp = lattice(fk, PRIME_Z);
+  float n0 = falloff(0.6f - x0 * x0 - y0 * y0 - z0 * z0) *
+             grad(hash(seed, ip, jp, kp), x0, y0, z0);
+  float n1 = falloff(0.6f - x1 * x1 - y1 * y1 - z1 * z1) *
+             grad(hash(seed, i1 ? ip + PRIME_X : ip, j1 ? jp + PRIME_Y : jp,
+                       k1 ? kp + PRIME_Z : kp),
+                  x1, y1, z1);
+  float n2 = falloff(0.6f - x2 * x2 - y2 * y2 - z2 * z2) *
+             grad(hash(seed, i2 ? ip + PRIME_X : ip, j2 ? jp + PRIME_Y : jp,
+                       k2 ? kp + PRIME_Z : kp),
+                  x2, y2, z2);
+  float n3 = falloff(0.6f - x3 * x3 - y3 * y3 - z3 * z3) *
+             grad(hash(seed, ip + PRIME_X, jp + PRIME_Y, kp + PRIME_Z), x3, y3,
+                  z3);
+  return (n0 + n1 + n2 + n3) * SIMPLEX3_SCALE;
+}
+
+float openSimplex2(std::uint32_t seed, glm::vec2 p) {
+  float s = (p.x + p.y) * F2;
+  float x = p.x + s;
+  float y = p.y + s;
+  float fi = std::floor(x);
+  float fj = std::floor(y);
+  float xi = x - fi;
+  float yi = y - fj;
+  float t = (xi + yi) * G2;
+  float x0 = xi - t;
+  float y0 = yi - t;
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  float a = 0.5f - x0 * x0 - y0 * y0;
+  float n0 = falloff(a) * gradRotated(hash(seed, ip, jp), x0, y0);
+
+  float c = FAR_CORNER_A * t + (FAR_CORNER_B + a);
+  float x2 = x0 + (2.0f * G2 - 1.0f);
+  float y2 = y0 + (2.0f * G2 - 1.0f);
+  float n2 = falloff(c) *
+             gradRotated(hash(seed, ip + PRIME_X, jp + PRIME_Y), x2, y2);
+
+  bool upper = y0 > x0;
+  float x1 = x0 + (upper ? G2 : G2 - 1.0f);
+  float y1 = y0 + (upper ? G2 - 1.0f : G2);
+  float b = 0.5f - x1 * x1 - y1 * y1;
+  float n1 = falloff(b) * gradRotated(hash(seed, upper ? ip : ip + PRIME_X,
+                                           upper ? jp + PRIME_Y : jp),
+                                      x1, y1);
+  return (n0 + n1 + n2) * OPEN_SIMPLEX2_2_SCALE;
+}
+
+float openSimplex2(std::uint32_t seed, glm::vec3 p) {
+  // rotate so the BCC lattice's main diagonal is the y axis
+  float r = (p.x + p.y + p.z) * (2.0f / 3.0f);
+  float x = r - p.x;
+  float y = r - p.y;
+  float z = r - p.z;
+
+  float fx = std::floor(x + 0.5f);
+  float fy = std::floor(y + 0.5f);
+  float fz = std::floor(z + 0.5f);
+  float x0 = x - fx;
+  float y0 = y - fy;
+  float z0 = z - fz;
+  float ax = std::abs(x0);
+  float ay = std::abs(y0);
+  float az = std::abs(z0);
+  // -1 towards the nearer lattice neighbour along each axis, +1 away
+  float sx = x0 >= 0.0f ? -1.0f : 1.0f;
+  float sy = y0 >= 0.0f ? -1.0f : 1.0f;
+  float sz = z0 >= 0.0f ? -1.0f : 1.0f;
+
+  auto ip = lattice(fx, PRIME_X);
+  auto jp = lattice(fy, PRIME_Y);
+  auto kp = lattice(fz, PRIME_Z);
+  float a = (0.6f - x0 * x0) - (y0 * y0 + z0 * z0);
+  float value = 0.0f;
+  // the closest point of each of the two offset lattices, plus its neighbour
+  // along the dominant axis
+  for (int pass = 0; pass < 2; pass++) {
+    value = value + falloff(a) * grad(hash(seed, ip, jp, kp), x0, y0, z0);
+
+    bool mx = ax >= ay && ax >= az;
+    bool my = !mx && ay > ax && ay >= az;
+    bool mz = !mx && !my;
+    float m = mx ? ax : (my ? ay : az);
+    float b = a + m + m;
+    auto ipn = mx ? (sx < 0.0f ? ip + PRIME_X : ip - PRIME_X) : ip;
+    auto jpn = my ? (sy < 0.0f ? jp + PRIME_Y : jp - PRIME_Y) : jp;
+    auto kpn = mz ? (sz < 0.0f ? kp + PRIME_Z : kp - PRIME_Z) : kp;
+    float x1 = mx ? x0 + sx : x0;
+    float y1 = my ? y0 + sy : y0;
+    float z1 = mz ? z0 + sz : z0;
+    value = value + falloff(b - 1.0f) * grad(hash(seed, ipn, jpn, kpn), x1, y1, z1);
+
+    if (pass == 1) {
+      break;
+    }
+    ax = 0.5f - ax;
+    ay = 0.5f - ay;
+    az = 0.5f - az;
+    x0 = sx * ax;
+    y0 = sy * ay;
+    z0 = sz * az;
+    a = a + ((0.75f - ax) - (ay + az));
+    ip = sx < 0.0f ? ip + PRIME_X : ip;
+    jp = sy < 0.0f ? jp + PRIME_Y : jp;
+    kp = sz < 0.0f ? kp + PRIME_Z : kp;
+    sx = -sx;
+    sy = -sy;
+    sz = -sz;
+    seed = ~seed;
+  }
+  return value * OPEN_SIMPLEX2_3_SCALE;
+}
+
+float jitter(std::uint32_t h, std::uint32_t shift) {
+  return static_cast<float>(static_cast<std::int32_t>((h >> shift) & 1023u)) *
+         JITTER_UNIT;
+}
+
+float cellular(std::uint32_t seed, glm::vec2 p) {
+  float fi = std::floor(p.x);
+  float fj = std::floor(p.y);
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  float nearest = CELL_FAR;
+  for (int dx = -1; dx <= 1; dx++) {
+    float cx = fi + static_cast<float>(dx);
+    auto cxp = ip + static_cast<std::uint32_t>(dx) * PRIME_X;
+    for (int dy = -1; dy <= 1; dy++) {
+      float cy = fj + static_cast<float>(dy);
+      auto cyp = jp + static_cast<std::uint32_t>(dy) * PRIME_Y;
+      auto h = hash(seed, cxp, cyp);
+      float vx = ((cx - p.x) + CELL_OFFSET) + jitter(h, 0) * CELL_JITTER;
+      float vy = ((cy - p.y) + CELL_OFFSET) + jitter(h, 10) * CELL_JITTER;
+      nearest = std::min(nearest, vx * vx + vy * vy);
+    }
+  }
+  return std::min(std::sqrt(nearest), 1.0f) * 2.0f - 1.0f;
+}
+
+float cellular(std::uint32_t seed, glm::vec3 p) {
+  float fi = std::floor(p.x);
+  float fj = std::floor(p.y);
+  float fk = std::floor(p.z);
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto kp = lattice(fk, PRIME_Z);
+  float nearest = CELL_FAR;
+  for (int dx = -1; dx <= 1; dx++) {
+    float cx = fi + static_cast<float>(dx);
+    auto cxp = ip + static_cast<std::uint32_t>(dx) * PRIME_X;
+    for (int dy = -1; dy <= 1; dy++) {
+      float cy = fj + static_cast<float>(dy);
+      auto cyp = jp + static_cast<std::uint32_t>(dy) * PRIME_Y;
+      for (int dz = -1; dz <= 1; dz++) {
+        float cz = fk + static_cast<float>(dz);
+        auto czp = kp + static_cast<std::uint32_t>(dz) * PRIME_Z;
+        auto h = hash(seed, cxp, cyp, czp);
+        float vx = ((cx - p.x) + CELL_OFFSET) + jitter(h, 0) * CELL_JITTER;
+        float vy = ((cy - p.y) + CELL_OFFSET) + jitter(h, 10) * CELL_JITTER;
+        float vz = ((cz - p.z) + CELL_OFFSET) + jitter(h, 20) * CELL_JITTER;
+        nearest = std::min(nearest, vx * vx + vy * vy + vz * vz);
+      }
+    }
+  }
+  return std::min(std::sqrt(nearest), 1.0f) * 2.0f - 1.0f;
+}
+
+template <typename P> float single(NoiseType type, std::uint32_t seed, P p) {
+  switch (type) {
+  case NoiseType::Perlin:
+    return perlin(seed, p);
+  case NoiseType::Simplex:
+    return simplex(seed, p);
+  case NoiseType::OpenSimplex2:
+    return openSimplex2(seed, p);
+  case NoiseType::Cellular:
+  default:
+    return cellular(seed, p);
+  }
+}
+
+template <typename P> float fractal(const NoiseSettings &settings, P p) {
+  auto seed = static_cast<std::uint32_t>(settings.seed);
+  if (settings.fractal == FractalType::None) {
+    return single(settings.type, seed, p * settings.frequency);
+  }
+  float sum = 0.0f;
+  float amplitude = 1.0f;
+  float frequency = settings.frequency;
+  for (std::uint32_t octave = 0; octave < settings.octaves; octave++) {
+    float n = single(settings.type, seed, p * frequency);
+    if (settings.fractal == FractalType::Ridged) {
+      sum = sum + (std::abs(n) * -2.0f + 1.0f) * amplitude;
+    } else {
+      sum = sum + n * amplitude;
+    }
+    seed++;
+    frequency *= settings.lacunarity;
+    amplitude *= settings.gain;
+  }
+  return sum * fractalBounding(settings);
+}
+} // namespace reference
+
+#if defined(MV_X86_64)
+namespace sse41 {
+#define MV_NOISE_TARGET MV_TARGET_SSE41
+using F = __m128;
+using I = __m128i;
+constexpr std::uint32_t WIDTH = 4;
+
+MV_NOISE_TARGET inline F set(float v) { return _mm_set1_ps(v); }
+MV_NOISE_TARGET inline I seti(std::uint32_t v) {
+  return _mm_set1_epi32(static_cast<std::int32_t>(v));
+}
+MV_NOISE_TARGET inline F iota() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+MV_NOISE_TARGET inline void store(float *dst, F v) { _mm_storeu_ps(dst, v); }
+
+MV_NOISE_TARGET inline F add(F a, F b) { return _mm_add_ps(a, b); }
+MV_NOISE_TARGET inline F sub(F a, F b) { return _mm_sub_ps(a, b); }
+MV_NOISE_TARGET inline F mul(F a, F b) { return _mm_mul_ps(a, b); }
+MV_NOISE_TARGET inline F min(F a, F b) { return _mm_min_ps(a, b); }
+MV_NOISE_TARGET inline F max(F a, F b) { return _mm_max_ps(a, b); }
+MV_NOISE_TARGET inline F sqrt(F a) { return _mm_sqrt_ps(a); }
+MV_NOISE_TARGET inline F floor(F a) { return _mm_floor_ps(a); }
+MV_NOISE_TARGET inline F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+// masks are all ones or all zeros per lane
+MV_NOISE_TARGET inline F gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+MV_NOISE_TARGET inline F ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+MV_NOISE_TARGET inline F lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+MV_NOISE_TARGET inline F and_(F a, F b) { return _mm_and_ps(a, b); }
+MV_NOISE_TARGET inline F or_(F a, F b) { return _mm_or_ps(a, b); }
+// !a & b
+MV_NOISE_TARGET inline F andNot(F a, F b) { return _mm_andnot_ps(a, b); }
+MV_NOISE_TARGET inline F not_(F a) {
+  return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+}
+// mask ? a : b
+MV_NOISE_TARGET inline F select(F mask, F a, F b) {
+  return _mm_blendv_ps(b, a, mask);
+}
+
+MV_NOISE_TARGET inline I toInt(F a) { return _mm_cvttps_epi32(a); }
+MV_NOISE_TARGET inline F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+MV_NOISE_TARGET inline F asFloat(I a) { return _mm_castsi128_ps(a); }
+MV_NOISE_TARGET inline I asInt(F a) { return _mm_castps_si128(a); }
+
+MV_NOISE_TARGET inline I add(I a, I b) { return _mm_add_epi32(a, b); }
+MV_NOISE_TARGET inline I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+MV_NOISE_TARGET inline I mul(I a, I b) { return _mm_mullo_epi32(a, b); }
+MV_NOISE_TARGET inline I xor_(I a, I b) { return _mm_xor_si128(a, b); }
+MV_NOISE_TARGET inline I and_(I a, I b) { return _mm_and_si128(a, b); }
+template <int N> MV_NOISE_TARGET inline I shr(I a) {
+  return _mm_srli_epi32(a, N);
+}
+template <int N> MV_NOISE_TARGET inline I shl(I a) {
+  return _mm_slli_epi32(a, N);
+}
+MV_NOISE_TARGET inline F eq(I a, I b) {
+  return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b));
+}
+
+#include "NoiseKernels.inl"
+#undef MV_NOISE_TARGET
+} // namespace sse41
+
+namespace avx2 {
+#define MV_NOISE_TARGET MV_TARGET_AVX2
+using F = __m256;
+using I = __m256i;
+constexpr std::uint32_t WIDTH = 8;
+
+MV_NOISE_TARGET inline F set(float v) { return _mm256_set1_ps(v); }
+MV_NOISE_TARGET inline I seti(std::uint32_t v) {
+  return _mm256_set1_epi32(static_cast<std::int32_t>(v));
+}
+MV_NOISE_TARGET inline F iota() {
+  return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+}
+MV_NOISE_TARGET inline void store(float *dst, F v) { _mm256_storeu_ps(dst, v); }
+
+MV_NOISE_TARGET inline F add(F a, F b) { return _mm256_add_ps(a, b); }
+MV_NOISE_TARGET inline F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+MV_NOISE_TARGET inline F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+MV_NOISE_TARGET inline F min(F a, F b) { return _mm256_min_ps(a, b); }
+MV_NOISE_TARGET inline F max(F a, F b) { return _mm256_max_ps(a, b); }
+MV_NOISE_TARGET inline F sqrt(F a) { return _mm256_sqrt_ps(a); }
+MV_NOISE_TARGET inline F floor(F a) { return _mm256_floor_ps(a); }
+MV_NOISE_TARGET inline F abs(F a) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+}
+
+MV_NOISE_TARGET inline F gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+MV_NOISE_TARGET inline F ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+MV_NOISE_TARGET inline F lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+MV_NOISE_TARGET inline F and_(F a, F b) { return _mm256_and_ps(a, b); }
+MV_NOISE_TARGET inline F or_(F a, F b) { return _mm256_or_ps(a, b); }
+MV_NOISE_TARGET inline F andNot(F a, F b) { return _mm256_andnot_ps(a, b); }
+MV_NOISE_TARGET inline F not_(F a) {
+  return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+}
+MV_NOISE_TARGET inline F select(F mask, F a, F b) {
+  return _mm256_blendv_ps(b, a, mask);
+}
+
+MV_NOISE_TARGET inline I toInt(F a) { return _mm256_cvttps_epi32(a); }
+MV_NOISE_TARGET inline F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+MV_NOISE_TARGET inline F asFloat(I a) { return _mm256_castsi256_ps(a); }
+MV_NOISE_TARGET inline I asInt(F a) { return _mm256_castps_si256(a); }
+
+MV_NOISE_TARGET inline I add(I a, I b) { return _mm256_add_epi32(a, b); }
+MV_NOISE_TARGET inline I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+MV_NOISE_TARGET inline I mul(I a, I b) { return _mm256_mullo_epi32(a, b); }
+MV_NOISE_TARGET inline I xor_(I a, I b) { return _mm256_xor_si256(a, b); }
+MV_NOISE_TARGET inline I and_(I a, I b) { return _mm256_and_si256(a, b); }
+template <int N> MV_NOISE_TARGET inline I shr(I a) {
+  return _mm256_srli_epi32(a, N);
+}
+template <int N> MV_NOISE_TARGET inline I shl(I a) {
+  return _mm256_slli_epi32(a, N);
+}
+MV_NOISE_TARGET inline F eq(I a, I b) {
+  return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b));
+}
+
+#include "NoiseKernels.inl"
+#undef MV_NOISE_TARGET
+} // namespace avx2
+#endif
+
+void generateScalar(const NoiseSettings &settings, const Grid2 &grid,
+                    float *out) {
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    for (std::uint32_t y = 0; y < grid.sizeY; y++) {
+      *out++ = reference::fractal(
+          settings, grid.origin + glm::vec2(static_cast<float>(x),
+                                            static_cast<float>(y)) *
+                                      grid.step);
+    }
+  }
+}
+
+void generateScalar(const NoiseSettings &settings, const Grid3 &grid,
+                    float *out) {
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    for (std::uint32_t z = 0; z < grid.sizeZ; z++) {
+      for (std::uint32_t y = 0; y < grid.sizeY; y++) {
+        *out++ = reference::fractal(
+            settings, grid.origin + glm::vec3(static_cast<float>(x),
+                                              static_cast<float>(y),
+                                              static_cast<float>(z)) *
+                                        grid.step);
+      }
+    }
+  }
+}
+
+template <typename Grid>
+void dispatch(const NoiseSettings &settings, const Grid &grid,
+              std::vector<float> &out, NoiseBackend backend) {
+  out.resize(grid.size());
+  if (out.empty()) {
+    return;
+  }
+  switch (resolve(backend)) {
+#if defined(MV_X86_64)
+  case NoiseBackend::Avx2:
+    avx2::generate(settings, grid, out.data());
+    break;
+  case NoiseBackend::Sse41:
+    sse41::generate(settings, grid, out.data());
+    break;
+#endif
+  default:
+    generateScalar(settings, grid, out.data());
+    break;
+  }
+}
+} // namespace
+
+float sample(const NoiseSettings &settings, const glm::vec2 &position) {
+  return reference::fractal(settings, position);
+}
+
+float sample(const NoiseSettings &settings, const glm::vec3 &position) {
+  return reference::fractal(settings, position);
+}
+
+void generate(const NoiseSettings &settings, const Grid2 &grid,
+              std::vector<float> &out, NoiseBackend backend) {
+  dispatch(settings, grid, out, backend);
+}
+
+void generate(const NoiseSettings &settings, const Grid3 &grid,
+              std::vector<float> &out, NoiseBackend backend) {
+  dispatch(settings, grid, out, backend);
+}
+
+NoiseBackend resolve(NoiseBackend backend) {
+  if (backend == NoiseBackend::Auto) {
+    if (cpu::hasAvx2()) {
+      return NoiseBackend::Avx2;
+    }
+    return cpu::hasSse41() ? NoiseBackend::Sse41 : NoiseBackend::Scalar;
+  }
+  // explicit requests the CPU cannot run fall back to the next best one
+  if (backend == NoiseBackend::Avx2 && !cpu::hasAvx2()) {
+    backend = NoiseBackend::Sse41;
+  }
+  if (backend == NoiseBackend::Sse41 && !cpu::hasSse41()) {
+    backend = NoiseBackend::Scalar;
+  }
+  return backend;
+}
+
+} // namespace noise
+} // namespace mv
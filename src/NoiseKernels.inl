@@ -0,0 +1,482 @@
+// SIMD versions of the reference noise in Noise.cpp. Included once per
+// instruction set inside a namespace that defines the vector types F and I,
+// WIDTH, the operations on them and MV_NOISE_TARGET. Every function repeats
+// its reference counterpart operation for operation, change both together.
+
+MV_NOISE_TARGET inline I select(F mask, I a, I b) {
+  return asInt(select(mask, asFloat(a), asFloat(b)));
+}
+
+// flips the sign of v where bit 31 of bits is set
+MV_NOISE_TARGET inline F flipSign(F v, I bits) {
+  return asFloat(xor_(asInt(v), bits));
+}
+
+MV_NOISE_TARGET inline I hash(I seed, I xp, I yp) {
+  auto h = mul(xor_(xor_(seed, xp), yp), seti(HASH_MULTIPLIER));
+  return xor_(h, shr<15>(h));
+}
+
+MV_NOISE_TARGET inline I hash(I seed, I xp, I yp, I zp) {
+  auto h = mul(xor_(xor_(xor_(seed, xp), yp), zp), seti(HASH_MULTIPLIER));
+  return xor_(h, shr<15>(h));
+}
+
+MV_NOISE_TARGET inline I lattice(F coordinate, std::uint32_t prime) {
+  return mul(toInt(coordinate), seti(prime));
+}
+
+MV_NOISE_TARGET inline F grad(I h, F x, F y) {
+  auto swap = eq(and_(h, seti(4)), seti(4));
+  auto u = select(swap, y, x);
+  auto v = select(swap, x, y);
+  u = flipSign(u, shl<31>(h));
+  v = mul(v, set(2.0f));
+  v = flipSign(v, shl<30>(and_(h, seti(2))));
+  return add(u, v);
+}
+
+MV_NOISE_TARGET inline F gradRotated(I h, F x, F y) {
+  auto swap = eq(and_(h, seti(4)), seti(4));
+  auto u = select(swap, y, x);
+  auto v = select(swap, x, y);
+  u = flipSign(u, shl<31>(h));
+  v = flipSign(v, shl<30>(and_(h, seti(2))));
+  return add(mul(u, set(ROTATED_MAJOR)), mul(v, set(ROTATED_MINOR)));
+}
+
+MV_NOISE_TARGET inline F grad(I h, F x, F y, F z) {
+  auto u = select(eq(and_(h, seti(8)), seti(0)), x, y);
+  auto v = select(eq(and_(h, seti(12)), seti(0)), y,
+                  select(eq(and_(h, seti(13)), seti(12)), x, z));
+  u = flipSign(u, shl<31>(h));
+  v = flipSign(v, shl<30>(and_(h, seti(2))));
+  return add(u, v);
+}
+
+MV_NOISE_TARGET inline F fade(F t) {
+  return mul(mul(mul(t, t), t),
+             add(mul(t, sub(mul(t, set(6.0f)), set(15.0f))), set(10.0f)));
+}
+
+MV_NOISE_TARGET inline F lerp(F a, F b, F t) {
+  return add(a, mul(t, sub(b, a)));
+}
+
+MV_NOISE_TARGET inline F falloff(F t) {
+  t = max(t, set(0.0f));
+  t = mul(t, t);
+  return mul(t, t);
+}
+
+// r - x * x - y * y (- z * z)
+MV_NOISE_TARGET inline F radius(float r, F x, F y) {
+  return sub(sub(set(r), mul(x, x)), mul(y, y));
+}
+
+MV_NOISE_TARGET inline F radius(float r, F x, F y, F z) {
+  return sub(radius(r, x, y), mul(z, z));
+}
+
+MV_NOISE_TARGET inline F perlin(I seed, F px, F py) {
+  auto fx = floor(px);
+  auto fy = floor(py);
+  auto xp0 = lattice(fx, PRIME_X);
+  auto yp0 = lattice(fy, PRIME_Y);
+  auto xp1 = add(xp0, seti(PRIME_X));
+  auto yp1 = add(yp0, seti(PRIME_Y));
+  auto x0 = sub(px, fx);
+  auto y0 = sub(py, fy);
+  auto x1 = sub(x0, set(1.0f));
+  auto y1 = sub(y0, set(1.0f));
+  auto u = fade(x0);
+  auto v = fade(y0);
+
+  auto n00 = grad(hash(seed, xp0, yp0), x0, y0);
+  auto n10 = grad(hash(seed, xp1, yp0), x1, y0);
+  auto n01 = grad(hash(seed, xp0, yp1), x0, y1);
+  auto n11 = grad(hash(seed, xp1, yp1), x1, y1);
+  return mul(lerp(lerp(n00, n10, u), lerp(n01, n11, u), v),
+             set(PERLIN2_SCALE));
+}
+
+MV_NOISE_TARGET inline F perlin(I seed, F px, F py, F pz) {
+  auto fx = floor(px);
+  auto fy = floor(py);
+  auto fz = floor(pz);
+  auto xp0 = lattice(fx, PRIME_X);
+  auto yp0 = lattice(fy, PRIME_Y);
+  auto zp0 = lattice(fz, PRIME_Z);
+  auto xp1 = add(xp0, seti(PRIME_X));
+  auto yp1 = add(yp0, seti(PRIME_Y));
+  auto zp1 = add(zp0, seti(PRIME_Z));
+  auto x0 = sub(px, fx);
+  auto y0 = sub(py, fy);
+  auto z0 = sub(pz, fz);
+  auto x1 = sub(x0, set(1.0f));
+  auto y1 = sub(y0, set(1.0f));
+  auto z1 = sub(z0, set(1.0f));
+  auto u = fade(x0);
+  auto v = fade(y0);
+  auto w = fade(z0);
+
+  auto n000 = grad(hash(seed, xp0, yp0, zp0), x0, y0, z0);
+  auto n100 = grad(hash(seed, xp1, yp0, zp0), x1, y0, z0);
+  auto n010 = grad(hash(seed, xp0, yp1, zp0), x0, y1, z0);
+  auto n110 = grad(hash(seed, xp1, yp1, zp0), x1, y1, z0);
+  auto n001 = grad(hash(seed, xp0, yp0, zp1), x0, y0, z1);
+  auto n101 = grad(hash(seed, xp1, yp0, zp1), x1, y0, z1);
+  auto n011 = grad(hash(seed, xp0, yp1, zp1), x0, y1, z1);
+  auto n111 = grad(hash(seed, xp1, yp1, zp1), x1, y1, z1);
+  auto lowerZ = lerp(lerp(n000, n100, u), lerp(n010, n110, u), v);
+  auto upperZ = lerp(lerp(n001, n101, u), lerp(n011, n111, u), v);
+  return mul(lerp(lowerZ, upperZ, w), set(PERLIN3_SCALE));
+}
+
+MV_NOISE_TARGET inline F simplex(I seed, F px, F py) {
+  auto s = mul(add(px, py), set(F2));
+  auto fi = floor(add(px, s));
+  auto fj = floor(add(py, s));
+  auto t = mul(add(fi, fj), set(G2));
+  auto x0 = sub(px, sub(fi, t));
+  auto y0 = sub(py, sub(fj, t));
+
+  auto one = set(1.0f);
+  auto lower = gt(x0, y0);
+  auto x1 = add(sub(x0, and_(lower, one)), set(G2));
+  auto y1 = add(sub(y0, andNot(lower, one)), set(G2));
+  auto x2 = add(x0, set(2.0f * G2 - 1.0f));
+  auto y2 = add(y0, set(2.0f * G2 - 1.0f));
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto ip1 = add(ip, seti(PRIME_X));
+  auto jp1 = add(jp, seti(PRIME_Y));
+  auto n0 = mul(falloff(radius(0.5f, x0, y0)), grad(hash(seed, ip, jp), x0, y0));
+  auto n1 = mul(falloff(radius(0.5f, x1, y1)),
+                grad(hash(seed, select(lower, ip1, ip), select(lower, jp, jp1)),
+                     x1, y1));
+  auto n2 = mul(falloff(radius(0.5f, x2, y2)), grad(hash(seed, ip1, jp1), x2, y2));
+  return mul(add(add(n0, n1), n2), set(SIMPLEX2_SCALE));
+}
+
+MV_NOISE_TARGET inline F simplex(I seed, F px, F py, F pz) {
+  auto s = mul(add(add(px, py), pz), set(F3));
+  auto fi = floor(add(px, s));
+  auto fj = floor(add(py, s));
+  auto fk = floor(add(pz, s));
+  auto t = mul(add(add(fi, fj), fk), set(G3));
+  auto x0 = sub(px, sub(fi, t));
+  auto y0 = sub(py, sub(fj, t));
+  auto z0 = sub(pz, sub(fk, t));
+
+  auto a = ge(x0, y0);
+  auto b = ge(y0, z0);
+  auto c = ge(x0, z0);
+  auto i1 = and_(a, or_(b, c));
+  auto j1 = andNot(a, b);
+  auto k1 = andNot(b, not_(c));
+  auto i2 = or_(a, and_(b, c));
+  auto j2 = or_(not_(a), b);
+  auto k2 = or_(not_(b), andNot(a, not_(c)));
+
+  auto one = set(1.0f);
+  auto x1 = add(sub(x0, and_(i1, one)), set(G3));
+  auto y1 = add(sub(y0, and_(j1, one)), set(G3));
+  auto z1 = add(sub(z0, and_(k1, one)), set(G3));
+  auto x2 = add(sub(x0, and_(i2, one)), set(2.0f * G3));
+  auto y2 = add(sub(y0, and_(j2, one)), set(2.0f * G3));
+  auto z2 = add(sub(z0, and_(k2, one)), set(2.0f * G3));
+  auto x3 = add(x0, set(3.0f * G3 - 1.0f));
+  auto y3 = add(y0, set(3.0f * G3 - 1.0f));
+  auto z3 = add(z0, set(3.0f * G3 - 1.0f));
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto kp = lattice(fk, PRIME_Z);
+  auto ip1 = add(ip, seti(PRIME_X));
+  auto jp1 = add(jp, seti(PRIME_Y));
+  auto kp1 = add(kp, seti(PRIME_Z));
+  auto n0 = mul(falloff(radius(0.6f, x0, y0, z0)),
+                grad(hash(seed, ip, jp, kp), x0, y0, z0));
+  auto n1 = mul(falloff(radius(0.6f, x1, y1, z1)),
+                grad(hash(seed, select(i1, ip1, ip), select(j1, jp1, jp),
+                          select(k1, kp1, kp)),
+                     x1, y1, z1));
+  auto n2 = mul(falloff(radius(0.6f, x2, y2, z2)),
+                grad(hash(seed, select(i2, ip1, ip), select(j2, jp1, jp),
+                          select(k2, kp1, kp)),
+                     x2, y2, z2));
+  auto n3 = mul(falloff(radius(0.6f, x3, y3, z3)),
+                grad(hash(seed, ip1, jp1, kp1), x3, y3, z3));
+  return mul(add(add(add(n0, n1), n2), n3), set(SIMPLEX3_SCALE));
+}
+
+MV_NOISE_TARGET inline F openSimplex2(I seed, F px, F py) {
+  auto s = mul(add(px, py), set(F2));
+  auto x = add(px, s);
+  auto y = add(py, s);
+  auto fi = floor(x);
+  auto fj = floor(y);
+  auto xi = sub(x, fi);
+  auto yi = sub(y, fj);
+  auto t = mul(add(xi, yi), set(G2));
+  auto x0 = sub(xi, t);
+  auto y0 = sub(yi, t);
+
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto ip1 = add(ip, seti(PRIME_X));
+  auto jp1 = add(jp, seti(PRIME_Y));
+  auto a = radius(0.5f, x0, y0);
+  auto n0 = mul(falloff(a), gradRotated(hash(seed, ip, jp), x0, y0));
+
+  auto c = add(mul(set(FAR_CORNER_A), t), add(set(FAR_CORNER_B), a));
+  auto x2 = add(x0, set(2.0f * G2 - 1.0f));
+  auto y2 = add(y0, set(2.0f * G2 - 1.0f));
+  auto n2 = mul(falloff(c), gradRotated(hash(seed, ip1, jp1), x2, y2));
+
+  auto upper = gt(y0, x0);
+  auto x1 = add(x0, select(upper, set(G2), set(G2 - 1.0f)));
+  auto y1 = add(y0, select(upper, set(G2 - 1.0f), set(G2)));
+  auto b = radius(0.5f, x1, y1);
+  auto n1 = mul(falloff(b),
+                gradRotated(hash(seed, select(upper, ip, ip1),
+                                 select(upper, jp1, jp)),
+                            x1, y1));
+  return mul(add(add(n0, n1), n2), set(OPEN_SIMPLEX2_2_SCALE));
+}
+
+MV_NOISE_TARGET inline F openSimplex2(I seed, F px, F py, F pz) {
+  auto r = mul(add(add(px, py), pz), set(2.0f / 3.0f));
+  auto x = sub(r, px);
+  auto y = sub(r, py);
+  auto z = sub(r, pz);
+
+  auto fx = floor(add(x, set(0.5f)));
+  auto fy = floor(add(y, set(0.5f)));
+  auto fz = floor(add(z, set(0.5f)));
+  auto x0 = sub(x, fx);
+  auto y0 = sub(y, fy);
+  auto z0 = sub(z, fz);
+  auto ax = abs(x0);
+  auto ay = abs(y0);
+  auto az = abs(z0);
+  auto zero = set(0.0f);
+  auto one = set(1.0f);
+  auto sx = select(ge(x0, zero), set(-1.0f), one);
+  auto sy = select(ge(y0, zero), set(-1.0f), one);
+  auto sz = select(ge(z0, zero), set(-1.0f), one);
+
+  auto ip = lattice(fx, PRIME_X);
+  auto jp = lattice(fy, PRIME_Y);
+  auto kp = lattice(fz, PRIME_Z);
+  auto a = sub(sub(set(0.6f), mul(x0, x0)), add(mul(y0, y0), mul(z0, z0)));
+  auto value = zero;
+  for (int pass = 0; pass < 2; pass++) {
+    value = add(value, mul(falloff(a), grad(hash(seed, ip, jp, kp), x0, y0, z0)));
+
+    auto mx = and_(ge(ax, ay), ge(ax, az));
+    auto my = andNot(mx, and_(gt(ay, ax), ge(ay, az)));
+    auto mz = not_(or_(mx, my));
+    auto m = select(mx, ax, select(my, ay, az));
+    auto b = add(add(a, m), m);
+    auto nx = lt(sx, zero);
+    auto ny = lt(sy, zero);
+    auto nz = lt(sz, zero);
+    auto ipn = select(mx, add(ip, select(nx, seti(PRIME_X), seti(0u - PRIME_X))), ip);
+    auto jpn = select(my, add(jp, select(ny, seti(PRIME_Y), seti(0u - PRIME_Y))), jp);
+    auto kpn = select(mz, add(kp, select(nz, seti(PRIME_Z), seti(0u - PRIME_Z))), kp);
+    auto x1 = select(mx, add(x0, sx), x0);
+    auto y1 = select(my, add(y0, sy), y0);
+    auto z1 = select(mz, add(z0, sz), z0);
+    value = add(value, mul(falloff(sub(b, one)),
+                           grad(hash(seed, ipn, jpn, kpn), x1, y1, z1)));
+
+    if (pass == 1) {
+      break;
+    }
+    ax = sub(set(0.5f), ax);
+    ay = sub(set(0.5f), ay);
+    az = sub(set(0.5f), az);
+    x0 = mul(sx, ax);
+    y0 = mul(sy, ay);
+    z0 = mul(sz, az);
+    a = add(a, sub(sub(set(0.75f), ax), add(ay, az)));
+    ip = select(nx, add(ip, seti(PRIME_X)), ip);
+    jp = select(ny, add(jp, seti(PRIME_Y)), jp);
+    kp = select(nz, add(kp, seti(PRIME_Z)), kp);
+    sx = sub(zero, sx);
+    sy = sub(zero, sy);
+    sz = sub(zero, sz);
+    seed = xor_(seed, seti(~0u));
+  }
+  return mul(value, set(OPEN_SIMPLEX2_3_SCALE));
+}
+
+template <int SHIFT> MV_NOISE_TARGET inline F jitter(I h) {
+  return mul(toFloat(and_(shr<SHIFT>(h), seti(1023))), set(JITTER_UNIT));
+}
+
+// ((cell - p) + CELL_OFFSET) + jitter * CELL_JITTER
+MV_NOISE_TARGET inline F featureOffset(F cell, F p, F jitter) {
+  return add(add(sub(cell, p), set(CELL_OFFSET)), mul(jitter, set(CELL_JITTER)));
+}
+
+MV_NOISE_TARGET inline F cellular(I seed, F px, F py) {
+  auto fi = floor(px);
+  auto fj = floor(py);
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto nearest = set(CELL_FAR);
+  for (int dx = -1; dx <= 1; dx++) {
+    auto cx = add(fi, set(static_cast<float>(dx)));
+    auto cxp = add(ip, seti(static_cast<std::uint32_t>(dx) * PRIME_X));
+    for (int dy = -1; dy <= 1; dy++) {
+      auto cy = add(fj, set(static_cast<float>(dy)));
+      auto cyp = add(jp, seti(static_cast<std::uint32_t>(dy) * PRIME_Y));
+      auto h = hash(seed, cxp, cyp);
+      auto vx = featureOffset(cx, px, jitter<0>(h));
+      auto vy = featureOffset(cy, py, jitter<10>(h));
+      nearest = min(nearest, add(mul(vx, vx), mul(vy, vy)));
+    }
+  }
+  return sub(mul(min(sqrt(nearest), set(1.0f)), set(2.0f)), set(1.0f));
+}
+
+MV_NOISE_TARGET inline F cellular(I seed, F px, F py, F pz) {
+  auto fi = floor(px);
+  auto fj = floor(py);
+  auto fk = floor(pz);
+  auto ip = lattice(fi, PRIME_X);
+  auto jp = lattice(fj, PRIME_Y);
+  auto kp = lattice(fk, PRIME_Z);
+  auto nearest = set(CELL_FAR);
+  for (int dx = -1; dx <= 1; dx++) {
+    auto cx = add(fi, set(static_cast<float>(dx)));
+    auto cxp = add(ip, seti(static_cast<std::uint32_t>(dx) * PRIME_X));
+    for (int dy = -1; dy <= 1; dy++) {
+      auto cy = add(fj, set(static_cast<float>(dy)));
+      auto cyp = add(jp, seti(static_cast<std::uint32_t>(dy) * PRIME_Y));
+      for (int dz = -1; dz <= 1; dz++) {
+        auto cz = add(fk, set(static_cast<float>(dz)));
+        auto czp = add(kp, seti(static_cast<std::uint32_t>(dz) * PRIME_Z));
+        auto h = hash(seed, cxp, cyp, czp);
+        auto vx = featureOffset(cx, px, jitter<0>(h));
+        auto vy = featureOffset(cy, py, jitter<10>(h));
+        auto vz = featureOffset(cz, pz, jitter<20>(h));
+        nearest =
+            min(nearest, add(add(mul(vx, vx), mul(vy, vy)), mul(vz, vz)));
+      }
+    }
+  }
+  return sub(mul(min(sqrt(nearest), set(1.0f)), set(2.0f)), set(1.0f));
+}
+
+// reference::fractal for WIDTH points
+template <typename Noise, typename... Coordinates>
+MV_NOISE_TARGET inline F fractal(const NoiseSettings &settings, float bounding,
+                                 Noise noise, Coordinates... p) {
+  auto seed = seti(static_cast<std::uint32_t>(settings.seed));
+  if (settings.fractal == FractalType::None) {
+    auto frequency = set(settings.frequency);
+    return noise(seed, mul(p, frequency)...);
+  }
+  auto sum = set(0.0f);
+  float amplitude = 1.0f;
+  float frequency = settings.frequency;
+  for (std::uint32_t octave = 0; octave < settings.octaves; octave++) {
+    auto n = noise(seed, mul(p, set(frequency))...);
+    if (settings.fractal == FractalType::Ridged) {
+      sum = add(sum, mul(add(mul(abs(n), set(-2.0f)), set(1.0f)),
+                         set(amplitude)));
+    } else {
+      sum = add(sum, mul(n, set(amplitude)));
+    }
+    seed = add(seed, seti(1));
+    frequency *= settings.lacunarity;
+    amplitude *= settings.gain;
+  }
+  return mul(sum, set(bounding));
+}
+
+MV_NOISE_TARGET inline void storePartial(float *dst, F value,
+                                         std::uint32_t count) {
+  if (count == WIDTH) {
+    store(dst, value);
+    return;
+  }
+  alignas(32) float lanes[WIDTH];
+  store(lanes, value);
+  for (std::uint32_t i = 0; i < count; i++) {
+    dst[i] = lanes[i];
+  }
+}
+
+// WIDTH consecutive y per call, the grid's fastest axis
+template <typename Noise>
+MV_NOISE_TARGET void fill(const NoiseSettings &settings, const Grid2 &grid,
+                          float *out, Noise noise) {
+  auto bounding = fractalBounding(settings);
+  auto lanes = iota();
+  auto stepY = set(grid.step.y);
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    auto px = set(grid.origin.x + static_cast<float>(x) * grid.step.x);
+    for (std::uint32_t y = 0; y < grid.sizeY; y += WIDTH) {
+      auto py = add(set(grid.origin.y),
+                    mul(add(lanes, set(static_cast<float>(y))), stepY));
+      storePartial(out + static_cast<std::size_t>(x) * grid.sizeY + y,
+                   fractal(settings, bounding, noise, px, py),
+                   std::min(WIDTH, grid.sizeY - y));
+    }
+  }
+}
+
+template <typename Noise>
+MV_NOISE_TARGET void fill(const NoiseSettings &settings, const Grid3 &grid,
+                          float *out, Noise noise) {
+  auto bounding = fractalBounding(settings);
+  auto lanes = iota();
+  auto stepY = set(grid.step.y);
+  for (std::uint32_t x = 0; x < grid.sizeX; x++) {
+    auto px = set(grid.origin.x + static_cast<float>(x) * grid.step.x);
+    for (std::uint32_t z = 0; z < grid.sizeZ; z++) {
+      auto pz = set(grid.origin.z + static_cast<float>(z) * grid.step.z);
+      auto *row =
+          out + (static_cast<std::size_t>(x) * grid.sizeZ + z) * grid.sizeY;
+      for (std::uint32_t y = 0; y < grid.sizeY; y += WIDTH) {
+        auto py = add(set(grid.origin.y),
+                      mul(add(lanes, set(static_cast<float>(y))), stepY));
+        storePartial(row + y, fractal(settings, bounding, noise, px, py, pz),
+                     std::min(WIDTH, grid.sizeY - y));
+      }
+    }
+  }
+}
+
+// the lambdas pick an overload and carry the target into fill()
+template <typename Grid>
+MV_NOISE_TARGET void generate(const NoiseSettings &settings, const Grid &grid,
+                              float *out) {
+  switch (settings.type) {
+  case NoiseType::Perlin:
+    fill(settings, grid, out,
+         [](I seed, auto... p) MV_NOISE_TARGET { return perlin(seed, p...); });
+    break;
+  case NoiseType::Simplex:
+    fill(settings, grid, out,
+         [](I seed, auto... p) MV_NOISE_TARGET { return simplex(seed, p...); });
+    break;
+  case NoiseType::OpenSimplex2:
+    fill(settings, grid, out, [](I seed, auto... p) MV_NOISE_TARGET {
+      return openSimplex2(seed, p...);
+    });
+    break;
+  case NoiseType::Cellular:
+  default:
+    fill(settings, grid, out, [](I seed, auto... p) MV_NOISE_TARGET {
+      return cellular(seed, p...);
+    });
+    break;
+  }
+}
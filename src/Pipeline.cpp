@@ -1,10 +1,12 @@
 #include "Pipeline.h"
 #include "DeviceHelper.h"
 #include "Log.h"
+#include "PipelineCache.h"
 
 #include "Model.h"
 
 #include <cassert>
+#include <chrono>
 
 namespace mv {
 
@@ -15,6 +17,9 @@ Pipeline::Pipeline(Device &device, const std::string &vertexFilepath,
   createGraphicsPipeline(vertexFilepath, fragmentFilepath, config);
 }
 
+Pipeline::Pipeline(Device &device, VkPipeline pipeline)
+    : mDevice{device}, graphicsPipeline{pipeline} {}
+
 Pipeline::~Pipeline() {
   vkDestroyShaderModule(mDevice.device(), vertexShaderModule, CUSTOM_ALLOCATOR);
   vkDestroyShaderModule(mDevice.device(), fragmentShaderModule,
@@ -28,6 +33,9 @@ void Pipeline::bind(VkCommandBuffer commandBuffer) {
 }
 
 void Pipeline::defaultPipelineConfig(PipelineConfig &config) noexcept {
+  config.bindingDescriptions = Vertex::getBindingDescriptions();
+  config.attributeDescriptions = Vertex::getAttributeDescriptions();
+
   config.inputAssemblyInfo.sType =
       VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   config.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -105,9 +113,10 @@ void Pipeline::defaultPipelineConfig(PipelineConfig &config) noexcept {
   config.dynamicStateInfo.flags = 0;
 }
 
-void Pipeline::createGraphicsPipeline(const std::string &vertexFilepath,
-                                      const std::string &fragmentFilepath,
-                                      const PipelineConfig &config) {
+void Pipeline::fillCreateInfo(const PipelineConfig &config,
+                              VkShaderModule vertexModule,
+                              VkShaderModule fragmentModule,
+                              CreateInfo &createInfo) noexcept {
   assert(config.renderPass != VK_NULL_HANDLE &&
          "Cannot create graphics pipeline: no renderPass provided in "
          "configPipeline");
@@ -115,32 +124,26 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilepath,
          "Cannot create graphics pipeline: no pipelineLayout provided in "
          "configPipeline");
 
-  auto vertCode = pipeline_helper::readBinaryFile(vertexFilepath);
-  auto fragCode = pipeline_helper::readBinaryFile(fragmentFilepath);
-
-  createShaderModule(vertCode, &vertexShaderModule);
-  createShaderModule(fragCode, &fragmentShaderModule);
-
-  VkPipelineShaderStageCreateInfo shaderStages[2];
+  auto *shaderStages = createInfo.shaderStages;
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  shaderStages[0].module = vertexShaderModule;
+  shaderStages[0].module = vertexModule;
   shaderStages[0].pName = "main";
   shaderStages[0].flags = 0;
   shaderStages[0].pNext = nullptr;
   shaderStages[0].pSpecializationInfo = nullptr;
   shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  shaderStages[1].module = fragmentShaderModule;
+  shaderStages[1].module = fragmentModule;
   shaderStages[1].pName = "main";
   shaderStages[1].flags = 0;
   shaderStages[1].pNext = nullptr;
   shaderStages[1].pSpecializationInfo = nullptr;
 
-  auto bindingDesc = Vertex::getBindingDescriptions();
-  auto attribDesc = Vertex::getAttributeDescriptions();
+  const auto &bindingDesc = config.bindingDescriptions;
+  const auto &attribDesc = config.attributeDescriptions;
 
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  auto &vertexInputInfo = createInfo.vertexInputInfo;
   vertexInputInfo.sType =
       VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
   vertexInputInfo.vertexAttributeDescriptionCount =
@@ -150,7 +153,7 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilepath,
   vertexInputInfo.pVertexAttributeDescriptions = attribDesc.data();
   vertexInputInfo.pVertexBindingDescriptions = bindingDesc.data();
 
-  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  auto &pipelineInfo = createInfo.pipelineInfo;
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
   pipelineInfo.stageCount = 2;
   pipelineInfo.pStages = shaderStages;
@@ -169,11 +172,31 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilepath,
 
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
   pipelineInfo.basePipelineIndex = -1;
+}
+
+void Pipeline::createGraphicsPipeline(const std::string &vertexFilepath,
+                                      const std::string &fragmentFilepath,
+                                      const PipelineConfig &config) {
+  auto vertCode = pipeline_helper::readBinaryFile(vertexFilepath);
+  auto fragCode = pipeline_helper::readBinaryFile(fragmentFilepath);
+
+  createShaderModule(vertCode, &vertexShaderModule);
+  createShaderModule(fragCode, &fragmentShaderModule);
+
+  CreateInfo createInfo;
+  fillCreateInfo(config, vertexShaderModule, fragmentShaderModule,
+                 createInfo);
 
-  VK_TEST(vkCreateGraphicsPipelines(mDevice.device(), VK_NULL_HANDLE, 1,
-                                    &pipelineInfo, CUSTOM_ALLOCATOR,
+  auto &pipelineCache = mDevice.getPipelineCache();
+  auto start = std::chrono::high_resolution_clock::now();
+  VK_TEST(vkCreateGraphicsPipelines(mDevice.device(), pipelineCache.get(), 1,
+                                    &createInfo.pipelineInfo, CUSTOM_ALLOCATOR,
                                     &graphicsPipeline),
           "Failed to create graphics pipeline")
+  pipelineCache.addCompileTime(
+      std::chrono::duration<double, std::milli>(
+          std::chrono::high_resolution_clock::now() - start)
+          .count());
 }
 
 void Pipeline::createShaderModule(const std::vector<char> &shaderBinary,
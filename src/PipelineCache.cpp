@@ -0,0 +1,171 @@
+#include "PipelineCache.h"
+#include "DeviceHelper.h"
+#include "Hash.h"
+#include "Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace mv {
+
+namespace {
+// layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, spelled out because
+// VkPipelineCacheHeaderVersionOne is missing from older SDK headers
+struct CacheHeaderV1 {
+  std::uint32_t headerSize;
+  std::uint32_t headerVersion;
+  std::uint32_t vendorID;
+  std::uint32_t deviceID;
+  std::uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+static_assert(sizeof(CacheHeaderV1) == 16 + VK_UUID_SIZE);
+} // namespace
+
+PipelineCache::PipelineCache(VkDevice device,
+                             const VkPhysicalDeviceProperties &properties,
+                             std::string path)
+    : mDevice{device}, mProperties{properties}, mPath{std::move(path)} {
+  auto blob = loadBlob();
+  mWarm = !blob.empty();
+
+  VkPipelineCacheCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = blob.size();
+  createInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+
+  auto result =
+      vkCreatePipelineCache(mDevice, &createInfo, CUSTOM_ALLOCATOR, &mCache);
+  if (result != VK_SUCCESS && mWarm) {
+    // the driver refused a blob that passed our checks, start cold instead
+    WLOG("Pipeline cache {} rejected by the driver, starting empty", mPath);
+    mWarm = false;
+    mSavedHash = 0;
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    result =
+        vkCreatePipelineCache(mDevice, &createInfo, CUSTOM_ALLOCATOR, &mCache);
+  }
+  VK_TEST(result, "Failed to create pipeline cache")
+
+  LOG("Pipeline cache: {} ({} KiB)", mWarm ? "warm" : "cold",
+      blob.size() / 1024);
+}
+
+PipelineCache::~PipelineCache() {
+  save();
+  vkDestroyPipelineCache(mDevice, mCache, CUSTOM_ALLOCATOR);
+}
+
+bool PipelineCache::save() {
+  std::size_t size = 0;
+  if (vkGetPipelineCacheData(mDevice, mCache, &size, nullptr) != VK_SUCCESS) {
+    WLOG("Failed to query pipeline cache size");
+    return false;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(mDevice, mCache, &size, data.data()) !=
+      VK_SUCCESS) {
+    WLOG("Failed to read pipeline cache data");
+    return false;
+  }
+  data.resize(size);
+
+  FileHeader header = {};
+  header.dataSize = data.size();
+  header.dataHash = hashBytes(data.data(), data.size());
+  if (header.dataHash == mSavedHash) {
+    return true;
+  }
+
+  auto tempPath = mPath + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios_base::binary | std::ios_base::trunc};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.flush();
+    if (!file.good()) {
+      WLOG("Failed to write pipeline cache {}", tempPath);
+      file.close();
+      std::error_code error;
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, mPath, error);
+  if (error) {
+    WLOG("Failed to replace pipeline cache {}: {}", mPath, error.message());
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  mSavedHash = header.dataHash;
+  LOG("Saved pipeline cache {} ({} KiB)", mPath, data.size() / 1024);
+  return true;
+}
+
+void PipelineCache::addCompileTime(double ms, std::uint32_t count) noexcept {
+  mCompileNs.fetch_add(static_cast<std::uint64_t>(ms * 1e6),
+                       std::memory_order_relaxed);
+  mPipelineCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+double PipelineCache::compileTimeMs() const noexcept {
+  return static_cast<double>(mCompileNs.load(std::memory_order_relaxed)) /
+         1e6;
+}
+
+std::vector<char> PipelineCache::loadBlob() {
+  std::ifstream file{mPath, std::ios_base::ate | std::ios_base::binary};
+  if (!file.is_open()) {
+    return {};
+  }
+  auto fileSize = static_cast<std::size_t>(file.tellg());
+  file.seekg(0);
+
+  FileHeader header = {};
+  if (fileSize < sizeof(header) ||
+      !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    WLOG("Pipeline cache {} is truncated, ignoring it", mPath);
+    return {};
+  }
+  const FileHeader expected = {};
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.version != expected.version ||
+      header.dataSize != fileSize - sizeof(header)) {
+    WLOG("Pipeline cache {} has a bad header, ignoring it", mPath);
+    return {};
+  }
+
+  std::vector<char> blob(header.dataSize);
+  if (!file.read(blob.data(), static_cast<std::streamsize>(blob.size())) ||
+      hashBytes(blob.data(), blob.size()) != header.dataHash) {
+    WLOG("Pipeline cache {} is corrupt, ignoring it", mPath);
+    return {};
+  }
+  if (!matchesDevice(blob)) {
+    LOG("Pipeline cache {} was built for another device or driver", mPath);
+    return {};
+  }
+
+  mSavedHash = header.dataHash;
+  return blob;
+}
+
+bool PipelineCache::matchesDevice(const std::vector<char> &blob) const {
+  CacheHeaderV1 header = {};
+  if (blob.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, blob.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == mProperties.vendorID &&
+         header.deviceID == mProperties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, mProperties.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+} // namespace mv
@@ -0,0 +1,148 @@
+#include "PipelineLibrary.h"
+#include "DeviceHelper.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "Log.h"
+#include "PipelineCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace mv {
+
+PipelineLibrary::PipelineLibrary(Device &device, JobSystem &jobs)
+    : mDevice{device}, mJobs{jobs} {}
+
+PipelineLibrary::~PipelineLibrary() {
+  // pipelines go first, they were created from the modules
+  mEntries.clear();
+  for (auto &module : mModules) {
+    vkDestroyShaderModule(mDevice.device(), module.module, CUSTOM_ALLOCATOR);
+  }
+}
+
+PipelineLibrary::Handle
+PipelineLibrary::add(const std::string &vertexFilepath,
+                     const std::string &fragmentFilepath,
+                     std::unique_ptr<PipelineConfig> config) {
+  assert(config != nullptr && "PipelineLibrary::add needs a config");
+
+  Entry entry = {};
+  entry.vertexModule = loadShaderModule(vertexFilepath);
+  entry.fragmentModule = loadShaderModule(fragmentFilepath);
+  entry.config = std::move(config);
+
+  auto handle = static_cast<Handle>(mEntries.size());
+  mEntries.push_back(std::move(entry));
+  mPending.push_back(handle);
+  return handle;
+}
+
+void PipelineLibrary::compile() {
+  if (mPending.empty()) {
+    return;
+  }
+  auto count = static_cast<std::uint32_t>(mPending.size());
+  auto createInfos = std::make_unique<Pipeline::CreateInfo[]>(count);
+  std::vector<VkGraphicsPipelineCreateInfo> pipelineInfos(count);
+  for (std::uint32_t i = 0; i < count; i++) {
+    const auto &entry = mEntries[mPending[i]];
+    Pipeline::fillCreateInfo(*entry.config, entry.vertexModule,
+                             entry.fragmentModule, createInfos[i]);
+    pipelineInfos[i] = createInfos[i].pipelineInfo;
+  }
+
+  // one batch per thread; the cache is internally synchronized, so the
+  // batches only contend inside the driver
+  auto batchCount = std::min(count, mJobs.threadCount());
+  auto batchSize = (count + batchCount - 1) / batchCount;
+  batchCount = (count + batchSize - 1) / batchSize;
+
+  std::vector<VkPipeline> pipelines(count, VK_NULL_HANDLE);
+  std::vector<VkResult> results(batchCount, VK_SUCCESS);
+  auto &pipelineCache = mDevice.getPipelineCache();
+  auto start = std::chrono::high_resolution_clock::now();
+  mJobs.parallelFor(
+      0, batchCount, 1, [&](std::uint32_t first, std::uint32_t last) {
+        for (auto batch = first; batch < last; batch++) {
+          auto begin = batch * batchSize;
+          auto size = std::min(batchSize, count - begin);
+          auto batchStart = std::chrono::high_resolution_clock::now();
+          results[batch] = vkCreateGraphicsPipelines(
+              mDevice.device(), pipelineCache.get(), size,
+              &pipelineInfos[begin], CUSTOM_ALLOCATOR, &pipelines[begin]);
+          pipelineCache.addCompileTime(
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::high_resolution_clock::now() - batchStart)
+                  .count(),
+              size);
+        }
+      });
+  auto ms = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start)
+                .count();
+
+  // wrap what was created before checking, failed slots are null and the
+  // rest is destroyed with the library
+  for (std::uint32_t i = 0; i < count; i++) {
+    auto &entry = mEntries[mPending[i]];
+    if (pipelines[i] != VK_NULL_HANDLE) {
+      entry.pipeline = std::make_unique<Pipeline>(mDevice, pipelines[i]);
+      entry.config.reset();
+    }
+  }
+  mPending.clear();
+  for (auto result : results) {
+    VK_TEST(result, "Failed to create graphics pipelines")
+  }
+
+  LOG("Created {} pipelines in {} batches in {:.1f} ms, {} shader modules",
+      count, batchCount, ms, mModules.size());
+}
+
+Pipeline &PipelineLibrary::get(Handle handle) {
+  assert(handle < mEntries.size() && "Unknown pipeline handle");
+  auto &entry = mEntries[handle];
+  if (entry.pipeline == nullptr) {
+    compile();
+    assert(entry.pipeline != nullptr);
+  }
+  return *entry.pipeline;
+}
+
+VkShaderModule PipelineLibrary::loadShaderModule(const std::string &filepath) {
+  if (auto it = mModulesByPath.find(filepath); it != mModulesByPath.end()) {
+    return it->second;
+  }
+
+  auto code = pipeline_helper::readBinaryFile(filepath);
+  // equal hashes are confirmed by comparing the code
+  auto hash = hashBytes(code.data(), code.size());
+  auto [first, last] = mModulesByHash.equal_range(hash);
+  for (auto it = first; it != last; it++) {
+    const auto &module = mModules[it->second];
+    if (module.code == code) {
+      // same SPIR-V under another name
+      mModulesByPath.emplace(filepath, module.module);
+      return module.module;
+    }
+  }
+
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const std::uint32_t *>(code.data());
+
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VK_TEST(vkCreateShaderModule(mDevice.device(), &createInfo, CUSTOM_ALLOCATOR,
+                               &shaderModule),
+          "Failed to create shader module")
+
+  mModulesByHash.emplace(hash, mModules.size());
+  mModules.push_back({hash, std::move(code), shaderModule});
+  mModulesByPath.emplace(filepath, shaderModule);
+  return shaderModule;
+}
+
+} // namespace mv
@@ -1,15 +1,21 @@
 #include "Renderer.h"
 #include "Log.h"
+#include "StagingRing.h"
+#include "UploadQueue.h"
 #include <array>
 
 namespace mv {
-Renderer::Renderer(Window &window, Device &device)
-    : mWindow{window}, mDevice{device}, currentImageIdx{0} {
+Renderer::Renderer(Window &window, Device &device, JobSystem &jobs)
+    : mWindow{window}, mDevice{device}, mJobs{jobs}, currentImageIdx{0} {
   recreateSwapChain();
   createCommandBuffers();
+  createThreadCommandPools();
 }
 
-Renderer::~Renderer() { freeCommandBuffers(); }
+Renderer::~Renderer() {
+  destroyThreadCommandPools();
+  freeCommandBuffers();
+}
 
 VkCommandBuffer Renderer::beginFrame() {
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
@@ -26,6 +32,15 @@ VkCommandBuffer Renderer::beginFrame() {
 
   isFrameStarted = true;
 
+  // the fence waited for in acquireNextImage covers this frame's secondaries
+  for (auto &commands : mThreadCommands[currentFrameIdx]) {
+    if (commands.used > 0) {
+      VK_TEST(vkResetCommandPool(mDevice.device(), commands.pool, 0),
+              "Failed to reset command pool")
+      commands.used = 0;
+    }
+  }
+
   auto commandBuffer = getCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo = {};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -37,12 +52,18 @@ VkCommandBuffer Renderer::beginFrame() {
 }
 
 void Renderer::endFrame() {
-  assert(!isFrameStarted && "Can't call endFrame while already in progress");
+  assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
 
   auto commandBuffer = getCurrentCommandBuffer();
 
   VK_TEST(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer")
 
+  // uploads recorded this frame go to the queue ahead of the draws using them;
+  // background uploads that finished are acquired in the same submission and
+  // become ready for the next frame's draws
+  mDevice.getUploadQueue().acquire(mDevice.getStagingRing());
+  mDevice.getStagingRing().submit();
+
   auto result =
       swapChain->submitCommandBuffers(&commandBuffer, &currentImageIdx);
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
@@ -57,7 +78,8 @@ void Renderer::endFrame() {
   currentFrameIdx = (currentFrameIdx + 1) % SwapChain::MAX_FRAME_IN_FLIGHT;
 }
 
-void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                        VkSubpassContents contents) {
   assert(isFrameStarted &&
          "Can't call beginSwapChainRenderPass while frame is not in progress");
   assert(commandBuffer == getCurrentCommandBuffer() &&
@@ -79,8 +101,10 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
       static_cast<std::uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+    return;
+  }
 
   VkViewport viewport = {};
   viewport.x = 0.0f;
@@ -104,6 +128,89 @@ void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   vkCmdEndRenderPass(commandBuffer);
 }
 
+void Renderer::recordSecondaries(
+    VkCommandBuffer commandBuffer,
+    const std::vector<SecondaryRecorder> &recorders) {
+  assert(isFrameStarted &&
+         "Can't record secondaries while frame is not in progress");
+  auto count = static_cast<std::uint32_t>(recorders.size());
+  if (count == 0) {
+    return;
+  }
+  mSecondaries.assign(count, VK_NULL_HANDLE);
+  mSecondaryResults.assign(count, VK_SUCCESS);
+
+  // jobs must not throw, Vulkan errors are reported once all are done
+  auto &frameCommands = mThreadCommands[currentFrameIdx];
+  mJobs.parallelFor(0, count, 1, [&](std::uint32_t first, std::uint32_t last) {
+    auto &commands = frameCommands[mJobs.threadIndex()];
+    for (auto i = first; i < last; i++) {
+      auto &secondary = mSecondaries[i];
+      mSecondaryResults[i] = beginSecondary(commands, secondary);
+      if (mSecondaryResults[i] != VK_SUCCESS) {
+        continue;
+      }
+      recorders[i](secondary);
+      mSecondaryResults[i] = vkEndCommandBuffer(secondary);
+    }
+  });
+
+  for (auto result : mSecondaryResults) {
+    VK_TEST(result, "Failed to record secondary command buffer")
+  }
+  vkCmdExecuteCommands(commandBuffer, count, mSecondaries.data());
+}
+
+VkResult Renderer::beginSecondary(ThreadCommands &commands,
+                                  VkCommandBuffer &out) {
+  if (commands.used == commands.secondaries.size()) {
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = commands.pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer secondary = VK_NULL_HANDLE;
+    auto result =
+        vkAllocateCommandBuffers(mDevice.device(), &allocInfo, &secondary);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    commands.secondaries.push_back(secondary);
+  }
+  out = commands.secondaries[commands.used++];
+
+  VkCommandBufferInheritanceInfo inheritanceInfo = {};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = swapChain->getRenderPass();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer =
+      swapChain->getFrameBuffer(static_cast<int>(currentImageIdx));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  auto result = vkBeginCommandBuffer(out, &beginInfo);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  // dynamic state is not inherited from the primary
+  VkViewport viewport = {};
+  viewport.width = static_cast<float>(swapChain->getSwapChainExtent().width);
+  viewport.height = static_cast<float>(swapChain->getSwapChainExtent().height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor = {{0, 0}, swapChain->getSwapChainExtent()};
+
+  vkCmdSetViewport(out, 0, 1, &viewport);
+  vkCmdSetScissor(out, 0, 1, &scissor);
+  return VK_SUCCESS;
+}
+
 void Renderer::createCommandBuffers() {
   commandBuffers.resize(SwapChain::MAX_FRAME_IN_FLIGHT);
 
@@ -126,6 +233,34 @@ void Renderer::freeCommandBuffers() {
   commandBuffers.clear();
 }
 
+void Renderer::createThreadCommandPools() {
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex =
+      mDevice.findPhysicalQueueFamily().graphicsFamily.value();
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  mThreadCommands.resize(SwapChain::MAX_FRAME_IN_FLIGHT);
+  for (auto &frameCommands : mThreadCommands) {
+    frameCommands.resize(mJobs.threadCount());
+    for (auto &commands : frameCommands) {
+      VK_TEST(vkCreateCommandPool(mDevice.device(), &poolInfo,
+                                  CUSTOM_ALLOCATOR, &commands.pool),
+              "Failed to create thread command pool")
+    }
+  }
+}
+
+void Renderer::destroyThreadCommandPools() {
+  // destroying a pool frees its command buffers
+  for (auto &frameCommands : mThreadCommands) {
+    for (auto &commands : frameCommands) {
+      vkDestroyCommandPool(mDevice.device(), commands.pool, CUSTOM_ALLOCATOR);
+    }
+  }
+  mThreadCommands.clear();
+}
+
 void Renderer::recreateSwapChain() {
   auto extent = mWindow.getExtent2D();
   while (extent.width == 0 || extent.height == 0) {
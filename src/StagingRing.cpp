@@ -0,0 +1,308 @@
+#include "StagingRing.h"
+#include "Buffer.h"
+#include "Device.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace mv {
+
+StagingRing::StagingRing(Device &device, VkQueue queue,
+                         std::uint32_t queueFamily, VkDeviceSize capacity)
+    : mDevice{device}, mQueue{queue}, mQueueFamily{queueFamily},
+      mCapacity{capacity} {
+  mGraphicsQueue =
+      mDevice.findPhysicalQueueFamily().graphicsFamily.value() == queueFamily;
+
+  createCommandPool();
+  createFrames();
+
+  mBuffer = std::make_unique<Buffer>(mDevice, mCapacity, 1,
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  VK_TEST(mBuffer->map(mCapacity), "Failed to map staging ring")
+  mMapped = static_cast<char *>(mBuffer->getMappedMemory());
+}
+
+StagingRing::~StagingRing() {
+  for (auto &frame : mFrames) {
+    if (frame.inFlight) {
+      vkWaitForFences(mDevice.device(), 1, &frame.fence, VK_TRUE, UINT64_MAX);
+    }
+    vkDestroyFence(mDevice.device(), frame.fence, CUSTOM_ALLOCATOR);
+  }
+  vkDestroyCommandPool(mDevice.device(), mCommandPool, CUSTOM_ALLOCATOR);
+}
+
+StagingAllocation StagingRing::allocate(VkDeviceSize size,
+                                        VkDeviceSize alignment) {
+  assert(size > 0 && "Staging allocation must not be empty");
+  assert((alignment & (alignment - 1)) == 0 &&
+         "Staging alignment must be a power of two");
+
+  commandBuffer();
+  if (size > mCapacity) {
+    return allocateDedicated(size);
+  }
+
+  VkDeviceSize offset = 0;
+  while (!tryAllocate(size, alignment, offset)) {
+    // wait for the oldest frame still holding ring space; if there is none the
+    // current frame filled the ring on its own, so flush it first
+    bool retired = false;
+    for (std::uint32_t i = 1; i < FRAME_COUNT && !retired; i++) {
+      auto &frame = mFrames[(mFrameIdx + i) % FRAME_COUNT];
+      if (frame.inFlight) {
+        retire(frame);
+        retired = true;
+      }
+    }
+    if (!retired) {
+      submit();
+      commandBuffer();
+    }
+  }
+
+  mStats.bytesStaged += size;
+  mStats.uploads++;
+  return {mMapped + offset % mCapacity, mBuffer->getBuffer(),
+          offset % mCapacity};
+}
+
+VkCommandBuffer StagingRing::commandBuffer() {
+  auto &frame = mFrames[mFrameIdx];
+  if (!frame.recording) {
+    beginFrame(frame);
+  }
+  return frame.commandBuffer;
+}
+
+void StagingRing::uploadBuffer(VkBuffer dstBuffer, const void *data,
+                               VkDeviceSize size, VkDeviceSize dstOffset) {
+  auto staging = allocate(size);
+  std::memcpy(staging.mapped, data, size);
+
+  VkBufferCopy copyRegion = {};
+  copyRegion.srcOffset = staging.offset;
+  copyRegion.dstOffset = dstOffset;
+  copyRegion.size = size;
+  vkCmdCopyBuffer(commandBuffer(), staging.buffer, dstBuffer, 1, &copyRegion);
+}
+
+void StagingRing::uploadImage(VkImage image, const void *data,
+                              VkDeviceSize size, std::uint32_t width,
+                              std::uint32_t height, std::uint32_t layerCount,
+                              std::uint32_t mipLevel) {
+  auto staging = allocate(size);
+  std::memcpy(staging.mapped, data, size);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = staging.offset;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = mipLevel;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layerCount;
+
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+
+  vkCmdCopyBufferToImage(commandBuffer(), staging.buffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+std::uint64_t StagingRing::submit() {
+  auto &frame = mFrames[mFrameIdx];
+  if (!frame.recording) {
+    return mSubmitSerial;
+  }
+
+  if (mGraphicsQueue) {
+    // later submissions on the queue (the frame's draws) must see the copies
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+    vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
+  VK_TEST(vkEndCommandBuffer(frame.commandBuffer),
+          "Failed to record upload command buffer")
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &frame.commandBuffer;
+
+  VK_TEST(vkQueueSubmit(mQueue, 1, &submitInfo, frame.fence),
+          "Failed to submit upload command buffer")
+
+  frame.end = mHead;
+  frame.serial = ++mSubmitSerial;
+  frame.recording = false;
+  frame.inFlight = true;
+  mStats.submits++;
+
+  mFrameIdx = (mFrameIdx + 1) % FRAME_COUNT;
+  return frame.serial;
+}
+
+std::uint64_t StagingRing::completedSerial() {
+  // in flight frames are ordered oldest first starting after the current one
+  for (std::uint32_t i = 1; i <= FRAME_COUNT; i++) {
+    auto &frame = mFrames[(mFrameIdx + i) % FRAME_COUNT];
+    if (!frame.inFlight) {
+      continue;
+    }
+    if (vkGetFenceStatus(mDevice.device(), frame.fence) != VK_SUCCESS) {
+      break;
+    }
+    retire(frame);
+  }
+  return mCompletedSerial;
+}
+
+bool StagingRing::waitForSerial(std::uint64_t serial, std::uint64_t timeout) {
+  if (serial <= mCompletedSerial) {
+    return true;
+  }
+  for (auto &frame : mFrames) {
+    if (frame.inFlight && frame.serial == serial) {
+      if (vkWaitForFences(mDevice.device(), 1, &frame.fence, VK_TRUE,
+                          timeout) != VK_SUCCESS) {
+        return false;
+      }
+      break;
+    }
+  }
+  return completedSerial() >= serial;
+}
+
+void StagingRing::release(std::unique_ptr<Buffer> buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  // an otherwise empty frame still gets submitted and fenced
+  commandBuffer();
+  mFrames[mFrameIdx].retained.push_back(std::move(buffer));
+}
+
+void StagingRing::createCommandPool() {
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = mQueueFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+  VK_TEST(vkCreateCommandPool(mDevice.device(), &poolInfo, CUSTOM_ALLOCATOR,
+                              &mCommandPool),
+          "Failed to create upload command pool")
+}
+
+void StagingRing::createFrames() {
+  std::array<VkCommandBuffer, FRAME_COUNT> commandBuffers = {};
+
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = mCommandPool;
+  allocInfo.commandBufferCount = FRAME_COUNT;
+
+  VK_TEST(vkAllocateCommandBuffers(mDevice.device(), &allocInfo,
+                                   commandBuffers.data()),
+          "Failed to allocate upload command buffers")
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  for (std::uint32_t i = 0; i < FRAME_COUNT; i++) {
+    mFrames[i].commandBuffer = commandBuffers[i];
+    VK_TEST(vkCreateFence(mDevice.device(), &fenceInfo, CUSTOM_ALLOCATOR,
+                          &mFrames[i].fence),
+            "Failed to create upload fence")
+  }
+}
+
+void StagingRing::beginFrame(UploadFrame &frame) {
+  if (frame.inFlight) {
+    retire(frame);
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  VK_TEST(vkBeginCommandBuffer(frame.commandBuffer, &beginInfo),
+          "Failed to begin upload command buffer")
+  frame.recording = true;
+}
+
+void StagingRing::retire(UploadFrame &frame) {
+  assert(frame.inFlight && "Retiring an upload frame that was not submitted");
+
+  if (vkGetFenceStatus(mDevice.device(), frame.fence) != VK_SUCCESS) {
+    mStats.stalls++;
+    vkWaitForFences(mDevice.device(), 1, &frame.fence, VK_TRUE, UINT64_MAX);
+  }
+  vkResetFences(mDevice.device(), 1, &frame.fence);
+
+  // frames complete in submission order, so the ring tail only moves forward
+  mTail = std::max(mTail, frame.end);
+  mCompletedSerial = std::max(mCompletedSerial, frame.serial);
+  frame.retained.clear();
+  frame.inFlight = false;
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment,
+                              VkDeviceSize &offset) {
+  if (mHead == mTail) {
+    // ring is empty, restart at the beginning of the buffer
+    mHead = mTail = (mHead + mCapacity - 1) / mCapacity * mCapacity;
+  }
+
+  auto start = (mHead + alignment - 1) & ~(alignment - 1);
+  // an allocation never wraps around the end of the buffer
+  auto physical = start % mCapacity;
+  if (physical + size > mCapacity) {
+    start += mCapacity - physical;
+  }
+  if (start + size - mTail > mCapacity) {
+    return false;
+  }
+
+  offset = start;
+  mHead = start + size;
+  return true;
+}
+
+StagingAllocation StagingRing::allocateDedicated(VkDeviceSize size) {
+  WLOG("Staging upload of {} B exceeds the {} B ring, using a dedicated buffer",
+       size, mCapacity);
+
+  auto buffer = std::make_unique<Buffer>(
+      mDevice, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  VK_TEST(buffer->map(size), "Failed to map dedicated staging buffer")
+
+  StagingAllocation allocation = {buffer->getMappedMemory(),
+                                  buffer->getBuffer(), 0};
+  mFrames[mFrameIdx].retained.push_back(std::move(buffer));
+
+  mStats.bytesStaged += size;
+  mStats.uploads++;
+  mStats.dedicatedUploads++;
+  return allocation;
+}
+} // namespace mv
@@ -31,7 +31,7 @@ SwapChain::~SwapChain() {
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(mDevice.device(), depthImageViews[i], CUSTOM_ALLOCATOR);
     vkDestroyImage(mDevice.device(), depthImages[i], CUSTOM_ALLOCATOR);
-    vkFreeMemory(mDevice.device(), depthImageMemorys[i], CUSTOM_ALLOCATOR);
+    mDevice.getAllocator().free(depthImageMemorys[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
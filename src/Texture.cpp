@@ -2,11 +2,217 @@
 #include "Buffer.h"
 
 #include "Log.h"
+#include "StagingRing.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <vector>
 
 namespace mv {
+  namespace texture_helper {
+    namespace {
+      bool isSrgb(VkFormat format) {
+        return format == VK_FORMAT_R8G8B8A8_SRGB ||
+          format == VK_FORMAT_B8G8R8A8_SRGB;
+      }
+
+      float srgbToLinear(std::uint8_t value) {
+        static const auto table = [] {
+          std::array<float, 256> result = {};
+          for (std::size_t i = 0; i < result.size(); i++) {
+            auto c = static_cast<float>(i) / 255.0f;
+            result[i] = c <= 0.04045f ? c / 12.92f
+              : std::pow((c + 0.055f) / 1.055f, 2.4f);
+          }
+          return result;
+        }();
+        return table[value];
+      }
+
+      std::uint8_t linearToSrgb(float value) {
+        auto c = value <= 0.0031308f ? value * 12.92f
+          : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<std::uint8_t>(
+          std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+      }
+
+      // halves every layer of src, odd edges fold into the last texel
+      void downsample(const std::uint8_t* src, std::uint32_t width,
+        std::uint32_t height, std::uint8_t* dst, std::uint32_t layerCount,
+        bool srgb) {
+        auto dstWidth = std::max(width / 2, 1u);
+        auto dstHeight = std::max(height / 2, 1u);
+        for (std::uint32_t layer = 0; layer < layerCount; layer++) {
+          for (std::uint32_t y = 0; y < dstHeight; y++) {
+            const auto* row0 = src + (y * 2) * width * 4;
+            const auto* row1 = src + std::min(y * 2 + 1, height - 1) * width * 4;
+            for (std::uint32_t x = 0; x < dstWidth; x++) {
+              auto x0 = x * 2 * 4;
+              auto x1 = std::min(x * 2 + 1, width - 1) * 4;
+              for (std::uint32_t c = 0; c < 4; c++) {
+                std::uint8_t texels[4] = {
+                  row0[x0 + c], row0[x1 + c], row1[x0 + c], row1[x1 + c] };
+                if (srgb && c < 3) {
+                  auto sum = srgbToLinear(texels[0]) + srgbToLinear(texels[1]) +
+                    srgbToLinear(texels[2]) + srgbToLinear(texels[3]);
+                  *dst++ = linearToSrgb(sum * 0.25f);
+                }
+                else {
+                  *dst++ = static_cast<std::uint8_t>(
+                    (texels[0] + texels[1] + texels[2] + texels[3] + 2) / 4);
+                }
+              }
+            }
+          }
+          src += static_cast<std::size_t>(width) * height * 4;
+        }
+      }
+    } // namespace
+
+    std::uint32_t mipLevelCount(std::uint32_t width, std::uint32_t height) {
+      std::uint32_t levels = 1;
+      for (auto size = std::max(width, height); size > 1; size /= 2) {
+        levels++;
+      }
+      return levels;
+    }
+
+    bool canBlitMipmaps(Device& device, VkFormat format) {
+      return device.supportsFormatFeatures(format, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    }
+
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image,
+      const VkImageSubresourceRange& range,
+      VkImageLayout oldLayout, VkImageLayout newLayout) {
+
+      VkImageMemoryBarrier barrier = {};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.oldLayout = oldLayout;
+      barrier.newLayout = newLayout;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = image;
+      barrier.subresourceRange = range;
+
+      VkPipelineStageFlags sourceStages;
+      VkPipelineStageFlags destinationStage;
+
+      if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
+        newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        sourceStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      }
+      else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+        newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        sourceStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      }
+      else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+        newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        sourceStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      }
+      else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL &&
+        newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        sourceStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      }
+      else {
+        RT_THROW("unsupported layout transition");
+      }
+      vkCmdPipelineBarrier(commandBuffer, sourceStages, destinationStage, 0, 0,
+        nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image,
+      std::uint32_t width, std::uint32_t height,
+      std::uint32_t mipLevels, std::uint32_t layerCount) {
+      VkImageSubresourceRange range = {};
+      range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      range.levelCount = 1;
+      range.baseArrayLayer = 0;
+      range.layerCount = layerCount;
+
+      auto srcWidth = static_cast<std::int32_t>(width);
+      auto srcHeight = static_cast<std::int32_t>(height);
+      for (std::uint32_t level = 1; level < mipLevels; level++) {
+        auto dstWidth = std::max(srcWidth / 2, 1);
+        auto dstHeight = std::max(srcHeight / 2, 1);
+
+        range.baseMipLevel = level - 1;
+        transitionImageLayout(commandBuffer, image, range,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = layerCount;
+        blit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstOffsets[1] = { dstWidth, dstHeight, 1 };
+        vkCmdBlitImage(commandBuffer,
+          image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          1, &blit, VK_FILTER_LINEAR);
+
+        // the source level is final once it has been read
+        transitionImageLayout(commandBuffer, image, range,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        srcWidth = dstWidth;
+        srcHeight = dstHeight;
+      }
+
+      range.baseMipLevel = mipLevels - 1;
+      transitionImageLayout(commandBuffer, image, range,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    void uploadMipChain(StagingRing& staging, VkImage image, VkFormat format,
+      const std::uint8_t* pixels, std::uint32_t width, std::uint32_t height,
+      std::uint32_t mipLevels, std::uint32_t layerCount) {
+      auto srgb = isSrgb(format);
+      staging.uploadImage(image, pixels,
+        static_cast<VkDeviceSize>(width) * height * 4 * layerCount,
+        width, height, layerCount);
+
+      std::vector<std::uint8_t> src;
+      std::vector<std::uint8_t> dst;
+      for (std::uint32_t level = 1; level < mipLevels; level++) {
+        auto dstWidth = std::max(width / 2, 1u);
+        auto dstHeight = std::max(height / 2, 1u);
+        dst.resize(static_cast<std::size_t>(dstWidth) * dstHeight * 4 *
+          layerCount);
+        downsample(level == 1 ? pixels : src.data(), width, height, dst.data(),
+          layerCount, srgb);
+        staging.uploadImage(image, dst.data(), dst.size(), dstWidth,
+          dstHeight, layerCount, level);
+
+        std::swap(src, dst);
+        width = dstWidth;
+        height = dstHeight;
+      }
+    }
+  } // namespace texture_helper
 
   Texture::Texture(Device& device, const std::string& textureFilePath, VkFormat format)
     : mDevice{ device }, mFormat{format}{
@@ -20,7 +226,7 @@ namespace mv {
     vkDestroySampler(mDevice.device(), mImageSampler, CUSTOM_ALLOCATOR);
     vkDestroyImageView(mDevice.device(), mImageView, CUSTOM_ALLOCATOR);
     vkDestroyImage(mDevice.device(), mImage, CUSTOM_ALLOCATOR);
-    vkFreeMemory(mDevice.device(), mImageMemory, CUSTOM_ALLOCATOR);
+    mDevice.getAllocator().free(mImageMemory);
   }
 
   void Texture::loadTextureFromFile(const std::string& filePath) {
@@ -35,29 +241,42 @@ namespace mv {
   void Texture::createTexture() {
     assert(mImageRawData && "Must load image before allocate memory on GPU");
 
+    auto width = static_cast<std::uint32_t>(mWidth);
+    auto height = static_cast<std::uint32_t>(mHeight);
     VkDeviceSize imageSize = mWidth * mHeight * 4; // 3 - case rgb, not rgba
-
-    Buffer stagingBuffer = { mDevice, imageSize, 1,
-                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
-
-    stagingBuffer.map(imageSize);
-    stagingBuffer.writeToBuffer((void*)mImageRawData, imageSize);
-    stagingBuffer.unMap();
-
-    stbi_image_free(mImageRawData); // not needed in RAM
+    mMipLevels = texture_helper::mipLevelCount(width, height);
 
     createImageBuffer();
 
-    transitionImageLayout(mImage, mFormat,
+    VkImageSubresourceRange allLevels = {};
+    allLevels.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    allLevels.baseMipLevel = 0;
+    allLevels.levelCount = mMipLevels;
+    allLevels.baseArrayLayer = 0;
+    allLevels.layerCount = 1;
+
+    auto& staging = mDevice.getStagingRing();
+    texture_helper::transitionImageLayout(staging.commandBuffer(), mImage,
+      allLevels,
       VK_IMAGE_LAYOUT_UNDEFINED,
       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    mDevice.copyBufferToImage(stagingBuffer.getBuffer(), mImage, mWidth, mHeight,
-      1);
-    transitionImageLayout(mImage, mFormat,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    if (texture_helper::canBlitMipmaps(mDevice, mFormat)) {
+      staging.uploadImage(mImage, mImageRawData, imageSize, width, height);
+      texture_helper::generateMipmaps(staging.commandBuffer(), mImage, width,
+        height, mMipLevels);
+    }
+    else {
+      WLOG("Format {} has no linear blit, building {} mip levels on the CPU",
+        static_cast<int>(mFormat), mMipLevels);
+      texture_helper::uploadMipChain(staging, mImage, mFormat, mImageRawData,
+        width, height, mMipLevels);
+      texture_helper::transitionImageLayout(staging.commandBuffer(), mImage,
+        allLevels,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    stbi_image_free(mImageRawData); // not needed in RAM
   }
 
   void Texture::createImageView()
@@ -69,7 +288,7 @@ namespace mv {
     imageViewInfo.format = mFormat;
     imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     imageViewInfo.subresourceRange.baseMipLevel = 0;
-    imageViewInfo.subresourceRange.levelCount = 1;
+    imageViewInfo.subresourceRange.levelCount = mMipLevels;
     imageViewInfo.subresourceRange.baseArrayLayer = 0;
     imageViewInfo.subresourceRange.layerCount = 1;
 
@@ -93,6 +312,9 @@ namespace mv {
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(mMipLevels);
 
     VK_TEST(vkCreateSampler(mDevice.device(), &samplerInfo, CUSTOM_ALLOCATOR, &mImageSampler),
       "Failed to create texture sampler");
@@ -105,76 +327,18 @@ namespace mv {
     imageInfo.extent.width = mWidth;
     imageInfo.extent.height = mHeight;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mMipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = mFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage =
+    // the blits read the upper levels back
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VK_TEST(
-      vkCreateImage(mDevice.device(), &imageInfo, CUSTOM_ALLOCATOR, &mImage),
-      "Failed to create image");
-
-    VkMemoryRequirements memReq;
-    vkGetImageMemoryRequirements(mDevice.device(), mImage, &memReq);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = mDevice.findMemoryType(
-      memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    VK_TEST(vkAllocateMemory(mDevice.device(), &allocInfo, CUSTOM_ALLOCATOR,
-      &mImageMemory),
-      "Failed to allocate image memory");
-    vkBindImageMemory(mDevice.device(), mImage, mImageMemory, 0);
-  }
-
-  void Texture::transitionImageLayout(VkImage image, VkFormat format,
-    VkImageLayout oldLayout,
-    VkImageLayout newLayout) {
-    auto commandBuffer = mDevice.beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags sourceStages;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-      newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-      barrier.srcAccessMask = 0;
-      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      sourceStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-      destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-      newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-      sourceStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
-      destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else {
-      RT_THROW("unsupported layout transition");
-    }
-    vkCmdPipelineBarrier(commandBuffer, sourceStages, destinationStage, 0, 0,
-      nullptr, 0, nullptr, 1, &barrier);
-
-    mDevice.endSingleTimeCommands(commandBuffer);
+    mDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      mImage, mImageMemory);
   }
 } // namespace mv
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "TextureArray.h"
+
+#include "Log.h"
+#include "StagingRing.h"
+#include "Texture.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace mv {
+  namespace {
+    struct DecodedTile {
+      stbi_uc* pixels = { nullptr };
+      int width = { 0 };
+      int height = { 0 };
+    };
+
+    // magenta and black quarters, hard to overlook in the world
+    void fillMissing(std::uint8_t* dst, std::uint32_t size) {
+      auto half = std::max(size / 2, 1u);
+      for (std::uint32_t y = 0; y < size; y++) {
+        for (std::uint32_t x = 0; x < size; x++) {
+          bool magenta = ((x / half) ^ (y / half)) & 1u;
+          *dst++ = magenta ? 255 : 0;
+          *dst++ = 0;
+          *dst++ = magenta ? 255 : 0;
+          *dst++ = 255;
+        }
+      }
+    }
+  } // namespace
+
+  TextureArray::TextureArray(Device& device, JobSystem& jobs,
+    const std::string& directory, VkFormat format)
+    : mDevice{ device }, mFormat{ format } {
+    namespace fs = std::filesystem;
+
+    std::vector<fs::path> files;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".png") {
+        files.push_back(entry.path());
+      }
+    }
+    if (error) {
+      WLOG("Failed to list block textures in {}: {}", directory,
+        error.message());
+    }
+    std::sort(files.begin(), files.end());
+
+    // the flag is global in stb_image, set it before the workers read it;
+    // rows bottom up so v grows with the block's y like in Texture
+    stbi_set_flip_vertically_on_load(true);
+    std::vector<DecodedTile> tiles(files.size());
+    jobs.parallelFor(0, static_cast<std::uint32_t>(files.size()), 1,
+      [&](std::uint32_t first, std::uint32_t last) {
+        for (auto i = first; i < last; i++) {
+          int channels = 0;
+          tiles[i].pixels = stbi_load(files[i].string().c_str(),
+            &tiles[i].width, &tiles[i].height, &channels, STBI_rgb_alpha);
+        }
+      });
+
+    // the first square tile sets the size of all layers
+    for (const auto& tile : tiles) {
+      if (tile.pixels && tile.width == tile.height) {
+        mTileSize = static_cast<std::uint32_t>(tile.width);
+        break;
+      }
+    }
+    mLayerCount = static_cast<std::uint32_t>(files.size()) + 1;
+    if (mLayerCount > mDevice.properties.limits.maxImageArrayLayers) {
+      RT_THROW("Too many block textures for one texture array");
+    }
+
+    auto tileBytes = static_cast<std::size_t>(mTileSize) * mTileSize * 4;
+    std::vector<std::uint8_t> pixels(tileBytes * mLayerCount);
+    fillMissing(pixels.data(), mTileSize);
+    mLayers.reserve(files.size());
+    for (std::size_t i = 0; i < files.size(); i++) {
+      const auto& tile = tiles[i];
+      auto* dst = pixels.data() + (i + 1) * tileBytes;
+      if (tile.pixels && static_cast<std::uint32_t>(tile.width) == mTileSize &&
+        static_cast<std::uint32_t>(tile.height) == mTileSize) {
+        std::memcpy(dst, tile.pixels, tileBytes);
+      }
+      else {
+        WLOG("Block texture {} is not a {}x{} image, using the missing texture",
+          files[i].string(), mTileSize, mTileSize);
+        fillMissing(dst, mTileSize);
+      }
+      stbi_image_free(tile.pixels);
+      mLayers.emplace(files[i].stem().string(), static_cast<std::uint32_t>(i + 1));
+    }
+
+    createImage(pixels.data());
+    createImageView();
+    createTextureSampler();
+    LOG("Block textures: {} layers of {}x{} with {} mip levels", mLayerCount,
+      mTileSize, mTileSize, mMipLevels);
+  }
+
+  TextureArray::~TextureArray() {
+    vkDestroySampler(mDevice.device(), mImageSampler, CUSTOM_ALLOCATOR);
+    vkDestroyImageView(mDevice.device(), mImageView, CUSTOM_ALLOCATOR);
+    vkDestroyImage(mDevice.device(), mImage, CUSTOM_ALLOCATOR);
+    mDevice.getAllocator().free(mImageMemory);
+  }
+
+  std::uint32_t TextureArray::layer(const std::string& name) const {
+    auto it = mLayers.find(name);
+    if (it == mLayers.end()) {
+      WLOG("No block texture named {}", name);
+      return MISSING_LAYER;
+    }
+    return it->second;
+  }
+
+  VkDescriptorImageInfo TextureArray::descriptorInfo() const {
+    VkDescriptorImageInfo info = {};
+    info.sampler = mImageSampler;
+    info.imageView = mImageView;
+    info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    return info;
+  }
+
+  void TextureArray::createImage(const std::uint8_t* pixels) {
+    mMipLevels = texture_helper::mipLevelCount(mTileSize, mTileSize);
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = mTileSize;
+    imageInfo.extent.height = mTileSize;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mMipLevels;
+    imageInfo.arrayLayers = mLayerCount;
+    imageInfo.format = mFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    mDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      mImage, mImageMemory);
+
+    VkImageSubresourceRange allLevels = {};
+    allLevels.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    allLevels.baseMipLevel = 0;
+    allLevels.levelCount = mMipLevels;
+    allLevels.baseArrayLayer = 0;
+    allLevels.layerCount = mLayerCount;
+
+    // same path as Texture, every layer at once
+    auto& staging = mDevice.getStagingRing();
+    texture_helper::transitionImageLayout(staging.commandBuffer(), mImage,
+      allLevels,
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    if (texture_helper::canBlitMipmaps(mDevice, mFormat)) {
+      staging.uploadImage(mImage, pixels,
+        static_cast<VkDeviceSize>(mTileSize) * mTileSize * 4 * mLayerCount,
+        mTileSize, mTileSize, mLayerCount);
+      texture_helper::generateMipmaps(staging.commandBuffer(), mImage,
+        mTileSize, mTileSize, mMipLevels, mLayerCount);
+    }
+    else {
+      texture_helper::uploadMipChain(staging, mImage, mFormat, pixels,
+        mTileSize, mTileSize, mMipLevels, mLayerCount);
+      texture_helper::transitionImageLayout(staging.commandBuffer(), mImage,
+        allLevels,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+  }
+
+  void TextureArray::createImageView() {
+    VkImageViewCreateInfo imageViewInfo = {};
+    imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewInfo.image = mImage;
+    imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    imageViewInfo.format = mFormat;
+    imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewInfo.subresourceRange.baseMipLevel = 0;
+    imageViewInfo.subresourceRange.levelCount = mMipLevels;
+    imageViewInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewInfo.subresourceRange.layerCount = mLayerCount;
+
+    VK_TEST(vkCreateImageView(mDevice.device(), &imageViewInfo, CUSTOM_ALLOCATOR, &mImageView),
+      "Failed to create texture array image view");
+  }
+
+  void TextureArray::createTextureSampler() {
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    // crisp texels up close, filtered mips in the distance
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.anisotropyEnable = VK_TRUE;
+    samplerInfo.maxAnisotropy = mDevice.properties.limits.maxSamplerAnisotropy;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(mMipLevels);
+
+    VK_TEST(vkCreateSampler(mDevice.device(), &samplerInfo, CUSTOM_ALLOCATOR, &mImageSampler),
+      "Failed to create texture array sampler");
+  }
+} // namespace mv
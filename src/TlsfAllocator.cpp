@@ -0,0 +1,218 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace mv {
+
+namespace {
+constexpr std::uint64_t alignUp(std::uint64_t value,
+                                std::uint64_t alignment) noexcept {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+TlsfAllocator::TlsfAllocator(std::uint64_t size)
+    : mSize{size & ~(MIN_BLOCK_SIZE - 1)} {
+  assert(mSize >= MIN_BLOCK_SIZE && "TLSF range is too small");
+  for (auto &row : mFreeLists) {
+    row.fill(INVALID_BLOCK);
+  }
+
+  auto block = newBlock();
+  mBlocks[block].offset = 0;
+  mBlocks[block].size = mSize;
+  insertFree(block);
+}
+
+std::uint32_t TlsfAllocator::allocate(std::uint64_t size,
+                                      std::uint64_t alignment,
+                                      std::uint64_t &offset) {
+  assert((alignment & (alignment - 1)) == 0 &&
+         "TLSF alignment must be a power of two");
+  size = alignUp(std::max<std::uint64_t>(size, 1), MIN_BLOCK_SIZE);
+  alignment = std::max(alignment, MIN_BLOCK_SIZE);
+
+  // every offset is a multiple of MIN_BLOCK_SIZE, so at most
+  // alignment - MIN_BLOCK_SIZE bytes are lost to padding
+  auto block = findFree(size + alignment - MIN_BLOCK_SIZE);
+  if (block == INVALID_BLOCK) {
+    return INVALID_BLOCK;
+  }
+  removeFree(block);
+
+  auto padding = alignUp(mBlocks[block].offset, alignment) -
+                 mBlocks[block].offset;
+  if (padding > 0) {
+    auto aligned = split(block, padding);
+    insertFree(block);
+    block = aligned;
+  }
+  if (mBlocks[block].size - size >= MIN_BLOCK_SIZE) {
+    insertFree(split(block, size));
+  }
+
+  mUsed += mBlocks[block].size;
+  mAllocationCount++;
+  offset = mBlocks[block].offset;
+  return block;
+}
+
+void TlsfAllocator::free(std::uint32_t block) {
+  assert(block < mBlocks.size() && !mBlocks[block].free &&
+         "Invalid TLSF block");
+  mUsed -= mBlocks[block].size;
+  mAllocationCount--;
+
+  auto prev = mBlocks[block].prevPhysical;
+  if (prev != INVALID_BLOCK && mBlocks[prev].free) {
+    removeFree(prev);
+    mergeWithNext(prev);
+    block = prev;
+  }
+  auto next = mBlocks[block].nextPhysical;
+  if (next != INVALID_BLOCK && mBlocks[next].free) {
+    removeFree(next);
+    mergeWithNext(block);
+  }
+  insertFree(block);
+}
+
+std::uint32_t TlsfAllocator::freeBlockCount() const noexcept {
+  return static_cast<std::uint32_t>(
+      std::count_if(mBlocks.begin(), mBlocks.end(),
+                    [](const Block &block) { return block.free; }));
+}
+
+std::uint64_t TlsfAllocator::largestFreeBlock() const noexcept {
+  if (mFlBitmap == 0) {
+    return 0;
+  }
+  auto fl = 63u - static_cast<std::uint32_t>(std::countl_zero(mFlBitmap));
+  auto sl = 31u - static_cast<std::uint32_t>(std::countl_zero(mSlBitmaps[fl]));
+
+  std::uint64_t largest = 0;
+  for (auto block = mFreeLists[fl][sl]; block != INVALID_BLOCK;
+       block = mBlocks[block].nextFree) {
+    largest = std::max(largest, mBlocks[block].size);
+  }
+  return largest;
+}
+
+void TlsfAllocator::mapping(std::uint64_t size, std::uint32_t &fl,
+                            std::uint32_t &sl) noexcept {
+  assert(size >= MIN_BLOCK_SIZE);
+  fl = 63u - static_cast<std::uint32_t>(std::countl_zero(size));
+  sl = static_cast<std::uint32_t>(size >> (fl - SL_BITS)) ^ SL_COUNT;
+}
+
+std::uint32_t TlsfAllocator::findFree(std::uint64_t size) const noexcept {
+  // round up to the next list boundary so any block found is large enough
+  auto topBit = 63u - static_cast<std::uint32_t>(std::countl_zero(size));
+  size += (std::uint64_t{1} << (topBit - SL_BITS)) - 1;
+
+  std::uint32_t fl = 0;
+  std::uint32_t sl = 0;
+  mapping(size, fl, sl);
+
+  auto slMap = mSlBitmaps[fl] & (~0u << sl);
+  if (slMap == 0) {
+    auto flMap = fl + 1 < FL_COUNT ? mFlBitmap & (~std::uint64_t{0} << (fl + 1))
+                                   : 0;
+    if (flMap == 0) {
+      return INVALID_BLOCK;
+    }
+    fl = static_cast<std::uint32_t>(std::countr_zero(flMap));
+    slMap = mSlBitmaps[fl];
+  }
+  sl = static_cast<std::uint32_t>(std::countr_zero(slMap));
+  return mFreeLists[fl][sl];
+}
+
+void TlsfAllocator::insertFree(std::uint32_t block) noexcept {
+  std::uint32_t fl = 0;
+  std::uint32_t sl = 0;
+  mapping(mBlocks[block].size, fl, sl);
+
+  auto head = mFreeLists[fl][sl];
+  mBlocks[block].free = true;
+  mBlocks[block].prevFree = INVALID_BLOCK;
+  mBlocks[block].nextFree = head;
+  if (head != INVALID_BLOCK) {
+    mBlocks[head].prevFree = block;
+  }
+  mFreeLists[fl][sl] = block;
+  mSlBitmaps[fl] |= 1u << sl;
+  mFlBitmap |= std::uint64_t{1} << fl;
+}
+
+void TlsfAllocator::removeFree(std::uint32_t block) noexcept {
+  std::uint32_t fl = 0;
+  std::uint32_t sl = 0;
+  mapping(mBlocks[block].size, fl, sl);
+
+  auto prev = mBlocks[block].prevFree;
+  auto next = mBlocks[block].nextFree;
+  if (prev != INVALID_BLOCK) {
+    mBlocks[prev].nextFree = next;
+  }
+  if (next != INVALID_BLOCK) {
+    mBlocks[next].prevFree = prev;
+  }
+  if (mFreeLists[fl][sl] == block) {
+    mFreeLists[fl][sl] = next;
+    if (next == INVALID_BLOCK) {
+      mSlBitmaps[fl] &= ~(1u << sl);
+      if (mSlBitmaps[fl] == 0) {
+        mFlBitmap &= ~(std::uint64_t{1} << fl);
+      }
+    }
+  }
+  mBlocks[block].free = false;
+}
+
+std::uint32_t TlsfAllocator::split(std::uint32_t block, std::uint64_t size) {
+  auto rest = newBlock();
+  auto &original = mBlocks[block];
+  auto &remainder = mBlocks[rest];
+
+  remainder.offset = original.offset + size;
+  remainder.size = original.size - size;
+  remainder.prevPhysical = block;
+  remainder.nextPhysical = original.nextPhysical;
+  if (original.nextPhysical != INVALID_BLOCK) {
+    mBlocks[original.nextPhysical].prevPhysical = rest;
+  }
+  original.size = size;
+  original.nextPhysical = rest;
+  return rest;
+}
+
+void TlsfAllocator::mergeWithNext(std::uint32_t block) {
+  auto next = mBlocks[block].nextPhysical;
+  mBlocks[block].size += mBlocks[next].size;
+  mBlocks[block].nextPhysical = mBlocks[next].nextPhysical;
+  if (mBlocks[next].nextPhysical != INVALID_BLOCK) {
+    mBlocks[mBlocks[next].nextPhysical].prevPhysical = block;
+  }
+  releaseBlock(next);
+}
+
+std::uint32_t TlsfAllocator::newBlock() {
+  if (!mUnusedBlocks.empty()) {
+    auto block = mUnusedBlocks.back();
+    mUnusedBlocks.pop_back();
+    mBlocks[block] = {};
+    return block;
+  }
+  mBlocks.emplace_back();
+  return static_cast<std::uint32_t>(mBlocks.size() - 1);
+}
+
+void TlsfAllocator::releaseBlock(std::uint32_t block) {
+  mBlocks[block] = {};
+  mUnusedBlocks.push_back(block);
+}
+
+} // namespace mv
@@ -0,0 +1,390 @@
+#include "UploadQueue.h"
+#include "Device.h"
+#include "Log.h"
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace mv {
+
+namespace {
+// how often the worker polls the fences of submitted batches
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds{1};
+
+VkBufferMemoryBarrier bufferBarrier(VkBuffer buffer, VkDeviceSize offset,
+                                    VkDeviceSize size, std::uint32_t srcFamily,
+                                    std::uint32_t dstFamily,
+                                    VkAccessFlags srcAccess,
+                                    VkAccessFlags dstAccess) {
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = srcFamily;
+  barrier.dstQueueFamilyIndex = dstFamily;
+  barrier.buffer = buffer;
+  barrier.offset = offset;
+  barrier.size = size;
+  return barrier;
+}
+
+VkImageMemoryBarrier imageBarrier(VkImage image, std::uint32_t layerCount,
+                                  VkImageLayout oldLayout,
+                                  VkImageLayout newLayout,
+                                  std::uint32_t srcFamily,
+                                  std::uint32_t dstFamily,
+                                  VkAccessFlags srcAccess,
+                                  VkAccessFlags dstAccess) {
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = srcFamily;
+  barrier.dstQueueFamilyIndex = dstFamily;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layerCount;
+  return barrier;
+}
+
+// every image upload starts by moving the whole image to TRANSFER_DST
+void recordImagesToTransferDst(VkCommandBuffer commandBuffer,
+                               const std::vector<VkImage> &images,
+                               const std::vector<std::uint32_t> &layers) {
+  if (images.empty()) {
+    return;
+  }
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.reserve(images.size());
+  for (std::size_t i = 0; i < images.size(); i++) {
+    barriers.push_back(imageBarrier(
+        images[i], layers[i], VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+  }
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, static_cast<std::uint32_t>(barriers.size()),
+                       barriers.data());
+}
+} // namespace
+
+UploadQueue::UploadQueue(Device &device) : mDevice{device} {
+  auto indices = mDevice.findPhysicalQueueFamily();
+  mGraphicsFamily = indices.graphicsFamily.value();
+
+  if (mDevice.hasTransferQueue()) {
+    mTransferFamily = indices.transferFamily.value();
+    mRing = std::make_unique<StagingRing>(mDevice, mDevice.getTransferQueue(),
+                                          mTransferFamily);
+    mWorker = std::thread{&UploadQueue::workerLoop, this};
+    LOG("Uploads run on transfer queue family {}", mTransferFamily);
+  } else {
+    mTransferFamily = mGraphicsFamily;
+    LOG("No transfer-only queue family, uploads share the graphics queue");
+  }
+}
+
+UploadQueue::~UploadQueue() {
+  {
+    std::lock_guard lock{mMutex};
+    mStop = true;
+  }
+  mWake.notify_all();
+  if (mWorker.joinable()) {
+    mWorker.join();
+  }
+  // the ring waits for its in flight batches before it goes away
+  mRing.reset();
+}
+
+UploadTicket UploadQueue::uploadBuffer(VkBuffer dstBuffer, const void *data,
+                                       VkDeviceSize size,
+                                       VkDeviceSize dstOffset,
+                                       VkPipelineStageFlags dstStage,
+                                       VkAccessFlags dstAccess) {
+  Request request = {};
+  request.buffer = dstBuffer;
+  request.dstOffset = dstOffset;
+  request.dstStage = dstStage;
+  request.dstAccess = dstAccess;
+  request.data.resize(size);
+  std::memcpy(request.data.data(), data, size);
+  return push(std::move(request));
+}
+
+UploadTicket UploadQueue::uploadImage(VkImage image, const void *data,
+                                      VkDeviceSize size, std::uint32_t width,
+                                      std::uint32_t height,
+                                      std::uint32_t layerCount) {
+  Request request = {};
+  request.image = image;
+  request.width = width;
+  request.height = height;
+  request.layerCount = layerCount;
+  request.dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  request.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+  request.data.resize(size);
+  std::memcpy(request.data.data(), data, size);
+  return push(std::move(request));
+}
+
+void UploadQueue::cancel(UploadTicket ticket) {
+  std::unique_lock lock{mMutex};
+  auto pending =
+      std::find_if(mPending.begin(), mPending.end(),
+                   [ticket](const Request &r) { return r.ticket == ticket; });
+  if (pending != mPending.end()) {
+    mPending.erase(pending);
+    return;
+  }
+  if (!isAsync()) {
+    // already recorded into the graphics ring, the caller releases the
+    // destination through it
+    return;
+  }
+
+  mBatchDone.wait(lock, [&] { return !isTransferring(ticket); });
+  // finished transfers wait here for acquire() on this same thread, so the
+  // barrier is either dropped now or already in the graphics ring
+  std::erase_if(mCompleted,
+                [ticket](const Acquire &a) { return a.ticket == ticket; });
+}
+
+void UploadQueue::acquire(StagingRing &graphicsRing) {
+  if (!isAsync()) {
+    std::vector<Request> batch;
+    UploadTicket ready = 0;
+    {
+      std::lock_guard lock{mMutex};
+      batch.assign(std::make_move_iterator(mPending.begin()),
+                   std::make_move_iterator(mPending.end()));
+      mPending.clear();
+      ready = mNextTicket - 1;
+    }
+    recordDirect(graphicsRing, batch);
+    mReadyTicket.store(ready, std::memory_order_release);
+    return;
+  }
+
+  std::vector<Acquire> completed;
+  UploadTicket ready = 0;
+  {
+    std::lock_guard lock{mMutex};
+    completed.swap(mCompleted);
+    ready = mTransferredTicket;
+  }
+
+  if (!completed.empty()) {
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    VkPipelineStageFlags dstStages = 0;
+    for (const auto &acquire : completed) {
+      if (acquire.buffer != VK_NULL_HANDLE) {
+        bufferBarriers.push_back(
+            bufferBarrier(acquire.buffer, acquire.offset, acquire.size,
+                          mTransferFamily, mGraphicsFamily, 0,
+                          acquire.dstAccess));
+      } else {
+        imageBarriers.push_back(imageBarrier(
+            acquire.image, acquire.layerCount,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mTransferFamily,
+            mGraphicsFamily, 0, acquire.dstAccess));
+      }
+      dstStages |= acquire.dstStage;
+    }
+
+    // the transfer batch already finished on the host timeline, so the
+    // acquire does not need a semaphore wait, only the ownership transfer
+    vkCmdPipelineBarrier(
+        graphicsRing.commandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dstStages, 0, 0, nullptr,
+        static_cast<std::uint32_t>(bufferBarriers.size()),
+        bufferBarriers.data(), static_cast<std::uint32_t>(imageBarriers.size()),
+        imageBarriers.data());
+  }
+  mReadyTicket.store(ready, std::memory_order_release);
+}
+
+UploadTicket UploadQueue::push(Request request) {
+  UploadTicket ticket = 0;
+  {
+    std::lock_guard lock{mMutex};
+    ticket = mNextTicket++;
+    request.ticket = ticket;
+    mPending.push_back(std::move(request));
+  }
+  mWake.notify_one();
+  return ticket;
+}
+
+void UploadQueue::workerLoop() {
+  std::unique_lock lock{mMutex};
+  while (true) {
+    auto hasWork = [&] { return mStop || !mPending.empty(); };
+    if (mInFlight.empty()) {
+      mWake.wait(lock, hasWork);
+    } else {
+      mWake.wait_for(lock, POLL_INTERVAL, hasWork);
+    }
+    if (mStop) {
+      break;
+    }
+
+    if (!mPending.empty()) {
+      std::vector<Request> batch(std::make_move_iterator(mPending.begin()),
+                                 std::make_move_iterator(mPending.end()));
+      mPending.clear();
+      mRecordingFirst = batch.front().ticket;
+      mRecordingLast = batch.back().ticket;
+      lock.unlock();
+
+      InFlightBatch inFlight = {};
+      inFlight.firstTicket = batch.front().ticket;
+      inFlight.lastTicket = batch.back().ticket;
+      recordTransfer(batch, inFlight.acquires);
+      inFlight.serial = mRing->submit();
+
+      lock.lock();
+      mRecordingFirst = mRecordingLast = 0;
+      mInFlight.push_back(std::move(inFlight));
+    }
+
+    lock.unlock();
+    auto completed = mRing->completedSerial();
+    lock.lock();
+    retireBatches(completed);
+  }
+}
+
+void UploadQueue::recordTransfer(const std::vector<Request> &batch,
+                                 std::vector<Acquire> &acquires) {
+  std::vector<VkImage> images;
+  std::vector<std::uint32_t> layers;
+  for (const auto &request : batch) {
+    if (request.image != VK_NULL_HANDLE) {
+      images.push_back(request.image);
+      layers.push_back(request.layerCount);
+    }
+  }
+  recordImagesToTransferDst(mRing->commandBuffer(), images, layers);
+
+  std::vector<VkBufferMemoryBarrier> bufferReleases;
+  std::vector<VkImageMemoryBarrier> imageReleases;
+  for (const auto &request : batch) {
+    Acquire acquire = {};
+    acquire.ticket = request.ticket;
+    acquire.dstStage = request.dstStage;
+    acquire.dstAccess = request.dstAccess;
+
+    if (request.buffer != VK_NULL_HANDLE) {
+      mRing->uploadBuffer(request.buffer, request.data.data(),
+                          request.data.size(), request.dstOffset);
+      bufferReleases.push_back(bufferBarrier(
+          request.buffer, request.dstOffset, request.data.size(),
+          mTransferFamily, mGraphicsFamily, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+      acquire.buffer = request.buffer;
+      acquire.offset = request.dstOffset;
+      acquire.size = request.data.size();
+    } else {
+      mRing->uploadImage(request.image, request.data.data(),
+                         request.data.size(), request.width, request.height,
+                         request.layerCount);
+      imageReleases.push_back(imageBarrier(
+          request.image, request.layerCount,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mTransferFamily,
+          mGraphicsFamily, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+      acquire.image = request.image;
+      acquire.layerCount = request.layerCount;
+    }
+    acquires.push_back(acquire);
+  }
+
+  // one release for the whole batch; if the ring had to submit part of the
+  // batch early the barrier still orders after those copies on this queue
+  vkCmdPipelineBarrier(mRing->commandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                       static_cast<std::uint32_t>(bufferReleases.size()),
+                       bufferReleases.data(),
+                       static_cast<std::uint32_t>(imageReleases.size()),
+                       imageReleases.data());
+}
+
+void UploadQueue::recordDirect(StagingRing &ring,
+                               const std::vector<Request> &batch) {
+  std::vector<VkImage> images;
+  std::vector<std::uint32_t> layers;
+  for (const auto &request : batch) {
+    if (request.image != VK_NULL_HANDLE) {
+      images.push_back(request.image);
+      layers.push_back(request.layerCount);
+    }
+  }
+  if (!images.empty()) {
+    recordImagesToTransferDst(ring.commandBuffer(), images, layers);
+  }
+
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  for (const auto &request : batch) {
+    if (request.buffer != VK_NULL_HANDLE) {
+      // the ring's end of frame barrier makes buffer copies visible
+      ring.uploadBuffer(request.buffer, request.data.data(),
+                        request.data.size(), request.dstOffset);
+    } else {
+      ring.uploadImage(request.image, request.data.data(), request.data.size(),
+                       request.width, request.height, request.layerCount);
+      imageBarriers.push_back(imageBarrier(
+          request.image, request.layerCount,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_QUEUE_FAMILY_IGNORED,
+          VK_QUEUE_FAMILY_IGNORED, VK_ACCESS_TRANSFER_WRITE_BIT,
+          VK_ACCESS_SHADER_READ_BIT));
+    }
+  }
+
+  if (!imageBarriers.empty()) {
+    vkCmdPipelineBarrier(ring.commandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr,
+                         static_cast<std::uint32_t>(imageBarriers.size()),
+                         imageBarriers.data());
+  }
+}
+
+void UploadQueue::retireBatches(std::uint64_t completedSerial) {
+  bool retired = false;
+  while (!mInFlight.empty() && mInFlight.front().serial <= completedSerial) {
+    auto &batch = mInFlight.front();
+    mCompleted.insert(mCompleted.end(), batch.acquires.begin(),
+                      batch.acquires.end());
+    mTransferredTicket = batch.lastTicket;
+    mInFlight.pop_front();
+    retired = true;
+  }
+  if (retired) {
+    mBatchDone.notify_all();
+  }
+}
+
+bool UploadQueue::isTransferring(UploadTicket ticket) const noexcept {
+  if (ticket >= mRecordingFirst && ticket <= mRecordingLast) {
+    return true;
+  }
+  return std::any_of(mInFlight.begin(), mInFlight.end(),
+                     [ticket](const InFlightBatch &batch) {
+                       return ticket >= batch.firstTicket &&
+                              ticket <= batch.lastTicket;
+                     });
+}
+
+} // namespace mv
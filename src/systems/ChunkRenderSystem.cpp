@@ -0,0 +1,209 @@
+#include "systems/ChunkRenderSystem.h"
+#include "SwapChain.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace mv {
+
+ChunkRenderSystem::ChunkRenderSystem(Device &device, PipelineLibrary &pipelines,
+                                     VkRenderPass renderPass,
+                                     VkDescriptorSetLayout globalSetLayout,
+                                     const TextureArray &blockTextures)
+    : mDevice{device}, mPipelines{pipelines} {
+  createDrawBuffers();
+  createTextureSet(blockTextures);
+  createPipelineLayout(globalSetLayout);
+  createPipeline(renderPass);
+}
+
+ChunkRenderSystem::~ChunkRenderSystem() {
+  vkDestroyPipelineLayout(mDevice.device(), mPipelineLayout, CUSTOM_ALLOCATOR);
+}
+
+void ChunkRenderSystem::render(FrameInfo &frameInfo, ChunkMeshPool &meshPool,
+                               const std::vector<ChunkRenderObject> &chunks,
+                               const std::vector<std::uint32_t> &visible) {
+  auto drawCount = prepare(frameInfo, meshPool, chunks, visible);
+  record(frameInfo, meshPool, 0, drawCount);
+}
+
+std::uint32_t
+ChunkRenderSystem::prepare(FrameInfo &frameInfo, ChunkMeshPool &meshPool,
+                           const std::vector<ChunkRenderObject> &chunks,
+                           const std::vector<std::uint32_t> &visible) {
+  meshPool.nextFrame();
+
+  auto &drawBuffer = *mDrawBuffers[frameInfo.frameIndex];
+  auto &originBuffer = *mOriginBuffers[frameInfo.frameIndex];
+  auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(
+      drawBuffer.getMappedMemory());
+  auto *origins = static_cast<glm::vec4 *>(originBuffer.getMappedMemory());
+
+  std::uint32_t drawCount = 0;
+  for (auto chunkIdx : visible) {
+    const auto &chunk = chunks[chunkIdx];
+    // streamed meshes show up once their upload was acquired
+    if (!meshPool.isReady(chunk.mesh)) {
+      continue;
+    }
+    if (drawCount == MAX_DRAWS) {
+      WLOG("More than {} chunk draws, the rest is skipped", MAX_DRAWS);
+      break;
+    }
+
+    auto &command = commands[drawCount];
+    command.indexCount = chunk.mesh.indexCount;
+    command.instanceCount = 1;
+    command.firstIndex = chunk.mesh.firstIndex;
+    command.vertexOffset = chunk.mesh.vertexOffset;
+    command.firstInstance = drawCount;
+    origins[drawCount] = glm::vec4(chunk.origin, 0.0f);
+    drawCount++;
+  }
+  if (drawCount > 0) {
+    drawBuffer.flush(drawCount * sizeof(VkDrawIndexedIndirectCommand));
+    originBuffer.flush(drawCount * sizeof(glm::vec4));
+  }
+  return drawCount;
+}
+
+std::uint32_t ChunkRenderSystem::bucketCount(std::uint32_t drawCount,
+                                             std::uint32_t maxBuckets) const {
+  if (drawCount == 0 || mDevice.enabledFeatures.multiDrawIndirect) {
+    return 1;
+  }
+  auto buckets = (drawCount + MIN_BUCKET_DRAWS - 1) / MIN_BUCKET_DRAWS;
+  return std::clamp(buckets, 1u, std::max(maxBuckets, 1u));
+}
+
+void ChunkRenderSystem::record(FrameInfo &frameInfo,
+                               const ChunkMeshPool &meshPool,
+                               std::uint32_t firstDraw,
+                               std::uint32_t drawCount) {
+  if (drawCount == 0) {
+    return;
+  }
+  auto &drawBuffer = *mDrawBuffers[frameInfo.frameIndex];
+  const auto *commands = static_cast<const VkDrawIndexedIndirectCommand *>(
+      drawBuffer.getMappedMemory());
+
+  auto commandBuffer = frameInfo.commandBuffer;
+  mPipelines.get(mPipeline).bind(commandBuffer);
+
+  VkDescriptorSet sets[] = {frameInfo.frameDescriptorSet,
+                            mChunkSets[frameInfo.frameIndex], mTextureSet};
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          mPipelineLayout, 0, 3, sets, 0, nullptr);
+
+  VkBuffer vertexBuffers[] = {meshPool.vertexBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, meshPool.indexBuffer(), 0,
+                       VK_INDEX_TYPE_UINT32);
+
+  const auto &features = mDevice.enabledFeatures;
+  auto stride = static_cast<std::uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+  if (features.multiDrawIndirect) {
+    vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.getBuffer(),
+                             firstDraw * stride, drawCount, stride);
+  } else if (features.drawIndirectFirstInstance) {
+    for (auto i = firstDraw; i < firstDraw + drawCount; i++) {
+      vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.getBuffer(),
+                               i * stride, 1, stride);
+    }
+  } else {
+    // indirect draws would ignore firstInstance, issue the same commands
+    // directly instead
+    for (auto i = firstDraw; i < firstDraw + drawCount; i++) {
+      const auto &command = commands[i];
+      vkCmdDrawIndexed(commandBuffer, command.indexCount, 1, command.firstIndex,
+                       command.vertexOffset, command.firstInstance);
+    }
+  }
+}
+
+void ChunkRenderSystem::createDrawBuffers() {
+  mChunkSetLayout = std::make_unique<DescriptorSetLayout>(mDevice);
+  mChunkSetLayout->addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                              VK_SHADER_STAGE_VERTEX_BIT);
+  mChunkSetLayout->createDescriptorSetLayout();
+
+  mChunkPool = std::make_unique<DescriptorPool>(mDevice);
+  mChunkPool->setMaxSets(SwapChain::MAX_FRAME_IN_FLIGHT);
+  mChunkPool->addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                          SwapChain::MAX_FRAME_IN_FLIGHT);
+  mChunkPool->createDescriptorPool();
+
+  mDrawBuffers.resize(SwapChain::MAX_FRAME_IN_FLIGHT);
+  mOriginBuffers.resize(SwapChain::MAX_FRAME_IN_FLIGHT);
+  mChunkSets.resize(SwapChain::MAX_FRAME_IN_FLIGHT);
+  for (int i = 0; i < SwapChain::MAX_FRAME_IN_FLIGHT; i++) {
+    mDrawBuffers[i] = std::make_unique<Buffer>(
+        mDevice, sizeof(VkDrawIndexedIndirectCommand), MAX_DRAWS,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    mDrawBuffers[i]->map(VK_WHOLE_SIZE);
+
+    mOriginBuffers[i] = std::make_unique<Buffer>(
+        mDevice, sizeof(glm::vec4), MAX_DRAWS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    mOriginBuffers[i]->map(VK_WHOLE_SIZE);
+
+    auto bufferInfo = mOriginBuffers[i]->descriptorInfo(VK_WHOLE_SIZE);
+    DescriptorWriter writer = {*mChunkSetLayout, *mChunkPool};
+    writer.writeBuffer(0, &bufferInfo);
+    writer.build(mChunkSets[i]);
+  }
+}
+
+void ChunkRenderSystem::createTextureSet(const TextureArray &blockTextures) {
+  mTextureSetLayout = std::make_unique<DescriptorSetLayout>(mDevice);
+  mTextureSetLayout->addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                VK_SHADER_STAGE_FRAGMENT_BIT);
+  mTextureSetLayout->createDescriptorSetLayout();
+
+  // the array never changes, one set serves every frame in flight
+  mTexturePool = std::make_unique<DescriptorPool>(mDevice);
+  mTexturePool->setMaxSets(1);
+  mTexturePool->addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1);
+  mTexturePool->createDescriptorPool();
+
+  auto imageInfo = blockTextures.descriptorInfo();
+  DescriptorWriter writer = {*mTextureSetLayout, *mTexturePool};
+  writer.writeImage(0, &imageInfo);
+  writer.build(mTextureSet);
+}
+
+void ChunkRenderSystem::createPipelineLayout(
+    VkDescriptorSetLayout descriptorSetLayout) {
+  std::vector<VkDescriptorSetLayout> descriptors{
+      descriptorSetLayout, mChunkSetLayout->getDescriptorSetLayout(),
+      mTextureSetLayout->getDescriptorSetLayout()};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptors.size());
+  pipelineLayoutInfo.pSetLayouts = descriptors.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+  VK_TEST(vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo,
+                                 CUSTOM_ALLOCATOR, &mPipelineLayout),
+          "Failed to create pipeline layout")
+}
+
+void ChunkRenderSystem::createPipeline(VkRenderPass renderPass) {
+  auto pipelineConfig = std::make_unique<PipelineConfig>();
+  Pipeline::defaultPipelineConfig(*pipelineConfig);
+  pipelineConfig->bindingDescriptions = VoxelVertex::getBindingDescriptions();
+  pipelineConfig->attributeDescriptions =
+      VoxelVertex::getAttributeDescriptions();
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = mPipelineLayout;
+
+  mPipeline = mPipelines.add("shaders/voxel.vert.spv", "shaders/voxel.frag.spv",
+                             std::move(pipelineConfig));
+}
+} // namespace mv
@@ -5,9 +5,9 @@
 namespace mv {
 
 ModelTestRenderSystem::ModelTestRenderSystem(
-    Device &device, VkRenderPass renderPass,
+    Device &device, PipelineLibrary &pipelines, VkRenderPass renderPass,
     VkDescriptorSetLayout globalSetLayout)
-    : mDevice{device} {
+    : mDevice{device}, mPipelines{pipelines} {
   createPipelineLayout(globalSetLayout);
   createPipline(renderPass);
 }
@@ -17,7 +17,7 @@ ModelTestRenderSystem::~ModelTestRenderSystem() {
 }
 
 void ModelTestRenderSystem::render(FrameInfo &frameInfo) {
-  mPipeline->bind(frameInfo.commandBuffer);
+  mPipelines.get(mPipeline).bind(frameInfo.commandBuffer);
 
   vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                           VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0,
@@ -45,13 +45,12 @@ void ModelTestRenderSystem::createPipelineLayout(
 }
 
 void ModelTestRenderSystem::createPipline(VkRenderPass renderPass) {
-  PipelineConfig pipelineConfig;
-  Pipeline::defaultPipelineConfig(pipelineConfig);
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = mPipelineLayout;
-
-  mPipeline =
-      std::make_unique<Pipeline>(mDevice, "shaders/model.vert.spv",
-                                 "shaders/model.frag.spv", pipelineConfig);
+  auto pipelineConfig = std::make_unique<PipelineConfig>();
+  Pipeline::defaultPipelineConfig(*pipelineConfig);
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = mPipelineLayout;
+
+  mPipeline = mPipelines.add("shaders/model.vert.spv", "shaders/model.frag.spv",
+                             std::move(pipelineConfig));
 }
 } // namespace mv
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "world/BlockTextureRegistry.h"
+
+#include <cassert>
+
+namespace mv {
+
+void BlockTextureRegistry::assign(BlockId id, std::uint32_t face,
+                                  std::uint32_t layer) {
+  assert(face < FACE_COUNT);
+  auto idx = static_cast<std::size_t>(id) * FACE_COUNT + face;
+  if (idx >= mLayers.size()) {
+    mLayers.resize((static_cast<std::size_t>(id) + 1) * FACE_COUNT,
+                   DEFAULT_LAYER);
+  }
+  mLayers[idx] = layer;
+}
+
+void BlockTextureRegistry::assign(BlockId id, std::uint32_t layer) {
+  for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+    assign(id, face, layer);
+  }
+}
+
+void BlockTextureRegistry::assign(BlockId id, std::uint32_t top,
+                                  std::uint32_t bottom, std::uint32_t sides) {
+  assign(id, sides);
+  assign(id, FACE_POS_Y, top);
+  assign(id, FACE_NEG_Y, bottom);
+}
+
+} // namespace mv
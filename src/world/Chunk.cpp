@@ -0,0 +1,236 @@
+#include "world/Chunk.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace mv {
+
+Chunk::Chunk(BlockId fill) { this->fill(fill); }
+
+void Chunk::set(std::uint32_t idx, BlockId id) {
+  assert(idx < VOLUME);
+  if (mBits == 0) {
+    // uniform fast path; nothing to do when the block does not change
+    if (mPalette[0] == id) {
+      return;
+    }
+    resize(1);
+  }
+
+  auto oldEntry = readIndex(idx);
+  if (mPalette[oldEntry] == id) {
+    return;
+  }
+
+  auto newEntry = findOrAddEntry(id);
+  writeIndex(idx, newEntry);
+  mRefCounts[newEntry]++;
+
+  if (--mRefCounts[oldEntry] == 0) {
+    mLiveEntries--;
+    maybeShrink();
+  }
+}
+
+void Chunk::fill(BlockId id) {
+  mPalette.assign(1, id);
+  mRefCounts.assign(1, static_cast<std::uint16_t>(VOLUME));
+  mData.clear();
+  mData.shrink_to_fit();
+  mLiveEntries = 1;
+  setBits(0);
+}
+
+void Chunk::assign(std::vector<BlockId> palette,
+                   const std::uint16_t *indices) {
+  assert(!palette.empty());
+  if (palette.size() == 1) {
+    fill(palette[0]);
+    return;
+  }
+  mPalette = std::move(palette);
+  mRefCounts.assign(mPalette.size(), 0);
+  for (std::uint32_t i = 0; i < VOLUME; i++) {
+    assert(indices[i] < mPalette.size());
+    mRefCounts[indices[i]]++;
+  }
+  mLiveEntries = static_cast<std::uint32_t>(
+      std::count_if(mRefCounts.begin(), mRefCounts.end(),
+                    [](std::uint16_t count) { return count != 0; }));
+  setBits(requiredBits(static_cast<std::uint32_t>(mPalette.size())));
+  mData.assign(static_cast<std::size_t>(VOLUME) * mBits / 64, 0);
+  for (std::uint32_t i = 0; i < VOLUME; i++) {
+    writeIndex(i, indices[i]);
+  }
+}
+
+void Chunk::getColumn(int x, int z, BlockId *out) const noexcept {
+  if (mBits == 0) {
+    std::fill_n(out, SIZE, mPalette[0]);
+    return;
+  }
+
+  // a column is SIZE consecutive indices, so whole words decode in sequence
+  auto idx = index(x, 0, z);
+  const auto *word = &mData[idx >> mValuesPerWordShift];
+  auto valuesPerWord = mValuesPerWordMask + 1;
+  for (int y = 0; y < SIZE; word++) {
+    auto bits = *word >> ((idx & mValuesPerWordMask) * mBits);
+    for (auto i = idx & mValuesPerWordMask; i < valuesPerWord && y < SIZE;
+         i++, y++, bits >>= mBits) {
+      out[y] = mPalette[bits & mIndexMask];
+    }
+    idx = 0;
+  }
+}
+
+void Chunk::compact() {
+  if (mBits == 0) {
+    return;
+  }
+
+  if (mLiveEntries == 1) {
+    for (std::size_t i = 0; i < mPalette.size(); i++) {
+      if (mRefCounts[i] != 0) {
+        fill(mPalette[i]);
+        return;
+      }
+    }
+  }
+
+  std::vector<std::uint32_t> remap(mPalette.size(), 0);
+  std::vector<BlockId> palette;
+  std::vector<std::uint16_t> refCounts;
+  palette.reserve(mLiveEntries);
+  refCounts.reserve(mLiveEntries);
+  for (std::size_t i = 0; i < mPalette.size(); i++) {
+    if (mRefCounts[i] != 0) {
+      remap[i] = static_cast<std::uint32_t>(palette.size());
+      palette.push_back(mPalette[i]);
+      refCounts.push_back(mRefCounts[i]);
+    }
+  }
+
+  repack(requiredBits(mLiveEntries), remap);
+
+  mPalette = std::move(palette);
+  mRefCounts = std::move(refCounts);
+}
+
+std::size_t Chunk::memoryUsage() const noexcept {
+  return sizeof(Chunk) + mPalette.capacity() * sizeof(BlockId) +
+         mRefCounts.capacity() * sizeof(std::uint16_t) +
+         mData.capacity() * sizeof(std::uint64_t);
+}
+
+ChunkStats Chunk::stats() const noexcept {
+  ChunkStats stats = {};
+  stats.bitsPerBlock = mBits;
+  stats.paletteSize = paletteSize();
+  stats.liveEntries = mLiveEntries;
+  stats.memoryUsage = memoryUsage();
+  return stats;
+}
+
+std::uint32_t Chunk::findOrAddEntry(BlockId id) {
+  auto freeEntry = static_cast<std::uint32_t>(mPalette.size());
+  for (std::uint32_t i = 0; i < mPalette.size(); i++) {
+    if (mPalette[i] == id) {
+      if (mRefCounts[i] == 0) {
+        mLiveEntries++;
+      }
+      return i;
+    }
+    if (mRefCounts[i] == 0 && freeEntry == mPalette.size()) {
+      freeEntry = i;
+    }
+  }
+
+  mLiveEntries++;
+  if (freeEntry < mPalette.size()) {
+    mPalette[freeEntry] = id;
+    return freeEntry;
+  }
+
+  if (mPalette.size() >= (std::size_t{1} << mBits)) {
+    resize(mBits * 2);
+  }
+  mPalette.push_back(id);
+  mRefCounts.push_back(0);
+  return freeEntry;
+}
+
+void Chunk::resize(std::uint32_t bits) {
+  assert(bits > mBits && bits <= 16);
+
+  if (mBits == 0) {
+    setBits(bits);
+    // every block points at palette entry 0
+    mData.assign(static_cast<std::size_t>(VOLUME) * mBits / 64, 0);
+    return;
+  }
+  repack(bits, {});
+}
+
+void Chunk::repack(std::uint32_t bits,
+                   const std::vector<std::uint32_t> &remap) {
+  auto oldData = std::move(mData);
+  auto oldBits = mBits;
+  auto oldShift = mValuesPerWordShift;
+  auto oldMask = mValuesPerWordMask;
+  auto oldIndexMask = mIndexMask;
+
+  setBits(bits);
+  mData.assign(static_cast<std::size_t>(VOLUME) * mBits / 64, 0);
+  for (std::uint32_t i = 0; i < VOLUME; i++) {
+    auto word = oldData[i >> oldShift];
+    auto entry = static_cast<std::uint32_t>(
+        (word >> ((i & oldMask) * oldBits)) & oldIndexMask);
+    writeIndex(i, remap.empty() ? entry : remap[entry]);
+  }
+}
+
+void Chunk::setBits(std::uint32_t bits) noexcept {
+  mBits = bits;
+  if (bits == 0) {
+    mValuesPerWordShift = 0;
+    mValuesPerWordMask = 0;
+    mIndexMask = 0;
+    return;
+  }
+
+  auto valuesPerWord = 64u / bits;
+  mValuesPerWordShift =
+      static_cast<std::uint32_t>(std::countr_zero(valuesPerWord));
+  mValuesPerWordMask = valuesPerWord - 1;
+  mIndexMask = (std::uint64_t{1} << bits) - 1;
+}
+
+void Chunk::maybeShrink() {
+  // shrink only once the palette fits into half the current width so a block
+  // toggled back and forth does not repack the section on every edit
+  if (mLiveEntries == 1 || requiredBits(mLiveEntries) <= mBits / 2) {
+    compact();
+  }
+}
+
+std::uint32_t Chunk::requiredBits(std::uint32_t entries) noexcept {
+  if (entries <= 1) {
+    return 0;
+  }
+  if (entries <= 2) {
+    return 1;
+  }
+  if (entries <= 4) {
+    return 2;
+  }
+  if (entries <= 16) {
+    return 4;
+  }
+  if (entries <= 256) {
+    return 8;
+  }
+  return 16;
+}
+
+} // namespace mv
@@ -0,0 +1,311 @@
+#include "world/ChunkCodec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace mv {
+namespace chunk_codec {
+
+namespace {
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t MAX_OFFSET = 0xffff;
+constexpr int HASH_BITS = 12;
+// token nibbles at this value continue in 255-summing extension bytes
+constexpr std::size_t NIBBLE_MAX = 15;
+// runs of one block and a palette of every block, with slack for varints
+constexpr std::size_t MAX_TRANSFORMED_SIZE =
+    static_cast<std::size_t>(Chunk::VOLUME) * 10;
+
+thread_local std::vector<std::uint8_t> tBytes;
+thread_local std::vector<std::uint16_t> tIndices;
+
+void writeVarint(std::vector<std::uint8_t> &out, std::uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// false on a truncated or overlong varint
+bool readVarint(const std::uint8_t *&data, const std::uint8_t *end,
+                std::uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (data == end) {
+      return false;
+    }
+    auto byte = *data++;
+    value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::uint32_t zigzag(std::int32_t value) {
+  return (static_cast<std::uint32_t>(value) << 1) ^
+         static_cast<std::uint32_t>(value >> 31);
+}
+
+std::int32_t unzigzag(std::uint32_t value) {
+  return static_cast<std::int32_t>(value >> 1) ^
+         -static_cast<std::int32_t>(value & 1);
+}
+
+std::uint32_t read32(const std::uint8_t *p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash32(std::uint32_t value) {
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<std::uint8_t> &out, std::size_t length) {
+  for (; length >= 255; length -= 255) {
+    out.push_back(255);
+  }
+  out.push_back(static_cast<std::uint8_t>(length));
+}
+
+bool readLength(const std::uint8_t *&data, const std::uint8_t *end,
+                std::size_t &length) {
+  std::uint8_t byte;
+  do {
+    if (data == end) {
+      return false;
+    }
+    byte = *data++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// literals followed by a match, or only literals when matchLength is 0
+void writeSequence(std::vector<std::uint8_t> &out,
+                   const std::uint8_t *literals, std::size_t literalCount,
+                   std::size_t offset, std::size_t matchLength) {
+  auto matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+  out.push_back(static_cast<std::uint8_t>(
+      std::min(literalCount, NIBBLE_MAX) << 4 |
+      std::min(matchCode, NIBBLE_MAX)));
+  if (literalCount >= NIBBLE_MAX) {
+    writeLength(out, literalCount - NIBBLE_MAX);
+  }
+  out.insert(out.end(), literals, literals + literalCount);
+  if (matchLength == 0) {
+    return;
+  }
+  out.push_back(static_cast<std::uint8_t>(offset));
+  out.push_back(static_cast<std::uint8_t>(offset >> 8));
+  if (matchCode >= NIBBLE_MAX) {
+    writeLength(out, matchCode - NIBBLE_MAX);
+  }
+}
+
+// runs of palette indices in Chunk::index order, then the palette
+void transform(const Chunk &chunk, std::vector<std::uint8_t> &out) {
+  std::vector<BlockId> palette;
+  BlockId blocks[Chunk::SIZE];
+  std::uint32_t runIndex = 0;
+  std::uint32_t runLength = 0;
+  BlockId runBlock = 0;
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int z = 0; z < Chunk::SIZE; z++) {
+      chunk.getColumn(x, z, blocks);
+      for (auto block : blocks) {
+        if (runLength > 0 && block == runBlock) {
+          runLength++;
+          continue;
+        }
+        if (runLength > 0) {
+          writeVarint(out, runIndex);
+          writeVarint(out, runLength - 1);
+        }
+        auto it = std::find(palette.begin(), palette.end(), block);
+        if (it == palette.end()) {
+          it = palette.insert(it, block);
+        }
+        runIndex = static_cast<std::uint32_t>(it - palette.begin());
+        runBlock = block;
+        runLength = 1;
+      }
+    }
+  }
+  writeVarint(out, runIndex);
+  writeVarint(out, runLength - 1);
+
+  writeVarint(out, static_cast<std::uint32_t>(palette.size()));
+  std::int32_t previous = 0;
+  for (auto id : palette) {
+    writeVarint(out, zigzag(static_cast<std::int32_t>(id) - previous));
+    previous = id;
+  }
+}
+
+bool untransform(const std::uint8_t *data, const std::uint8_t *end,
+                 Chunk &chunk) {
+  tIndices.resize(Chunk::VOLUME);
+  std::uint32_t filled = 0;
+  std::uint32_t maxIndex = 0;
+  while (filled < Chunk::VOLUME) {
+    std::uint32_t index;
+    std::uint32_t length;
+    if (!readVarint(data, end, index) || !readVarint(data, end, length) ||
+        length >= Chunk::VOLUME - filled) {
+      return false;
+    }
+    maxIndex = std::max(maxIndex, index);
+    if (maxIndex >= Chunk::VOLUME) {
+      return false;
+    }
+    std::fill_n(tIndices.begin() + filled, length + 1,
+                static_cast<std::uint16_t>(index));
+    filled += length + 1;
+  }
+
+  std::uint32_t paletteSize;
+  if (!readVarint(data, end, paletteSize) || paletteSize <= maxIndex ||
+      paletteSize > Chunk::VOLUME) {
+    return false;
+  }
+  std::vector<BlockId> palette(paletteSize);
+  std::int32_t previous = 0;
+  for (auto &id : palette) {
+    std::uint32_t delta;
+    if (!readVarint(data, end, delta)) {
+      return false;
+    }
+    auto value = static_cast<std::int64_t>(previous) + unzigzag(delta);
+    if (value < 0 || value > std::numeric_limits<BlockId>::max()) {
+      return false;
+    }
+    id = static_cast<BlockId>(value);
+    previous = id;
+  }
+  if (data != end) {
+    return false;
+  }
+  auto sorted = palette;
+  std::sort(sorted.begin(), sorted.end());
+  if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+    return false;
+  }
+  chunk.assign(std::move(palette), tIndices.data());
+  return true;
+}
+} // namespace
+
+void encode(const Chunk &chunk, std::vector<std::uint8_t> &out) {
+  tBytes.clear();
+  transform(chunk, tBytes);
+  out.push_back(FORMAT);
+  writeVarint(out, static_cast<std::uint32_t>(tBytes.size()));
+  compress(tBytes.data(), tBytes.size(), out);
+}
+
+bool decode(const std::uint8_t *data, std::size_t size, Chunk &chunk) {
+  const auto *end = data + size;
+  std::uint32_t transformedSize;
+  if (size == 0 || *data++ != FORMAT ||
+      !readVarint(data, end, transformedSize) ||
+      transformedSize > MAX_TRANSFORMED_SIZE) {
+    return false;
+  }
+  tBytes.resize(transformedSize);
+  return decompress(data, static_cast<std::size_t>(end - data), tBytes.data(),
+                    tBytes.size()) &&
+         untransform(tBytes.data(), tBytes.data() + tBytes.size(), chunk);
+}
+
+void compress(const std::uint8_t *data, std::size_t size,
+              std::vector<std::uint8_t> &out) {
+  // positions of recent 4 byte sequences; a stale or colliding entry only
+  // costs the compare
+  std::array<std::uint32_t, std::size_t{1} << HASH_BITS> table = {};
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (pos + MIN_MATCH <= size) {
+    auto sequence = read32(data + pos);
+    auto &slot = table[hash32(sequence)];
+    std::size_t candidate = slot;
+    slot = static_cast<std::uint32_t>(pos);
+    if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+        read32(data + candidate) != sequence) {
+      pos++;
+      continue;
+    }
+    auto length = MIN_MATCH;
+    while (pos + length < size &&
+           data[candidate + length] == data[pos + length]) {
+      length++;
+    }
+    writeSequence(out, data + anchor, pos - anchor, pos - candidate, length);
+    pos += length;
+    anchor = pos;
+    // lets the next match start right behind this one
+    if (pos + 2 <= size) {
+      table[hash32(read32(data + pos - 2))] =
+          static_cast<std::uint32_t>(pos - 2);
+    }
+  }
+  if (anchor < size || size == 0) {
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+  }
+}
+
+bool decompress(const std::uint8_t *data, std::size_t size,
+                std::uint8_t *out, std::size_t outSize) {
+  const auto *end = data + size;
+  std::size_t written = 0;
+  while (data < end) {
+    auto token = *data++;
+    std::size_t literals = token >> 4;
+    if (literals == NIBBLE_MAX && !readLength(data, end, literals)) {
+      return false;
+    }
+    if (literals > static_cast<std::size_t>(end - data) ||
+        literals > outSize - written) {
+      return false;
+    }
+    std::copy_n(data, literals, out + written);
+    data += literals;
+    written += literals;
+    if (data == end) {
+      break;
+    }
+
+    if (end - data < 2) {
+      return false;
+    }
+    std::size_t offset = data[0] | std::size_t{data[1]} << 8;
+    data += 2;
+    std::size_t length = token & 0xf;
+    if (length == NIBBLE_MAX && !readLength(data, end, length)) {
+      return false;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > written || length > outSize - written) {
+      return false;
+    }
+    const auto *from = out + written - offset;
+    if (offset >= length) {
+      std::memcpy(out + written, from, length);
+    } else {
+      // overlapping copies repeat the last offset bytes
+      for (std::size_t i = 0; i < length; i++) {
+        out[written + i] = from[i];
+      }
+    }
+    written += length;
+  }
+  return written == outSize;
+}
+
+} // namespace chunk_codec
+} // namespace mv
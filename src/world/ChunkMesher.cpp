@@ -0,0 +1,362 @@
+#include "world/ChunkMesher.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <limits>
+
+namespace mv {
+
+namespace {
+constexpr std::uint16_t NO_SLOT = std::numeric_limits<std::uint16_t>::max();
+// one face plane holds a 32 bit row per v for every slice
+constexpr std::size_t PLANE_WORDS = Chunk::SIZE * Chunk::SIZE;
+constexpr std::size_t SLOT_WORDS = FACE_COUNT * PLANE_WORDS;
+} // namespace
+
+ChunkMesher::ChunkMesher(MesherBackend backend, ChunkVertexFormat format)
+    : mBackend{backend}, mFormat{format},
+      mBlocks(PADDED_SIZE * PADDED_SIZE * PADDED_SIZE, block::AIR),
+      mMask(Chunk::AREA, block::AIR),
+      mColumns(3 * PADDED_SIZE * PADDED_SIZE, 0),
+      mBlockSlots(std::numeric_limits<BlockId>::max() + 1, NO_SLOT) {}
+
+void ChunkMesher::mesh(const Chunk &chunk, const ChunkNeighbours &neighbours,
+                       ChunkMesh &out) {
+  auto start = std::chrono::high_resolution_clock::now();
+  out.clear();
+
+  if (!chunk.isEmpty()) {
+    gatherBlocks(chunk, neighbours);
+    switch (mBackend) {
+    case MesherBackend::Greedy:
+      meshGreedy(out);
+      break;
+    case MesherBackend::BinaryGreedy:
+      meshBinary(out);
+      break;
+    }
+  }
+  out.visibility = mVisibility.compute(chunk);
+
+  out.stats.triangles = out.stats.quads * 2;
+  out.stats.vertexBytes = out.vertices.size() * sizeof(Vertex) +
+                          out.packedVertices.size() * sizeof(VoxelVertex);
+  out.stats.meshTimeMs = std::chrono::duration<double, std::milli>(
+                             std::chrono::high_resolution_clock::now() - start)
+                             .count();
+}
+
+void ChunkMesher::logStats(const ChunkMeshStats &stats) {
+  LOG("Chunk mesh: {} quads ({} naive), {} triangles, {} KiB vertices, "
+      "{:.3f} ms",
+      stats.quads, stats.naiveQuads, stats.triangles, stats.vertexBytes / 1024,
+      stats.meshTimeMs);
+}
+
+void ChunkMesher::gatherBlocks(const Chunk &chunk,
+                               const ChunkNeighbours &neighbours) {
+  constexpr int S = Chunk::SIZE;
+  std::fill(mBlocks.begin(), mBlocks.end(), block::AIR);
+
+  for (int x = 0; x < S; x++) {
+    for (int z = 0; z < S; z++) {
+      chunk.getColumn(x, z, &mBlocks[paddedIndex(x, 0, z)]);
+    }
+  }
+
+  // one layer from each face neighbour; edges and corners stay air
+  for (int a = 0; a < S; a++) {
+    for (int b = 0; b < S; b++) {
+      if (auto *n = neighbours[FACE_NEG_X]) {
+        mBlocks[paddedIndex(-1, a, b)] = n->get(S - 1, a, b);
+      }
+      if (auto *n = neighbours[FACE_POS_X]) {
+        mBlocks[paddedIndex(S, a, b)] = n->get(0, a, b);
+      }
+      if (auto *n = neighbours[FACE_NEG_Y]) {
+        mBlocks[paddedIndex(a, -1, b)] = n->get(a, S - 1, b);
+      }
+      if (auto *n = neighbours[FACE_POS_Y]) {
+        mBlocks[paddedIndex(a, S, b)] = n->get(a, 0, b);
+      }
+      if (auto *n = neighbours[FACE_NEG_Z]) {
+        mBlocks[paddedIndex(a, b, -1)] = n->get(a, b, S - 1);
+      }
+      if (auto *n = neighbours[FACE_POS_Z]) {
+        mBlocks[paddedIndex(a, b, S)] = n->get(a, b, 0);
+      }
+    }
+  }
+}
+
+void ChunkMesher::meshGreedy(ChunkMesh &out) {
+  constexpr int S = Chunk::SIZE;
+
+  for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+    int d = static_cast<int>(face / 2);
+    int u = (d + 1) % 3;
+    int v = (d + 2) % 3;
+    // padded array strides of the x, y and z axes
+    const int strides[3] = {PADDED_SIZE * PADDED_SIZE, 1, PADDED_SIZE};
+    int neighbourOffset = (face & 1) ? strides[d] : -strides[d];
+
+    for (int slice = 0; slice < S; slice++) {
+      // mask of visible faces on this slice, 0 (air) where there is none
+      auto sliceBase =
+          static_cast<int>(paddedIndex(0, 0, 0)) + slice * strides[d];
+      for (int j = 0; j < S; j++) {
+        auto rowBase = sliceBase + j * strides[v];
+        for (int i = 0; i < S; i++) {
+          auto idx = rowBase + i * strides[u];
+          auto id = mBlocks[idx];
+          auto neighbour = mBlocks[idx + neighbourOffset];
+
+          bool visible = block::isOpaque(id) && !block::isOpaque(neighbour);
+          mMask[j * S + i] = visible ? id : block::AIR;
+          out.stats.naiveQuads += visible ? 1 : 0;
+        }
+      }
+
+      for (int j = 0; j < S; j++) {
+        for (int i = 0; i < S;) {
+          auto id = mMask[j * S + i];
+          if (id == block::AIR) {
+            i++;
+            continue;
+          }
+
+          int width = 1;
+          while (i + width < S && mMask[j * S + i + width] == id) {
+            width++;
+          }
+
+          int height = 1;
+          for (; j + height < S; height++) {
+            auto *row = &mMask[(j + height) * S + i];
+            if (!std::all_of(row, row + width,
+                             [id](BlockId other) { return other == id; })) {
+              break;
+            }
+          }
+
+          for (int h = 0; h < height; h++) {
+            std::fill_n(&mMask[(j + h) * S + i], width, block::AIR);
+          }
+
+          if (mFormat == ChunkVertexFormat::Packed) {
+            mesher_helper::emitPackedQuad(out, face, slice, i, j, width,
+                                          height, textureLayer(id, face));
+          } else {
+            mesher_helper::emitQuad(out, face, slice, i, j, width, height, id);
+          }
+          i += width;
+        }
+      }
+    }
+  }
+}
+
+void ChunkMesher::meshBinary(ChunkMesh &out) {
+  constexpr int S = Chunk::SIZE;
+  constexpr int P = PADDED_SIZE;
+
+  // occupancy columns: bit i of column [d][v][u] is set when the padded voxel
+  // at coordinate i along axis d is opaque
+  std::fill(mColumns.begin(), mColumns.end(), 0);
+  for (int x = 0; x < P; x++) {
+    for (int z = 0; z < P; z++) {
+      const auto *column = &mBlocks[(x * P + z) * P];
+      std::uint64_t columnY = 0;
+      for (int y = 0; y < P; y++) {
+        auto opaque = static_cast<std::uint64_t>(block::isOpaque(column[y]));
+        columnY |= opaque << y;
+        mColumns[(0 * P + z) * P + y] |= opaque << x;
+        mColumns[(2 * P + y) * P + x] |= opaque << z;
+      }
+      mColumns[(1 * P + x) * P + z] = columnY;
+    }
+  }
+
+  // face culling: a voxel shows its -d face when the voxel below it along d
+  // is empty, which for a whole column is col & ~(col << 1)
+  for (int d = 0; d < 3; d++) {
+    int axisU = (d + 1) % 3;
+    int axisV = (d + 2) % 3;
+    for (int v = 0; v < S; v++) {
+      for (int u = 0; u < S; u++) {
+        auto column = mColumns[(d * P + v + 1) * P + u + 1];
+        const std::uint64_t faces[2] = {column & ~(column << 1),
+                                        column & ~(column >> 1)};
+
+        for (std::uint32_t dir = 0; dir < 2; dir++) {
+          auto face = static_cast<std::uint32_t>(d * 2) + dir;
+          // drop the padding bit on both ends
+          auto bits = static_cast<std::uint32_t>(faces[dir] >> 1);
+          out.stats.naiveQuads += std::popcount(bits);
+
+          for (; bits != 0; bits &= bits - 1) {
+            int slice = std::countr_zero(bits);
+            int pos[3] = {};
+            pos[d] = slice;
+            pos[axisU] = u;
+            pos[axisV] = v;
+            auto slot = blockSlot(mBlocks[paddedIndex(pos[0], pos[1], pos[2])]);
+
+            mPlanes[slot * SLOT_WORDS + face * PLANE_WORDS + slice * S + v] |=
+                1u << u;
+            mUsedSlices[slot * FACE_COUNT + face] |= 1u << slice;
+          }
+        }
+      }
+    }
+  }
+
+  // greedy merge on each 32x32 plane: take the lowest run of set bits in a
+  // row, then grow it over the following rows while they contain the run
+  for (std::size_t slot = 0; slot < mSlotBlocks.size(); slot++) {
+    auto id = mSlotBlocks[slot];
+    for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+      auto &usedSlices = mUsedSlices[slot * FACE_COUNT + face];
+      for (; usedSlices != 0; usedSlices &= usedSlices - 1) {
+        int slice = std::countr_zero(usedSlices);
+        auto *plane =
+            &mPlanes[slot * SLOT_WORDS + face * PLANE_WORDS + slice * S];
+
+        for (int row = 0; row < S; row++) {
+          for (auto bits = plane[row]; bits != 0;) {
+            int start = std::countr_zero(bits);
+            int width = std::countr_one(bits >> start);
+            auto run = width == 32 ? ~0u : ((1u << width) - 1) << start;
+            bits &= ~run;
+
+            int height = 1;
+            while (row + height < S && (plane[row + height] & run) == run) {
+              plane[row + height] &= ~run;
+              height++;
+            }
+
+            if (mFormat == ChunkVertexFormat::Packed) {
+              mesher_helper::emitPackedQuad(out, face, slice, start, row,
+                                            width, height,
+                                            textureLayer(id, face));
+            } else {
+              mesher_helper::emitQuad(out, face, slice, start, row, width,
+                                      height, id);
+            }
+          }
+          plane[row] = 0;
+        }
+      }
+    }
+    mBlockSlots[id] = NO_SLOT;
+  }
+  mSlotBlocks.clear();
+}
+
+std::uint32_t ChunkMesher::blockSlot(BlockId id) {
+  auto slot = mBlockSlots[id];
+  if (slot != NO_SLOT) {
+    return slot;
+  }
+
+  slot = static_cast<std::uint16_t>(mSlotBlocks.size());
+  mBlockSlots[id] = slot;
+  mSlotBlocks.push_back(id);
+  // planes are left zeroed by the merge, so they only grow here
+  if (mPlanes.size() < mSlotBlocks.size() * SLOT_WORDS) {
+    mPlanes.resize(mSlotBlocks.size() * SLOT_WORDS, 0);
+    mUsedSlices.resize(mSlotBlocks.size() * FACE_COUNT, 0);
+  }
+  return slot;
+}
+
+namespace mesher_helper {
+namespace {
+void emitQuadIndices(ChunkMesh &mesh, uint32_t base, bool positive) {
+  // u x v points along +d, so 0-1-2 is counter-clockwise seen from +d
+  auto indexOffset = mesh.indices.size();
+  mesh.indices.resize(indexOffset + 6);
+  auto *index = &mesh.indices[indexOffset];
+  if (positive) {
+    index[0] = base, index[1] = base + 1, index[2] = base + 2;
+    index[3] = base, index[4] = base + 2, index[5] = base + 3;
+  } else {
+    index[0] = base, index[1] = base + 2, index[2] = base + 1;
+    index[3] = base, index[4] = base + 3, index[5] = base + 2;
+  }
+}
+} // namespace
+
+glm::vec3 blockColor(BlockId id) noexcept {
+  switch (id) {
+  case block::STONE:
+    return {0.5f, 0.5f, 0.5f};
+  case block::DIRT:
+    return {0.45f, 0.3f, 0.15f};
+  case block::GRASS:
+    return {0.3f, 0.65f, 0.2f};
+  default:
+    return {1.0f, 1.0f, 1.0f};
+  }
+}
+
+void emitQuad(ChunkMesh &mesh, std::uint32_t face, int slice, int u, int v,
+              int width, int height, BlockId id) {
+  int d = static_cast<int>(face / 2);
+  int axisU = (d + 1) % 3;
+  int axisV = (d + 2) % 3;
+  bool positive = (face & 1) != 0;
+
+  glm::vec3 normal = {};
+  normal[d] = positive ? 1.0f : -1.0f;
+  auto color = blockColor(id);
+
+  auto base = static_cast<uint32_t>(mesh.vertices.size());
+  mesh.vertices.resize(base + 4);
+  auto *vertex = &mesh.vertices[base];
+  const int corners[4][2] = {{0, 0}, {width, 0}, {width, height}, {0, height}};
+  for (const auto &corner : corners) {
+    vertex->position[d] = static_cast<float>(positive ? slice + 1 : slice);
+    vertex->position[axisU] = static_cast<float>(u + corner[0]);
+    vertex->position[axisV] = static_cast<float>(v + corner[1]);
+    vertex->color = color;
+    vertex->normal = normal;
+    // one texture repeat per block
+    vertex->uv = {static_cast<float>(corner[0]), static_cast<float>(corner[1])};
+    vertex++;
+  }
+
+  emitQuadIndices(mesh, base, positive);
+  mesh.stats.quads++;
+}
+
+void emitPackedQuad(ChunkMesh &mesh, std::uint32_t face, int slice, int u,
+                    int v, int width, int height, std::uint32_t layer) {
+  int d = static_cast<int>(face / 2);
+  int axisU = (d + 1) % 3;
+  int axisV = (d + 2) % 3;
+  bool positive = (face & 1) != 0;
+
+  auto base = static_cast<uint32_t>(mesh.packedVertices.size());
+  mesh.packedVertices.resize(base + 4);
+  auto *vertex = &mesh.packedVertices[base];
+  const int corners[4][2] = {{0, 0}, {width, 0}, {width, height}, {0, height}};
+  for (const auto &corner : corners) {
+    std::uint32_t pos[3] = {};
+    pos[d] = static_cast<std::uint32_t>(positive ? slice + 1 : slice);
+    pos[axisU] = static_cast<std::uint32_t>(u + corner[0]);
+    pos[axisV] = static_cast<std::uint32_t>(v + corner[1]);
+    // no occlusion and full light until AO and lighting are computed
+    *vertex++ =
+        VoxelVertex::pack(pos[0], pos[1], pos[2], face, 3, layer, 15, 0);
+  }
+
+  emitQuadIndices(mesh, base, positive);
+  mesh.stats.quads++;
+}
+} // namespace mesher_helper
+
+} // namespace mv
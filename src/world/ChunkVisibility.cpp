@@ -0,0 +1,118 @@
+#include "world/ChunkVisibility.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace mv {
+
+namespace {
+constexpr int S = Chunk::SIZE;
+static_assert(S == 32, "a column of open blocks must fit in 32 bits");
+
+constexpr std::uint32_t BORDER_BITS = 1u | (1u << (S - 1));
+
+// the run of set bits in mask containing bit y, which must be set
+std::uint32_t runAround(std::uint32_t mask, int y) noexcept {
+  auto above = std::countr_one(mask >> y);
+  auto below = std::countl_one(mask << (S - 1 - y));
+  auto width = above + below - 1;
+  auto start = y - below + 1;
+  return width >= S ? ~0u : ((1u << width) - 1u) << start;
+}
+} // namespace
+
+ChunkVisibilityBuilder::ChunkVisibilityBuilder()
+    : mOpen(Chunk::AREA, 0), mVisited(Chunk::AREA, 0) {
+  mStack.reserve(Chunk::AREA);
+}
+
+ChunkVisibility ChunkVisibilityBuilder::compute(const Chunk &chunk) {
+  if (chunk.isUniform()) {
+    return block::isOpaque(chunk.palette()[0]) ? ChunkVisibility::none()
+                                               : ChunkVisibility::all();
+  }
+
+  std::array<BlockId, S> blocks = {};
+  for (int x = 0; x < S; x++) {
+    for (int z = 0; z < S; z++) {
+      chunk.getColumn(x, z, blocks.data());
+      std::uint32_t open = 0;
+      for (int y = 0; y < S; y++) {
+        open |= static_cast<std::uint32_t>(!block::isOpaque(blocks[y])) << y;
+      }
+      mOpen[column(x, z)] = open;
+    }
+  }
+  std::fill(mVisited.begin(), mVisited.end(), 0);
+
+  ChunkVisibility visibility;
+  for (int x = 0; x < S; x++) {
+    for (int z = 0; z < S; z++) {
+      // side columns touch a face with every block, inner ones only at the
+      // top and bottom
+      bool side = x == 0 || x == S - 1 || z == 0 || z == S - 1;
+      auto border = side ? ~0u : BORDER_BITS;
+      auto c = column(x, z);
+      for (auto seeds = mOpen[c] & ~mVisited[c] & border; seeds != 0;
+           seeds = mOpen[c] & ~mVisited[c] & border) {
+        visibility.connectAll(fill(c, std::countr_zero(seeds)));
+        if (visibility == ChunkVisibility::all()) {
+          return visibility;
+        }
+      }
+    }
+  }
+  return visibility;
+}
+
+std::uint32_t ChunkVisibilityBuilder::fill(std::uint32_t seedColumn,
+                                           int seedY) {
+  std::uint32_t faces = 0;
+  mStack.clear();
+  mStack.push_back(static_cast<std::uint16_t>(seedColumn * S + seedY));
+
+  while (!mStack.empty()) {
+    std::uint32_t idx = mStack.back();
+    mStack.pop_back();
+    auto c = idx / S;
+    auto y = static_cast<int>(idx % S);
+    if ((mVisited[c] >> y) & 1u) {
+      continue;
+    }
+
+    auto run = runAround(mOpen[c] & ~mVisited[c], y);
+    mVisited[c] |= run;
+
+    int x = static_cast<int>(c / S);
+    int z = static_cast<int>(c % S);
+    faces |= (run & 1u) ? 1u << FACE_NEG_Y : 0u;
+    faces |= (run >> (S - 1)) ? 1u << FACE_POS_Y : 0u;
+    faces |= x == 0 ? 1u << FACE_NEG_X : 0u;
+    faces |= x == S - 1 ? 1u << FACE_POS_X : 0u;
+    faces |= z == 0 ? 1u << FACE_NEG_Z : 0u;
+    faces |= z == S - 1 ? 1u << FACE_POS_Z : 0u;
+
+    auto spread = [&](int nx, int nz) {
+      if (nx < 0 || nx >= S || nz < 0 || nz >= S) {
+        return;
+      }
+      auto n = column(nx, nz);
+      auto reachable = mOpen[n] & ~mVisited[n] & run;
+      // one seed at the bottom of each run, the rest of the run is found
+      // when it is popped
+      for (auto seeds = reachable & ~(reachable << 1); seeds != 0;
+           seeds &= seeds - 1) {
+        mStack.push_back(
+            static_cast<std::uint16_t>(n * S + std::countr_zero(seeds)));
+      }
+    };
+    spread(x - 1, z);
+    spread(x + 1, z);
+    spread(x, z - 1);
+    spread(x, z + 1);
+  }
+  return faces;
+}
+
+} // namespace mv
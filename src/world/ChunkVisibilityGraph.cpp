@@ -0,0 +1,134 @@
+#include "world/ChunkVisibilityGraph.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mv {
+
+void ChunkVisibilityGraph::set(const ChunkCoord &coord,
+                               ChunkVisibility visibility,
+                               std::uint32_t drawIndex) {
+  if (mSections.empty()) {
+    mMin = coord;
+    mMax = coord;
+  } else {
+    mMin = {std::min(mMin.x, coord.x), std::min(mMin.y, coord.y),
+            std::min(mMin.z, coord.z)};
+    mMax = {std::max(mMax.x, coord.x), std::max(mMax.y, coord.y),
+            std::max(mMax.z, coord.z)};
+  }
+  mSections[coord] = {visibility, drawIndex};
+}
+
+void ChunkVisibilityGraph::remove(const ChunkCoord &coord) {
+  mSections.erase(coord);
+}
+
+void ChunkVisibilityGraph::clear() {
+  mSections.clear();
+  mMin = {};
+  mMax = {};
+}
+
+ChunkCoord ChunkVisibilityGraph::sectionAt(const glm::vec3 &position,
+                                           const glm::vec3 &origin) {
+  auto section = (position - origin) / static_cast<float>(Chunk::SIZE);
+  return {static_cast<std::int32_t>(std::floor(section.x)),
+          static_cast<std::int32_t>(std::floor(section.y)),
+          static_cast<std::int32_t>(std::floor(section.z))};
+}
+
+bool ChunkVisibilityGraph::inRegion(const ChunkCoord &coord) const noexcept {
+  return coord.x >= mRegionMin.x && coord.x < mRegionMin.x + mRegionSize.x &&
+         coord.y >= mRegionMin.y && coord.y < mRegionMin.y + mRegionSize.y &&
+         coord.z >= mRegionMin.z && coord.z < mRegionMin.z + mRegionSize.z;
+}
+
+std::size_t
+ChunkVisibilityGraph::regionIndex(const ChunkCoord &coord) const noexcept {
+  auto x = static_cast<std::size_t>(coord.x - mRegionMin.x);
+  auto y = static_cast<std::size_t>(coord.y - mRegionMin.y);
+  auto z = static_cast<std::size_t>(coord.z - mRegionMin.z);
+  return (x * static_cast<std::size_t>(mRegionSize.z) + z) *
+             static_cast<std::size_t>(mRegionSize.y) +
+         y;
+}
+
+void ChunkVisibilityGraph::prepareVisited() {
+  mRegionMin = {mMin.x - 1, mMin.y - 1, mMin.z - 1};
+  mRegionSize = {mMax.x - mMin.x + 3, mMax.y - mMin.y + 3,
+                 mMax.z - mMin.z + 3};
+  auto count = static_cast<std::size_t>(mRegionSize.x) *
+               static_cast<std::size_t>(mRegionSize.y) *
+               static_cast<std::size_t>(mRegionSize.z);
+
+  // stamps from a differently shaped region are meaningless, start over
+  if (mVisited.size() != count || ++mStamp == 0) {
+    mVisited.assign(count, 0);
+    mStamp = 1;
+  }
+}
+
+std::size_t ChunkVisibilityGraph::collectVisible(
+    const ChunkCoord &camera, const Frustum &frustum, const glm::vec3 &origin,
+    std::vector<std::uint32_t> &visible) {
+  visible.clear();
+  mLastVisited = 0;
+  if (mSections.empty()) {
+    return 0;
+  }
+  prepareVisited();
+
+  const ChunkCoord regionMax = {mRegionMin.x + mRegionSize.x - 1,
+                                mRegionMin.y + mRegionSize.y - 1,
+                                mRegionMin.z + mRegionSize.z - 1};
+  ChunkCoord start = {std::clamp(camera.x, mRegionMin.x, regionMax.x),
+                      std::clamp(camera.y, mRegionMin.y, regionMax.y),
+                      std::clamp(camera.z, mRegionMin.z, regionMax.z)};
+
+  mQueue.clear();
+  mQueue.push_back({start, FACE_COUNT, 0});
+  mVisited[regionIndex(start)] = mStamp;
+
+  constexpr auto size = static_cast<float>(Chunk::SIZE);
+  for (std::size_t head = 0; head < mQueue.size(); head++) {
+    auto node = mQueue[head];
+    auto visibility = ChunkVisibility::all();
+    if (const auto *section = mSections.find(node.coord)) {
+      visibility = section->visibility;
+      if (section->drawIndex != NO_DRAW) {
+        visible.push_back(section->drawIndex);
+      }
+    }
+
+    auto exits = node.entryFace == FACE_COUNT
+                     ? 0x3fu
+                     : visibility.connections(node.entryFace);
+    for (std::uint32_t face = 0; face < FACE_COUNT; face++) {
+      if (!(exits & (1u << face)) ||
+          (node.directions & (1u << oppositeFace(face)))) {
+        continue;
+      }
+      auto next = neighbourCoord(node.coord, face);
+      if (!inRegion(next)) {
+        continue;
+      }
+      auto &stamp = mVisited[regionIndex(next)];
+      if (stamp == mStamp) {
+        continue;
+      }
+      auto min = glm::vec3(next.x, next.y, next.z) * size + origin;
+      if (!frustum.intersects(min, min + glm::vec3(size))) {
+        continue;
+      }
+      stamp = mStamp;
+      mQueue.push_back(
+          {next, oppositeFace(face), node.directions | (1u << face)});
+    }
+  }
+
+  mLastVisited = mQueue.size();
+  return visible.size();
+}
+
+} // namespace mv
@@ -0,0 +1,53 @@
+#include "world/HeightmapCache.h"
+
+#include <algorithm>
+
+namespace mv {
+
+HeightmapCache::HeightmapCache(std::size_t capacity) : mCapacity{capacity} {
+  mRegions.reserve(capacity + 1);
+}
+
+std::shared_ptr<const HeightRegion> HeightmapCache::find(std::int32_t x,
+                                                         std::int32_t z) {
+  std::lock_guard lock{mMutex};
+  // a few dozen entries, a scan beats hashing
+  auto it = std::find_if(mRegions.begin(), mRegions.end(),
+                         [&](const auto &r) { return r->x == x && r->z == z; });
+  if (it == mRegions.end()) {
+    mMisses++;
+    return nullptr;
+  }
+  mHits++;
+  std::rotate(mRegions.begin(), it, it + 1);
+  return mRegions.front();
+}
+
+std::shared_ptr<const HeightRegion>
+HeightmapCache::insert(std::shared_ptr<const HeightRegion> region) {
+  std::lock_guard lock{mMutex};
+  auto it = std::find_if(mRegions.begin(), mRegions.end(), [&](const auto &r) {
+    return r->x == region->x && r->z == region->z;
+  });
+  if (it != mRegions.end()) {
+    std::rotate(mRegions.begin(), it, it + 1);
+    return mRegions.front();
+  }
+  mRegions.insert(mRegions.begin(), region);
+  if (mRegions.size() > mCapacity) {
+    mRegions.pop_back();
+  }
+  return region;
+}
+
+std::uint64_t HeightmapCache::hits() const {
+  std::lock_guard lock{mMutex};
+  return mHits;
+}
+
+std::uint64_t HeightmapCache::misses() const {
+  std::lock_guard lock{mMutex};
+  return mMisses;
+}
+
+} // namespace mv
@@ -0,0 +1,272 @@
+#include "world/RegionFile.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace mv {
+
+namespace {
+constexpr std::uint32_t WORD_BITS = 64;
+} // namespace
+
+bool RegionFile::open(const std::string &path) {
+  close();
+  mPath = path;
+  std::error_code error;
+  auto size = std::filesystem::file_size(path, error);
+  std::vector<std::uint32_t> dropped;
+  bool ok = error || size == 0 ? create() : load(dropped);
+  if (ok) {
+    mStream.open(path, std::ios_base::in | std::ios_base::out |
+                           std::ios_base::binary);
+    ok = mStream.is_open();
+  }
+  // dropped entries are cleared on disk before their sectors can be handed
+  // out again, or they would claim them back on the next open
+  for (std::size_t i = 0; ok && i < dropped.size(); i++) {
+    ok = writeEntry(dropped[i], {});
+  }
+  if (!ok) {
+    WLOG("Failed to open region file {}", path);
+    close();
+  }
+  return ok;
+}
+
+void RegionFile::close() {
+  mStream.close();
+  mMapping.close();
+  mMappingStale = true;
+  mEntries = {};
+  mUsed.clear();
+  mSectorCount = 0;
+}
+
+bool RegionFile::contains(int x, int z) const noexcept {
+  return mEntries[entryIndex(x, z)].sector != 0;
+}
+
+RegionFile::Payload RegionFile::read(int x, int z) {
+  const auto &entry = mEntries[entryIndex(x, z)];
+  if (entry.sector == 0) {
+    return {};
+  }
+  if (mMappingStale) {
+    mStream.flush();
+    if (!mMapping.open(mPath)) {
+      ELOG("Failed to map region file {}", mPath);
+      return {};
+    }
+    mMappingStale = false;
+  }
+  return {mMapping.data() + std::uint64_t{entry.sector} * SECTOR_SIZE,
+          entry.length, entry.timestamp};
+}
+
+bool RegionFile::write(int x, int z, const void *data, std::size_t size,
+                       std::int64_t timestamp) {
+  if (size == 0) {
+    return erase(x, z);
+  }
+  if (size > std::numeric_limits<std::uint32_t>::max()) {
+    ELOG("Column payload of {} bytes does not fit a region file", size);
+    return false;
+  }
+  // the file may grow, which a live mapping can prevent
+  mMapping.close();
+  mMappingStale = true;
+
+  auto index = entryIndex(x, z);
+  auto count = sectorsFor(size);
+  auto first = allocate(count);
+  static const char padding[SECTOR_SIZE] = {};
+  mStream.seekp(
+      static_cast<std::streamoff>(std::uint64_t{first} * SECTOR_SIZE));
+  mStream.write(static_cast<const char *>(data),
+                static_cast<std::streamsize>(size));
+  mStream.write(padding, static_cast<std::streamsize>(
+                             std::uint64_t{count} * SECTOR_SIZE - size));
+  // the payload goes out before the entry pointing at it
+  mStream.flush();
+  Entry entry = {first, static_cast<std::uint32_t>(size), timestamp};
+  if (!mStream.good() || !writeEntry(index, entry)) {
+    WLOG("Failed to write column {}, {} to region file {}", x, z, mPath);
+    mStream.clear();
+    markSectors(first, count, false);
+    return false;
+  }
+
+  auto old = mEntries[index];
+  mEntries[index] = entry;
+  if (old.sector != 0) {
+    markSectors(old.sector, sectorsFor(old.length), false);
+  }
+  return true;
+}
+
+bool RegionFile::erase(int x, int z) {
+  auto index = entryIndex(x, z);
+  auto old = mEntries[index];
+  if (old.sector == 0) {
+    return true;
+  }
+  mMapping.close();
+  mMappingStale = true;
+  if (!writeEntry(index, {})) {
+    WLOG("Failed to erase column {}, {} from region file {}", x, z, mPath);
+    mStream.clear();
+    return false;
+  }
+  mEntries[index] = {};
+  markSectors(old.sector, sectorsFor(old.length), false);
+  return true;
+}
+
+std::uint32_t RegionFile::freeSectorCount() const noexcept {
+  std::uint32_t used = 0;
+  for (auto word : mUsed) {
+    used += static_cast<std::uint32_t>(std::popcount(word));
+  }
+  return mSectorCount - used;
+}
+
+std::int32_t RegionFile::region(std::int32_t column) noexcept {
+  return column / COLUMNS - (column % COLUMNS < 0 ? 1 : 0);
+}
+
+int RegionFile::local(std::int32_t column) noexcept {
+  return static_cast<int>(column - region(column) * COLUMNS);
+}
+
+std::string RegionFile::fileName(std::int32_t regionX, std::int32_t regionZ) {
+  return "r." + std::to_string(regionX) + "." + std::to_string(regionZ) +
+         EXTENSION;
+}
+
+std::uint32_t RegionFile::entryIndex(int x, int z) noexcept {
+  assert(x >= 0 && x < COLUMNS && z >= 0 && z < COLUMNS);
+  return static_cast<std::uint32_t>(x * COLUMNS + z);
+}
+
+bool RegionFile::create() {
+  std::ofstream file{mPath, std::ios_base::binary | std::ios_base::trunc};
+  Header header = {};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  std::vector<char> zeros(HEADER_SECTORS * SECTOR_SIZE - sizeof(header));
+  file.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+  file.flush();
+  if (!file.good()) {
+    return false;
+  }
+  mSectorCount = HEADER_SECTORS;
+  mUsed.assign((mSectorCount + WORD_BITS - 1) / WORD_BITS, 0);
+  markSectors(0, HEADER_SECTORS, true);
+  return true;
+}
+
+bool RegionFile::load(std::vector<std::uint32_t> &dropped) {
+  if (!mMapping.open(mPath) ||
+      mMapping.size() < std::size_t{HEADER_SECTORS} * SECTOR_SIZE) {
+    WLOG("Region file {} is truncated", mPath);
+    return false;
+  }
+  Header header = {};
+  std::memcpy(&header, mMapping.data(), sizeof(header));
+  const Header expected = {};
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.version != expected.version ||
+      header.columns != expected.columns ||
+      header.sectorSize != expected.sectorSize) {
+    WLOG("{} is not a region file or has an old version", mPath);
+    return false;
+  }
+  std::memcpy(mEntries.data(), mMapping.data() + sizeof(header),
+              sizeof(mEntries));
+
+  // a torn append leaves a partial sector at the end, nothing points there
+  mSectorCount = static_cast<std::uint32_t>(mMapping.size() / SECTOR_SIZE);
+  mUsed.assign((mSectorCount + WORD_BITS - 1) / WORD_BITS, 0);
+  markSectors(0, HEADER_SECTORS, true);
+  for (std::uint32_t i = 0; i < ENTRY_COUNT; i++) {
+    auto &entry = mEntries[i];
+    if (entry.sector == 0) {
+      continue;
+    }
+    auto count = sectorsFor(entry.length);
+    bool valid = entry.length > 0 && entry.sector >= HEADER_SECTORS &&
+                 std::uint64_t{entry.sector} + count <= mSectorCount;
+    for (auto s = entry.sector; valid && s < entry.sector + count; s++) {
+      valid = !isUsed(s);
+    }
+    if (!valid) {
+      entry = {};
+      dropped.push_back(i);
+      continue;
+    }
+    markSectors(entry.sector, count, true);
+  }
+  if (!dropped.empty()) {
+    WLOG("Dropped {} columns with bad entries from region file {}",
+         dropped.size(), mPath);
+  }
+  mMappingStale = false;
+  return true;
+}
+
+std::uint32_t RegionFile::allocate(std::uint32_t count) {
+  // first fit; runs of used sectors are skipped a word at a time
+  std::uint32_t start = 0;
+  std::uint32_t run = 0;
+  for (std::uint32_t s = 0; s < mSectorCount && run < count;) {
+    if (run == 0 && s % WORD_BITS == 0 && mUsed[s / WORD_BITS] == ~0ull) {
+      s += WORD_BITS;
+      continue;
+    }
+    if (isUsed(s)) {
+      run = 0;
+    } else if (run++ == 0) {
+      start = s;
+    }
+    s++;
+  }
+  // no gap is large enough: continue the free sectors at the end, if any
+  if (run == 0) {
+    start = mSectorCount;
+  }
+  mSectorCount = std::max(mSectorCount, start + count);
+  mUsed.resize((mSectorCount + WORD_BITS - 1) / WORD_BITS);
+  markSectors(start, count, true);
+  return start;
+}
+
+void RegionFile::markSectors(std::uint32_t first, std::uint32_t count,
+                             bool used) {
+  for (auto s = first; s < first + count; s++) {
+    auto bit = 1ull << (s % WORD_BITS);
+    if (used) {
+      mUsed[s / WORD_BITS] |= bit;
+    } else {
+      mUsed[s / WORD_BITS] &= ~bit;
+    }
+  }
+}
+
+bool RegionFile::isUsed(std::uint32_t sector) const noexcept {
+  return (mUsed[sector / WORD_BITS] >> (sector % WORD_BITS)) & 1u;
+}
+
+bool RegionFile::writeEntry(std::uint32_t index, const Entry &entry) {
+  mStream.seekp(
+      static_cast<std::streamoff>(sizeof(Header) + index * sizeof(Entry)));
+  mStream.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+  mStream.flush();
+  return mStream.good();
+}
+
+} // namespace mv
@@ -0,0 +1,606 @@
+#include "world/TerrainGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace mv {
+
+namespace {
+// heights: BASE_HEIGHT +- CONTINENT_AMPLITUDE, plus up to HILL_AMPLITUDE in
+// the hills; the density noise moves the ground up to OVERHANG_* blocks
+constexpr float BASE_HEIGHT = 56.0f;
+constexpr float CONTINENT_AMPLITUDE = 16.0f;
+constexpr float HILL_AMPLITUDE = 28.0f;
+constexpr float OVERHANG_LOW = 3.0f;
+constexpr float OVERHANG_HIGH = 10.0f;
+// the overhang amplitude blends from low to high over this height range
+constexpr float OVERHANG_BLEND_START = 64.0f;
+constexpr float OVERHANG_BLEND_RANGE = 24.0f;
+constexpr int MIN_HEIGHT = 8;
+// room above the highest ground for overhangs and trees
+constexpr int MAX_HEIGHT = ChunkColumn::HEIGHT - 20;
+
+// hill biome weight ramps from 0 to 1 over this band of the biome noise
+constexpr float HILL_BIOME_START = 0.1f;
+constexpr float HILL_BIOME_RANGE = 0.3f;
+constexpr float FOREST_THRESHOLD = 0.15f;
+
+// two noise fields near zero at once trace tunnels
+constexpr float CAVE_RADIUS = 0.015f;
+// caves never open into the bottom layers
+constexpr int CAVE_FLOOR = 4;
+constexpr int DIRT_DEPTH = 3;
+
+// DensitySampling::Interpolated cell size; the density varies much faster
+// along y than across
+constexpr int CELL_XZ = 4;
+constexpr int CELL_Y = 8;
+// cave cells reaching this far below the lowest ground in them are sampled
+// at every block, interpolated tunnels would open new holes in the surface
+constexpr float CAVE_SURFACE_DEPTH = 8.0f;
+
+// one tree candidate per TREE_CELL^2 blocks; trunks sit at least
+// TREE_RADIUS inside their cell so canopies never overlap
+constexpr int TREE_CELL = 8;
+constexpr int TREE_RADIUS = 2;
+constexpr int TREE_MIN_TRUNK = 4;
+constexpr int TREE_TRUNK_VARIATION = 3;
+// candidates out of 256 that grow a tree, per Biome
+constexpr std::uint32_t TREE_CHANCE[] = {10, 110, 30};
+
+// one column in RUIN_RARITY holds a ruin of (2 * RUIN_HALF + 1)^2 blocks
+constexpr std::uint32_t RUIN_RARITY = 24;
+constexpr int RUIN_HALF = 3;
+constexpr int RUIN_MAX_WALL = 4;
+// air cleared above the ruin's floor
+constexpr int RUIN_CLEARANCE = 6;
+
+// salts keep the feature hashes of one position independent
+constexpr std::uint32_t SALT_TREE = 0x9e3779b9u;
+constexpr std::uint32_t SALT_RUIN = 0x85ebca6bu;
+constexpr std::uint32_t SALT_WALL = 0xc2b2ae35u;
+
+std::uint32_t featureHash(std::int32_t seed, std::int32_t x, std::int32_t z,
+                          std::uint32_t salt) {
+  auto h = static_cast<std::uint32_t>(seed) ^ salt;
+  h ^= static_cast<std::uint32_t>(x) * 0x27d4eb2du;
+  h ^= static_cast<std::uint32_t>(z) * 0x165667b1u;
+  // murmur3 finalizer
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+float overhangAmplitude(float height) {
+  auto t = std::clamp((height - OVERHANG_BLEND_START) / OVERHANG_BLEND_RANGE,
+                      0.0f, 1.0f);
+  return OVERHANG_LOW + (OVERHANG_HIGH - OVERHANG_LOW) * t;
+}
+
+glm::vec2 columnOrigin(const ChunkColumn &column) {
+  return {static_cast<float>(column.x * Chunk::SIZE),
+          static_cast<float>(column.z * Chunk::SIZE)};
+}
+
+std::int32_t floorDiv(std::int32_t a, std::int32_t b) {
+  return a / b - (a % b < 0 ? 1 : 0);
+}
+
+float lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+template <typename Grid>
+void sample(const noise::NoiseSettings &settings, const Grid &grid,
+            std::vector<float> &out, TerrainScratch &scratch) {
+  noise::generate(settings, grid, out);
+  scratch.noiseSamples += grid.size();
+}
+
+// Noise at the corners of cellXZ x cellY x cellXZ block cells covering one
+// section, far faces included; cells of one block sample every block.
+struct Lattice {
+  int cellXZ = {1};
+  int cellY = {1};
+
+  int sizeXZ() const noexcept { return Chunk::SIZE / cellXZ + 1; }
+  int sizeY() const noexcept { return Chunk::SIZE / cellY + 1; }
+  int cellsXZ() const noexcept { return Chunk::SIZE / cellXZ; }
+  int cellsY() const noexcept { return Chunk::SIZE / cellY; }
+
+  noise::Grid3 grid(const ChunkColumn &column, int section) const {
+    auto origin = columnOrigin(column);
+    return {{origin.x, static_cast<float>(section * Chunk::SIZE), origin.y},
+            {static_cast<float>(cellXZ), static_cast<float>(cellY),
+             static_cast<float>(cellXZ)},
+            static_cast<std::uint32_t>(sizeXZ()),
+            static_cast<std::uint32_t>(sizeY()),
+            static_cast<std::uint32_t>(sizeXZ())};
+  }
+
+  // corners of cell (cx, cy, cz) at dx * 4 + dz * 2 + dy
+  void corners(const std::vector<float> &values, int cx, int cy, int cz,
+               float out[8]) const {
+    for (int dx = 0; dx < 2; dx++) {
+      for (int dz = 0; dz < 2; dz++) {
+        auto row = static_cast<std::size_t>(((cx + dx) * sizeXZ() + cz + dz) *
+                                            sizeY());
+        out[dx * 4 + dz * 2] = values[row + cy];
+        out[dx * 4 + dz * 2 + 1] = values[row + cy + 1];
+      }
+    }
+  }
+
+  // the noise at every block of cell (cx, cy, cz) of the section sampled by
+  // grid, laid out like interpolate(); a cell of one block is its corner
+  void exact(const noise::NoiseSettings &settings, const noise::Grid3 &grid,
+             int cx, int cy, int cz, const float c[8], float *out,
+             TerrainScratch &scratch) const {
+    if (cellXZ == 1 && cellY == 1) {
+      out[0] = c[0];
+      return;
+    }
+    auto offset = glm::vec3{static_cast<float>(cx * cellXZ),
+                            static_cast<float>(cy * cellY),
+                            static_cast<float>(cz * cellXZ)};
+    noise::Grid3 cell = {grid.origin + offset,
+                         {1.0f, 1.0f, 1.0f},
+                         static_cast<std::uint32_t>(cellXZ),
+                         static_cast<std::uint32_t>(cellY),
+                         static_cast<std::uint32_t>(cellXZ)};
+    sample(settings, cell, scratch.c, scratch);
+    std::copy(scratch.c.begin(), scratch.c.end(), out);
+  }
+
+  // the cell's blocks at (x * cellXZ + z) * cellY + y
+  void interpolate(const float c[8], float *out) const {
+    auto stepXZ = 1.0f / static_cast<float>(cellXZ);
+    auto stepY = 1.0f / static_cast<float>(cellY);
+    for (int x = 0; x < cellXZ; x++) {
+      auto tx = static_cast<float>(x) * stepXZ;
+      for (int z = 0; z < cellXZ; z++) {
+        auto tz = static_cast<float>(z) * stepXZ;
+        auto lower = lerp(lerp(c[0], c[2], tz), lerp(c[4], c[6], tz), tx);
+        auto upper = lerp(lerp(c[1], c[3], tz), lerp(c[5], c[7], tz), tx);
+        for (int y = 0; y < cellY; y++) {
+          *out++ = lerp(lower, upper, static_cast<float>(y) * stepY);
+        }
+      }
+    }
+  }
+};
+
+constexpr int MAX_CELL_VOLUME = CELL_XZ * CELL_Y * CELL_XZ;
+
+Lattice latticeFor(DensitySampling sampling) {
+  if (sampling == DensitySampling::Full) {
+    return {1, 1};
+  }
+  return {CELL_XZ, CELL_Y};
+}
+
+// interpolated values never leave the range of the corners
+std::pair<float, float> cornerRange(const float c[8]) {
+  auto [low, high] = std::minmax_element(c, c + 8);
+  return {*low, *high};
+}
+
+// lowest and highest terrain height over the block columns of cell (cx, cz)
+std::pair<float, float> heightRange(const ChunkColumn &column,
+                                    const Lattice &lattice, int cx, int cz) {
+  auto low = std::numeric_limits<float>::max();
+  auto high = std::numeric_limits<float>::lowest();
+  for (int x = cx * lattice.cellXZ; x < (cx + 1) * lattice.cellXZ; x++) {
+    for (int z = cz * lattice.cellXZ; z < (cz + 1) * lattice.cellXZ; z++) {
+      auto h =
+          static_cast<float>(column.heights[ChunkColumn::columnIndex(x, z)]);
+      low = std::min(low, h);
+      high = std::max(high, h);
+    }
+  }
+  return {low, high};
+}
+} // namespace
+
+TerrainGenerator::TerrainGenerator(std::int32_t seed,
+                                   DensitySampling sampling)
+    : mSeed{seed}, mSampling{sampling} {
+  using noise::FractalType;
+  using noise::NoiseType;
+  mContinents = {NoiseType::OpenSimplex2, FractalType::Fbm, seed, 1.0f / 384.0f,
+                 4, 2.0f, 0.5f};
+  mHills = {NoiseType::OpenSimplex2, FractalType::Ridged, seed + 16,
+            1.0f / 160.0f, 3, 2.0f, 0.5f};
+  mHillBiome = {NoiseType::OpenSimplex2, FractalType::None, seed + 32,
+                1.0f / 600.0f};
+  mForestBiome = {NoiseType::OpenSimplex2, FractalType::None, seed + 48,
+                  1.0f / 400.0f};
+  mDensity = {NoiseType::OpenSimplex2, FractalType::Fbm, seed + 64,
+              1.0f / 48.0f, 2, 2.0f, 0.5f};
+  mCaveA = {NoiseType::OpenSimplex2, FractalType::None, seed + 80,
+            1.0f / 48.0f};
+  mCaveB = {NoiseType::OpenSimplex2, FractalType::None, seed + 96,
+            1.0f / 48.0f};
+}
+
+void TerrainGenerator::run(GenStage stage, ChunkColumn &column,
+                           const ColumnNeighbourhood &neighbourhood,
+                           TerrainScratch &scratch) const {
+  switch (stage) {
+  case GenStage::Biome:
+    biomes(column, scratch);
+    break;
+  case GenStage::Terrain:
+    terrain(column, scratch);
+    break;
+  case GenStage::Caves:
+    caves(column, scratch);
+    break;
+  case GenStage::Surface:
+    surface(column);
+    break;
+  case GenStage::Decoration:
+    decorate(column, neighbourhood);
+    break;
+  case GenStage::Structures:
+    structures(column, neighbourhood);
+    break;
+  default:
+    break;
+  }
+}
+
+std::shared_ptr<const HeightRegion>
+TerrainGenerator::region(std::int32_t x, std::int32_t z,
+                         TerrainScratch &scratch) const {
+  if (auto cached = mHeightmaps.find(x, z)) {
+    return cached;
+  }
+  auto region = std::make_shared<HeightRegion>();
+  region->x = x;
+  region->z = z;
+  noise::Grid2 grid = {{static_cast<float>(x * HeightRegion::SIZE),
+                        static_cast<float>(z * HeightRegion::SIZE)},
+                       {1.0f, 1.0f},
+                       HeightRegion::SIZE,
+                       HeightRegion::SIZE};
+  sample(mContinents, grid, scratch.a, scratch);
+  sample(mHills, grid, scratch.b, scratch);
+  sample(mHillBiome, grid, scratch.c, scratch);
+
+  for (std::uint32_t i = 0; i < HeightRegion::AREA; i++) {
+    auto hillWeight = std::clamp(
+        (scratch.c[i] - HILL_BIOME_START) / HILL_BIOME_RANGE, 0.0f, 1.0f);
+    auto height = BASE_HEIGHT + scratch.a[i] * CONTINENT_AMPLITUDE +
+                  hillWeight * (scratch.b[i] + 1.0f) * 0.5f * HILL_AMPLITUDE;
+    region->heights[i] = static_cast<std::int16_t>(
+        std::clamp(static_cast<int>(height), MIN_HEIGHT, MAX_HEIGHT));
+    region->biomes[i] = hillWeight > 0.5f ? Biome::Hills : Biome::Plains;
+  }
+
+  sample(mForestBiome, grid, scratch.c, scratch);
+  for (std::uint32_t i = 0; i < HeightRegion::AREA; i++) {
+    if (region->biomes[i] == Biome::Plains && scratch.c[i] > FOREST_THRESHOLD) {
+      region->biomes[i] = Biome::Forest;
+    }
+  }
+  return mHeightmaps.insert(std::move(region));
+}
+
+void TerrainGenerator::biomes(ChunkColumn &column,
+                              TerrainScratch &scratch) const {
+  auto rx = floorDiv(column.x, HeightRegion::COLUMNS);
+  auto rz = floorDiv(column.z, HeightRegion::COLUMNS);
+  auto source = region(rx, rz, scratch);
+  auto ox = (column.x - rx * HeightRegion::COLUMNS) * Chunk::SIZE;
+  auto oz = (column.z - rz * HeightRegion::COLUMNS) * Chunk::SIZE;
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    auto row = source->heights.begin() + HeightRegion::index(ox + x, oz);
+    std::copy(row, row + Chunk::SIZE,
+              column.heights.begin() + ChunkColumn::columnIndex(x, 0));
+    auto biomes = source->biomes.begin() + HeightRegion::index(ox + x, oz);
+    std::copy(biomes, biomes + Chunk::SIZE,
+              column.biomes.begin() + ChunkColumn::columnIndex(x, 0));
+  }
+}
+
+void TerrainGenerator::terrain(ChunkColumn &column,
+                               TerrainScratch &scratch) const {
+  auto [low, high] =
+      std::minmax_element(column.heights.begin(), column.heights.end());
+  // sections wholly above or below what the overhangs can reach need no noise
+  auto solidBelow = static_cast<int>(*low - OVERHANG_HIGH);
+  auto airAbove = static_cast<int>(*high + OVERHANG_HIGH);
+
+  auto lattice = latticeFor(mSampling);
+  float cell[MAX_CELL_VOLUME];
+  for (int s = 0; s < ChunkColumn::SECTIONS; s++) {
+    auto &section = column.sections[s];
+    int bottom = s * Chunk::SIZE;
+    if (bottom > airAbove) {
+      continue;
+    }
+    if (bottom + Chunk::SIZE <= solidBelow) {
+      section.fill(block::STONE);
+      continue;
+    }
+
+    auto grid = lattice.grid(column, s);
+    sample(mDensity, grid, scratch.a, scratch);
+    for (int cx = 0; cx < lattice.cellsXZ(); cx++) {
+      for (int cz = 0; cz < lattice.cellsXZ(); cz++) {
+        int x0 = cx * lattice.cellXZ;
+        int z0 = cz * lattice.cellXZ;
+        auto [cellLow, cellHigh] = heightRange(column, lattice, cx, cz);
+        auto amplitudeLow = overhangAmplitude(cellLow);
+        auto amplitudeHigh = overhangAmplitude(cellHigh);
+
+        for (int cy = 0; cy < lattice.cellsY(); cy++) {
+          int y0 = cy * lattice.cellY;
+          float corners[8];
+          lattice.corners(scratch.a, cx, cy, cz, corners);
+          // bound the density over the whole cell; only cells it may cross
+          // zero in need the noise per block, and those hold the ground's
+          // edge, so they get it exact rather than interpolated
+          auto [noiseLow, noiseHigh] = cornerRange(corners);
+          auto densityLow =
+              cellLow - static_cast<float>(bottom + y0 + lattice.cellY - 1) +
+              std::min(noiseLow * amplitudeLow, noiseLow * amplitudeHigh);
+          auto densityHigh =
+              cellHigh - static_cast<float>(bottom + y0) +
+              std::max(noiseHigh * amplitudeLow, noiseHigh * amplitudeHigh);
+          if (densityHigh <= 0.0f) {
+            continue;
+          }
+          bool solid = densityLow > 0.0f;
+          if (!solid) {
+            lattice.exact(mDensity, grid, cx, cy, cz, corners, cell, scratch);
+          }
+          const float *n = cell;
+          for (int x = x0; x < x0 + lattice.cellXZ; x++) {
+            for (int z = z0; z < z0 + lattice.cellXZ; z++) {
+              auto height = static_cast<float>(
+                  column.heights[ChunkColumn::columnIndex(x, z)]);
+              auto amplitude = overhangAmplitude(height);
+              for (int y = y0; y < y0 + lattice.cellY; y++, n++) {
+                if (solid || height - static_cast<float>(bottom + y) +
+                                     *n * amplitude >
+                                 0.0f) {
+                  section.set(Chunk::index(x, y, z), block::STONE);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void TerrainGenerator::caves(ChunkColumn &column,
+                             TerrainScratch &scratch) const {
+  // a tunnel needs both fields within this of zero
+  auto reach = std::sqrt(CAVE_RADIUS);
+  auto lattice = latticeFor(mSampling);
+  float cellA[MAX_CELL_VOLUME];
+  float cellB[MAX_CELL_VOLUME];
+  for (int s = 0; s < ChunkColumn::SECTIONS; s++) {
+    auto &section = column.sections[s];
+    if (section.isEmpty()) {
+      continue;
+    }
+    auto grid = lattice.grid(column, s);
+    sample(mCaveA, grid, scratch.a, scratch);
+    sample(mCaveB, grid, scratch.b, scratch);
+    int bottom = s * Chunk::SIZE;
+    for (int cx = 0; cx < lattice.cellsXZ(); cx++) {
+      for (int cz = 0; cz < lattice.cellsXZ(); cz++) {
+        auto [cellLow, cellHigh] = heightRange(column, lattice, cx, cz);
+        for (int cy = 0; cy < lattice.cellsY(); cy++) {
+          float cornersA[8];
+          float cornersB[8];
+          lattice.corners(scratch.a, cx, cy, cz, cornersA);
+          lattice.corners(scratch.b, cx, cy, cz, cornersB);
+          auto [lowA, highA] = cornerRange(cornersA);
+          auto [lowB, highB] = cornerRange(cornersB);
+          if (lowA >= reach || highA <= -reach || lowB >= reach ||
+              highB <= -reach) {
+            continue;
+          }
+          auto cellBottom = static_cast<float>(bottom + cy * lattice.cellY);
+          if (cellBottom + static_cast<float>(lattice.cellY) >
+                  cellLow - OVERHANG_HIGH - CAVE_SURFACE_DEPTH &&
+              cellBottom <= cellHigh + OVERHANG_HIGH) {
+            lattice.exact(mCaveA, grid, cx, cy, cz, cornersA, cellA, scratch);
+            lattice.exact(mCaveB, grid, cx, cy, cz, cornersB, cellB, scratch);
+          } else {
+            lattice.interpolate(cornersA, cellA);
+            lattice.interpolate(cornersB, cellB);
+          }
+
+          int x0 = cx * lattice.cellXZ;
+          int y0 = cy * lattice.cellY;
+          int z0 = cz * lattice.cellXZ;
+          int i = 0;
+          for (int x = x0; x < x0 + lattice.cellXZ; x++) {
+            for (int z = z0; z < z0 + lattice.cellXZ; z++) {
+              for (int y = y0; y < y0 + lattice.cellY; y++, i++) {
+                auto a = cellA[i];
+                auto b = cellB[i];
+                if (a * a + b * b >= CAVE_RADIUS || bottom + y < CAVE_FLOOR) {
+                  continue;
+                }
+                auto idx = Chunk::index(x, y, z);
+                if (section.get(idx) != block::AIR) {
+                  section.set(idx, block::AIR);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    section.compact();
+  }
+}
+
+void TerrainGenerator::surface(ChunkColumn &column) const {
+  column.surface.fill(ChunkColumn::NO_SURFACE);
+  // start at the top of the highest section holding anything
+  int top = -1;
+  for (int s = ChunkColumn::SECTIONS - 1; s >= 0; s--) {
+    if (!column.sections[s].isEmpty()) {
+      top = (s + 1) * Chunk::SIZE - 1;
+      break;
+    }
+  }
+
+  for (int x = 0; x < Chunk::SIZE; x++) {
+    for (int z = 0; z < Chunk::SIZE; z++) {
+      int y = top;
+      while (y >= 0 && column.get(x, y, z) == block::AIR) {
+        y--;
+      }
+      if (y < 0) {
+        continue;
+      }
+      column.surface[ChunkColumn::columnIndex(x, z)] =
+          static_cast<std::int16_t>(y);
+      column.set(x, y, z, block::GRASS);
+      for (int depth = 1; depth <= DIRT_DEPTH && y - depth >= 0; depth++) {
+        if (column.get(x, y - depth, z) == block::AIR) {
+          break;
+        }
+        column.set(x, y - depth, z, block::DIRT);
+      }
+    }
+  }
+}
+
+void TerrainGenerator::decorate(
+    ChunkColumn &column, const ColumnNeighbourhood &neighbourhood) const {
+  constexpr int CELLS = Chunk::SIZE / TREE_CELL;
+  constexpr int SPREAD = TREE_CELL - 2 * TREE_RADIUS;
+  auto put = [&column](int x, int y, int z, BlockId id) {
+    if (x < 0 || x >= Chunk::SIZE || z < 0 || z >= Chunk::SIZE || y < 0 ||
+        y >= ChunkColumn::HEIGHT) {
+      return;
+    }
+    auto current = column.get(x, y, z);
+    if (current == block::AIR ||
+        (id == block::LOG && current == block::LEAVES)) {
+      column.set(x, y, z, id);
+    }
+  };
+
+  for (int dx = -1; dx <= 1; dx++) {
+    for (int dz = -1; dz <= 1; dz++) {
+      const auto *source = neighbourhood[(dx + 1) * 3 + dz + 1];
+      assert(source != nullptr);
+      for (int cx = 0; cx < CELLS; cx++) {
+        for (int cz = 0; cz < CELLS; cz++) {
+          // trees of the source column in this column's coordinates
+          int x = cx * TREE_CELL + TREE_RADIUS;
+          int z = cz * TREE_CELL + TREE_RADIUS;
+          auto h = featureHash(mSeed, source->x * Chunk::SIZE + x,
+                               source->z * Chunk::SIZE + z, SALT_TREE);
+          x += static_cast<int>((h >> 8) % SPREAD);
+          z += static_cast<int>((h >> 12) % SPREAD);
+          auto idx = ChunkColumn::columnIndex(x, z);
+          auto ground = source->surface[idx];
+          auto biome = static_cast<std::uint32_t>(source->biomes[idx]);
+          if ((h & 0xff) >= TREE_CHANCE[biome] ||
+              ground == ChunkColumn::NO_SURFACE) {
+            continue;
+          }
+          x += dx * Chunk::SIZE;
+          z += dz * Chunk::SIZE;
+          if (x + TREE_RADIUS < 0 || x - TREE_RADIUS >= Chunk::SIZE ||
+              z + TREE_RADIUS < 0 || z - TREE_RADIUS >= Chunk::SIZE) {
+            continue;
+          }
+
+          int top = ground + TREE_MIN_TRUNK +
+                    static_cast<int>((h >> 16) % TREE_TRUNK_VARIATION);
+          for (int y = top - 2; y <= top + 1; y++) {
+            int radius = y < top ? TREE_RADIUS : 1;
+            for (int ox = -radius; ox <= radius; ox++) {
+              for (int oz = -radius; oz <= radius; oz++) {
+                // rounded canopy, the top layer is a cross
+                bool corner = std::abs(ox) == radius && std::abs(oz) == radius;
+                if (!corner || (radius == TREE_RADIUS && ((h >> 20) & 1))) {
+                  put(x + ox, y, z + oz, block::LEAVES);
+                }
+              }
+            }
+          }
+          for (int y = ground + 1; y <= top; y++) {
+            put(x, y, z, block::LOG);
+          }
+        }
+      }
+    }
+  }
+}
+
+void TerrainGenerator::structures(
+    ChunkColumn &column, const ColumnNeighbourhood &neighbourhood) const {
+  constexpr int SPREAD = Chunk::SIZE - 2 * (RUIN_HALF + 1);
+  for (int dx = -1; dx <= 1; dx++) {
+    for (int dz = -1; dz <= 1; dz++) {
+      const auto *source = neighbourhood[(dx + 1) * 3 + dz + 1];
+      assert(source != nullptr);
+      auto h = featureHash(mSeed, source->x, source->z, SALT_RUIN);
+      if (h % RUIN_RARITY != 0) {
+        continue;
+      }
+      int cx = RUIN_HALF + 1 + static_cast<int>((h >> 8) % SPREAD);
+      int cz = RUIN_HALF + 1 + static_cast<int>((h >> 16) % SPREAD);
+      auto centre = ChunkColumn::columnIndex(cx, cz);
+      // ruins sit on the ground at their centre, which may lie in a
+      // neighbour; forests have no room for them
+      int floor = source->surface[centre];
+      if (floor == ChunkColumn::NO_SURFACE ||
+          source->biomes[centre] == Biome::Forest) {
+        continue;
+      }
+      cx += dx * Chunk::SIZE;
+      cz += dz * Chunk::SIZE;
+
+      for (int ox = -RUIN_HALF; ox <= RUIN_HALF; ox++) {
+        for (int oz = -RUIN_HALF; oz <= RUIN_HALF; oz++) {
+          int x = cx + ox;
+          int z = cz + oz;
+          if (x < 0 || x >= Chunk::SIZE || z < 0 || z >= Chunk::SIZE) {
+            continue;
+          }
+          // foundation down to the ground where it is lower than the floor
+          int ground = column.surface[ChunkColumn::columnIndex(x, z)];
+          for (int y = std::max(ground + 1, 0); y < floor; y++) {
+            column.set(x, y, z, block::STONE);
+          }
+          column.set(x, floor, z, block::STONE);
+
+          bool wall = std::abs(ox) == RUIN_HALF || std::abs(oz) == RUIN_HALF;
+          int wallHeight =
+              wall ? static_cast<int>(
+                         featureHash(mSeed, column.x * Chunk::SIZE + x,
+                                     column.z * Chunk::SIZE + z, SALT_WALL) %
+                         RUIN_MAX_WALL)
+                   : 0;
+          for (int y = floor + 1;
+               y <= floor + RUIN_CLEARANCE && y < ChunkColumn::HEIGHT; y++) {
+            column.set(x, y, z,
+                       y <= floor + wallHeight ? block::STONE : block::AIR);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace mv
@@ -0,0 +1,162 @@
+#include "world/WorldGenerator.h"
+
+#include "Log.h"
+
+namespace mv {
+
+WorldGenerator::WorldGenerator(JobSystem &jobs, std::int32_t seed)
+    : mJobs{jobs}, mTerrain{seed}, mScratch(jobs.threadCount()) {}
+
+WorldGenerator::~WorldGenerator() {
+  for (auto *e : mRunning) {
+    mJobs.wait(e->job);
+  }
+}
+
+void WorldGenerator::request(std::int32_t x, std::int32_t z) {
+  auto &e = entry(x, z);
+  if (e.requested) {
+    return;
+  }
+  e.requested = true;
+  want(e, GenStage::Structures);
+}
+
+void WorldGenerator::update() {
+  std::size_t running = 0;
+  for (auto *e : mRunning) {
+    if (!e->job.done()) {
+      mRunning[running++] = e;
+      continue;
+    }
+    e->stage = e->runningTo;
+    e->running = false;
+    if (e->stage < e->target) {
+      e->queued = true;
+      mPending.push_back(e);
+    } else if (e->requested && e->stage == GenStage::Structures) {
+      mCompleted.push_back(&e->column);
+    }
+  }
+  mRunning.resize(running);
+
+  std::size_t pending = 0;
+  for (auto *e : mPending) {
+    if (canStart(*e)) {
+      e->queued = false;
+      start(*e);
+    } else {
+      mPending[pending++] = e;
+    }
+  }
+  mPending.resize(pending);
+}
+
+void WorldGenerator::finish() {
+  for (;;) {
+    update();
+    if (mRunning.empty()) {
+      break;
+    }
+    mJobs.wait(mRunning.front()->job);
+  }
+  // every pending column waits on a neighbour that is pending or running
+  if (!mPending.empty()) {
+    ELOG("World generation stalled with {} columns pending", mPending.size());
+  }
+}
+
+void WorldGenerator::takeCompleted(std::vector<const ChunkColumn *> &out) {
+  out.insert(out.end(), mCompleted.begin(), mCompleted.end());
+  mCompleted.clear();
+}
+
+const ChunkColumn *WorldGenerator::find(std::int32_t x, std::int32_t z) const {
+  const auto *e = mColumns.find(ChunkCoord{x, 0, z});
+  if (e == nullptr || (*e)->stage != GenStage::Structures) {
+    return nullptr;
+  }
+  return &(*e)->column;
+}
+
+WorldGenerator::Entry &WorldGenerator::entry(std::int32_t x, std::int32_t z) {
+  auto [e, inserted] = mColumns.emplace(ChunkCoord{x, 0, z}, nullptr);
+  if (inserted) {
+    *e = std::make_unique<Entry>();
+    (*e)->column.x = x;
+    (*e)->column.z = z;
+  }
+  return **e;
+}
+
+void WorldGenerator::want(Entry &e, GenStage stage) {
+  if (stage <= e.target) {
+    return;
+  }
+  // the last newly wanted stage that reads neighbours decides how far they
+  // have to get
+  auto neighbours = GenStage::None;
+  for (auto s = nextStage(e.target); s <= stage; s = nextStage(s)) {
+    if (TerrainGenerator::needsNeighbours(s)) {
+      neighbours = static_cast<GenStage>(static_cast<std::uint8_t>(s) - 1);
+    }
+  }
+  e.target = stage;
+  if (!e.queued && !e.running) {
+    e.queued = true;
+    mPending.push_back(&e);
+  }
+
+  if (neighbours == GenStage::None) {
+    return;
+  }
+  auto x = e.column.x;
+  auto z = e.column.z;
+  for (std::int32_t dx = -1; dx <= 1; dx++) {
+    for (std::int32_t dz = -1; dz <= 1; dz++) {
+      if (dx != 0 || dz != 0) {
+        want(entry(x + dx, z + dz), neighbours);
+      }
+    }
+  }
+}
+
+bool WorldGenerator::canStart(Entry &e) {
+  auto next = nextStage(e.stage);
+  if (!TerrainGenerator::needsNeighbours(next)) {
+    return true;
+  }
+  for (std::int32_t dx = -1; dx <= 1; dx++) {
+    for (std::int32_t dz = -1; dz <= 1; dz++) {
+      auto *n = mColumns.find(ChunkCoord{e.column.x + dx, 0, e.column.z + dz});
+      if (n == nullptr || (*n)->stage < e.stage) {
+        return false;
+      }
+      e.neighbourhood[(dx + 1) * 3 + dz + 1] = &(*n)->column;
+    }
+  }
+  return true;
+}
+
+void WorldGenerator::start(Entry &e) {
+  // stages that stay inside the column share one job
+  e.runningTo = nextStage(e.stage);
+  while (e.runningTo < e.target &&
+         !TerrainGenerator::needsNeighbours(nextStage(e.runningTo))) {
+    e.runningTo = nextStage(e.runningTo);
+  }
+  e.running = true;
+  mRunning.push_back(&e);
+  mJobs.run([this, &e] { runStages(e); }, &e.job);
+}
+
+void WorldGenerator::runStages(Entry &e) {
+  auto &scratch = mScratch[mJobs.threadIndex()];
+  auto stage = e.stage;
+  do {
+    stage = nextStage(stage);
+    mTerrain.run(stage, e.column, e.neighbourhood, scratch);
+  } while (stage < e.runningTo);
+}
+
+} // namespace mv